@@ -0,0 +1,5 @@
+-- Moldova Insight Realty MVP - price_history upsert support
+
+-- The aggregation engine materializes one row per district, room count and
+-- month, and upserts on this key when recomputing dirty months
+CREATE UNIQUE INDEX idx_price_history_series_month ON price_history(district_id, room_count, date);
@@ -0,0 +1,8 @@
+-- Moldova Insight Realty MVP - per-model price predictions
+
+-- The prediction job stores the forecasts of every registered model along
+-- with its walk-forward error; readers pick the lowest backtest_mape
+ALTER TABLE price_predictions ADD COLUMN backtest_mape DECIMAL(7,3);
+
+CREATE UNIQUE INDEX idx_price_predictions_series_model
+    ON price_predictions(district_id, room_count, prediction_date, algorithm);
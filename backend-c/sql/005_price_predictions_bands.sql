@@ -0,0 +1,8 @@
+-- Moldova Insight Realty MVP - prediction intervals
+
+-- Residual bootstrap percentiles of the predicted price per sqm; only the
+-- model served for a series has them
+ALTER TABLE price_predictions
+    ADD COLUMN predicted_p10 INTEGER,
+    ADD COLUMN predicted_p50 INTEGER,
+    ADD COLUMN predicted_p90 INTEGER;
@@ -0,0 +1,16 @@
+-- Moldova Insight Realty MVP - saved-search notifications
+
+-- One row per listing that newly matches a saved search; filled in
+-- batches by the saved-search matcher after every listing refresh
+CREATE TABLE user_notifications (
+    id BIGSERIAL PRIMARY KEY,
+    user_id INTEGER REFERENCES users(id) ON DELETE CASCADE,
+    saved_search_id INTEGER REFERENCES user_saved_searches(id) ON DELETE CASCADE,
+    property_id INTEGER REFERENCES properties(id) ON DELETE CASCADE,
+    reason VARCHAR(20) NOT NULL,  -- new_listing or now_matching
+    created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
+    read_at TIMESTAMP,
+    UNIQUE (saved_search_id, property_id)
+);
+
+CREATE INDEX idx_user_notifications_user ON user_notifications(user_id, created_at DESC);
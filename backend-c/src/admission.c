@@ -0,0 +1,111 @@
+#include "include/admission.h"
+#include "include/utils.h"
+#include <string.h>
+#include <netinet/in.h>
+#include <stdatomic.h>
+
+#define MILLI 1000ULL   // Tokens are kept in thousandths
+
+// Token bucket: high 32 bits the last refill (monotonic ms, wrapping),
+// low 32 bits the tokens left in thousandths. 0 is a bucket never used.
+static _Atomic uint64_t buckets[ADMISSION_BUCKETS];
+
+static unsigned int rate = ADMISSION_DEFAULT_RATE;
+static unsigned int burst = ADMISSION_DEFAULT_BURST;
+static unsigned int max_in_flight = ADMISSION_DEFAULT_MAX_IN_FLIGHT;
+
+static atomic_int in_flight = 0;
+static atomic_uint_fast64_t admitted = 0;
+static atomic_uint_fast64_t rate_limited = 0;
+static atomic_uint_fast64_t shed = 0;
+static atomic_uint_fast64_t deadline_exceeded = 0;
+
+void admission_configure(unsigned int new_rate, unsigned int new_burst, unsigned int new_max_in_flight) {
+    rate = new_rate > 1000000 ? 1000000 : new_rate;
+    // Thousandths of the bucket must fit in 32 bits
+    burst = new_burst == 0 ? 1 : (new_burst > 1000000 ? 1000000 : new_burst);
+    max_in_flight = new_max_in_flight;
+}
+
+// FNV-1a over the address bytes that identify a client
+static size_t bucket_of(const struct sockaddr* addr) {
+    const unsigned char* bytes = NULL;
+    size_t length = 0;
+    if (addr->sa_family == AF_INET) {
+        bytes = (const unsigned char*) &((const struct sockaddr_in*) addr)->sin_addr;
+        length = 4;
+    } else if (addr->sa_family == AF_INET6) {
+        // One client usually owns a whole /64
+        bytes = (const unsigned char*) &((const struct sockaddr_in6*) addr)->sin6_addr;
+        length = 8;
+    }
+    uint64_t hash = 14695981039346656037ULL ^ (uint64_t) addr->sa_family;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return (size_t) (hash & (ADMISSION_BUCKETS - 1));
+}
+
+int admission_check_rate(const struct sockaddr* addr, unsigned int* retry_after_s) {
+    if (rate == 0 || addr == NULL) {
+        return ADMISSION_OK;
+    }
+    _Atomic uint64_t* bucket = &buckets[bucket_of(addr)];
+    uint32_t now = (uint32_t) monotonic_ms();
+    uint64_t capacity = burst * MILLI;
+
+    uint64_t old = atomic_load_explicit(bucket, memory_order_relaxed);
+    for (;;) {
+        uint64_t tokens = capacity;
+        if (old != 0) {
+            uint32_t elapsed = now - (uint32_t) (old >> 32);
+            tokens = (old & 0xffffffffULL) + (uint64_t) elapsed * rate;   // rate tokens/s = thousandths/ms
+            if (tokens > capacity) {
+                tokens = capacity;
+            }
+        }
+        if (tokens < MILLI) {
+            atomic_fetch_add(&rate_limited, 1);
+            uint64_t wait_ms = (MILLI - tokens + rate - 1) / rate;
+            *retry_after_s = (unsigned int) ((wait_ms + 999) / 1000);
+            return ADMISSION_RATE_LIMITED;
+        }
+        uint64_t next = ((uint64_t) now << 32) | (tokens - MILLI);
+        if (next == 0) {
+            next = 1;   // Keep "never used" distinct
+        }
+        if (atomic_compare_exchange_weak_explicit(bucket, &old, next, memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+            return ADMISSION_OK;
+        }
+    }
+}
+
+int admission_enter(void) {
+    int running = atomic_fetch_add(&in_flight, 1) + 1;
+    if (max_in_flight > 0 && running > (int) max_in_flight) {
+        atomic_fetch_sub(&in_flight, 1);
+        atomic_fetch_add(&shed, 1);
+        return ADMISSION_OVERLOADED;
+    }
+    atomic_fetch_add(&admitted, 1);
+    return ADMISSION_OK;
+}
+
+void admission_leave(void) {
+    atomic_fetch_sub(&in_flight, 1);
+}
+
+void admission_record_deadline_exceeded(void) {
+    atomic_fetch_add(&deadline_exceeded, 1);
+}
+
+void admission_get_stats(admission_stats_t* out) {
+    memset(out, 0, sizeof(*out));
+    out->admitted = atomic_load(&admitted);
+    out->rate_limited = atomic_load(&rate_limited);
+    out->shed = atomic_load(&shed);
+    out->deadline_exceeded = atomic_load(&deadline_exceeded);
+    int running = atomic_load(&in_flight);
+    out->in_flight = running > 0 ? (size_t) running : 0;
+}
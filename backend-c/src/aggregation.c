@@ -0,0 +1,464 @@
+#include "include/aggregation.h"
+#include "include/parallel.h"
+#include "include/db.h"
+#include "include/utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#define MONTH_WORDS (AGGREGATION_MAX_MONTHS / 64)
+
+// Months touched by ingest since the last run
+static atomic_uint_fast64_t dirty_months[MONTH_WORDS];
+
+// Materialized view of price_history, sorted by (district, rooms, month)
+static pthread_rwlock_t view_lock = PTHREAD_RWLOCK_INITIALIZER;
+static price_history_row_t* view_rows = NULL;
+static size_t view_count = 0;
+
+// Open-addressing accumulator keyed by packed (district, rooms, month)
+typedef struct {
+    uint64_t* keys;
+    double* sums;
+    int* counts;
+    size_t capacity;
+    size_t size;
+} group_table_t;
+
+typedef struct {
+    const property_t* listings;
+    const uint64_t* month_mask;
+    group_table_t* tables;
+    atomic_int failed;
+} group_by_job_t;
+
+static uint64_t group_key(int district_id, int room_count, int month) {
+    return ((uint64_t) (uint32_t) district_id << 32) | ((uint64_t) room_count << 16) | (uint64_t) month;
+}
+
+static int group_table_init(group_table_t* t, size_t capacity) {
+    t->keys = calloc(capacity, sizeof(uint64_t));
+    t->sums = malloc(capacity * sizeof(double));
+    t->counts = malloc(capacity * sizeof(int));
+    t->capacity = capacity;
+    t->size = 0;
+    return (t->keys && t->sums && t->counts) ? 0 : 1;
+}
+
+static void group_table_free(group_table_t* t) {
+    free(t->keys);
+    free(t->sums);
+    free(t->counts);
+    memset(t, 0, sizeof(*t));
+}
+
+static size_t group_slot(const group_table_t* t, uint64_t key) {
+    size_t slot = (size_t) ((key * 0x9E3779B97F4A7C15ull) >> 20) & (t->capacity - 1);
+    while (t->keys[slot] != 0 && t->keys[slot] != key) {
+        slot = (slot + 1) & (t->capacity - 1);
+    }
+    return slot;
+}
+
+static int group_table_add(group_table_t* t, uint64_t key, double sum, int count);
+
+static int group_table_grow(group_table_t* t) {
+    group_table_t grown;
+    if (group_table_init(&grown, t->capacity * 2) != 0) {
+        group_table_free(&grown);
+        return 1;
+    }
+    for (size_t i = 0; i < t->capacity; i++) {
+        if (t->keys[i] != 0) {
+            group_table_add(&grown, t->keys[i], t->sums[i], t->counts[i]);
+        }
+    }
+    group_table_free(t);
+    *t = grown;
+    return 0;
+}
+
+static int group_table_add(group_table_t* t, uint64_t key, double sum, int count) {
+    if ((t->size + 1) * 2 > t->capacity && group_table_grow(t) != 0) {
+        return 1;
+    }
+    size_t slot = group_slot(t, key);
+    if (t->keys[slot] == 0) {
+        t->keys[slot] = key;
+        t->sums[slot] = 0.0;
+        t->counts[slot] = 0;
+        t->size++;
+    }
+    t->sums[slot] += sum;
+    t->counts[slot] += count;
+    return 0;
+}
+
+static int month_in_mask(const uint64_t* mask, int month) {
+    if (month < 0 || month >= AGGREGATION_MAX_MONTHS) {
+        return 0;
+    }
+    return mask == NULL || (mask[month / 64] >> (month % 64)) & 1u;
+}
+
+static void group_by_task(size_t begin, size_t end, int worker, void* ctx) {
+    group_by_job_t* job = ctx;
+    group_table_t* table = &job->tables[worker];
+
+    for (size_t i = begin; i < end; i++) {
+        const property_t* p = &job->listings[i];
+        if (p->area_sqm <= 0 || p->price <= 0 || p->district_id <= 0 ||
+            p->num_rooms < 0 || p->num_rooms > 0xFFFF || !month_in_mask(job->month_mask, p->month_listed)) {
+            continue;
+        }
+        double price_per_sqm = (double) p->price / (double) p->area_sqm;
+        if (group_table_add(table, group_key(p->district_id, p->num_rooms, p->month_listed), price_per_sqm, 1) != 0) {
+            job->failed = 1;
+            return;
+        }
+    }
+}
+
+static int compare_rows(const void* a, const void* b) {
+    const price_history_row_t* x = a;
+    const price_history_row_t* y = b;
+    if (x->district_id != y->district_id) return x->district_id < y->district_id ? -1 : 1;
+    if (x->room_count != y->room_count) return x->room_count < y->room_count ? -1 : 1;
+    if (x->month != y->month) return x->month < y->month ? -1 : 1;
+    return 0;
+}
+
+int aggregation_group_by(const property_t* listings, size_t count, const uint64_t* month_mask,
+                         int workers, price_history_row_t** out_rows, size_t* out_count) {
+    *out_rows = NULL;
+    *out_count = 0;
+
+    if (workers <= 0) {
+        workers = parallel_default_workers();
+    }
+
+    group_by_job_t job = { .listings = listings, .month_mask = month_mask, .failed = 0 };
+    job.tables = calloc((size_t) workers, sizeof(group_table_t));
+    if (job.tables == NULL) {
+        return 1;
+    }
+    for (int w = 0; w < workers; w++) {
+        if (group_table_init(&job.tables[w], 256) != 0) {
+            job.failed = 1;
+        }
+    }
+
+    // A run whose workers never started has counted nothing; its empty
+    // result must not pass for fresh months, which would be persisted
+    if (!job.failed && parallel_for(count, 0, workers, group_by_task, &job) < 0) {
+        job.failed = 1;
+    }
+
+    // Merge the partial tables into the first one
+    group_table_t* merged = &job.tables[0];
+    for (int w = 1; w < workers && !job.failed; w++) {
+        group_table_t* part = &job.tables[w];
+        for (size_t i = 0; i < part->capacity; i++) {
+            if (part->keys[i] != 0 && group_table_add(merged, part->keys[i], part->sums[i], part->counts[i]) != 0) {
+                job.failed = 1;
+                break;
+            }
+        }
+    }
+
+    price_history_row_t* result = NULL;
+    size_t n = 0;
+    if (!job.failed && merged->size > 0) {
+        result = malloc(sizeof(price_history_row_t) * merged->size);
+        if (result == NULL) {
+            job.failed = 1;
+        } else {
+            for (size_t i = 0; i < merged->capacity; i++) {
+                if (merged->keys[i] == 0) {
+                    continue;
+                }
+                uint64_t key = merged->keys[i];
+                result[n].district_id = (int) (key >> 32);
+                result[n].room_count = (int) ((key >> 16) & 0xFFFF);
+                result[n].month = (int) (key & 0xFFFF);
+                result[n].avg_price_per_sqm = merged->sums[i] / merged->counts[i];
+                result[n].sample_size = merged->counts[i];
+                n++;
+            }
+            qsort(result, n, sizeof(price_history_row_t), compare_rows);
+        }
+    }
+
+    for (int w = 0; w < workers; w++) {
+        group_table_free(&job.tables[w]);
+    }
+    free(job.tables);
+
+    if (job.failed) {
+        free(result);
+        return 1;
+    }
+    *out_rows = result;
+    *out_count = n;
+    return 0;
+}
+
+void aggregation_mark_dirty(int month) {
+    if (month < 0 || month >= AGGREGATION_MAX_MONTHS) {
+        return;
+    }
+    atomic_fetch_or_explicit(&dirty_months[month / 64], (uint_fast64_t) 1 << (month % 64), memory_order_relaxed);
+}
+
+// Listing ingest hook: a change can move a listing between groups, so
+// both the old and the new month are recomputed
+static void aggregation_on_ingest(const property_t* previous, const property_t* current, void* ctx) {
+    (void) ctx;
+    if (previous != NULL) {
+        if (previous->district_id == current->district_id && previous->num_rooms == current->num_rooms &&
+            previous->area_sqm == current->area_sqm && previous->price == current->price &&
+            previous->month_listed == current->month_listed) {
+            return; // Status-only change, aggregates are unaffected
+        }
+        aggregation_mark_dirty(previous->month_listed);
+    }
+    aggregation_mark_dirty(current->month_listed);
+}
+
+void aggregation_init(void) {
+    properties_register_ingest_hook(aggregation_on_ingest, NULL);
+}
+
+int aggregation_load(PGconn* conn) {
+    static const char* sql =
+        "SELECT district_id, room_count, to_char(date, 'YYYY-MM-DD'), avg_price_per_sqm, COALESCE(sample_size, 0) "
+        "FROM price_history WHERE district_id IS NOT NULL AND room_count IS NOT NULL "
+        "ORDER BY district_id, room_count, date";
+
+    PGresult* res = db_query_params(conn, sql, 0, NULL);
+    if (res == NULL) {
+        return -1;
+    }
+
+    int n = PQntuples(res);
+    price_history_row_t* loaded = n > 0 ? malloc(sizeof(price_history_row_t) * (size_t) n) : NULL;
+    if (n > 0 && loaded == NULL) {
+        PQclear(res);
+        return -1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        loaded[i].district_id = atoi(PQgetvalue(res, i, 0));
+        loaded[i].room_count = atoi(PQgetvalue(res, i, 1));
+        loaded[i].month = month_index_from_date(PQgetvalue(res, i, 2));
+        loaded[i].avg_price_per_sqm = atof(PQgetvalue(res, i, 3));
+        loaded[i].sample_size = atoi(PQgetvalue(res, i, 4));
+    }
+    PQclear(res);
+
+    pthread_rwlock_wrlock(&view_lock);
+    free(view_rows);
+    view_rows = loaded;
+    view_count = (size_t) n;
+    pthread_rwlock_unlock(&view_lock);
+
+    return n;
+}
+
+// Upsert the fresh rows for the dirty months and delete groups that have
+// disappeared from those months, in a single statement
+static int aggregation_persist(PGconn* conn, const price_history_row_t* fresh, size_t fresh_count,
+                               const uint64_t* mask) {
+    static const char* sql =
+        "WITH fresh AS ("
+        "  SELECT * FROM unnest($1::int[], $2::int[], $3::date[], $4::int[], $5::int[]) "
+        "  AS f(district_id, room_count, date, avg_price_per_sqm, sample_size)"
+        "), upserted AS ("
+        "  INSERT INTO price_history (district_id, room_count, date, avg_price_per_sqm, sample_size) "
+        "  SELECT district_id, room_count, date, avg_price_per_sqm, sample_size FROM fresh "
+        "  ON CONFLICT (district_id, room_count, date) DO UPDATE "
+        "  SET avg_price_per_sqm = EXCLUDED.avg_price_per_sqm, sample_size = EXCLUDED.sample_size "
+        "  RETURNING 1"
+        ") "
+        "DELETE FROM price_history ph WHERE ph.date = ANY($6::date[]) "
+        "AND NOT EXISTS (SELECT 1 FROM fresh f WHERE f.district_id = ph.district_id "
+        "AND f.room_count = ph.room_count AND f.date = ph.date)";
+
+    string_buffer_t districts, rooms, dates, prices, samples, months;
+    string_buffer_init(&districts);
+    string_buffer_init(&rooms);
+    string_buffer_init(&dates);
+    string_buffer_init(&prices);
+    string_buffer_init(&samples);
+    string_buffer_init(&months);
+
+    char date_str[16];
+    string_buffer_append(&districts, "{", 1);
+    string_buffer_append(&rooms, "{", 1);
+    string_buffer_append(&dates, "{", 1);
+    string_buffer_append(&prices, "{", 1);
+    string_buffer_append(&samples, "{", 1);
+    for (size_t i = 0; i < fresh_count; i++) {
+        const char* sep = i > 0 ? "," : "";
+        month_index_to_date(fresh[i].month, date_str, sizeof(date_str));
+        string_buffer_appendf(&districts, "%s%d", sep, fresh[i].district_id);
+        string_buffer_appendf(&rooms, "%s%d", sep, fresh[i].room_count);
+        string_buffer_appendf(&dates, "%s%s", sep, date_str);
+        string_buffer_appendf(&prices, "%s%ld", sep, lround(fresh[i].avg_price_per_sqm));
+        string_buffer_appendf(&samples, "%s%d", sep, fresh[i].sample_size);
+    }
+    string_buffer_append(&districts, "}", 1);
+    string_buffer_append(&rooms, "}", 1);
+    string_buffer_append(&dates, "}", 1);
+    string_buffer_append(&prices, "}", 1);
+    string_buffer_append(&samples, "}", 1);
+
+    string_buffer_append(&months, "{", 1);
+    int first = 1;
+    for (int m = 0; m < AGGREGATION_MAX_MONTHS; m++) {
+        if (month_in_mask(mask, m)) {
+            month_index_to_date(m, date_str, sizeof(date_str));
+            string_buffer_appendf(&months, "%s%s", first ? "" : ",", date_str);
+            first = 0;
+        }
+    }
+    string_buffer_append(&months, "}", 1);
+
+    const char* params[6] = { districts.data, rooms.data, dates.data, prices.data, samples.data, months.data };
+    int rc = db_exec_params(conn, sql, 6, params);
+
+    string_buffer_free(&districts);
+    string_buffer_free(&rooms);
+    string_buffer_free(&dates);
+    string_buffer_free(&prices);
+    string_buffer_free(&samples);
+    string_buffer_free(&months);
+    return rc;
+}
+
+// Replace the dirty months of the in-memory view with the fresh rows
+static int aggregation_merge_view(const price_history_row_t* fresh, size_t fresh_count, const uint64_t* mask) {
+    pthread_rwlock_wrlock(&view_lock);
+
+    price_history_row_t* merged = malloc(sizeof(price_history_row_t) * (view_count + fresh_count + 1));
+    if (merged == NULL) {
+        pthread_rwlock_unlock(&view_lock);
+        return 1;
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i < view_count; i++) {
+        if (!month_in_mask(mask, view_rows[i].month)) {
+            merged[n++] = view_rows[i];
+        }
+    }
+    memcpy(merged + n, fresh, sizeof(price_history_row_t) * fresh_count);
+    n += fresh_count;
+    qsort(merged, n, sizeof(price_history_row_t), compare_rows);
+
+    free(view_rows);
+    view_rows = merged;
+    view_count = n;
+    pthread_rwlock_unlock(&view_lock);
+    return 0;
+}
+
+int aggregation_run(PGconn* conn, int workers) {
+    uint64_t mask[MONTH_WORDS];
+    int dirty = 0;
+    for (int i = 0; i < MONTH_WORDS; i++) {
+        mask[i] = (uint64_t) atomic_exchange_explicit(&dirty_months[i], 0, memory_order_acq_rel);
+        dirty += __builtin_popcountll(mask[i]);
+    }
+    if (dirty == 0) {
+        return 0;
+    }
+
+    size_t listing_count = 0;
+    price_history_row_t* fresh = NULL;
+    size_t fresh_count = 0;
+
+    const property_t* listings = properties_acquire(&listing_count);
+    int rc = aggregation_group_by(listings, listing_count, mask, workers, &fresh, &fresh_count);
+    properties_release();
+
+    if (rc == 0 && conn != NULL) {
+        rc = aggregation_persist(conn, fresh, fresh_count, mask);
+    }
+    if (rc == 0) {
+        rc = aggregation_merge_view(fresh, fresh_count, mask);
+    }
+    free(fresh);
+
+    if (rc != 0) {
+        // Keep the months dirty so the next run retries them
+        for (int i = 0; i < MONTH_WORDS; i++) {
+            atomic_fetch_or_explicit(&dirty_months[i], mask[i], memory_order_relaxed);
+        }
+        return -1;
+    }
+
+    printf("Aggregation recomputed %d month(s), %zu price_history row(s)\n", dirty, fresh_count);
+    return dirty;
+}
+
+price_history_row_t* aggregation_get_series(int district_id, int room_count, int months, int* out_count) {
+    *out_count = 0;
+    if (months <= 0) {
+        return NULL;
+    }
+
+    pthread_rwlock_rdlock(&view_lock);
+
+    // Binary search for the first row of the series
+    size_t lo = 0, hi = view_count;
+    price_history_row_t probe = { .district_id = district_id, .room_count = room_count, .month = -1 };
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (compare_rows(&view_rows[mid], &probe) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    size_t end = lo;
+    while (end < view_count && view_rows[end].district_id == district_id && view_rows[end].room_count == room_count) {
+        end++;
+    }
+
+    size_t n = end - lo;
+    if (n > (size_t) months) {
+        lo = end - (size_t) months;
+        n = (size_t) months;
+    }
+
+    price_history_row_t* series = NULL;
+    if (n > 0) {
+        series = malloc(sizeof(price_history_row_t) * n);
+        if (series != NULL) {
+            memcpy(series, view_rows + lo, sizeof(price_history_row_t) * n);
+            *out_count = (int) n;
+        }
+    }
+
+    pthread_rwlock_unlock(&view_lock);
+    return series;
+}
+
+price_history_row_t* aggregation_snapshot(size_t* out_count) {
+    pthread_rwlock_rdlock(&view_lock);
+    price_history_row_t* copy = NULL;
+    *out_count = 0;
+    if (view_count > 0) {
+        copy = malloc(sizeof(price_history_row_t) * view_count);
+        if (copy != NULL) {
+            memcpy(copy, view_rows, sizeof(price_history_row_t) * view_count);
+            *out_count = view_count;
+        }
+    }
+    pthread_rwlock_unlock(&view_lock);
+    return copy;
+}
@@ -3,81 +3,130 @@
 #include "include/districts.h"
 #include "include/auth.h"
 #include "include/user_dashboard.h"
+#include "include/user_writes.h"
+#include "include/db.h"
 #include "include/prediction.h"
+#include "include/valuation.h"
+#include "include/comparables.h"
+#include "include/investment.h"
+#include "include/district_stats.h"
+#include "include/event_stream.h"
+#include "include/singleflight.h"
+#include "include/admission.h"
+#include "include/supervisor.h"
+#include "include/utils.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <microhttpd.h>
 #include <jansson.h>
 
 // Global server instance
 static struct MHD_Daemon* http_daemon = NULL;
 
+// Set once the server stops accepting; responses then close their
+// connection so clients reconnect to a server that still accepts
+static atomic_int draining = 0;
+
+#define DRAIN_QUIET_MS 500    // No request in flight for this long ends a drain
+
 // API route definitions
 static api_route_t routes[] = {
     // Property routes
-    {"/api/properties", METHOD_GET, properties_get_all},
-    {"/api/properties/:id", METHOD_GET, properties_get_by_id},
+    { .path = "/api/properties", .method = METHOD_GET, .handler = properties_get_all },
+    { .path = "/api/properties/:id", .method = METHOD_GET, .handler = properties_get_by_id, .deadline_ms = 2000 },
+    { .path = "/api/properties/:id/valuation", .method = METHOD_GET, .handler = properties_get_valuation },
+    { .path = "/api/properties/:id/comparables", .method = METHOD_GET, .handler = properties_get_comparables },
+    { .path = "/api/properties/:id/investment", .method = METHOD_GET, .handler = properties_get_investment },
+    
+    // Investment routes
+    { .path = "/api/investment/rankings", .method = METHOD_GET, .handler = investment_get_rankings },
     
     // District routes
-    {"/api/districts", METHOD_GET, districts_get_all},
-    {"/api/districts/:id", METHOD_GET, districts_get_by_id},
-    {"/api/districts/:id/properties", METHOD_GET, districts_get_properties},
+    { .path = "/api/districts", .method = METHOD_GET, .handler = districts_get_all },
+    { .path = "/api/districts/:id", .method = METHOD_GET, .handler = districts_get_by_id, .deadline_ms = 2000 },
+    { .path = "/api/districts/:id/properties", .method = METHOD_GET, .handler = districts_get_properties },
+    { .path = "/api/districts/:id/stats", .method = METHOD_GET, .handler = districts_get_stats },
     
     // Price trends and predictions
-    {"/api/trends", METHOD_GET, price_get_trends},
-    {"/api/predictions", METHOD_GET, price_get_predictions},
+    { .path = "/api/trends", .method = METHOD_GET, .handler = price_get_trends, .deadline_ms = 2000 },
+    { .path = "/api/predictions", .method = METHOD_GET, .handler = price_get_predictions },
     
     // Auth routes
-    {"/api/auth/login", METHOD_POST, auth_login},
-    {"/api/auth/register", METHOD_POST, auth_register},
+    { .path = "/api/auth/login", .method = METHOD_POST, .handler = auth_login },
+    { .path = "/api/auth/register", .method = METHOD_POST, .handler = auth_register },
+    { .path = "/api/auth/logout", .method = METHOD_POST, .handler = auth_logout },
+
+    // Admission, deadline and coalescing counters
+    { .path = "/api/metrics", .method = METHOD_GET, .handler = metrics_get },
     
-    // User dashboard routes
-    {"/api/user/saved-properties", METHOD_GET, user_get_saved_properties},
-    {"/api/user/saved-properties", METHOD_POST, user_save_property},
-    {"/api/user/saved-properties/:id", METHOD_DELETE, user_unsave_property},
-    {"/api/user/saved-searches", METHOD_GET, user_get_saved_searches},
-    {"/api/user/saved-searches", METHOD_POST, user_save_search},
-    {"/api/user/saved-searches/:id", METHOD_DELETE, user_delete_saved_search}
+    // User dashboard routes (token required)
+    { .path = "/api/user/dashboard", .method = METHOD_GET, .user_handler = user_get_dashboard },
+    { .path = "/api/user/saved-properties", .method = METHOD_GET, .user_handler = user_get_saved_properties },
+    { .path = "/api/user/saved-properties", .method = METHOD_POST, .user_handler = user_save_property },
+    { .path = "/api/user/saved-properties/:id", .method = METHOD_DELETE, .user_handler = user_unsave_property },
+    { .path = "/api/user/saved-searches", .method = METHOD_GET, .user_handler = user_get_saved_searches },
+    { .path = "/api/user/saved-searches", .method = METHOD_POST, .user_handler = user_save_search },
+    { .path = "/api/user/saved-searches/:id", .method = METHOD_DELETE, .user_handler = user_delete_saved_search }
 };
 
 // Number of routes
 static const size_t route_count = sizeof(routes) / sizeof(routes[0]);
 
-// Helper function to match URL pattern with route path
+// Match a URL against a route path segment by segment; ":name"
+// segments match any value, which is copied to the next free `params`
+// slot. Repeated and trailing slashes are ignored. Nothing is left in
+// `params` when the path does not match.
 static int match_route(const char* url, const char* pattern, char** params) {
-    // Simple matching logic - can be enhanced for more complex routes
-    char url_copy[256];
-    char pattern_copy[256];
-    strncpy(url_copy, url, sizeof(url_copy) - 1);
-    strncpy(pattern_copy, pattern, sizeof(pattern_copy) - 1);
-    
-    char* url_token = strtok(url_copy, "/");
-    char* pattern_token = strtok(pattern_copy, "/");
-    
-    int param_index = 0;
-    
-    while (url_token != NULL && pattern_token != NULL) {
-        // If pattern token starts with ':', it's a parameter
-        if (pattern_token[0] == ':') {
+    int param_count = 0;
+    int matched = 1;
+    for (;;) {
+        url += strspn(url, "/");
+        pattern += strspn(pattern, "/");
+        if (*url == '\0' || *pattern == '\0') {
+            matched = *url == '\0' && *pattern == '\0';
+            break;
+        }
+        size_t url_length = strcspn(url, "/");
+        size_t pattern_length = strcspn(pattern, "/");
+        if (pattern[0] == ':') {
             if (params != NULL) {
-                params[param_index++] = strdup(url_token);
+                if (param_count == API_MAX_ROUTE_PARAMS) {
+                    matched = 0;
+                    break;
+                }
+                params[param_count++] = strndup(url, url_length);
             }
-        } else if (strcmp(url_token, pattern_token) != 0) {
-            return 0; // Mismatch
+        } else if (url_length != pattern_length || strncmp(url, pattern, url_length) != 0) {
+            matched = 0;
+            break;
         }
-        
-        url_token = strtok(NULL, "/");
-        pattern_token = strtok(NULL, "/");
+        url += url_length;
+        pattern += pattern_length;
     }
-    
-    // If both are NULL, it's a complete match
-    return (url_token == NULL && pattern_token == NULL);
+
+    if (!matched && params != NULL) {
+        for (int i = 0; i < param_count; i++) {
+            free(params[i]);
+            params[i] = NULL;
+        }
+    }
+    return matched;
+}
+
+const api_route_t* api_routes(size_t* out_count) {
+    *out_count = route_count;
+    return routes;
 }
 
-// Helper to find route handler
-static route_handler_func find_route_handler(const char* url, const char* method_str, char** params) {
+const api_route_t* api_find_route(const char* url, const char* method_str, char** params) {
     http_method_t method;
     
     // Convert method string to enum
@@ -96,65 +145,271 @@ static route_handler_func find_route_handler(const char* url, const char* method
     // Find matching route
     for (size_t i = 0; i < route_count; i++) {
         if (routes[i].method == method && match_route(url, routes[i].path, params)) {
-            return routes[i].handler;
+            return &routes[i];
         }
     }
     
     return NULL; // No matching route
 }
 
+#define EVENT_STREAM_BLOCK_SIZE (32 * 1024)
+
+// MHD content reader for /api/stream: blocks in its connection's thread
+// until events arrive, writing a keep-alive comment on each heartbeat
+static ssize_t event_stream_reader(void* cls, uint64_t pos, char* buf, size_t max) {
+    (void) pos;
+    ssize_t n = event_stream_read(cls, buf, max, EVENT_STREAM_HEARTBEAT_MS);
+    return n > 0 ? n : MHD_CONTENT_READER_END_OF_STREAM;
+}
+
+static void event_stream_reader_free(void* cls) {
+    event_stream_unsubscribe(cls);
+}
+
+// GET /api/stream: Server-Sent Events change feed. Query params: types
+// (comma-separated listing, status, prediction), last_event_id (also
+// taken from the Last-Event-ID header sent by reconnecting clients)
+static int serve_event_stream(struct MHD_Connection* connection) {
+    const char* types = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "types");
+    const char* last_id = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, "Last-Event-ID");
+    if (last_id == NULL) {
+        last_id = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "last_event_id");
+    }
+
+    const char* error = NULL;
+    unsigned int status = 400;
+    unsigned mask = STREAM_EVENT_ALL;
+    if (types != NULL && (mask = event_stream_parse_types(types)) == 0) {
+        error = "{\"error\":\"Unknown event type\"}";
+    }
+    event_subscriber_t* subscriber = NULL;
+    if (error == NULL) {
+        subscriber = event_stream_subscribe(last_id ? strtoull(last_id, NULL, 10) : 0, mask);
+        if (subscriber == NULL) {
+            error = "{\"error\":\"Too many stream subscribers\"}";
+            status = 503;
+        }
+    }
+
+    struct MHD_Response* response;
+    if (error != NULL) {
+        response = MHD_create_response_from_buffer(strlen(error), (void*) error, MHD_RESPMEM_PERSISTENT);
+        MHD_add_response_header(response, "Content-Type", "application/json");
+    } else {
+        response = MHD_create_response_from_callback(MHD_SIZE_UNKNOWN, EVENT_STREAM_BLOCK_SIZE,
+                                                     event_stream_reader, subscriber, event_stream_reader_free);
+        MHD_add_response_header(response, "Content-Type", "text/event-stream");
+        MHD_add_response_header(response, "Cache-Control", "no-cache");
+        MHD_add_response_header(response, "X-Accel-Buffering", "no");
+        status = 200;
+    }
+    MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+    int ret = MHD_queue_response(connection, status, response);
+    MHD_destroy_response(response);
+    return ret;
+}
+
+#define MAX_REQUEST_BODY (1024 * 1024)
+
+// Per-request state kept in con_cls while the body is uploaded
+typedef struct {
+    string_buffer_t body;
+    int too_large;
+    int admitted;            // Counted in flight (see admission.h)
+    long long arrived_ms;    // Route deadlines run from here
+} request_context_t;
+
+// MHD completion callback: frees the request context
+static void api_request_completed(void* cls, struct MHD_Connection* connection, void** con_cls,
+                                  enum MHD_RequestTerminationCode toe) {
+    (void) cls;
+    (void) connection;
+    (void) toe;
+    request_context_t* context = *con_cls;
+    if (context != NULL) {
+        if (context->admitted) {
+            admission_leave();
+        }
+        string_buffer_free(&context->body);
+        free(context);
+        *con_cls = NULL;
+    }
+}
+
+static int queue_static_json(struct MHD_Connection* connection, unsigned int status, const char* body) {
+    struct MHD_Response* response = MHD_create_response_from_buffer(
+        strlen(body), (void*) body, MHD_RESPMEM_PERSISTENT);
+    MHD_add_response_header(response, "Content-Type", "application/json");
+    MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+    int ret = MHD_queue_response(connection, status, response);
+    MHD_destroy_response(response);
+    return ret;
+}
+
+// Turn a request away before any work is done on it
+static int queue_retry_later(struct MHD_Connection* connection, unsigned int status, const char* body,
+                             unsigned int retry_after_s) {
+    char retry_after[16];
+    snprintf(retry_after, sizeof(retry_after), "%u", retry_after_s > 0 ? retry_after_s : 1);
+    struct MHD_Response* response = MHD_create_response_from_buffer(
+        strlen(body), (void*) body, MHD_RESPMEM_PERSISTENT);
+    MHD_add_response_header(response, "Content-Type", "application/json");
+    MHD_add_response_header(response, "Retry-After", retry_after);
+    MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+    int ret = MHD_queue_response(connection, status, response);
+    MHD_destroy_response(response);
+    return ret;
+}
+
+// Admit a new request: the client's rate first, then the in-flight
+// limit (long-lived streams are not counted in flight)
+static int admit_request(struct MHD_Connection* connection, const char* url, const char* method,
+                         request_context_t* context) {
+    const union MHD_ConnectionInfo* info = MHD_get_connection_info(connection, MHD_CONNECTION_INFO_CLIENT_ADDRESS);
+    unsigned int retry_after = 0;
+    if (admission_check_rate(info ? info->client_addr : NULL, &retry_after) != ADMISSION_OK) {
+        return queue_retry_later(connection, 429, "{\"error\":\"Too many requests\"}", retry_after);
+    }
+    if (strcmp(method, "GET") == 0 && strcmp(url, "/api/stream") == 0) {
+        return MHD_YES;
+    }
+    if (admission_enter() != ADMISSION_OK) {
+        return queue_retry_later(connection, 503, "{\"error\":\"Server busy\"}", 1);
+    }
+    context->admitted = 1;
+    return MHD_YES;
+}
+
+// Resolve the user of a request from its "Authorization: Bearer <token>" header
+static int authenticate_request(struct MHD_Connection* connection, int* user_id) {
+    const char* header = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, "Authorization");
+    if (header == NULL || strncasecmp(header, "Bearer ", 7) != 0) {
+        return AUTH_ERR_INVALID;
+    }
+    return auth_verify_token(header + 7, user_id);
+}
+
+// MHD iterator: adds one GET argument to the rebuilt query string
+static int collect_query_argument(void* cls, enum MHD_ValueKind kind, const char* key, const char* value) {
+    (void) kind;
+    return query_string_append(cls, key, value) == 0 ? MHD_YES : MHD_NO;
+}
+
 // Request handler callback for microhttpd
 int api_request_handler(void* cls, struct MHD_Connection* connection,
                       const char* url, const char* method,
                       const char* version, const char* upload_data,
                       size_t* upload_data_size, void** con_cls) {
-    
-    static int request_counter = 0;
+    (void) cls;
+    (void) version;
     
     // First call is used to setup connection context
     if (*con_cls == NULL) {
-        *con_cls = &request_counter;
-        return MHD_YES;
+        request_context_t* context = calloc(1, sizeof(request_context_t));
+        if (context == NULL) {
+            return MHD_NO;
+        }
+        string_buffer_init(&context->body);
+        context->arrived_ms = monotonic_ms();
+        *con_cls = context;
+        return admit_request(connection, url, method, context);
     }
+    request_context_t* context = *con_cls;
     
-    // Get query string
-    const char* query_string = MHD_lookup_connection_value(
-        connection, MHD_GET_ARGUMENT_KIND, NULL);
-    
-    // Extract request body (for POST/PUT)
-    char* request_body = NULL;
-    if (strcmp(method, "POST") == 0 || strcmp(method, "PUT") == 0) {
-        if (*upload_data_size != 0) {
-            request_body = malloc(*upload_data_size + 1);
-            memcpy(request_body, upload_data, *upload_data_size);
-            request_body[*upload_data_size] = '\0';
-            *upload_data_size = 0;
-            return MHD_YES;
+    // Accumulate the request body (for POST/PUT); it may arrive in several chunks
+    if (*upload_data_size != 0) {
+        if (context->body.length + *upload_data_size > MAX_REQUEST_BODY ||
+            string_buffer_append(&context->body, upload_data, *upload_data_size) != 0) {
+            context->too_large = 1;
         }
+        *upload_data_size = 0;
+        return MHD_YES;
+    }
+    if (context->too_large) {
+        return queue_static_json(connection, 413, "{\"error\":\"Request body too large\"}");
     }
+    const char* request_body = context->body.data;
     
+    // The change feed streams from a callback rather than a handler's buffer
+    if (strcmp(method, "GET") == 0 && strcmp(url, "/api/stream") == 0) {
+        return serve_event_stream(connection);
+    }
+
     // Find route handler
-    char* params[5] = {NULL}; // Allow up to 5 URL parameters
-    route_handler_func handler = find_route_handler(url, method, params);
+    char* params[API_MAX_ROUTE_PARAMS] = {NULL};
+    const api_route_t* route = api_find_route(url, method, params);
+    
+    // User routes need a valid session token
+    int user_id = 0;
+    if (route != NULL && route->user_handler != NULL && authenticate_request(connection, &user_id) != AUTH_OK) {
+        for (int i = 0; i < API_MAX_ROUTE_PARAMS; i++) {
+            free(params[i]);
+        }
+        return queue_static_json(connection, 401, "{\"error\":\"Authentication required\"}");
+    }
     
     struct MHD_Response* response;
     int ret;
     
-    if (handler != NULL) {
+    if (route != NULL) {
         // Initialize API response
+        response_format_t format = response_format_negotiate(
+            MHD_lookup_connection_value(connection, MHD_HEADER_KIND, "Accept"));
         api_response_t api_response = {
             .status_code = 200,
             .content_type = "application/json",
             .body = NULL,
-            .body_size = 0
+            .body_size = 0,
+            .data = NULL,
+            .format = format
         };
         
-        // Call route handler
-        int result = handler(url, query_string, request_body, &api_response);
+        // Call route handler under the route's deadline, unless the
+        // request already spent it waiting
+        long long deadline = context->arrived_ms +
+            (route->deadline_ms > 0 ? route->deadline_ms : ADMISSION_DEFAULT_DEADLINE_MS);
+        int result = 0;
+        int timed_out = monotonic_ms() >= deadline;
+        if (!timed_out) {
+            // MHD has already split and decoded the arguments; handlers
+            // take them back as one "key=value&..." string
+            string_buffer_t query;
+            string_buffer_init(&query);
+            MHD_get_connection_values(connection, MHD_GET_ARGUMENT_KIND, collect_query_argument, &query);
+            const char* query_string = query.data;
+            db_set_deadline(deadline);
+            result = route->user_handler != NULL
+                ? route->user_handler(user_id, url, query_string, request_body, &api_response)
+                : route->handler(url, query_string, request_body, &api_response);
+            // A 504 also comes from a coalesced run or wait that ran out
+            timed_out = db_deadline_hit() || api_response.status_code == 504;
+            db_set_deadline(0);
+            string_buffer_free(&query);
+        }
         
-        if (result != 0) {
+        if (timed_out) {
+            // Whatever the handler made of the abandoned query, the client
+            // is told it ran out of time
+            admission_record_deadline_exceeded();
+            free(api_response.body);
+            json_decref(api_response.data);
+            api_response.status_code = 504;
+            api_response.content_type = "application/json";
+            api_response.body = strdup("{\"error\":\"Deadline exceeded\"}");
+            api_response.body_size = strlen(api_response.body);
+        } else if (result == 0 && api_response.data != NULL) {
+            // Serialize in the format the client asked for
+            result = response_encode(api_response.data, format, &api_response.body, &api_response.body_size);
+            api_response.content_type = (char*) response_format_content_type(format);
+            json_decref(api_response.data);
+        } else if (result != 0) {
+            json_decref(api_response.data);
+        }
+        if (!timed_out && result != 0) {
             // Handler failed, set error response
+            free(api_response.body);
             api_response.status_code = 500;
+            api_response.content_type = "application/json";
             api_response.body = strdup("{\"error\":\"Internal server error\"}");
             api_response.body_size = strlen(api_response.body);
         }
@@ -164,6 +419,10 @@ int api_request_handler(void* cls, struct MHD_Connection* connection,
             api_response.body_size, (void*) api_response.body, MHD_RESPMEM_MUST_FREE);
         
         MHD_add_response_header(response, "Content-Type", api_response.content_type);
+        MHD_add_response_header(response, "Vary", "Accept");
+        if (atomic_load(&draining)) {
+            MHD_add_response_header(response, "Connection", "close");
+        }
         
         // Add CORS headers for development
         MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
@@ -184,11 +443,7 @@ int api_request_handler(void* cls, struct MHD_Connection* connection,
     }
     
     // Free resources
-    if (request_body != NULL) {
-        free(request_body);
-    }
-    
-    for (int i = 0; i < 5; i++) {
+    for (int i = 0; i < API_MAX_ROUTE_PARAMS; i++) {
         if (params[i] != NULL) {
             free(params[i]);
         }
@@ -197,30 +452,119 @@ int api_request_handler(void* cls, struct MHD_Connection* connection,
     return ret;
 }
 
-// Initialize API server
-int api_server_init(unsigned int port) {
-    http_daemon = MHD_start_daemon(
-        MHD_USE_SELECT_INTERNALLY, port, NULL, NULL,
-        &api_request_handler, NULL, MHD_OPTION_END);
+// Start the daemon on `port`, or on an inherited listening socket
+static int start_daemon(unsigned int port, int listen_fd) {
+    // A thread per connection lets /api/stream block between events; the
+    // inter-thread channel lets MHD_quiesce_daemon wake the listen thread
+    unsigned int flags = MHD_USE_SELECT_INTERNALLY | MHD_USE_THREAD_PER_CONNECTION | MHD_USE_ITC;
+    if (listen_fd >= 0) {
+        http_daemon = MHD_start_daemon(
+            flags, 0, NULL, NULL,
+            &api_request_handler, NULL,
+            MHD_OPTION_LISTEN_SOCKET, listen_fd,
+            MHD_OPTION_NOTIFY_COMPLETED, &api_request_completed, NULL,
+            MHD_OPTION_END);
+    } else {
+        // SO_REUSEPORT, so a replacement can bind while this one drains
+        http_daemon = MHD_start_daemon(
+            flags, port, NULL, NULL,
+            &api_request_handler, NULL,
+            MHD_OPTION_LISTENING_ADDRESS_REUSE, 1,
+            MHD_OPTION_NOTIFY_COMPLETED, &api_request_completed, NULL,
+            MHD_OPTION_END);
+    }
     
     if (http_daemon == NULL) {
         fprintf(stderr, "Failed to start API server\n");
         return 1;
     }
-    
+    return 0;
+}
+
+// Initialize API server
+int api_server_init(unsigned int port) {
+    if (start_daemon(port, -1) != 0) {
+        return 1;
+    }
     printf("API server initialized on port %u\n", port);
     return 0;
 }
 
+int api_server_init_socket(int listen_fd) {
+    if (start_daemon(0, listen_fd) != 0) {
+        return 1;
+    }
+    printf("API server initialized on inherited socket %d\n", listen_fd);
+    return 0;
+}
+
+void api_server_block_signals(void) {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+}
+
+// Stop accepting, end the event streams and wait until no request has
+// been in flight for DRAIN_QUIET_MS, all connections are closed or the
+// timeout passes. MHD_stop_daemon then closes what is left.
+static void drain(unsigned int timeout_ms) {
+    atomic_store(&draining, 1);
+    MHD_socket listen_fd = MHD_quiesce_daemon(http_daemon);
+    if (listen_fd != MHD_INVALID_SOCKET) {
+        // Inherited sockets stay open in the supervisor, so connections
+        // still queued on them go to the next worker
+        close(listen_fd);
+    }
+    event_stream_close();
+
+    long long start = monotonic_ms();
+    long long quiet_since = start;
+    for (;;) {
+        long long now = monotonic_ms();
+        admission_stats_t stats;
+        admission_get_stats(&stats);
+        if (stats.in_flight > 0) {
+            quiet_since = now;
+        }
+        const union MHD_DaemonInfo* info = MHD_get_daemon_info(http_daemon, MHD_DAEMON_INFO_CURRENT_CONNECTIONS);
+        if ((info != NULL && info->num_connections == 0) || now - quiet_since >= DRAIN_QUIET_MS ||
+            now - start >= (long long) timeout_ms) {
+            break;
+        }
+        usleep(20000);
+    }
+    printf("API server drained in %lld ms\n", monotonic_ms() - start);
+}
+
 // Start API server
-int api_server_start() {
+int api_server_start(unsigned int drain_timeout_ms) {
     printf("API server started. Press Ctrl+C to stop.\n");
     
     // Block until signal
-    while (1) {
-        sleep(1);
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGHUP);
+    int sig = 0;
+    for (;;) {
+        if (sigwait(&signals, &sig) != 0) {
+            continue;
+        }
+        if (sig != SIGHUP) {
+            break;
+        }
+        // Reloading is the supervisor's job (see supervisor.h)
+        printf("SIGHUP ignored: reloads need WORKERS (supervisor mode)\n");
     }
     
+    printf("%s received, draining\n", sig == SIGINT ? "SIGINT" : "SIGTERM");
+    if (http_daemon != NULL) {
+        drain(drain_timeout_ms);
+    }
     return 0;
 }
 
@@ -229,23 +573,25 @@ void api_server_stop() {
     if (http_daemon != NULL) {
         MHD_stop_daemon(http_daemon);
         http_daemon = NULL;
-        printf("API server stopped\n");
+
+        singleflight_stats_t stats;
+        singleflight_get_stats(&stats);
+        printf("API server stopped (%llu coalescable requests, %llu answered by a shared run)\n",
+               (unsigned long long) stats.calls, (unsigned long long) stats.coalesced);
     }
 }
 
 // Create JSON response
 api_response_t create_json_response(json_t* data, int status_code) {
-    api_response_t response;
-    response.status_code = status_code;
-    response.content_type = "application/json";
-    
-    char* json_str = json_dumps(data, JSON_COMPACT);
-    response.body = json_str;
-    response.body_size = strlen(json_str);
-    
-    // The caller is responsible for freeing data
-    json_decref(data);
-    
+    // Serialized (and released) by the dispatcher in the negotiated format
+    api_response_t response = {
+        .status_code = status_code,
+        .content_type = "application/json",
+        .body = NULL,
+        .body_size = 0,
+        .data = data,
+        .format = RESPONSE_FORMAT_JSON
+    };
     return response;
 }
 
@@ -257,97 +603,886 @@ api_response_t create_error_response(const char* message, int status_code) {
     return create_json_response(error, status_code);
 }
 
+// Serialize a loader's JSON result for singleflight_do
+static int serialize_shared(json_t* data, int status_code, response_format_t format,
+                            char** out_body, size_t* out_length) {
+    int rc = response_encode(data, format, out_body, out_length);
+    json_decref(data);
+    return rc == 0 ? status_code : -1;
+}
+
+static int serialize_shared_error(const char* message, int status_code, response_format_t format,
+                                  char** out_body, size_t* out_length) {
+    json_t* error = json_object();
+    json_object_set_new(error, "error", json_string(message));
+    return serialize_shared(error, status_code, format, out_body, out_length);
+}
+
+// A loader that failed because its run hit the deadline answers 504,
+// for the caller that ran it and every request sharing the result
+static int serialize_shared_failure(const char* message, int status_code, response_format_t format,
+                                    char** out_body, size_t* out_length) {
+    if (db_deadline_hit()) {
+        return serialize_shared_error("Deadline exceeded", 504, format, out_body, out_length);
+    }
+    return serialize_shared_error(message, status_code, format, out_body, out_length);
+}
+
+// Answer with the response of the loader run for `key` in the
+// negotiated format, shared with identical requests in flight (see
+// singleflight.h); the format is part of the key. Waiting for another
+// request's run stops at this request's own deadline (504).
+static int respond_coalesced(const char* key, singleflight_fn load, void* ctx, api_response_t* response) {
+    char format_key[SINGLEFLIGHT_MAX_KEY];
+    snprintf(format_key, sizeof(format_key), "%s:%s", key, response_format_name(response->format));
+    char* body = NULL;
+    size_t length = 0;
+    int status_code = singleflight_do(format_key, load, ctx, db_get_deadline(), &body, &length, NULL);
+    if (status_code == SINGLEFLIGHT_TIMEOUT) {
+        *response = create_error_response("Deadline exceeded", 504);
+        return 0;
+    }
+    if (status_code < 0 || body == NULL) {
+        free(body);
+        return 1;
+    }
+    response->status_code = status_code;
+    response->content_type = (char*) response_format_content_type(response->format);
+    response->body = body;
+    response->body_size = length;
+    return 0;
+}
+
+typedef struct {
+    int district_id;
+    int room_count;
+    int months;
+    int columns;                  // One array per field instead of one object per month
+    response_format_t format;
+} trends_request_t;
+
+static int load_trends(void* ctx, char** out_body, size_t* out_length) {
+    const trends_request_t* request = ctx;
+    json_t* trends = price_get_trends_handler(request->district_id, request->room_count, request->months);
+    if (trends && request->columns) {
+        json_t* columns = response_records_to_columns(trends);
+        json_decref(trends);
+        trends = columns;
+    }
+    if (!trends) {
+        return serialize_shared_failure("Failed to retrieve trends data", 500, request->format, out_body, out_length);
+    }
+    return serialize_shared(trends, 200, request->format, out_body, out_length);
+}
+
 /**
  * Handler for price trends API endpoint
- * GET /api/trends?district=1&rooms=2&months=12
+ * GET /api/trends?district=1&rooms=2&months=12&layout=columns
  */
-int price_get_trends(const char* url, const char* query_string, 
+int price_get_trends(const char* url, const char* query_string,
                      const char* request_body, api_response_t* response) {
-    printf("[STUB] Processing price trends request: %s?%s\n", url, query_string ? query_string : "");
-    
-    // Parse query parameters
-    int district_id = 1; // Default to Botanica
-    int room_count = 2;  // Default to 2 rooms
-    int months = 12;     // Default to 12 months
-    
+    (void) url;
+    (void) request_body;
+
+    trends_request_t request = {
+        .district_id = 1,   // Default to Botanica
+        .room_count = 2,    // Default to 2 rooms
+        .months = 12,       // Default to 12 months
+        .columns = 0,
+        .format = response->format
+    };
+
     if (query_string) {
-        // Simple query string parsing - can be improved
         char query_copy[256];
-        strncpy(query_copy, query_string, sizeof(query_copy) - 1);
-        
-        char* token = strtok(query_copy, "&");
-        while (token) {
+        char* saveptr = NULL;
+        snprintf(query_copy, sizeof(query_copy), "%s", query_string);
+
+        for (char* token = strtok_r(query_copy, "&", &saveptr); token; token = strtok_r(NULL, "&", &saveptr)) {
             if (strncmp(token, "district=", 9) == 0) {
-                district_id = atoi(token + 9);
+                request.district_id = atoi(token + 9);
             } else if (strncmp(token, "rooms=", 6) == 0) {
-                room_count = atoi(token + 6);
+                request.room_count = atoi(token + 6);
             } else if (strncmp(token, "months=", 7) == 0) {
-                months = atoi(token + 7);
+                request.months = atoi(token + 7);
+            } else if (strcmp(token, "layout=columns") == 0) {
+                request.columns = 1;
             }
-            token = strtok(NULL, "&");
         }
     }
-    
-    // Validate parameters
-    if (district_id <= 0 || room_count <= 0 || months <= 0) {
-        return create_error_response("Invalid parameters", 400).status_code;
+
+    if (request.district_id <= 0 || request.room_count <= 0 || request.months <= 0) {
+        *response = create_error_response("Invalid parameters", 400);
+        return 0;
     }
-    
-    // Get trends data from prediction module
-    json_t* trends = price_get_trends_handler(district_id, room_count, months);
-    if (!trends) {
-        return create_error_response("Failed to retrieve trends data", 500).status_code;
+
+    char key[64];
+    snprintf(key, sizeof(key), "trends:%d:%d:%d:%s", request.district_id, request.room_count, request.months,
+             request.columns ? "columns" : "rows");
+    return respond_coalesced(key, load_trends, &request, response);
+}
+
+typedef struct {
+    int id;
+    response_format_t format;
+} lookup_request_t;
+
+// Load one row through a pooled connection, as a shared response
+static int load_detail(int (*get_detail)(PGconn*, int, json_t**), const lookup_request_t* request,
+                       const char* not_found, char** out_body, size_t* out_length) {
+    PGconn* conn = db_pool_acquire();
+    if (conn == NULL) {
+        return serialize_shared_failure("Database unavailable", 503, request->format, out_body, out_length);
     }
-    
-    // Create response
-    *response = create_json_response(trends, 200);
-    json_decref(trends);
-    
-    return response->status_code;
+    json_t* detail = NULL;
+    int rc = get_detail(conn, request->id, &detail);
+    db_pool_release(conn);
+    if (rc == 1) {
+        return serialize_shared_error(not_found, 404, request->format, out_body, out_length);
+    }
+    if (rc != 0) {
+        return serialize_shared_failure("Could not load data", 500, request->format, out_body, out_length);
+    }
+    return serialize_shared(detail, 200, request->format, out_body, out_length);
+}
+
+static int load_property(void* ctx, char** out_body, size_t* out_length) {
+    return load_detail(properties_get_detail, ctx, "Property not found", out_body, out_length);
+}
+
+static int load_district(void* ctx, char** out_body, size_t* out_length) {
+    return load_detail(districts_get_detail, ctx, "District not found", out_body, out_length);
+}
+
+// Answer a listing search on a pooled connection
+static int respond_with_listings(const properties_filter_t* filter, api_response_t* response) {
+    if (filter->limit < 1 || filter->limit > PROPERTIES_LIST_MAX_LIMIT || filter->offset < 0) {
+        *response = create_error_response("limit must be 1-200 and offset not negative", 400);
+        return 0;
+    }
+    PGconn* conn = db_pool_acquire();
+    if (conn == NULL) {
+        *response = create_error_response("Database unavailable", 503);
+        return 0;
+    }
+    json_t* list = NULL;
+    int rc = properties_list(conn, filter, &list);
+    db_pool_release(conn);
+    if (rc != 0) {
+        *response = create_error_response("Could not load properties", 500);
+        return 0;
+    }
+    *response = create_json_response(list, 200);
+    return 0;
+}
+
+/**
+ * Handler for the property list API endpoint
+ * GET /api/properties?district_id=3&rooms=2&min_price=40000&max_price=90000&limit=50&offset=0
+ */
+int properties_get_all(const char* url, const char* query_string,
+                       const char* request_body, api_response_t* response) {
+    (void) url;
+    (void) request_body;
+
+    properties_filter_t filter = properties_parse_filter(query_string);
+    return respond_with_listings(&filter, response);
+}
+
+/**
+ * Handler for property details API endpoint
+ * GET /api/properties/:id
+ */
+int properties_get_by_id(const char* url, const char* query_string,
+                         const char* request_body, api_response_t* response) {
+    (void) query_string;
+    (void) request_body;
+
+    int property_id = 0;
+    if (sscanf(url, "/api/properties/%d", &property_id) != 1 || property_id <= 0) {
+        *response = create_error_response("Invalid property id", 400);
+        return 0;
+    }
+
+    lookup_request_t request = { property_id, response->format };
+    char key[32];
+    snprintf(key, sizeof(key), "property:%d", property_id);
+    return respond_coalesced(key, load_property, &request, response);
+}
+
+/**
+ * Handler for district details API endpoint
+ * GET /api/districts/:id
+ */
+int districts_get_by_id(const char* url, const char* query_string,
+                        const char* request_body, api_response_t* response) {
+    (void) query_string;
+    (void) request_body;
+
+    int district_id = 0;
+    if (sscanf(url, "/api/districts/%d", &district_id) != 1 || district_id <= 0) {
+        *response = create_error_response("Invalid district id", 400);
+        return 0;
+    }
+
+    lookup_request_t request = { district_id, response->format };
+    char key[32];
+    snprintf(key, sizeof(key), "district:%d", district_id);
+    return respond_coalesced(key, load_district, &request, response);
+}
+
+/**
+ * Handler for the district list API endpoint
+ * GET /api/districts
+ */
+int districts_get_all(const char* url, const char* query_string,
+                      const char* request_body, api_response_t* response) {
+    (void) url;
+    (void) query_string;
+    (void) request_body;
+
+    PGconn* conn = db_pool_acquire();
+    if (conn == NULL) {
+        *response = create_error_response("Database unavailable", 503);
+        return 0;
+    }
+    json_t* list = NULL;
+    int rc = districts_list(conn, &list);
+    db_pool_release(conn);
+    if (rc != 0) {
+        *response = create_error_response("Could not load districts", 500);
+        return 0;
+    }
+    *response = create_json_response(list, 200);
+    return 0;
+}
+
+/**
+ * Handler for the listings of a district
+ * GET /api/districts/:id/properties?rooms=2&min_price=40000&max_price=90000&limit=50&offset=0
+ */
+int districts_get_properties(const char* url, const char* query_string,
+                             const char* request_body, api_response_t* response) {
+    (void) request_body;
+
+    int district_id = 0;
+    if (sscanf(url, "/api/districts/%d/properties", &district_id) != 1 || district_id <= 0) {
+        *response = create_error_response("Invalid district id", 400);
+        return 0;
+    }
+
+    properties_filter_t filter = properties_parse_filter(query_string);
+    filter.district_id = district_id;
+    return respond_with_listings(&filter, response);
 }
 
 /**
  * Handler for price predictions API endpoint
  * GET /api/predictions?district=1&rooms=2
  */
-int price_get_predictions(const char* url, const char* query_string, 
-                        const char* request_body, api_response_t* response) {
-    printf("[STUB] Processing price predictions request: %s?%s\n", url, query_string ? query_string : "");
-    
-    // Parse query parameters
+int price_get_predictions(const char* url, const char* query_string,
+                          const char* request_body, api_response_t* response) {
+    (void) url;
+    (void) request_body;
+
     int district_id = 1; // Default to Botanica
     int room_count = 2;  // Default to 2 rooms
-    
+
     if (query_string) {
-        // Simple query string parsing - can be improved
         char query_copy[256];
-        strncpy(query_copy, query_string, sizeof(query_copy) - 1);
-        
-        char* token = strtok(query_copy, "&");
-        while (token) {
+        char* saveptr = NULL;
+        snprintf(query_copy, sizeof(query_copy), "%s", query_string);
+
+        for (char* token = strtok_r(query_copy, "&", &saveptr); token; token = strtok_r(NULL, "&", &saveptr)) {
             if (strncmp(token, "district=", 9) == 0) {
                 district_id = atoi(token + 9);
             } else if (strncmp(token, "rooms=", 6) == 0) {
                 room_count = atoi(token + 6);
             }
-            token = strtok(NULL, "&");
         }
     }
-    
-    // Validate parameters
+
     if (district_id <= 0 || room_count <= 0) {
-        return create_error_response("Invalid parameters", 400).status_code;
+        *response = create_error_response("Invalid parameters", 400);
+        return 0;
     }
-    
-    // Get prediction data from prediction module
+
     json_t* predictions = price_get_predictions_handler(district_id, room_count);
     if (!predictions) {
-        return create_error_response("Failed to retrieve prediction data", 500).status_code;
+        *response = create_error_response("Failed to retrieve prediction data", 500);
+        return 0;
     }
-    
-    // Create response
+
+    // create_json_response takes ownership of the JSON value
     *response = create_json_response(predictions, 200);
-    json_decref(predictions);
-    
-    return response->status_code;
+    return 0;
+}
+
+/**
+ * Handler for property valuation API endpoint
+ * GET /api/properties/:id/valuation
+ */
+int properties_get_valuation(const char* url, const char* query_string,
+                             const char* request_body, api_response_t* response) {
+    (void) query_string;
+    (void) request_body;
+
+    int property_id = 0;
+    if (sscanf(url, "/api/properties/%d/valuation", &property_id) != 1 || property_id <= 0) {
+        *response = create_error_response("Invalid property id", 400);
+        return 0;
+    }
+
+    json_t* valuation = valuation_get_handler(property_id);
+    if (!valuation) {
+        *response = create_error_response("Property not found or no valuation model", 404);
+        return 0;
+    }
+
+    // create_json_response takes ownership of the JSON value
+    *response = create_json_response(valuation, 200);
+    return 0;
+}
+
+/**
+ * Handler for comparable properties API endpoint
+ * GET /api/properties/:id/comparables?k=5&scope=district&rooms=1
+ *
+ * scope=all searches every district; rooms=-1 drops the room filter.
+ */
+int properties_get_comparables(const char* url, const char* query_string,
+                               const char* request_body, api_response_t* response) {
+    (void) request_body;
+
+    int property_id = 0;
+    if (sscanf(url, "/api/properties/%d/comparables", &property_id) != 1 || property_id <= 0) {
+        *response = create_error_response("Invalid property id", 400);
+        return 0;
+    }
+
+    comparables_query_t query = comparables_parse_query(query_string);
+    if (query.k < 1 || query.k > COMPARABLES_MAX_K) {
+        *response = create_error_response("k must be between 1 and 50", 400);
+        return 0;
+    }
+
+    json_t* comparables = comparables_get_handler(property_id, &query);
+    if (!comparables) {
+        *response = create_error_response("Property not found", 404);
+        return 0;
+    }
+
+    *response = create_json_response(comparables, 200);
+    return 0;
+}
+
+/**
+ * Handler for listing investment analysis API endpoint
+ * GET /api/properties/:id/investment?down_payment=20&interest_rate=5&years=10&schedule=monthly
+ */
+int properties_get_investment(const char* url, const char* query_string,
+                              const char* request_body, api_response_t* response) {
+    (void) request_body;
+
+    int property_id = 0;
+    if (sscanf(url, "/api/properties/%d/investment", &property_id) != 1 || property_id <= 0) {
+        *response = create_error_response("Invalid property id", 400);
+        return 0;
+    }
+
+    investment_assumptions_t assumptions = investment_default_assumptions();
+    int monthly_schedule = 0;
+    if (query_string) {
+        char query_copy[256];
+        char* saveptr = NULL;
+        snprintf(query_copy, sizeof(query_copy), "%s", query_string);
+
+        for (char* token = strtok_r(query_copy, "&", &saveptr); token; token = strtok_r(NULL, "&", &saveptr)) {
+            if (strcmp(token, "schedule=monthly") == 0) {
+                monthly_schedule = 1;
+            } else {
+                investment_parse_assumption(token, &assumptions);
+            }
+        }
+    }
+    if (investment_validate_assumptions(&assumptions) != 0) {
+        *response = create_error_response("Invalid investment assumptions", 400);
+        return 0;
+    }
+
+    json_t* analysis = investment_get_handler(property_id, &assumptions, monthly_schedule);
+    if (!analysis) {
+        *response = create_error_response("Property not found or not priced", 404);
+        return 0;
+    }
+
+    *response = create_json_response(analysis, 200);
+    return 0;
+}
+
+/**
+ * Handler for investment rankings API endpoint
+ * GET /api/investment/rankings?limit=20&offset=0&district=3&rooms=2&max_price=90000&down_payment=30
+ *
+ * Active listings sorted by projected ROI over the holding period; any
+ * assumption parameter re-evaluates every listing.
+ */
+int investment_get_rankings(const char* url, const char* query_string,
+                            const char* request_body, api_response_t* response) {
+    (void) url;
+    (void) request_body;
+
+    investment_assumptions_t assumptions = investment_default_assumptions();
+    investment_filter_t filter = { 0 };
+    int custom = 0;
+    long offset = 0, limit = 20;
+    if (query_string) {
+        char query_copy[512];
+        char* saveptr = NULL;
+        snprintf(query_copy, sizeof(query_copy), "%s", query_string);
+
+        for (char* token = strtok_r(query_copy, "&", &saveptr); token; token = strtok_r(NULL, "&", &saveptr)) {
+            if (strncmp(token, "limit=", 6) == 0) {
+                limit = atol(token + 6);
+            } else if (strncmp(token, "offset=", 7) == 0) {
+                offset = atol(token + 7);
+            } else if (!investment_parse_filter(token, &filter)) {
+                custom += investment_parse_assumption(token, &assumptions);
+            }
+        }
+    }
+    if (limit < 1 || limit > 100 || offset < 0 || offset + limit > INVESTMENT_MAX_RANKING) {
+        *response = create_error_response("limit must be 1-100 and offset + limit at most 500", 400);
+        return 0;
+    }
+    if (investment_validate_assumptions(&assumptions) != 0) {
+        *response = create_error_response("Invalid investment assumptions", 400);
+        return 0;
+    }
+
+    json_t* rankings = investment_rankings_handler(custom ? &assumptions : NULL, &filter,
+                                                   (size_t) offset, (size_t) limit);
+    if (!rankings) {
+        *response = create_error_response("Investment rankings not available yet", 503);
+        return 0;
+    }
+
+    *response = create_json_response(rankings, 200);
+    return 0;
+}
+
+/**
+ * Handler for district price statistics API endpoint
+ * GET /api/districts/:id/stats?rooms=2&type=1
+ */
+int districts_get_stats(const char* url, const char* query_string,
+                        const char* request_body, api_response_t* response) {
+    (void) request_body;
+
+    int district_id = 0;
+    if (sscanf(url, "/api/districts/%d/stats", &district_id) != 1 || district_id <= 0) {
+        *response = create_error_response("Invalid district id", 400);
+        return 0;
+    }
+
+    int num_rooms = 0, type_id = 0;
+    if (query_string) {
+        char query_copy[256];
+        char* saveptr = NULL;
+        snprintf(query_copy, sizeof(query_copy), "%s", query_string);
+
+        for (char* token = strtok_r(query_copy, "&", &saveptr); token; token = strtok_r(NULL, "&", &saveptr)) {
+            if (strncmp(token, "rooms=", 6) == 0) {
+                num_rooms = atoi(token + 6);
+            } else if (strncmp(token, "type=", 5) == 0) {
+                type_id = atoi(token + 5);
+            }
+        }
+    }
+
+    json_t* stats = district_stats_handler(district_id, num_rooms, type_id);
+    if (!stats) {
+        *response = create_error_response("No listings in this district", 404);
+        return 0;
+    }
+
+    *response = create_json_response(stats, 200);
+    return 0;
+}
+
+/**
+ * Handler for server counters
+ * GET /api/metrics
+ */
+int metrics_get(const char* url, const char* query_string,
+                const char* request_body, api_response_t* response) {
+    (void) url;
+    (void) query_string;
+    (void) request_body;
+
+    admission_stats_t admission;
+    db_deadline_stats_t deadlines;
+    singleflight_stats_t coalescing;
+    admission_get_stats(&admission);
+    db_get_deadline_stats(&deadlines);
+    singleflight_get_stats(&coalescing);
+
+    json_t* requests = json_object();
+    json_object_set_new(requests, "admitted", json_integer((json_int_t) admission.admitted));
+    json_object_set_new(requests, "in_flight", json_integer((json_int_t) admission.in_flight));
+    json_object_set_new(requests, "rate_limited", json_integer((json_int_t) admission.rate_limited));
+    json_object_set_new(requests, "shed", json_integer((json_int_t) admission.shed));
+    json_object_set_new(requests, "deadline_exceeded", json_integer((json_int_t) admission.deadline_exceeded));
+
+    json_t* database = json_object();
+    json_object_set_new(database, "skipped", json_integer((json_int_t) deadlines.skipped));
+    json_object_set_new(database, "cancelled", json_integer((json_int_t) deadlines.cancelled));
+    json_object_set_new(database, "pool_timeouts", json_integer((json_int_t) deadlines.pool_timeouts));
+
+    json_t* coalesced = json_object();
+    json_object_set_new(coalesced, "calls", json_integer((json_int_t) coalescing.calls));
+    json_object_set_new(coalesced, "executions", json_integer((json_int_t) coalescing.executions));
+    json_object_set_new(coalesced, "coalesced", json_integer((json_int_t) coalescing.coalesced));
+    json_object_set_new(coalesced, "waiter_timeouts", json_integer((json_int_t) coalescing.timeouts));
+
+    // Counters are per process; in supervisor mode each worker has its own
+    json_t* process = json_object();
+    json_object_set_new(process, "pid", json_integer((json_int_t) getpid()));
+    json_object_set_new(process, "worker", json_integer(supervisor_worker_slot()));
+
+    json_t* metrics = json_object();
+    json_object_set_new(metrics, "process", process);
+    json_object_set_new(metrics, "requests", requests);
+    json_object_set_new(metrics, "database_deadlines", database);
+    json_object_set_new(metrics, "coalescing", coalesced);
+    *response = create_json_response(metrics, 200);
+    return 0;
+}
+
+// Build the login/register response: the user and a fresh session token
+static int auth_session_response(const auth_user_t* user, int status_code, api_response_t* response) {
+    char token[AUTH_TOKEN_MAX_LENGTH];
+    time_t expires = 0;
+    if (auth_issue_token(user->id, token, sizeof(token), &expires) != AUTH_OK) {
+        *response = create_error_response("Could not issue token", 500);
+        return 0;
+    }
+
+    json_t* user_json = json_object();
+    json_object_set_new(user_json, "id", json_integer(user->id));
+    json_object_set_new(user_json, "email", json_string(user->email));
+    json_object_set_new(user_json, "first_name", json_string(user->first_name));
+    json_object_set_new(user_json, "last_name", json_string(user->last_name));
+    json_object_set_new(user_json, "is_admin", json_boolean(user->is_admin));
+
+    json_t* body = json_object();
+    json_object_set_new(body, "user", user_json);
+    json_object_set_new(body, "token", json_string(token));
+    json_object_set_new(body, "expires_at", json_integer((json_int_t) expires));
+    *response = create_json_response(body, status_code);
+    return 0;
+}
+
+// Map the failure of a password operation to an error response
+static void auth_error_response(int status, api_response_t* response) {
+    switch (status) {
+        case AUTH_ERR_INVALID:
+            *response = create_error_response("Invalid email or password", 401);
+            break;
+        case AUTH_ERR_EXISTS:
+            *response = create_error_response("Email already registered", 409);
+            break;
+        case AUTH_ERR_BUSY:
+            *response = create_error_response("Too many login attempts in progress, retry shortly", 503);
+            break;
+        default:
+            *response = create_error_response("Authentication failed", 500);
+            break;
+    }
+}
+
+/**
+ * Handler for login API endpoint
+ * POST /api/auth/login {"email": ..., "password": ...}
+ */
+int auth_login(const char* url, const char* query_string,
+               const char* request_body, api_response_t* response) {
+    (void) url;
+    (void) query_string;
+
+    json_t* body = request_body ? json_loads(request_body, 0, NULL) : NULL;
+    const char* email = body ? json_string_value(json_object_get(body, "email")) : NULL;
+    const char* password = body ? json_string_value(json_object_get(body, "password")) : NULL;
+    if (!email || !password) {
+        json_decref(body);
+        *response = create_error_response("email and password are required", 400);
+        return 0;
+    }
+
+    auth_user_t user;
+    int status = login_user(email, password, &user);
+    json_decref(body);
+    if (status != AUTH_OK) {
+        auth_error_response(status, response);
+        return 0;
+    }
+    return auth_session_response(&user, 200, response);
+}
+
+/**
+ * Handler for registration API endpoint
+ * POST /api/auth/register {"email", "password", "first_name", "last_name"}
+ */
+int auth_register(const char* url, const char* query_string,
+                  const char* request_body, api_response_t* response) {
+    (void) url;
+    (void) query_string;
+
+    json_t* body = request_body ? json_loads(request_body, 0, NULL) : NULL;
+    const char* email = body ? json_string_value(json_object_get(body, "email")) : NULL;
+    const char* password = body ? json_string_value(json_object_get(body, "password")) : NULL;
+    const char* first_name = body ? json_string_value(json_object_get(body, "first_name")) : NULL;
+    const char* last_name = body ? json_string_value(json_object_get(body, "last_name")) : NULL;
+    if (!email || !password || !first_name || !last_name || strchr(email, '@') == NULL) {
+        json_decref(body);
+        *response = create_error_response("email, password, first_name and last_name are required", 400);
+        return 0;
+    }
+    if (strlen(password) < 8 || strlen(password) > 72) {
+        json_decref(body);
+        *response = create_error_response("Password must be 8-72 characters", 400);
+        return 0;
+    }
+
+    auth_user_t user;
+    int status = register_user(email, password, first_name, last_name, &user);
+    json_decref(body);
+    if (status != AUTH_OK) {
+        auth_error_response(status, response);
+        return 0;
+    }
+    return auth_session_response(&user, 201, response);
+}
+
+/**
+ * Handler for logout API endpoint
+ * POST /api/auth/logout {"token": ...}
+ */
+int auth_logout(const char* url, const char* query_string,
+                const char* request_body, api_response_t* response) {
+    (void) url;
+    (void) query_string;
+
+    json_t* body = request_body ? json_loads(request_body, 0, NULL) : NULL;
+    const char* token = body ? json_string_value(json_object_get(body, "token")) : NULL;
+    int status = token ? auth_revoke_token(token) : AUTH_ERR_INVALID;
+    json_decref(body);
+
+    if (status == AUTH_OK || status == AUTH_ERR_REVOKED) {
+        json_t* body_json = json_object();
+        json_object_set_new(body_json, "success", json_true());
+        *response = create_json_response(body_json, 200);
+    } else if (status == AUTH_ERR_BUSY) {
+        *response = create_error_response("Too many revoked sessions, retry shortly", 503);
+    } else {
+        *response = create_error_response("Invalid token", 401);
+    }
+    return 0;
+}
+
+/**
+ * Handler for the user dashboard API endpoint
+ * GET /api/user/dashboard
+ */
+int user_get_dashboard(int user_id, const char* url, const char* query_string,
+                       const char* request_body, api_response_t* response) {
+    (void) url;
+    (void) query_string;
+    (void) request_body;
+
+    PGconn* conn = db_pool_acquire();
+    if (conn == NULL) {
+        *response = create_error_response("Database unavailable", 503);
+        return 0;
+    }
+    json_t* dashboard = user_dashboard_get(conn, user_id);
+    db_pool_release(conn);
+    if (!dashboard) {
+        *response = create_error_response("Could not load dashboard", 500);
+        return 0;
+    }
+
+    *response = create_json_response(dashboard, 200);
+    return 0;
+}
+
+// Run a user list loader on a pooled connection
+static int respond_with_user_list(int user_id, json_t* (*load)(PGconn*, int), api_response_t* response) {
+    PGconn* conn = db_pool_acquire();
+    if (conn == NULL) {
+        *response = create_error_response("Database unavailable", 503);
+        return 0;
+    }
+    json_t* list = load(conn, user_id);
+    db_pool_release(conn);
+    if (!list) {
+        *response = create_error_response("Could not load saved items", 500);
+        return 0;
+    }
+    *response = create_json_response(list, 200);
+    return 0;
+}
+
+// Answer an accepted write-behind mutation, or why it was not accepted
+static int respond_to_mutation(int status, json_t* body, int status_code, api_response_t* response) {
+    if (status == USER_WRITES_OK) {
+        json_object_set_new(body, "success", json_true());
+        *response = create_json_response(body, status_code);
+        return 0;
+    }
+    json_decref(body);
+    if (status == USER_WRITES_ERR_BUSY || status == USER_WRITES_ERR_NO_IDS) {
+        *response = create_error_response("Too many pending changes, retry shortly", 503);
+    } else {
+        *response = create_error_response("Could not save change", 500);
+    }
+    return 0;
+}
+
+/**
+ * Handler for saved properties API endpoint
+ * GET /api/user/saved-properties
+ */
+int user_get_saved_properties(int user_id, const char* url, const char* query_string,
+                              const char* request_body, api_response_t* response) {
+    (void) url;
+    (void) query_string;
+    (void) request_body;
+    return respond_with_user_list(user_id, user_saved_properties_get, response);
+}
+
+/**
+ * Handler for saving a property
+ * POST /api/user/saved-properties {"property_id": 123}
+ */
+int user_save_property(int user_id, const char* url, const char* query_string,
+                       const char* request_body, api_response_t* response) {
+    (void) url;
+    (void) query_string;
+
+    json_t* body = request_body ? json_loads(request_body, 0, NULL) : NULL;
+    json_t* id_value = body ? json_object_get(body, "property_id") : NULL;
+    int property_id = json_is_integer(id_value) ? (int) json_integer_value(id_value) : 0;
+    json_decref(body);
+    if (property_id <= 0) {
+        *response = create_error_response("property_id is required", 400);
+        return 0;
+    }
+    property_t property;
+    if (properties_find(property_id, &property) != 0) {
+        *response = create_error_response("Property not found", 404);
+        return 0;
+    }
+
+    json_t* result = json_object();
+    json_object_set_new(result, "property_id", json_integer(property_id));
+    return respond_to_mutation(user_writes_save_property(user_id, property_id), result, 200, response);
+}
+
+/**
+ * Handler for removing a saved property
+ * DELETE /api/user/saved-properties/:id
+ */
+int user_unsave_property(int user_id, const char* url, const char* query_string,
+                         const char* request_body, api_response_t* response) {
+    (void) query_string;
+    (void) request_body;
+
+    int property_id = 0;
+    if (sscanf(url, "/api/user/saved-properties/%d", &property_id) != 1 || property_id <= 0) {
+        *response = create_error_response("Invalid property id", 400);
+        return 0;
+    }
+
+    json_t* result = json_object();
+    json_object_set_new(result, "property_id", json_integer(property_id));
+    return respond_to_mutation(user_writes_unsave_property(user_id, property_id), result, 200, response);
+}
+
+/**
+ * Handler for saved searches API endpoint
+ * GET /api/user/saved-searches
+ */
+int user_get_saved_searches(int user_id, const char* url, const char* query_string,
+                            const char* request_body, api_response_t* response) {
+    (void) url;
+    (void) query_string;
+    (void) request_body;
+    return respond_with_user_list(user_id, user_saved_searches_get, response);
+}
+
+/**
+ * Handler for saving a search
+ * POST /api/user/saved-searches {"name": "...", "filters": {...}}
+ */
+int user_save_search(int user_id, const char* url, const char* query_string,
+                     const char* request_body, api_response_t* response) {
+    (void) url;
+    (void) query_string;
+
+    json_t* body = request_body ? json_loads(request_body, 0, NULL) : NULL;
+    json_t* name_value = body ? json_object_get(body, "name") : NULL;
+    json_t* filters = body ? json_object_get(body, "filters") : NULL;
+    const char* name = json_string_value(name_value);
+    if (!json_is_object(filters) || (name_value && !json_is_null(name_value) && !name) ||
+        (name && strlen(name) > 100)) {
+        json_decref(body);
+        *response = create_error_response("filters must be an object and name at most 100 characters", 400);
+        return 0;
+    }
+    char* params = json_dumps(filters, JSON_COMPACT);
+
+    user_search_row_t search;
+    int status = params ? user_writes_create_search(user_id, name, params, &search) : USER_WRITES_ERR_INTERNAL;
+    if (status == USER_WRITES_ERR_NO_IDS) {
+        // The flusher keeps ids in reserve; only a burst of saves runs out
+        PGconn* conn = db_pool_acquire();
+        if (conn != NULL) {
+            user_writes_reserve_ids(conn);
+            db_pool_release(conn);
+            status = user_writes_create_search(user_id, name, params, &search);
+        }
+    }
+    free(params);
+    json_decref(body);
+
+    json_t* result = json_object();
+    if (status == USER_WRITES_OK) {
+        char date[11];
+        struct tm tm_info;
+        localtime_r(&search.created_at, &tm_info);
+        strftime(date, sizeof(date), "%Y-%m-%d", &tm_info);
+        json_object_set_new(result, "search", user_saved_search_json(search.id, search.name, search.params, date));
+        user_writes_free_search_row(&search);
+    }
+    return respond_to_mutation(status, result, 201, response);
+}
+
+/**
+ * Handler for deleting a saved search
+ * DELETE /api/user/saved-searches/:id
+ */
+int user_delete_saved_search(int user_id, const char* url, const char* query_string,
+                             const char* request_body, api_response_t* response) {
+    (void) query_string;
+    (void) request_body;
+
+    int search_id = 0;
+    if (sscanf(url, "/api/user/saved-searches/%d", &search_id) != 1 || search_id <= 0) {
+        *response = create_error_response("Invalid search id", 400);
+        return 0;
+    }
+
+    json_t* result = json_object();
+    json_object_set_new(result, "search_id", json_integer(search_id));
+    return respond_to_mutation(user_writes_delete_search(user_id, search_id), result, 200, response);
 }
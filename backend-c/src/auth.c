@@ -1,10 +1,484 @@
 #include "include/auth.h"
+#include "include/db.h"
+#include "include/parallel.h"
 #include <stdio.h>
-int register_user(const char* email, const char* password) {
-    printf("[STUB] register_user called.\n");
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <crypt.h>
+#include <openssl/hmac.h>
+#include <openssl/evp.h>
+#include <openssl/sha.h>
+#include <openssl/rand.h>
+#include <openssl/crypto.h>
+
+#define SECRET_SIZE 32
+#define MAC_SIZE 32
+#define MAC_TEXT_LENGTH 43           // base64url of 32 bytes, unpadded
+#define MAX_PASSWORD_LENGTH 72       // bcrypt ignores anything longer
+
+// Checked when the email is unknown so that path costs a full bcrypt run
+static const char* DUMMY_HASH = "$2b$12$yZ/0K8e2WC583hVHBwZIIOAyHS01Yw6AlnBinUhnl/s4YlCE.gRbC";
+
+typedef enum {
+    HASH_JOB_HASH,
+    HASH_JOB_VERIFY
+} hash_job_kind_t;
+
+// Lives on the submitting thread's stack until done is set
+typedef struct hash_job {
+    hash_job_kind_t kind;
+    const char* password;
+    const char* hash;          // HASH_JOB_VERIFY: stored hash
+    char* out;                 // HASH_JOB_HASH: receives the new hash
+    size_t out_size;
+    int result;
+    int done;
+    struct hash_job* next;
+} hash_job_t;
+
+typedef struct {
+    uint64_t token_id;         // 0 = empty
+    time_t expires;
+} revoked_entry_t;
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t job_queued = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t job_done = PTHREAD_COND_INITIALIZER;
+static hash_job_t* queue_head = NULL;
+static hash_job_t* queue_tail = NULL;
+static size_t queue_length = 0;
+static pthread_t* workers = NULL;
+static int worker_count = 0;
+static int stopping = 0;
+
+static unsigned char secret[SECRET_SIZE];
+static size_t secret_length = 0;
+
+static pthread_rwlock_t revoked_lock = PTHREAD_RWLOCK_INITIALIZER;
+static revoked_entry_t revoked[AUTH_REVOCATION_CAPACITY];
+static size_t revoked_count = 0;
+
+static atomic_uint_fast64_t hashes_done = 0;
+static atomic_uint_fast64_t rejected_busy = 0;
+
+// ----- Password hash workers -----
+
+static int run_hash(const char* password, char* out, size_t out_size, struct crypt_data* data) {
+    char salt[CRYPT_GENSALT_OUTPUT_SIZE];
+    if (crypt_gensalt_rn("$2b$", AUTH_BCRYPT_COST, NULL, 0, salt, sizeof(salt)) == NULL) {
+        return AUTH_ERR_INTERNAL;
+    }
+    const char* hash = crypt_r(password, salt, data);
+    if (hash == NULL || hash[0] == '*' || strlen(hash) >= out_size) {
+        return AUTH_ERR_INTERNAL;
+    }
+    strcpy(out, hash);
+    return AUTH_OK;
+}
+
+static int run_verify(const char* password, const char* stored, struct crypt_data* data) {
+    const char* hash = crypt_r(password, stored, data);
+    if (hash == NULL || hash[0] == '*') {
+        return AUTH_ERR_INTERNAL;
+    }
+    size_t length = strlen(stored);
+    return strlen(hash) == length && CRYPTO_memcmp(hash, stored, length) == 0 ? AUTH_OK : AUTH_ERR_INVALID;
+}
+
+static void* hash_worker(void* arg) {
+    (void) arg;
+    // crypt_data is large (tens of KB); one per worker
+    struct crypt_data* data = calloc(1, sizeof(struct crypt_data));
+    pthread_mutex_lock(&pool_lock);
+    for (;;) {
+        while (queue_head == NULL && !stopping) {
+            pthread_cond_wait(&job_queued, &pool_lock);
+        }
+        if (queue_head == NULL) {
+            break;
+        }
+        hash_job_t* job = queue_head;
+        queue_head = job->next;
+        if (queue_head == NULL) {
+            queue_tail = NULL;
+        }
+        queue_length--;
+        pthread_mutex_unlock(&pool_lock);
+
+        int result = AUTH_ERR_INTERNAL;
+        if (data != NULL) {
+            result = job->kind == HASH_JOB_HASH ? run_hash(job->password, job->out, job->out_size, data)
+                                                : run_verify(job->password, job->hash, data);
+        }
+        atomic_fetch_add(&hashes_done, 1);
+
+        pthread_mutex_lock(&pool_lock);
+        job->result = result;
+        job->done = 1;
+        pthread_cond_broadcast(&job_done);
+    }
+    pthread_mutex_unlock(&pool_lock);
+    free(data);
+    return NULL;
+}
+
+// Queue a job and wait for it, or turn it away if the queue is full
+static int submit(hash_job_t* job) {
+    job->done = 0;
+    job->next = NULL;
+    pthread_mutex_lock(&pool_lock);
+    if (worker_count == 0 || stopping) {
+        pthread_mutex_unlock(&pool_lock);
+        return AUTH_ERR_INTERNAL;
+    }
+    if (queue_length >= AUTH_HASH_QUEUE_CAPACITY) {
+        pthread_mutex_unlock(&pool_lock);
+        atomic_fetch_add(&rejected_busy, 1);
+        return AUTH_ERR_BUSY;
+    }
+    if (queue_tail != NULL) {
+        queue_tail->next = job;
+    } else {
+        queue_head = job;
+    }
+    queue_tail = job;
+    queue_length++;
+    pthread_cond_signal(&job_queued);
+    while (!job->done) {
+        pthread_cond_wait(&job_done, &pool_lock);
+    }
+    pthread_mutex_unlock(&pool_lock);
+    return job->result;
+}
+
+int auth_hash_password(const char* password, char* out, size_t out_size) {
+    if (strlen(password) > MAX_PASSWORD_LENGTH) {
+        return AUTH_ERR_INVALID;
+    }
+    hash_job_t job = { .kind = HASH_JOB_HASH, .password = password, .out = out, .out_size = out_size };
+    return submit(&job);
+}
+
+int auth_verify_password(const char* password, const char* hash) {
+    if (strlen(password) > MAX_PASSWORD_LENGTH) {
+        return AUTH_ERR_INVALID;
+    }
+    hash_job_t job = { .kind = HASH_JOB_VERIFY, .password = password, .hash = hash };
+    return submit(&job);
+}
+
+int auth_generate_secret(char* out, size_t out_size) {
+    unsigned char key[SECRET_SIZE];
+    if (out_size < AUTH_SECRET_TEXT_LENGTH + 1 || RAND_bytes(key, SECRET_SIZE) != 1) {
+        return 1;
+    }
+    for (size_t i = 0; i < SECRET_SIZE; i++) {
+        snprintf(out + i * 2, 3, "%02x", key[i]);
+    }
+    OPENSSL_cleanse(key, sizeof(key));
     return 0;
 }
-int login_user(const char* email, const char* password) {
-    printf("[STUB] login_user called.\n");
+
+int auth_init(const char* key, int worker_threads) {
+    if (key != NULL && strlen(key) < SECRET_SIZE) {
+        fprintf(stderr, "Token signing key must be at least %d bytes\n", SECRET_SIZE);
+        return 1;
+    }
+    if (key != NULL) {
+        // Longer keys are folded to 32 bytes, as HMAC itself would do
+        SHA256((const unsigned char*) key, strlen(key), secret);
+    } else if (RAND_bytes(secret, SECRET_SIZE) != 1) {
+        return 1;
+    }
+    secret_length = SECRET_SIZE;
+
+    if (worker_threads <= 0) {
+        worker_threads = parallel_default_workers() / 2;
+    }
+    if (worker_threads < 1) {
+        worker_threads = 1;
+    }
+
+    pthread_mutex_lock(&pool_lock);
+    if (worker_count > 0) {
+        pthread_mutex_unlock(&pool_lock);
+        return 0;
+    }
+    workers = calloc((size_t) worker_threads, sizeof(pthread_t));
+    if (workers == NULL) {
+        pthread_mutex_unlock(&pool_lock);
+        return 1;
+    }
+    stopping = 0;
+    for (int i = 0; i < worker_threads; i++) {
+        if (pthread_create(&workers[worker_count], NULL, hash_worker, NULL) == 0) {
+            worker_count++;
+        }
+    }
+    int started = worker_count;
+    pthread_mutex_unlock(&pool_lock);
+    return started > 0 ? 0 : 1;
+}
+
+void auth_shutdown(void) {
+    pthread_mutex_lock(&pool_lock);
+    stopping = 1;
+    pthread_cond_broadcast(&job_queued);
+    int count = worker_count;
+    pthread_mutex_unlock(&pool_lock);
+
+    for (int i = 0; i < count; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    pthread_mutex_lock(&pool_lock);
+    free(workers);
+    workers = NULL;
+    worker_count = 0;
+    pthread_mutex_unlock(&pool_lock);
+}
+
+// ----- Tokens -----
+
+static void base64url(const unsigned char* in, size_t length, char* out) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+    size_t o = 0;
+    for (size_t i = 0; i < length; i += 3) {
+        size_t n = length - i < 3 ? length - i : 3;
+        uint32_t v = (uint32_t) in[i] << 16;
+        if (n > 1) {
+            v |= (uint32_t) in[i + 1] << 8;
+        }
+        if (n > 2) {
+            v |= in[i + 2];
+        }
+        // n input bytes give n + 1 output characters
+        for (size_t c = 0; c <= n; c++) {
+            out[o++] = alphabet[(v >> (18 - 6 * c)) & 63];
+        }
+    }
+    out[o] = '\0';
+}
+
+// MAC text of the signed part of a token
+static int sign(const char* payload, size_t length, char* out) {
+    unsigned char mac[MAC_SIZE];
+    unsigned int mac_length = 0;
+    if (secret_length == 0 ||
+        HMAC(EVP_sha256(), secret, (int) secret_length, (const unsigned char*) payload, length, mac, &mac_length) == NULL ||
+        mac_length != MAC_SIZE) {
+        return -1;
+    }
+    base64url(mac, MAC_SIZE, out);
     return 0;
 }
+
+int auth_issue_token(int user_id, char* out, size_t out_size, time_t* out_expires) {
+    uint64_t token_id = 0;
+    while (token_id == 0) {
+        if (RAND_bytes((unsigned char*) &token_id, sizeof(token_id)) != 1) {
+            return AUTH_ERR_INTERNAL;
+        }
+    }
+    time_t expires = time(NULL) + AUTH_TOKEN_TTL_SECONDS;
+    char payload[64];
+    int length = snprintf(payload, sizeof(payload), "%d.%lld.%016" PRIx64, user_id, (long long) expires, token_id);
+    char mac[MAC_TEXT_LENGTH + 1];
+    if (sign(payload, (size_t) length, mac) != 0 || (size_t) length + 1 + MAC_TEXT_LENGTH + 1 > out_size) {
+        return AUTH_ERR_INTERNAL;
+    }
+    snprintf(out, out_size, "%s.%s", payload, mac);
+    if (out_expires != NULL) {
+        *out_expires = expires;
+    }
+    return AUTH_OK;
+}
+
+// Check the MAC and expiry; fills the claims of a valid token
+static int parse_token(const char* token, int* user_id, time_t* expires, uint64_t* token_id) {
+    const char* mac = strrchr(token, '.');
+    if (mac == NULL || strlen(mac + 1) != MAC_TEXT_LENGTH || (size_t) (mac - token) >= 64) {
+        return AUTH_ERR_INVALID;
+    }
+    char expected[MAC_TEXT_LENGTH + 1];
+    if (sign(token, (size_t) (mac - token), expected) != 0 ||
+        CRYPTO_memcmp(expected, mac + 1, MAC_TEXT_LENGTH) != 0) {
+        return AUTH_ERR_INVALID;
+    }
+
+    // Signed by us, so the fields are well formed
+    long long expiry = 0;
+    if (sscanf(token, "%d.%lld.%" SCNx64, user_id, &expiry, token_id) != 3 || expiry <= time(NULL)) {
+        return AUTH_ERR_INVALID;
+    }
+    *expires = (time_t) expiry;
+    return AUTH_OK;
+}
+
+static size_t revoked_slot(uint64_t token_id) {
+    return (size_t) (token_id * 0x9E3779B97F4A7C15ULL >> 48) & (AUTH_REVOCATION_CAPACITY - 1);
+}
+
+static int is_revoked(uint64_t token_id) {
+    int found = 0;
+    pthread_rwlock_rdlock(&revoked_lock);
+    if (revoked_count > 0) {
+        for (size_t i = revoked_slot(token_id); revoked[i].token_id != 0; i = (i + 1) & (AUTH_REVOCATION_CAPACITY - 1)) {
+            if (revoked[i].token_id == token_id) {
+                found = 1;
+                break;
+            }
+        }
+    }
+    pthread_rwlock_unlock(&revoked_lock);
+    return found;
+}
+
+int auth_verify_token(const char* token, int* out_user_id) {
+    int user_id;
+    time_t expires;
+    uint64_t token_id;
+    int rc = parse_token(token, &user_id, &expires, &token_id);
+    if (rc != AUTH_OK) {
+        return rc;
+    }
+    if (is_revoked(token_id)) {
+        return AUTH_ERR_REVOKED;
+    }
+    *out_user_id = user_id;
+    return AUTH_OK;
+}
+
+// Drop expired entries by rebuilding the table; caller holds the write lock
+static void purge_expired_locked(void) {
+    static revoked_entry_t live[AUTH_REVOCATION_CAPACITY];
+    time_t now = time(NULL);
+    size_t kept = 0;
+    for (size_t i = 0; i < AUTH_REVOCATION_CAPACITY; i++) {
+        if (revoked[i].token_id != 0 && revoked[i].expires > now) {
+            live[kept++] = revoked[i];
+        }
+    }
+    memset(revoked, 0, sizeof(revoked));
+    for (size_t k = 0; k < kept; k++) {
+        size_t i = revoked_slot(live[k].token_id);
+        while (revoked[i].token_id != 0) {
+            i = (i + 1) & (AUTH_REVOCATION_CAPACITY - 1);
+        }
+        revoked[i] = live[k];
+    }
+    revoked_count = kept;
+}
+
+int auth_revoke_token(const char* token) {
+    int user_id;
+    time_t expires;
+    uint64_t token_id;
+    int rc = parse_token(token, &user_id, &expires, &token_id);
+    if (rc != AUTH_OK) {
+        return rc;
+    }
+
+    pthread_rwlock_wrlock(&revoked_lock);
+    // Keep the table at most 3/4 full so probes stay short
+    if (revoked_count + 1 > AUTH_REVOCATION_CAPACITY / 4 * 3) {
+        purge_expired_locked();
+    }
+    if (revoked_count + 1 > AUTH_REVOCATION_CAPACITY / 4 * 3) {
+        pthread_rwlock_unlock(&revoked_lock);
+        return AUTH_ERR_BUSY;
+    }
+    size_t i = revoked_slot(token_id);
+    while (revoked[i].token_id != 0 && revoked[i].token_id != token_id) {
+        i = (i + 1) & (AUTH_REVOCATION_CAPACITY - 1);
+    }
+    rc = revoked[i].token_id == token_id ? AUTH_ERR_REVOKED : AUTH_OK;
+    if (rc == AUTH_OK) {
+        revoked[i].token_id = token_id;
+        revoked[i].expires = expires;
+        revoked_count++;
+    }
+    pthread_rwlock_unlock(&revoked_lock);
+    return rc;
+}
+
+// ----- Users -----
+
+static void copy_field(char* out, size_t size, const char* value) {
+    snprintf(out, size, "%s", value != NULL ? value : "");
+}
+
+static void fill_user(PGresult* res, auth_user_t* out) {
+    out->id = atoi(PQgetvalue(res, 0, 0));
+    copy_field(out->email, sizeof(out->email), PQgetvalue(res, 0, 1));
+    copy_field(out->first_name, sizeof(out->first_name), PQgetvalue(res, 0, 2));
+    copy_field(out->last_name, sizeof(out->last_name), PQgetvalue(res, 0, 3));
+    out->is_admin = strcmp(PQgetvalue(res, 0, 4), "t") == 0;
+}
+
+int register_user(const char* email, const char* password, const char* first_name, const char* last_name,
+                  auth_user_t* out) {
+    char hash[CRYPT_OUTPUT_SIZE];
+    int rc = auth_hash_password(password, hash, sizeof(hash));
+    if (rc != AUTH_OK) {
+        return rc;
+    }
+
+    PGconn* conn = db_pool_acquire();
+    if (conn == NULL) {
+        return AUTH_ERR_INTERNAL;
+    }
+    const char* params[4] = { email, hash, first_name, last_name };
+    PGresult* res = db_query_params(conn,
+        "INSERT INTO users (email, password_hash, first_name, last_name) VALUES ($1, $2, $3, $4) "
+        "ON CONFLICT (email) DO NOTHING RETURNING id, email, first_name, last_name, is_admin",
+        4, params);
+    db_pool_release(conn);
+    if (res == NULL) {
+        return AUTH_ERR_INTERNAL;
+    }
+    rc = PQntuples(res) == 1 ? AUTH_OK : AUTH_ERR_EXISTS;
+    if (rc == AUTH_OK) {
+        fill_user(res, out);
+    }
+    PQclear(res);
+    return rc;
+}
+
+int login_user(const char* email, const char* password, auth_user_t* out) {
+    PGconn* conn = db_pool_acquire();
+    if (conn == NULL) {
+        return AUTH_ERR_INTERNAL;
+    }
+    const char* params[1] = { email };
+    PGresult* res = db_query_params(conn,
+        "SELECT id, email, first_name, last_name, is_admin, password_hash FROM users WHERE email = $1",
+        1, params);
+    db_pool_release(conn);
+    if (res == NULL) {
+        return AUTH_ERR_INTERNAL;
+    }
+
+    int found = PQntuples(res) == 1;
+    int rc = auth_verify_password(password, found ? PQgetvalue(res, 0, 5) : DUMMY_HASH);
+    if (rc == AUTH_OK && found) {
+        fill_user(res, out);
+    } else if (rc == AUTH_OK) {
+        rc = AUTH_ERR_INVALID;
+    }
+    PQclear(res);
+    return rc;
+}
+
+void auth_get_stats(auth_stats_t* out) {
+    out->hashes = atomic_load(&hashes_done);
+    out->rejected_busy = atomic_load(&rejected_busy);
+    pthread_mutex_lock(&pool_lock);
+    out->queue_length = queue_length;
+    pthread_mutex_unlock(&pool_lock);
+    pthread_rwlock_rdlock(&revoked_lock);
+    out->revoked = revoked_count;
+    pthread_rwlock_unlock(&revoked_lock);
+}
@@ -0,0 +1,264 @@
+#include "include/backtest.h"
+#include "include/series_store.h"
+#include "include/parallel.h"
+#include "include/rng.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+
+typedef struct {
+    const backtest_series_t* series;
+    const backtest_config_t* config;
+    backtest_result_t* results;
+} backtest_job_t;
+
+backtest_config_t backtest_default_config(int horizon) {
+    backtest_config_t config = {
+        .model = NULL,
+        .horizon = horizon,
+        .min_train = 12,
+        .window = 0,
+        .interval_z = 1.2816  // 80% two-sided interval
+    };
+    return config;
+}
+
+// Walk forward through one series, scoring every origin whose target
+// month exists. Models are fit on the series spread over consecutive
+// months (see forecast_fill_gaps), so horizons and the seasonal phase
+// count calendar months; each origin ends on an observed month, so a
+// filled month never uses prices from after the origin.
+void backtest_evaluate(const backtest_series_t* s, const backtest_config_t* config, backtest_result_t* r) {
+    memset(r, 0, sizeof(*r));
+    r->district_id = s->district_id;
+    r->room_count = s->room_count;
+
+    const forecast_model_t* model = config->model ? config->model : forecast_model_find("linear_regression");
+    int min_train = config->min_train > 2 ? config->min_train : 2;
+    if (min_train < model->min_points) {
+        min_train = model->min_points;
+    }
+    int span = forecast_fill_gaps(s->months, s->prices, s->count, NULL);
+    double* filled = span > 0 ? malloc(sizeof(double) * (size_t) span) : NULL;
+    if (filled == NULL) {
+        return;
+    }
+    forecast_fill_gaps(s->months, s->prices, s->count, filled);
+
+    double abs_sum = 0.0, pct_sum = 0.0;
+    int covered = 0, scored = 0;
+    int target_index = 0;
+
+    for (int origin = 0; origin < s->count; origin++) {
+        // Training: the months up to and including this observed one
+        int t = s->months[origin] - s->months[0] + 1;
+        if (t < min_train) {
+            continue;
+        }
+        int start = (config->window > 0 && t > config->window) ? t - config->window : 0;
+        if (t - start < model->min_points) {
+            continue;
+        }
+        int last_month = s->months[origin];
+        int target_month = last_month + config->horizon;
+
+        // Targets only move forward as the origin advances
+        if (target_index <= origin) {
+            target_index = origin + 1;
+        }
+        while (target_index < s->count && s->months[target_index] < target_month) {
+            target_index++;
+        }
+        if (target_index >= s->count) {
+            break;
+        }
+        if (s->months[target_index] != target_month) {
+            continue;
+        }
+
+        forecast_fit_t fit;
+        if (model->fit(filled + start, t - start, last_month % FORECAST_SEASON_LENGTH, &fit) != 0) {
+            continue;
+        }
+        double std_error = 0.0;
+        double forecast = model->forecast(&fit, config->horizon, &std_error);
+        double actual = s->prices[target_index];
+        double error = fabs(actual - forecast);
+
+        abs_sum += error;
+        if (actual != 0.0) {
+            pct_sum += error / fabs(actual);
+        }
+        if (error <= config->interval_z * std_error) {
+            covered++;
+        }
+        scored++;
+    }
+    free(filled);
+
+    if (scored > 0) {
+        r->forecasts = scored;
+        r->mae = abs_sum / scored;
+        r->mape = 100.0 * pct_sum / scored;
+        r->coverage = (double) covered / scored;
+    }
+}
+
+static void backtest_task(size_t begin, size_t end, int worker, void* ctx) {
+    (void) worker;
+    backtest_job_t* job = ctx;
+    for (size_t i = begin; i < end; i++) {
+        backtest_evaluate(&job->series[i], job->config, &job->results[i]);
+    }
+}
+
+int backtest_run(const backtest_series_t* series, size_t count, const backtest_config_t* config,
+                 int workers, backtest_result_t* results, backtest_summary_t* summary) {
+    memset(summary, 0, sizeof(*summary));
+    if (count == 0) {
+        return 0;
+    }
+
+    backtest_result_t* owned = NULL;
+    if (results == NULL) {
+        owned = malloc(sizeof(backtest_result_t) * count);
+        if (owned == NULL) {
+            return 1;
+        }
+        results = owned;
+    }
+
+    backtest_job_t job = { .series = series, .config = config, .results = results };
+    if (parallel_for(count, 4, workers, backtest_task, &job) < 0) {
+        free(owned);
+        return 1;
+    }
+
+    double abs_sum = 0.0, pct_sum = 0.0, covered = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        const backtest_result_t* r = &results[i];
+        if (r->forecasts == 0) {
+            continue;
+        }
+        summary->series++;
+        summary->forecasts += r->forecasts;
+        abs_sum += r->mae * r->forecasts;
+        pct_sum += r->mape * r->forecasts;
+        covered += r->coverage * r->forecasts;
+    }
+    if (summary->forecasts > 0) {
+        summary->mae = abs_sum / summary->forecasts;
+        summary->mape = pct_sum / summary->forecasts;
+        summary->coverage = covered / summary->forecasts;
+    }
+
+    free(owned);
+    return 0;
+}
+
+backtest_series_t* backtest_load_store(size_t* out_count) {
+    *out_count = 0;
+    size_t n = series_store_count();
+    if (n == 0) {
+        return NULL;
+    }
+
+    backtest_series_t* series = calloc(n, sizeof(backtest_series_t));
+    if (series == NULL) {
+        return NULL;
+    }
+
+    size_t loaded = 0;
+    for (size_t i = 0; i < n; i++) {
+        int district_id = 0, room_count = 0, points = 0;
+        if (series_store_key(i, &district_id, &room_count) != 0) {
+            break;
+        }
+        price_history_row_t* rows = series_store_get_series(district_id, room_count, INT_MAX, &points);
+        if (rows == NULL) {
+            continue;
+        }
+
+        backtest_series_t* s = &series[loaded];
+        s->district_id = district_id;
+        s->room_count = room_count;
+        s->count = points;
+        s->months = malloc(sizeof(int) * (size_t) points);
+        s->prices = malloc(sizeof(double) * (size_t) points);
+        if (s->months == NULL || s->prices == NULL) {
+            free(rows);
+            backtest_free_series(series, loaded + 1);
+            return NULL;
+        }
+        for (int j = 0; j < points; j++) {
+            s->months[j] = rows[j].month;
+            s->prices[j] = rows[j].avg_price_per_sqm;
+        }
+        free(rows);
+        loaded++;
+    }
+
+    *out_count = loaded;
+    return series;
+}
+
+backtest_series_t* backtest_generate_synthetic(size_t count, int length, uint64_t seed) {
+    backtest_series_t* series = calloc(count ? count : 1, sizeof(backtest_series_t));
+    if (series == NULL) {
+        return NULL;
+    }
+
+    rng_t rng;
+    rng_seed(&rng, seed);
+    static const double quarter_factor[4] = { 0.98, 1.03, 1.01, 0.99 };
+    for (size_t i = 0; i < count; i++) {
+        backtest_series_t* s = &series[i];
+        s->district_id = 0;
+        s->room_count = (int) i + 1;
+        s->count = length;
+        s->months = malloc(sizeof(int) * (size_t) length);
+        s->prices = malloc(sizeof(double) * (size_t) length);
+        if (s->months == NULL || s->prices == NULL) {
+            backtest_free_series(series, i + 1);
+            return NULL;
+        }
+
+        double level = 700.0 + 400.0 * rng_uniform(&rng);
+        double drift = 0.012 * (rng_uniform(&rng) - 0.3);   // -0.36% .. +0.84% per month
+        double noise = 0.005 + 0.02 * rng_uniform(&rng);
+        int first_month = 12 * 30 + (int) rng_below(&rng, 12);
+
+        for (int j = 0; j < length; j++) {
+            int month = first_month + j;
+            level *= 1.0 + drift;
+            s->months[j] = month;
+            s->prices[j] = level * quarter_factor[(month % 12) / 3] * (1.0 + noise * rng_gaussian(&rng));
+        }
+    }
+    return series;
+}
+
+void backtest_free_series(backtest_series_t* series, size_t count) {
+    if (series == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        free(series[i].months);
+        free(series[i].prices);
+    }
+    free(series);
+}
+
+void backtest_write_csv(FILE* out, const backtest_config_t* config,
+                        const backtest_result_t* results, size_t count, int header) {
+    const char* model = config->model ? config->model->name : "linear_regression";
+    if (header) {
+        fprintf(out, "model,district_id,room_count,horizon,window,forecasts,mae,mape,coverage\n");
+    }
+    for (size_t i = 0; i < count; i++) {
+        const backtest_result_t* r = &results[i];
+        fprintf(out, "%s,%d,%d,%d,%d,%d,%.4f,%.4f,%.4f\n", model, r->district_id, r->room_count,
+                config->horizon, config->window, r->forecasts, r->mae, r->mape, r->coverage);
+    }
+}
@@ -0,0 +1,201 @@
+#include "include/backtest.h"
+#include "include/series_store.h"
+#include "include/db.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_SWEEP_VALUES 16
+
+static void print_usage(const char* program) {
+    printf("Usage: %s [options]\n", program);
+    printf("\n");
+    printf("Walk-forward backtest of the price forecasting models.\n");
+    printf("\n");
+    printf("Options:\n");
+    printf("  --store PATH       Series store to evaluate (default %s)\n", SERIES_STORE_DEFAULT_PATH);
+    printf("  --db CONNINFO      Rebuild the series store from price_history first\n");
+    printf("  --synthetic N      Evaluate N synthetic series instead of the store\n");
+    printf("  --length L         Points per synthetic series (default 120)\n");
+    printf("  --seed S           Seed for synthetic series (default 1)\n");
+    printf("  --horizons LIST    Comma-separated horizons in months (default 6,12)\n");
+    printf("  --windows LIST     Comma-separated training windows in months, 0 = expanding (default 0)\n");
+    printf("  --models LIST      Comma-separated models (default: all registered)\n");
+    printf("  --min-train N      Minimum months of training history (default 12)\n");
+    printf("  --workers N        Worker threads (default: CPU count)\n");
+    printf("  --csv FILE         Write per-series results to FILE\n");
+}
+
+static int parse_list(const char* text, int* values, int max) {
+    int n = 0;
+    char copy[256];
+    snprintf(copy, sizeof(copy), "%s", text);
+    for (char* token = strtok(copy, ","); token != NULL && n < max; token = strtok(NULL, ",")) {
+        values[n++] = atoi(token);
+    }
+    return n;
+}
+
+static double elapsed_ms(struct timespec start, struct timespec end) {
+    return (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1e6;
+}
+
+int main(int argc, char** argv) {
+    const char* store_path = SERIES_STORE_DEFAULT_PATH;
+    const char* conn_info = NULL;
+    const char* csv_path = NULL;
+    size_t synthetic = 0;
+    int length = 120;
+    unsigned long long seed = 1;
+    int horizons[MAX_SWEEP_VALUES] = { 6, 12 };
+    int horizon_count = 2;
+    int windows[MAX_SWEEP_VALUES] = { 0 };
+    int window_count = 1;
+    int min_train = 12;
+    int workers = 0;
+    const forecast_model_t* models[MAX_SWEEP_VALUES];
+    int model_count = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        }
+        if (value == NULL) {
+            fprintf(stderr, "Missing value for %s\n", arg);
+            return 1;
+        }
+        if (strcmp(arg, "--store") == 0) {
+            store_path = value;
+        } else if (strcmp(arg, "--db") == 0) {
+            conn_info = value;
+        } else if (strcmp(arg, "--synthetic") == 0) {
+            synthetic = (size_t) strtoull(value, NULL, 10);
+        } else if (strcmp(arg, "--length") == 0) {
+            length = atoi(value);
+        } else if (strcmp(arg, "--seed") == 0) {
+            seed = strtoull(value, NULL, 10);
+        } else if (strcmp(arg, "--horizons") == 0) {
+            horizon_count = parse_list(value, horizons, MAX_SWEEP_VALUES);
+        } else if (strcmp(arg, "--windows") == 0) {
+            window_count = parse_list(value, windows, MAX_SWEEP_VALUES);
+        } else if (strcmp(arg, "--models") == 0) {
+            char copy[256];
+            snprintf(copy, sizeof(copy), "%s", value);
+            for (char* name = strtok(copy, ","); name != NULL && model_count < MAX_SWEEP_VALUES; name = strtok(NULL, ",")) {
+                models[model_count] = forecast_model_find(name);
+                if (models[model_count] == NULL) {
+                    fprintf(stderr, "Unknown model: %s\n", name);
+                    return 1;
+                }
+                model_count++;
+            }
+        } else if (strcmp(arg, "--min-train") == 0) {
+            min_train = atoi(value);
+        } else if (strcmp(arg, "--workers") == 0) {
+            workers = atoi(value);
+        } else if (strcmp(arg, "--csv") == 0) {
+            csv_path = value;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", arg);
+            print_usage(argv[0]);
+            return 1;
+        }
+        i++;
+    }
+
+    if (model_count == 0) {
+        int registered = 0;
+        const forecast_model_t* all = forecast_models(&registered);
+        for (int m = 0; m < registered && m < MAX_SWEEP_VALUES; m++) {
+            models[model_count++] = &all[m];
+        }
+    }
+
+    // Collect the series to evaluate
+    backtest_series_t* series = NULL;
+    size_t series_count = 0;
+    if (synthetic > 0) {
+        series = backtest_generate_synthetic(synthetic, length, seed);
+        series_count = series ? synthetic : 0;
+        printf("Source: %zu synthetic series x %d months (seed %llu)\n", series_count, length, seed);
+    } else {
+        if (conn_info != NULL) {
+            PGconn* conn = db_connect(conn_info);
+            if (conn == NULL || series_store_rebuild_from_db(conn, store_path) != 0) {
+                fprintf(stderr, "Failed to rebuild %s from price_history\n", store_path);
+                db_disconnect(conn);
+                return 1;
+            }
+            db_disconnect(conn);
+        } else if (series_store_open(store_path) != 0) {
+            fprintf(stderr, "Cannot open series store %s\n", store_path);
+            return 1;
+        }
+        series = backtest_load_store(&series_count);
+        printf("Source: %s (%zu series)\n", store_path, series_count);
+    }
+    if (series_count == 0) {
+        fprintf(stderr, "No series to evaluate\n");
+        backtest_free_series(series, series_count);
+        return 1;
+    }
+
+    FILE* csv = NULL;
+    if (csv_path != NULL && (csv = fopen(csv_path, "w")) == NULL) {
+        fprintf(stderr, "Cannot write %s\n", csv_path);
+        backtest_free_series(series, series_count);
+        return 1;
+    }
+
+    backtest_result_t* results = malloc(sizeof(backtest_result_t) * series_count);
+    if (results == NULL) {
+        backtest_free_series(series, series_count);
+        return 1;
+    }
+
+    printf("\n%-18s %7s %6s %7s %10s %10s %8s %9s %10s\n",
+           "model", "horizon", "window", "series", "forecasts", "MAE", "MAPE%", "coverage", "time_ms");
+
+    int rc = 0;
+    int csv_header = 1;
+    for (int m = 0; m < model_count; m++) {
+        for (int h = 0; h < horizon_count; h++) {
+            for (int w = 0; w < window_count; w++) {
+                backtest_config_t config = backtest_default_config(horizons[h]);
+                config.model = models[m];
+                config.window = windows[w];
+                config.min_train = min_train;
+
+                backtest_summary_t summary;
+                struct timespec start, end;
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                if (backtest_run(series, series_count, &config, workers, results, &summary) != 0) {
+                    fprintf(stderr, "Backtest failed for horizon %d, window %d\n", config.horizon, config.window);
+                    rc = 1;
+                    continue;
+                }
+                clock_gettime(CLOCK_MONOTONIC, &end);
+
+                printf("%-18s %7d %6d %7d %10ld %10.2f %8.2f %8.1f%% %10.1f\n",
+                       config.model->name, config.horizon, config.window, summary.series, summary.forecasts,
+                       summary.mae, summary.mape, summary.coverage * 100.0, elapsed_ms(start, end));
+
+                if (csv != NULL) {
+                    backtest_write_csv(csv, &config, results, series_count, csv_header);
+                    csv_header = 0;
+                }
+            }
+        }
+    }
+
+    if (csv != NULL) {
+        fclose(csv);
+    }
+    free(results);
+    backtest_free_series(series, series_count);
+    return rc;
+}
@@ -0,0 +1,129 @@
+#include "include/bootstrap.h"
+#include "include/utils.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*) a;
+    double y = *(const double*) b;
+    return (x > y) - (x < y);
+}
+
+// Linear interpolation between order statistics of a sorted sample
+static double quantile_sorted(const double* sorted, int n, double q) {
+    double position = q * (n - 1);
+    int lower = (int) position;
+    if (lower >= n - 1) {
+        return sorted[n - 1];
+    }
+    double fraction = position - lower;
+    return sorted[lower] + fraction * (sorted[lower + 1] - sorted[lower]);
+}
+
+int forecast_bootstrap(const forecast_model_t* model, const double* prices, int count, int base_month,
+                       const int* horizons, int horizon_count, int resamples, rng_t* rng,
+                       price_band_t* out_bands) {
+    memset(out_bands, 0, sizeof(price_band_t) * (size_t) horizon_count);
+
+    forecast_fit_t fit;
+    if (count < model->min_points || resamples < 2 || model->fit(prices, count, base_month, &fit) != 0) {
+        return 1;
+    }
+
+    // One buffer: residuals, drawn residuals, a perturbed copy of the
+    // prices, then per horizon the weights and the samples
+    size_t doubles = (size_t) count * 3 + (size_t) horizon_count * ((size_t) count + (size_t) resamples);
+    double* buffer = malloc(sizeof(double) * doubles);
+    double* point = malloc(sizeof(double) * (size_t) horizon_count * 3);
+    if (buffer == NULL || point == NULL) {
+        free(buffer);
+        free(point);
+        return 1;
+    }
+    double* residuals = buffer;
+    double* drawn = residuals + count;
+    double* perturbed = drawn + count;
+    double* weights = perturbed + count;
+    double* samples = weights + (size_t) horizon_count * count;
+    double* noise_scale = point + horizon_count;
+    double* offset = noise_scale + horizon_count;
+
+    int k = model->residuals(prices, count, &fit, residuals);
+    if (k < 2) {
+        free(buffer);
+        free(point);
+        return 1;
+    }
+    // Residuals belong to the last k points; center them
+    int first = count - k;
+    double mean = 0.0;
+    for (int j = 0; j < k; j++) {
+        mean += residuals[j];
+    }
+    mean /= k;
+    for (int j = 0; j < k; j++) {
+        residuals[j] -= mean;
+    }
+
+    for (int h = 0; h < horizon_count; h++) {
+        double std_error = 0.0;
+        point[h] = model->forecast(&fit, horizons[h], &std_error);
+        noise_scale[h] = fit.residual_sd > 0.0 ? std_error / fit.residual_sd : 1.0;
+    }
+
+    // Forecast weight of each price that has a residual: the response of
+    // the refit forecast to a unit change of that price
+    memcpy(perturbed, prices, sizeof(double) * (size_t) count);
+    for (int j = 0; j < k; j++) {
+        forecast_fit_t shifted = fit;
+        perturbed[first + j] += 1.0;
+        int rc = model->refit(perturbed, count, base_month, &shifted);
+        perturbed[first + j] = prices[first + j];
+        for (int h = 0; h < horizon_count; h++) {
+            weights[(size_t) h * count + j] = rc == 0 ? model->forecast(&shifted, horizons[h], NULL) - point[h] : 0.0;
+        }
+    }
+
+    // The refits already spread the forecast by the estimation error, so
+    // remove it from standard errors that include it (its variance is
+    // sd^2 * |weights|^2)
+    if (model->std_error_includes_estimation) {
+        for (int h = 0; h < horizon_count; h++) {
+            const double* w = &weights[(size_t) h * count];
+            double future = noise_scale[h] * noise_scale[h] - dot_product(w, w, k);
+            noise_scale[h] = future > 0.0 ? sqrt(future) : 0.0;
+        }
+    }
+
+    // Pseudo-series are fitted + drawn = prices - residuals + drawn, so
+    // the point forecast moves by weights . (drawn - residuals)
+    for (int h = 0; h < horizon_count; h++) {
+        offset[h] = point[h] - dot_product(&weights[(size_t) h * count], residuals, k);
+    }
+
+    for (int b = 0; b < resamples; b++) {
+        // Gather the draws first so the dot products run over contiguous
+        // arrays
+        for (int j = 0; j < k; j++) {
+            drawn[j] = residuals[rng_below(rng, (uint32_t) k)];
+        }
+        for (int h = 0; h < horizon_count; h++) {
+            double sum = dot_product(&weights[(size_t) h * count], drawn, k);
+            double future_error = noise_scale[h] * residuals[rng_below(rng, (uint32_t) k)];
+            samples[(size_t) h * resamples + b] = offset[h] + sum + future_error;
+        }
+    }
+
+    for (int h = 0; h < horizon_count; h++) {
+        double* sorted = &samples[(size_t) h * resamples];
+        qsort(sorted, (size_t) resamples, sizeof(double), compare_doubles);
+        out_bands[h].p10 = quantile_sorted(sorted, resamples, 0.10);
+        out_bands[h].p50 = quantile_sorted(sorted, resamples, 0.50);
+        out_bands[h].p90 = quantile_sorted(sorted, resamples, 0.90);
+    }
+
+    free(buffer);
+    free(point);
+    return 0;
+}
@@ -0,0 +1,453 @@
+#include "include/comparables.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <limits.h>
+#include <pthread.h>
+
+#define D COMPARABLES_DIMENSIONS
+#define LANES 8
+#define KM_PER_DEGREE 111.32
+#define NEIGHBORHOOD_KM 2.0    // Coordinate distance worth one standard deviation
+
+// Weights of the attribute dimensions (coordinates are weighted by
+// NEIGHBORHOOD_KM instead)
+static const double WEIGHTS[4] = { 1.0, 0.7, 0.3, 0.5 };
+
+// Eight single-precision lanes; GCC lowers this to whatever vector
+// registers the target has (two SSE registers on baseline x86-64)
+typedef float float_lanes_t __attribute__((vector_size(LANES * sizeof(float))));
+
+typedef struct {
+    int district_id;
+    int num_rooms;
+    size_t begin;
+    size_t end;
+} partition_t;
+
+typedef struct {
+    size_t count;
+    float* dims[D];            // Normalized features, one array per dimension
+    int* ids;
+    int* district_ids;
+    int* rooms;
+    int* areas;
+    int* prices;
+    unsigned char* statuses;
+    double mean[D];
+    double scale[D];
+    double km_per_lon_degree;
+    partition_t* partitions;   // Sorted by (district, rooms)
+    size_t partition_count;
+} comparables_index_t;
+
+typedef struct {
+    float distance;
+    size_t row;
+} heap_entry_t;
+
+static pthread_rwlock_t index_lock = PTHREAD_RWLOCK_INITIALIZER;
+static comparables_index_t* current_index = NULL;
+
+comparables_query_t comparables_default_query(void) {
+    comparables_query_t query = { .k = 5, .same_district = 1, .rooms_tolerance = 1 };
+    return query;
+}
+
+comparables_query_t comparables_parse_query(const char* query_string) {
+    comparables_query_t query = comparables_default_query();
+    if (query_string == NULL) {
+        return query;
+    }
+    char query_copy[256];
+    char* saveptr = NULL;
+    snprintf(query_copy, sizeof(query_copy), "%s", query_string);
+
+    for (char* token = strtok_r(query_copy, "&", &saveptr); token; token = strtok_r(NULL, "&", &saveptr)) {
+        if (strncmp(token, "k=", 2) == 0) {
+            query.k = atoi(token + 2);
+        } else if (strcmp(token, "scope=all") == 0) {
+            query.same_district = 0;
+        } else if (strcmp(token, "scope=district") == 0) {
+            query.same_district = 1;
+        } else if (strncmp(token, "rooms=", 6) == 0) {
+            query.rooms_tolerance = atoi(token + 6);
+        }
+    }
+    return query;
+}
+
+static void index_free(comparables_index_t* index) {
+    if (index == NULL) {
+        return;
+    }
+    for (int d = 0; d < D; d++) {
+        free(index->dims[d]);
+    }
+    free(index->ids);
+    free(index->district_ids);
+    free(index->rooms);
+    free(index->areas);
+    free(index->prices);
+    free(index->statuses);
+    free(index->partitions);
+    free(index);
+}
+
+// Raw (unnormalized) features; NAN marks a missing value
+static void raw_features(const property_t* p, double km_per_lon_degree, double* out) {
+    out[0] = p->area_sqm > 0 ? log((double) p->area_sqm) : NAN;
+    out[1] = p->num_rooms > 0 ? (double) p->num_rooms : NAN;
+    out[2] = (p->floor > 0 && p->total_floors > 0) ? (double) p->floor / p->total_floors : NAN;
+    out[3] = p->year_built > 0 ? (double) p->year_built : NAN;
+    if (p->latitude != 0.0 || p->longitude != 0.0) {
+        out[4] = p->latitude * KM_PER_DEGREE;
+        out[5] = p->longitude * km_per_lon_degree;
+    } else {
+        out[4] = out[5] = NAN;
+    }
+}
+
+static void normalize(const comparables_index_t* index, const double* raw, float* out) {
+    for (int d = 0; d < D; d++) {
+        out[d] = isnan(raw[d]) ? 0.0f : (float) ((raw[d] - index->mean[d]) * index->scale[d]);
+    }
+}
+
+static int compare_rows(const void* a, const void* b, void* ctx) {
+    const property_t* listings = ctx;
+    const property_t* x = &listings[*(const size_t*) a];
+    const property_t* y = &listings[*(const size_t*) b];
+    if (x->district_id != y->district_id) {
+        return x->district_id < y->district_id ? -1 : 1;
+    }
+    if (x->num_rooms != y->num_rooms) {
+        return x->num_rooms < y->num_rooms ? -1 : 1;
+    }
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+static comparables_index_t* index_build(const property_t* listings, size_t n) {
+    comparables_index_t* index = calloc(1, sizeof(comparables_index_t));
+    size_t* order = malloc(sizeof(size_t) * (n ? n : 1));
+    double* raw = malloc(sizeof(double) * D * (n ? n : 1));
+    if (index == NULL || order == NULL || raw == NULL) {
+        free(order);
+        free(raw);
+        index_free(index);
+        return NULL;
+    }
+
+    // Longitude degrees shrink with latitude; use the mean latitude
+    double lat_sum = 0.0;
+    size_t located = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (listings[i].latitude != 0.0 || listings[i].longitude != 0.0) {
+            lat_sum += listings[i].latitude;
+            located++;
+        }
+    }
+    index->km_per_lon_degree = KM_PER_DEGREE * cos((located ? lat_sum / located : 0.0) * M_PI / 180.0);
+
+    // Partition order: (district, rooms, id)
+    for (size_t i = 0; i < n; i++) {
+        order[i] = i;
+    }
+    qsort_r(order, n, sizeof(size_t), compare_rows, (void*) listings);
+
+    double sum[D] = { 0 }, sum_sq[D] = { 0 };
+    long present[D] = { 0 };
+    for (size_t i = 0; i < n; i++) {
+        double* r = &raw[i * D];
+        raw_features(&listings[order[i]], index->km_per_lon_degree, r);
+        for (int d = 0; d < D; d++) {
+            if (!isnan(r[d])) {
+                sum[d] += r[d];
+                sum_sq[d] += r[d] * r[d];
+                present[d]++;
+            }
+        }
+    }
+    for (int d = 0; d < D; d++) {
+        index->mean[d] = present[d] ? sum[d] / present[d] : 0.0;
+        if (d < 4) {
+            double variance = present[d] ? sum_sq[d] / present[d] - index->mean[d] * index->mean[d] : 0.0;
+            index->scale[d] = WEIGHTS[d] / (variance > 1e-12 ? sqrt(variance) : 1.0);
+        } else {
+            index->scale[d] = 1.0 / NEIGHBORHOOD_KM;
+        }
+    }
+
+    index->count = n;
+    size_t bytes = sizeof(float) * (n ? n : 1);
+    int failed = 0;
+    for (int d = 0; d < D; d++) {
+        failed |= (index->dims[d] = malloc(bytes)) == NULL;
+    }
+    index->ids = malloc(sizeof(int) * (n ? n : 1));
+    index->district_ids = malloc(sizeof(int) * (n ? n : 1));
+    index->rooms = malloc(sizeof(int) * (n ? n : 1));
+    index->areas = malloc(sizeof(int) * (n ? n : 1));
+    index->prices = malloc(sizeof(int) * (n ? n : 1));
+    index->statuses = malloc(n ? n : 1);
+    index->partitions = malloc(sizeof(partition_t) * (n ? n : 1));
+    if (failed || !index->ids || !index->district_ids || !index->rooms || !index->areas || !index->prices ||
+        !index->statuses || !index->partitions) {
+        free(order);
+        free(raw);
+        index_free(index);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        const property_t* p = &listings[order[i]];
+        float features[D];
+        normalize(index, &raw[i * D], features);
+        for (int d = 0; d < D; d++) {
+            index->dims[d][i] = features[d];
+        }
+        index->ids[i] = p->id;
+        index->district_ids[i] = p->district_id;
+        index->rooms[i] = p->num_rooms;
+        index->areas[i] = p->area_sqm;
+        index->prices[i] = p->price;
+        index->statuses[i] = (unsigned char) p->status;
+
+        if (index->partition_count == 0 ||
+            index->partitions[index->partition_count - 1].district_id != p->district_id ||
+            index->partitions[index->partition_count - 1].num_rooms != p->num_rooms) {
+            partition_t* part = &index->partitions[index->partition_count++];
+            part->district_id = p->district_id;
+            part->num_rooms = p->num_rooms;
+            part->begin = i;
+        }
+        index->partitions[index->partition_count - 1].end = i + 1;
+    }
+
+    free(order);
+    free(raw);
+    return index;
+}
+
+long comparables_rebuild(void) {
+    size_t n = 0;
+    const property_t* listings = properties_acquire(&n);
+    comparables_index_t* index = index_build(listings, n);
+    properties_release();
+    if (index == NULL) {
+        return -1;
+    }
+
+    pthread_rwlock_wrlock(&index_lock);
+    comparables_index_t* old = current_index;
+    current_index = index;
+    pthread_rwlock_unlock(&index_lock);
+
+    index_free(old);
+    return (long) n;
+}
+
+size_t comparables_count(void) {
+    pthread_rwlock_rdlock(&index_lock);
+    size_t n = current_index ? current_index->count : 0;
+    pthread_rwlock_unlock(&index_lock);
+    return n;
+}
+
+// Bounded max-heap: the root is the worst of the best k so far
+static void heap_offer(heap_entry_t* heap, int* size, int k, float distance, size_t row) {
+    int i;
+    if (*size < k) {
+        i = (*size)++;
+        while (i > 0 && heap[(i - 1) / 2].distance < distance) {
+            heap[i] = heap[(i - 1) / 2];
+            i = (i - 1) / 2;
+        }
+    } else if (distance < heap[0].distance) {
+        i = 0;
+        for (;;) {
+            int child = 2 * i + 1;
+            if (child >= k) {
+                break;
+            }
+            if (child + 1 < k && heap[child + 1].distance > heap[child].distance) {
+                child++;
+            }
+            if (heap[child].distance <= distance) {
+                break;
+            }
+            heap[i] = heap[child];
+            i = child;
+        }
+    } else {
+        return;
+    }
+    heap[i].distance = distance;
+    heap[i].row = row;
+}
+
+static void scan_range(const comparables_index_t* index, size_t begin, size_t end, const float* q,
+                       int exclude_id, heap_entry_t* heap, int* size, int k) {
+    float_lanes_t query[D];
+    for (int d = 0; d < D; d++) {
+        for (int l = 0; l < LANES; l++) {
+            query[d][l] = q[d];
+        }
+    }
+
+    size_t i = begin;
+    for (; i + LANES <= end; i += LANES) {
+        float_lanes_t acc = { 0 };
+        for (int d = 0; d < D; d++) {
+            float_lanes_t v;
+            memcpy(&v, &index->dims[d][i], sizeof(v));
+            float_lanes_t diff = v - query[d];
+            acc += diff * diff;
+        }
+        float worst = *size < k ? FLT_MAX : heap[0].distance;
+        for (int l = 0; l < LANES; l++) {
+            if (acc[l] < worst && index->ids[i + l] != exclude_id) {
+                heap_offer(heap, size, k, acc[l], i + l);
+                worst = *size < k ? FLT_MAX : heap[0].distance;
+            }
+        }
+    }
+    for (; i < end; i++) {
+        float acc = 0.0f;
+        for (int d = 0; d < D; d++) {
+            float diff = index->dims[d][i] - q[d];
+            acc += diff * diff;
+        }
+        if (index->ids[i] != exclude_id) {
+            heap_offer(heap, size, k, acc, i);
+        }
+    }
+}
+
+static int compare_heap_entries(const void* a, const void* b) {
+    float x = ((const heap_entry_t*) a)->distance;
+    float y = ((const heap_entry_t*) b)->distance;
+    return (x > y) - (x < y);
+}
+
+int comparables_find(const property_t* subject, const comparables_query_t* query, comparable_t* out) {
+    int k = query->k < 1 ? 1 : (query->k > COMPARABLES_MAX_K ? COMPARABLES_MAX_K : query->k);
+    heap_entry_t heap[COMPARABLES_MAX_K];
+    int size = 0;
+
+    pthread_rwlock_rdlock(&index_lock);
+    const comparables_index_t* index = current_index;
+    if (index == NULL) {
+        pthread_rwlock_unlock(&index_lock);
+        return -1;
+    }
+
+    double raw[D];
+    float q[D];
+    raw_features(subject, index->km_per_lon_degree, raw);
+    normalize(index, raw, q);
+
+    // Partitions are sorted by (district, rooms): with a district filter
+    // the allowed ones are contiguous; start at the first that can match
+    size_t first = 0;
+    if (query->same_district) {
+        int min_rooms = query->rooms_tolerance >= 0 ? subject->num_rooms - query->rooms_tolerance : INT_MIN;
+        size_t lo = 0, hi = index->partition_count;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            const partition_t* p = &index->partitions[mid];
+            if (p->district_id < subject->district_id ||
+                (p->district_id == subject->district_id && p->num_rooms < min_rooms)) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        first = lo;
+    }
+
+    size_t run_begin = 0, run_end = 0;
+    for (size_t p = first; p < index->partition_count; p++) {
+        const partition_t* part = &index->partitions[p];
+        if (query->same_district && part->district_id != subject->district_id) {
+            break;
+        }
+        if (query->rooms_tolerance >= 0 && abs(part->num_rooms - subject->num_rooms) > query->rooms_tolerance) {
+            continue;
+        }
+        // Merge adjacent partitions into one scan
+        if (run_end == part->begin && run_end != 0) {
+            run_end = part->end;
+            continue;
+        }
+        if (run_end > run_begin) {
+            scan_range(index, run_begin, run_end, q, subject->id, heap, &size, k);
+        }
+        run_begin = part->begin;
+        run_end = part->end;
+    }
+    if (run_end > run_begin) {
+        scan_range(index, run_begin, run_end, q, subject->id, heap, &size, k);
+    }
+
+    qsort(heap, (size_t) size, sizeof(heap_entry_t), compare_heap_entries);
+    for (int i = 0; i < size; i++) {
+        size_t row = heap[i].row;
+        out[i].property_id = index->ids[row];
+        out[i].district_id = index->district_ids[row];
+        out[i].num_rooms = index->rooms[row];
+        out[i].area_sqm = index->areas[row];
+        out[i].price = index->prices[row];
+        out[i].status = (property_status_t) index->statuses[row];
+        out[i].distance = sqrtf(heap[i].distance);
+    }
+    pthread_rwlock_unlock(&index_lock);
+    return size;
+}
+
+json_t* comparables_get_handler(int property_id, const comparables_query_t* query) {
+    property_t subject;
+    comparable_t found[COMPARABLES_MAX_K];
+    if (properties_find(property_id, &subject) != 0) {
+        return NULL;
+    }
+    int n = comparables_find(&subject, query, found);
+    if (n < 0) {
+        return NULL;
+    }
+
+    json_t* list = json_array();
+    double per_sqm_sum = 0.0;
+    int priced = 0;
+    for (int i = 0; i < n; i++) {
+        const comparable_t* c = &found[i];
+        double per_sqm = c->area_sqm > 0 ? (double) c->price / c->area_sqm : 0.0;
+        if (per_sqm > 0.0) {
+            per_sqm_sum += per_sqm;
+            priced++;
+        }
+
+        json_t* item = json_object();
+        json_object_set_new(item, "id", json_integer(c->property_id));
+        json_object_set_new(item, "district_id", json_integer(c->district_id));
+        json_object_set_new(item, "num_rooms", json_integer(c->num_rooms));
+        json_object_set_new(item, "area", json_integer(c->area_sqm));
+        json_object_set_new(item, "price", json_integer(c->price));
+        json_object_set_new(item, "price_per_sqm", json_real(per_sqm));
+        json_object_set_new(item, "status", json_string(property_status_to_string(c->status)));
+        json_object_set_new(item, "distance", json_real(c->distance));
+        json_array_append_new(list, item);
+    }
+
+    json_t* json_obj = json_object();
+    json_object_set_new(json_obj, "property_id", json_integer(property_id));
+    json_object_set_new(json_obj, "comparables", list);
+    if (priced > 0) {
+        double avg_per_sqm = per_sqm_sum / priced;
+        json_object_set_new(json_obj, "avg_price_per_sqm", json_real(avg_per_sqm));
+        json_object_set_new(json_obj, "expected_price", json_real(avg_per_sqm * subject.area_sqm));
+    }
+    return json_obj;
+}
@@ -1,9 +1,352 @@
 #include "include/db.h"
+#include "include/utils.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_available = PTHREAD_COND_INITIALIZER;
+static PGconn** pool_idle = NULL;      // Stack of idle connections
+static int pool_idle_count = 0;
+static int pool_size = 0;
+
+// Deadline of the request running on this thread (monotonic ms, 0 for none)
+static _Thread_local long long thread_deadline_ms = 0;
+static _Thread_local int thread_deadline_hit = 0;
+
+static atomic_uint_fast64_t deadline_skipped = 0;
+static atomic_uint_fast64_t deadline_cancelled = 0;
+static atomic_uint_fast64_t deadline_pool_timeouts = 0;
+
+// Sent first in a pipeline under a deadline; local to its transaction
+static const char* STATEMENT_TIMEOUT_SQL = "SELECT set_config('statement_timeout', $1, true)";
+
 PGconn* db_connect(const char *conn_info_str) {
-    printf("[STUB] db_connect called with: %s\n", conn_info_str);
-    return NULL;
+    PGconn *conn = PQconnectdb(conn_info_str);
+    if (PQstatus(conn) != CONNECTION_OK) {
+        fprintf(stderr, "Database connection failed: %s", PQerrorMessage(conn));
+        PQfinish(conn);
+        return NULL;
+    }
+    return conn;
 }
+
 void db_disconnect(PGconn *conn) {
-    printf("[STUB] db_disconnect called.\n");
+    if (conn != NULL) {
+        PQfinish(conn);
+    }
+}
+
+void db_set_deadline(long long deadline_ms) {
+    thread_deadline_ms = deadline_ms;
+    thread_deadline_hit = 0;
+}
+
+long long db_get_deadline(void) {
+    return thread_deadline_ms;
+}
+
+int db_deadline_hit(void) {
+    return thread_deadline_hit;
+}
+
+void db_get_deadline_stats(db_deadline_stats_t* out) {
+    out->skipped = atomic_load(&deadline_skipped);
+    out->cancelled = atomic_load(&deadline_cancelled);
+    out->pool_timeouts = atomic_load(&deadline_pool_timeouts);
+}
+
+// Time left before this thread's deadline: 1 if there is one (left may
+// be <= 0 once it has passed), 0 without a deadline
+static int deadline_left(long long* left) {
+    if (thread_deadline_ms == 0) {
+        return 0;
+    }
+    *left = thread_deadline_ms - monotonic_ms();
+    return 1;
+}
+
+// Run one statement through a pipeline so it carries the deadline
+static PGresult* run_with_deadline(PGconn *conn, const char *sql, int n_params, const char *const *params) {
+    db_statement_t statement = { sql, n_params, params };
+    PGresult *res = NULL;
+    return db_pipeline(conn, &statement, 1, &res) == 0 ? res : NULL;
+}
+
+int db_exec_params(PGconn *conn, const char *sql, int n_params, const char *const *params) {
+    long long left;
+    if (deadline_left(&left)) {
+        PGresult *res = run_with_deadline(conn, sql, n_params, params);
+        PQclear(res);
+        return res == NULL;
+    }
+    PGresult *res = PQexecParams(conn, sql, n_params, NULL, params, NULL, NULL, 0);
+    ExecStatusType status = PQresultStatus(res);
+    if (status != PGRES_COMMAND_OK && status != PGRES_TUPLES_OK) {
+        fprintf(stderr, "Database statement failed: %s", PQerrorMessage(conn));
+        PQclear(res);
+        return 1;
+    }
+    PQclear(res);
+    return 0;
+}
+
+PGresult* db_query_params(PGconn *conn, const char *sql, int n_params, const char *const *params) {
+    long long left;
+    if (deadline_left(&left)) {
+        PGresult *res = run_with_deadline(conn, sql, n_params, params);
+        if (res != NULL && PQresultStatus(res) != PGRES_TUPLES_OK) {
+            PQclear(res);
+            return NULL;
+        }
+        return res;
+    }
+    PGresult *res = PQexecParams(conn, sql, n_params, NULL, params, NULL, NULL, 0);
+    if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+        fprintf(stderr, "Database query failed: %s", PQerrorMessage(conn));
+        PQclear(res);
+        return NULL;
+    }
+    return res;
+}
+
+// Ask the server to stop the statement running on the connection
+static void cancel_running(PGconn *conn) {
+    char error[256];
+    PGcancel *cancel = PQgetCancel(conn);
+    if (cancel == NULL || PQcancel(cancel, error, sizeof(error)) != 1) {
+        fprintf(stderr, "Database cancel failed: %s\n", cancel ? error : "no cancel handle");
+    }
+    PQfreeCancel(cancel);
+    thread_deadline_hit = 1;
+    atomic_fetch_add(&deadline_cancelled, 1);
+}
+
+// Wait until the next result can be read without blocking. Past the
+// deadline the running statement is cancelled; if the server does not
+// answer within DB_CANCEL_GRACE_MS the wait is abandoned.
+// Returns 0 when a result is ready, non-zero if the connection must be dropped.
+static int await_result(PGconn *conn, int *cancelled) {
+    long long give_up = 0;
+    while (PQisBusy(conn)) {
+        long long left;
+        if (!deadline_left(&left)) {
+            return 0;
+        }
+        if (!*cancelled && left <= 0) {
+            cancel_running(conn);
+            *cancelled = 1;
+        }
+        if (*cancelled) {
+            if (give_up == 0) {
+                give_up = monotonic_ms() + DB_CANCEL_GRACE_MS;
+            }
+            left = give_up - monotonic_ms();
+            if (left <= 0) {
+                return 1;
+            }
+        }
+        struct pollfd pfd = { .fd = PQsocket(conn), .events = POLLIN };
+        int ready = poll(&pfd, 1, left > INT_MAX ? INT_MAX : (int) left);
+        if (ready < 0 && errno != EINTR) {
+            return 1;
+        }
+        if (ready > 0 && PQconsumeInput(conn) == 0) {
+            return 0;   // PQgetResult reports the broken connection
+        }
+    }
+    return 0;
+}
+
+int db_pipeline(PGconn *conn, const db_statement_t *statements, int count, PGresult **results) {
+    for (int i = 0; i < count; i++) {
+        results[i] = NULL;
+    }
+
+    // Under a deadline the pipeline opens with the statement timeout
+    // (same round trip), and is not sent at all once the deadline passed
+    long long left = 0;
+    int timed = deadline_left(&left);
+    char timeout_text[32];
+    const char *timeout_params[] = { timeout_text };
+    if (timed) {
+        if (left <= 0) {
+            thread_deadline_hit = 1;
+            atomic_fetch_add(&deadline_skipped, 1);
+            return 1;
+        }
+        snprintf(timeout_text, sizeof(timeout_text), "%lld", left);
+    }
+
+    if (PQenterPipelineMode(conn) != 1) {
+        fprintf(stderr, "Database pipeline failed: %s", PQerrorMessage(conn));
+        return 1;
+    }
+
+    int failed = 0;
+    int sent = timed && PQsendQueryParams(conn, STATEMENT_TIMEOUT_SQL, 1, NULL, timeout_params,
+                                          NULL, NULL, 0) != 1 ? -1 : 0;
+    while (sent >= 0 && sent < count && PQsendQueryParams(conn, statements[sent].sql, statements[sent].n_params,
+                                                          NULL, statements[sent].params, NULL, NULL, 0) == 1) {
+        sent++;
+    }
+    int synced = sent == count && PQpipelineSync(conn) == 1;
+    if (!synced) {
+        fprintf(stderr, "Database pipeline failed: %s", PQerrorMessage(conn));
+        failed = 1;
+    }
+
+    // Each statement yields its result and then NULL; statements after a
+    // failed one come back as PGRES_PIPELINE_ABORTED
+    int cancelled = 0;
+    int abandoned = 0;
+    for (int i = timed ? -1 : 0; synced && i < count; i++) {
+        if (await_result(conn, &cancelled) != 0) {
+            abandoned = 1;
+            failed = 1;
+            break;
+        }
+        PGresult *res = PQgetResult(conn);
+        ExecStatusType status = PQresultStatus(res);
+        if (i >= 0 && (status == PGRES_TUPLES_OK || status == PGRES_COMMAND_OK)) {
+            results[i] = res;
+        } else if (i < 0 && status == PGRES_TUPLES_OK) {
+            PQclear(res);
+        } else {
+            if (status != PGRES_PIPELINE_ABORTED) {
+                fprintf(stderr, "Database query failed: %s", PQerrorMessage(conn));
+            }
+            // query_canceled: our PQcancel or the statement timeout
+            const char *state = PQresultErrorField(res, PG_DIAG_SQLSTATE);
+            if (timed && !cancelled && state != NULL && strcmp(state, "57014") == 0) {
+                thread_deadline_hit = 1;
+                atomic_fetch_add(&deadline_cancelled, 1);
+            }
+            failed = 1;
+            PQclear(res);
+            if (res == NULL) {
+                break;
+            }
+        }
+        while (await_result(conn, &cancelled) == 0 && (res = PQgetResult(conn)) != NULL) {
+            PQclear(res);
+        }
+    }
+    if (synced && !abandoned && await_result(conn, &cancelled) == 0) {
+        PGresult *sync = PQgetResult(conn);
+        if (PQresultStatus(sync) != PGRES_PIPELINE_SYNC) {
+            failed = 1;
+        }
+        PQclear(sync);
+    } else if (synced) {
+        abandoned = 1;
+    }
+
+    // A connection left mid-pipeline cannot be reused as is
+    if (abandoned || PQexitPipelineMode(conn) != 1) {
+        PQreset(conn);
+        failed = 1;
+    }
+    if (failed) {
+        for (int i = 0; i < count; i++) {
+            PQclear(results[i]);
+            results[i] = NULL;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+int db_pool_init(const char *conn_info_str, int size) {
+    PGconn** idle = calloc((size_t) (size > 0 ? size : 1), sizeof(PGconn*));
+    if (idle == NULL) {
+        return 0;
+    }
+    int opened = 0;
+    for (int i = 0; i < size; i++) {
+        PGconn* conn = db_connect(conn_info_str);
+        if (conn == NULL) {
+            break;
+        }
+        idle[opened++] = conn;
+    }
+
+    pthread_mutex_lock(&pool_lock);
+    free(pool_idle);
+    pool_idle = idle;
+    pool_idle_count = pool_size = opened;
+    pthread_mutex_unlock(&pool_lock);
+    return opened;
+}
+
+PGconn* db_pool_acquire(void) {
+    // Under a deadline, stop waiting for a free connection when it passes
+    struct timespec until;
+    long long left = 0;
+    int timed = deadline_left(&left);
+    if (timed) {
+        clock_gettime(CLOCK_REALTIME, &until);
+        left = left > 0 ? left : 0;
+        until.tv_sec += left / 1000;
+        until.tv_nsec += (left % 1000) * 1000000;
+        if (until.tv_nsec >= 1000000000) {
+            until.tv_sec++;
+            until.tv_nsec -= 1000000000;
+        }
+    }
+
+    pthread_mutex_lock(&pool_lock);
+    while (pool_size > 0 && pool_idle_count == 0) {
+        if (!timed) {
+            pthread_cond_wait(&pool_available, &pool_lock);
+        } else if (pthread_cond_timedwait(&pool_available, &pool_lock, &until) == ETIMEDOUT) {
+            break;
+        }
+    }
+    PGconn* conn = pool_idle_count > 0 ? pool_idle[--pool_idle_count] : NULL;
+    int timed_out = conn == NULL && pool_size > 0;
+    pthread_mutex_unlock(&pool_lock);
+    if (timed_out) {
+        thread_deadline_hit = 1;
+        atomic_fetch_add(&deadline_pool_timeouts, 1);
+    }
+    return conn;
+}
+
+void db_pool_release(PGconn *conn) {
+    if (conn == NULL) {
+        return;
+    }
+    if (PQstatus(conn) != CONNECTION_OK) {
+        PQreset(conn);
+    }
+    pthread_mutex_lock(&pool_lock);
+    if (pool_idle == NULL) {
+        // The pool was closed while the connection was borrowed
+        pthread_mutex_unlock(&pool_lock);
+        PQfinish(conn);
+        return;
+    }
+    pool_idle[pool_idle_count++] = conn;
+    pthread_cond_signal(&pool_available);
+    pthread_mutex_unlock(&pool_lock);
+}
+
+void db_pool_close(void) {
+    pthread_mutex_lock(&pool_lock);
+    // Borrowed connections are not waited for; only idle ones are closed
+    for (int i = 0; i < pool_idle_count; i++) {
+        PQfinish(pool_idle[i]);
+    }
+    free(pool_idle);
+    pool_idle = NULL;
+    pool_idle_count = pool_size = 0;
+    pthread_cond_broadcast(&pool_available);
+    pthread_mutex_unlock(&pool_lock);
 }
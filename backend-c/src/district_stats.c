@@ -0,0 +1,528 @@
+#include "include/district_stats.h"
+#include "include/quantile_sketch.h"
+#include "include/parallel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define SKETCH_SEED 0x5d15791c7a75ULL
+#define FENCE_REFRESH_DIVISOR 64   // Recompute cached fences after count grows by 1/64
+
+// One (district, rooms, type) group
+typedef struct {
+    int district_id;
+    int num_rooms;
+    int type_id;
+    quantile_sketch_t sketch;
+    uint64_t fences_count;     // Sketch count when the fences were cached (0 = none)
+    double lower_fence;
+    double upper_fence;
+} cell_t;
+
+// Groups sorted by (district, rooms, type)
+typedef struct {
+    cell_t* cells;
+    size_t count;
+    size_t capacity;
+} cell_table_t;
+
+typedef struct {
+    int property_id;
+    int num_rooms;
+    int type_id;
+    float price_per_sqm;
+    price_outlier_t outlier;
+} outlier_entry_t;
+
+typedef struct {
+    int district_id;
+    outlier_entry_t entries[DISTRICT_STATS_RECENT_OUTLIERS];
+    int next;
+    int count;
+} district_outliers_t;
+
+// A new listing seen while a rebuild is running
+typedef struct {
+    int district_id;
+    int num_rooms;
+    int type_id;
+    float price_per_sqm;
+} pending_listing_t;
+
+static pthread_rwlock_t stats_lock = PTHREAD_RWLOCK_INITIALIZER;
+static cell_table_t table = { NULL, 0, 0 };
+static int capturing = 0;                  // A rebuild is running; new listings are kept for it
+static pending_listing_t* pending = NULL;
+static size_t pending_count = 0;
+static size_t pending_capacity = 0;
+static district_outliers_t* outliers = NULL;
+static size_t outlier_district_count = 0;
+static atomic_int stats_ready = 0;
+
+static const double FRACTIONS[7] = { 0.0, 0.10, 0.25, 0.50, 0.75, 0.90, 1.0 };
+
+const char* price_outlier_to_string(price_outlier_t outlier) {
+    switch (outlier) {
+        case PRICE_OUTLIER_LOW: return "low";
+        case PRICE_OUTLIER_HIGH: return "high";
+        default: return "none";
+    }
+}
+
+static int compare_key(const cell_t* c, int district_id, int num_rooms, int type_id) {
+    if (c->district_id != district_id) {
+        return c->district_id < district_id ? -1 : 1;
+    }
+    if (c->num_rooms != num_rooms) {
+        return c->num_rooms < num_rooms ? -1 : 1;
+    }
+    return (c->type_id > type_id) - (c->type_id < type_id);
+}
+
+// Index of the first cell not below the key
+static size_t lower_bound(const cell_table_t* t, int district_id, int num_rooms, int type_id) {
+    size_t lo = 0, hi = t->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (compare_key(&t->cells[mid], district_id, num_rooms, type_id) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static cell_t* find_cell(const cell_table_t* t, int district_id, int num_rooms, int type_id) {
+    size_t i = lower_bound(t, district_id, num_rooms, type_id);
+    if (i < t->count && compare_key(&t->cells[i], district_id, num_rooms, type_id) == 0) {
+        return &t->cells[i];
+    }
+    return NULL;
+}
+
+static cell_t* find_or_add_cell(cell_table_t* t, int district_id, int num_rooms, int type_id) {
+    size_t i = lower_bound(t, district_id, num_rooms, type_id);
+    if (i < t->count && compare_key(&t->cells[i], district_id, num_rooms, type_id) == 0) {
+        return &t->cells[i];
+    }
+    if (t->count == t->capacity) {
+        size_t capacity = t->capacity ? t->capacity * 2 : 64;
+        cell_t* grown = realloc(t->cells, sizeof(cell_t) * capacity);
+        if (grown == NULL) {
+            return NULL;
+        }
+        t->cells = grown;
+        t->capacity = capacity;
+    }
+    memmove(&t->cells[i + 1], &t->cells[i], sizeof(cell_t) * (t->count - i));
+    t->count++;
+
+    cell_t* cell = &t->cells[i];
+    memset(cell, 0, sizeof(*cell));
+    cell->district_id = district_id;
+    cell->num_rooms = num_rooms;
+    cell->type_id = type_id;
+    // Seed per group so rebuilds do not depend on which worker ran
+    quantile_sketch_init(&cell->sketch, QUANTILE_SKETCH_DEFAULT_K,
+                         rng_seed_for(SKETCH_SEED, district_id, num_rooms * 1000 + type_id));
+    return cell;
+}
+
+static void table_free(cell_table_t* t) {
+    for (size_t i = 0; i < t->count; i++) {
+        quantile_sketch_free(&t->cells[i].sketch);
+    }
+    free(t->cells);
+    t->cells = NULL;
+    t->count = t->capacity = 0;
+}
+
+static int price_per_sqm(const property_t* p, float* out) {
+    if (p->price <= 0 || p->area_sqm <= 0) {
+        return 0;
+    }
+    *out = (float) p->price / (float) p->area_sqm;
+    return 1;
+}
+
+static void distribution_from(const quantile_sketch_t* sketch, price_distribution_t* out) {
+    double q[7];
+    memset(out, 0, sizeof(*out));
+    if (quantile_sketch_quantiles(sketch, FRACTIONS, 7, q) != 0) {
+        return;
+    }
+    out->count = sketch->count;
+    out->min = q[0];
+    out->p10 = q[1];
+    out->p25 = q[2];
+    out->p50 = q[3];
+    out->p75 = q[4];
+    out->p90 = q[5];
+    out->max = q[6];
+    double iqr = out->p75 - out->p25;
+    out->lower_fence = out->p25 - 1.5 * iqr;
+    out->upper_fence = out->p75 + 1.5 * iqr;
+}
+
+// Merge the cells of a district matching rooms and type (0 = any);
+// caller holds the lock
+static int merge_cells(int district_id, int num_rooms, int type_id, quantile_sketch_t* out) {
+    quantile_sketch_init(out, QUANTILE_SKETCH_DEFAULT_K, SKETCH_SEED);
+    size_t begin = lower_bound(&table, district_id, num_rooms ? num_rooms : INT_MIN, INT_MIN);
+    for (size_t i = begin; i < table.count && table.cells[i].district_id == district_id; i++) {
+        const cell_t* cell = &table.cells[i];
+        if (num_rooms != 0 && cell->num_rooms != num_rooms) {
+            if (cell->num_rooms > num_rooms) {
+                break;
+            }
+            continue;
+        }
+        if (type_id != 0 && cell->type_id != type_id) {
+            continue;
+        }
+        if (quantile_sketch_merge(out, &cell->sketch) != 0) {
+            quantile_sketch_free(out);
+            return -1;
+        }
+    }
+    if (out->count == 0) {
+        quantile_sketch_free(out);
+        return -1;
+    }
+    return 0;
+}
+
+int district_stats_get(int district_id, int num_rooms, int type_id, price_distribution_t* out) {
+    quantile_sketch_t merged;
+    pthread_rwlock_rdlock(&stats_lock);
+    int rc = merge_cells(district_id, num_rooms, type_id, &merged);
+    pthread_rwlock_unlock(&stats_lock);
+    if (rc == 0) {
+        distribution_from(&merged, out);
+        quantile_sketch_free(&merged);
+    }
+    return rc;
+}
+
+// Fences of the finest group with enough listings; caller holds the
+// write lock (cell fences are cached)
+static int fences_for(const property_t* listing, double* lower, double* upper) {
+    cell_t* cell = find_cell(&table, listing->district_id, listing->num_rooms, listing->type_id);
+    if (cell != NULL && cell->sketch.count >= DISTRICT_STATS_MIN_SAMPLES) {
+        uint64_t n = cell->sketch.count;
+        if (cell->fences_count == 0 || n - cell->fences_count > cell->fences_count / FENCE_REFRESH_DIVISOR) {
+            price_distribution_t d;
+            distribution_from(&cell->sketch, &d);
+            cell->lower_fence = d.lower_fence;
+            cell->upper_fence = d.upper_fence;
+            cell->fences_count = n;
+        }
+        *lower = cell->lower_fence;
+        *upper = cell->upper_fence;
+        return 0;
+    }
+
+    // Small group: fall back to the rooms group, then the district
+    for (int level = 0; level < 2; level++) {
+        quantile_sketch_t merged;
+        if (merge_cells(listing->district_id, level == 0 ? listing->num_rooms : 0, 0, &merged) != 0) {
+            continue;
+        }
+        int enough = merged.count >= DISTRICT_STATS_MIN_SAMPLES;
+        if (enough) {
+            price_distribution_t d;
+            distribution_from(&merged, &d);
+            *lower = d.lower_fence;
+            *upper = d.upper_fence;
+        }
+        quantile_sketch_free(&merged);
+        if (enough) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static price_outlier_t classify_locked(const property_t* listing) {
+    float value;
+    double lower, upper;
+    if (!price_per_sqm(listing, &value) || fences_for(listing, &lower, &upper) != 0) {
+        return PRICE_OUTLIER_NONE;
+    }
+    if (value < lower) {
+        return PRICE_OUTLIER_LOW;
+    }
+    return value > upper ? PRICE_OUTLIER_HIGH : PRICE_OUTLIER_NONE;
+}
+
+price_outlier_t district_stats_classify(const property_t* listing) {
+    // Fence caching writes to the cell
+    pthread_rwlock_wrlock(&stats_lock);
+    price_outlier_t outlier = classify_locked(listing);
+    pthread_rwlock_unlock(&stats_lock);
+    return outlier;
+}
+
+static district_outliers_t* find_outliers(int district_id, int create) {
+    for (size_t i = 0; i < outlier_district_count; i++) {
+        if (outliers[i].district_id == district_id) {
+            return &outliers[i];
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+    district_outliers_t* grown = realloc(outliers, sizeof(district_outliers_t) * (outlier_district_count + 1));
+    if (grown == NULL) {
+        return NULL;
+    }
+    outliers = grown;
+    district_outliers_t* d = &outliers[outlier_district_count++];
+    memset(d, 0, sizeof(*d));
+    d->district_id = district_id;
+    return d;
+}
+
+static void remember_outlier(const property_t* listing, float value, price_outlier_t outlier) {
+    district_outliers_t* d = find_outliers(listing->district_id, 1);
+    if (d == NULL) {
+        return;
+    }
+    outlier_entry_t* e = &d->entries[d->next];
+    e->property_id = listing->id;
+    e->num_rooms = listing->num_rooms;
+    e->type_id = listing->type_id;
+    e->price_per_sqm = value;
+    e->outlier = outlier;
+    d->next = (d->next + 1) % DISTRICT_STATS_RECENT_OUTLIERS;
+    if (d->count < DISTRICT_STATS_RECENT_OUTLIERS) {
+        d->count++;
+    }
+}
+
+// Keep a new listing for the rebuild in progress; caller holds the lock
+static void capture_listing(const property_t* listing, float value) {
+    if (pending_count == pending_capacity) {
+        size_t capacity = pending_capacity ? pending_capacity * 2 : 256;
+        pending_listing_t* grown = realloc(pending, sizeof(pending_listing_t) * capacity);
+        if (grown == NULL) {
+            return;
+        }
+        pending = grown;
+        pending_capacity = capacity;
+    }
+    pending_listing_t* e = &pending[pending_count++];
+    e->district_id = listing->district_id;
+    e->num_rooms = listing->num_rooms;
+    e->type_id = listing->type_id;
+    e->price_per_sqm = value;
+}
+
+// Listing ingest hook: new listings are judged and sketched. Reprices
+// and moves are left to the next rebuild: a sketch cannot drop the
+// listing's old observation, so adding the new one would count it twice.
+static void district_stats_on_ingest(const property_t* previous, const property_t* current, void* ctx) {
+    (void) ctx;
+    float value;
+    if (previous != NULL || !price_per_sqm(current, &value)) {
+        return;
+    }
+
+    pthread_rwlock_wrlock(&stats_lock);
+    if (capturing) {
+        capture_listing(current, value);
+    }
+    if (atomic_load(&stats_ready)) {
+        price_outlier_t outlier = classify_locked(current);
+        if (outlier != PRICE_OUTLIER_NONE) {
+            remember_outlier(current, value, outlier);
+        }
+        cell_t* cell = find_or_add_cell(&table, current->district_id, current->num_rooms, current->type_id);
+        if (cell != NULL) {
+            quantile_sketch_update(&cell->sketch, value);
+        }
+    }
+    pthread_rwlock_unlock(&stats_lock);
+}
+
+void district_stats_init(void) {
+    properties_register_ingest_hook(district_stats_on_ingest, NULL);
+}
+
+typedef struct {
+    const property_t* listings;
+    cell_table_t* tables;      // One per worker
+    atomic_int failed;
+} rebuild_job_t;
+
+static void rebuild_task(size_t begin, size_t end, int worker, void* ctx) {
+    rebuild_job_t* job = ctx;
+    cell_table_t* t = &job->tables[worker];
+    for (size_t i = begin; i < end; i++) {
+        const property_t* p = &job->listings[i];
+        float value;
+        if (!price_per_sqm(p, &value)) {
+            continue;
+        }
+        cell_t* cell = find_or_add_cell(t, p->district_id, p->num_rooms, p->type_id);
+        if (cell == NULL || quantile_sketch_update(&cell->sketch, value) != 0) {
+            atomic_store(&job->failed, 1);
+            return;
+        }
+    }
+}
+
+long district_stats_rebuild(int workers) {
+    if (workers <= 0) {
+        workers = parallel_default_workers();
+    }
+    rebuild_job_t job;
+    job.tables = calloc((size_t) workers, sizeof(cell_table_t));
+    atomic_init(&job.failed, 0);
+    if (job.tables == NULL) {
+        return -1;
+    }
+
+    // Every listing in the store has been through the hooks and none
+    // arrives during the scan; those ingested after it are captured and
+    // added to the new table before it is swapped in
+    properties_hold_ingest();
+    pthread_rwlock_wrlock(&stats_lock);
+    capturing = 1;
+    pending_count = 0;
+    pthread_rwlock_unlock(&stats_lock);
+    size_t n = 0;
+    job.listings = properties_acquire(&n);
+    int used = parallel_for(n, 0, workers, rebuild_task, &job);
+    properties_release();
+    properties_resume_ingest();
+
+    // Merge the per-worker groups into the first worker's table
+    cell_table_t merged = job.tables[0];
+    int failed = used < 0 || atomic_load(&job.failed);
+    for (int w = 1; w < workers && !failed; w++) {
+        for (size_t i = 0; i < job.tables[w].count && !failed; i++) {
+            const cell_t* part = &job.tables[w].cells[i];
+            cell_t* cell = find_or_add_cell(&merged, part->district_id, part->num_rooms, part->type_id);
+            failed = cell == NULL || quantile_sketch_merge(&cell->sketch, &part->sketch) != 0;
+        }
+    }
+    for (int w = 1; w < workers; w++) {
+        table_free(&job.tables[w]);
+    }
+    free(job.tables);
+
+    pthread_rwlock_wrlock(&stats_lock);
+    for (size_t i = 0; i < pending_count && !failed; i++) {
+        const pending_listing_t* e = &pending[i];
+        cell_t* cell = find_or_add_cell(&merged, e->district_id, e->num_rooms, e->type_id);
+        failed = cell == NULL || quantile_sketch_update(&cell->sketch, e->price_per_sqm) != 0;
+    }
+    capturing = 0;
+    pending_count = 0;
+    if (failed) {
+        pthread_rwlock_unlock(&stats_lock);
+        table_free(&merged);
+        return -1;
+    }
+    cell_table_t old = table;
+    table = merged;
+    pthread_rwlock_unlock(&stats_lock);
+
+    long sketched = 0;
+    for (size_t i = 0; i < merged.count; i++) {
+        sketched += (long) merged.cells[i].sketch.count;
+    }
+    atomic_store(&stats_ready, 1);
+
+    table_free(&old);
+    return sketched;
+}
+
+static void distribution_json(json_t* json, const price_distribution_t* d) {
+    json_object_set_new(json, "count", json_integer((json_int_t) d->count));
+    json_object_set_new(json, "min", json_real(d->min));
+    json_object_set_new(json, "p10", json_real(d->p10));
+    json_object_set_new(json, "p25", json_real(d->p25));
+    json_object_set_new(json, "p50", json_real(d->p50));
+    json_object_set_new(json, "p75", json_real(d->p75));
+    json_object_set_new(json, "p90", json_real(d->p90));
+    json_object_set_new(json, "max", json_real(d->max));
+}
+
+json_t* district_stats_handler(int district_id, int num_rooms, int type_id) {
+    price_distribution_t d;
+    if (district_stats_get(district_id, num_rooms, type_id, &d) != 0) {
+        return NULL;
+    }
+
+    json_t* json_obj = json_object();
+    json_object_set_new(json_obj, "district_id", json_integer(district_id));
+    if (num_rooms != 0) {
+        json_object_set_new(json_obj, "rooms", json_integer(num_rooms));
+    }
+    if (type_id != 0) {
+        json_object_set_new(json_obj, "type_id", json_integer(type_id));
+    }
+
+    json_t* overall = json_object();
+    distribution_json(overall, &d);
+    json_object_set_new(overall, "iqr", json_real(d.p75 - d.p25));
+    json_object_set_new(overall, "lower_fence", json_real(d.lower_fence));
+    json_object_set_new(overall, "upper_fence", json_real(d.upper_fence));
+    json_object_set_new(json_obj, "price_per_sqm", overall);
+
+    // Breakdown by rooms; cells are sorted by rooms within the district
+    pthread_rwlock_rdlock(&stats_lock);
+    int rooms[64];
+    int room_count = 0;
+    size_t begin = lower_bound(&table, district_id, INT_MIN, INT_MIN);
+    for (size_t i = begin; i < table.count && table.cells[i].district_id == district_id; i++) {
+        int r = table.cells[i].num_rooms;
+        if ((num_rooms == 0 || r == num_rooms) && (room_count == 0 || rooms[room_count - 1] != r) && room_count < 64) {
+            rooms[room_count++] = r;
+        }
+    }
+    json_t* by_rooms = json_array();
+    for (int i = 0; i < room_count; i++) {
+        quantile_sketch_t merged;
+        if (merge_cells(district_id, rooms[i], type_id, &merged) != 0) {
+            continue;
+        }
+        price_distribution_t rd;
+        distribution_from(&merged, &rd);
+        quantile_sketch_free(&merged);
+
+        json_t* item = json_object();
+        json_object_set_new(item, "rooms", json_integer(rooms[i]));
+        distribution_json(item, &rd);
+        json_array_append_new(by_rooms, item);
+    }
+
+    json_t* recent = json_array();
+    const district_outliers_t* o = find_outliers(district_id, 0);
+    for (int i = 0; o != NULL && i < o->count; i++) {
+        // Newest first
+        const outlier_entry_t* e =
+            &o->entries[(o->next - 1 - i + DISTRICT_STATS_RECENT_OUTLIERS) % DISTRICT_STATS_RECENT_OUTLIERS];
+        if ((num_rooms != 0 && e->num_rooms != num_rooms) || (type_id != 0 && e->type_id != type_id)) {
+            continue;
+        }
+        json_t* item = json_object();
+        json_object_set_new(item, "id", json_integer(e->property_id));
+        json_object_set_new(item, "num_rooms", json_integer(e->num_rooms));
+        json_object_set_new(item, "type_id", json_integer(e->type_id));
+        json_object_set_new(item, "price_per_sqm", json_real(e->price_per_sqm));
+        json_object_set_new(item, "outlier", json_string(price_outlier_to_string(e->outlier)));
+        json_array_append_new(recent, item);
+    }
+    pthread_rwlock_unlock(&stats_lock);
+
+    json_object_set_new(json_obj, "by_rooms", by_rooms);
+    json_object_set_new(json_obj, "recent_outliers", recent);
+    return json_obj;
+}
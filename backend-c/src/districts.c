@@ -1,5 +1,80 @@
 #include "include/districts.h"
+#include "include/db.h"
 #include <stdio.h>
+#include <stdlib.h>
+
 void get_districts_json() {
     printf("[STUB] get_districts_json called.\n");
 }
+
+static const char* DISTRICT_DETAIL_SQL =
+    "SELECT d.id, d.name, d.description, d.population, d.avg_price_per_sqm, "
+    "d.coordinates[0], d.coordinates[1], "
+    "(SELECT count(*) FROM properties p WHERE p.district_id = d.id AND p.status = 'active') "
+    "FROM districts d WHERE d.id = $1";
+
+int districts_get_detail(PGconn* conn, int district_id, json_t** out) {
+    char id_text[16];
+    snprintf(id_text, sizeof(id_text), "%d", district_id);
+    const char* params[] = { id_text };
+    PGresult* res = db_query_params(conn, DISTRICT_DETAIL_SQL, 1, params);
+    if (res == NULL) {
+        return -1;
+    }
+    if (PQntuples(res) == 0) {
+        PQclear(res);
+        return 1;
+    }
+
+    json_t* obj = json_object();
+    json_object_set_new(obj, "id", json_integer(atoi(PQgetvalue(res, 0, 0))));
+    json_object_set_new(obj, "name", json_string(PQgetvalue(res, 0, 1)));
+    json_object_set_new(obj, "description",
+                        PQgetisnull(res, 0, 2) ? json_null() : json_string(PQgetvalue(res, 0, 2)));
+    json_object_set_new(obj, "population",
+                        PQgetisnull(res, 0, 3) ? json_null() : json_integer(atoi(PQgetvalue(res, 0, 3))));
+    json_object_set_new(obj, "avg_price_per_sqm",
+                        PQgetisnull(res, 0, 4) ? json_null() : json_integer(atoi(PQgetvalue(res, 0, 4))));
+    json_object_set_new(obj, "latitude",
+                        PQgetisnull(res, 0, 5) ? json_null() : json_real(atof(PQgetvalue(res, 0, 5))));
+    json_object_set_new(obj, "longitude",
+                        PQgetisnull(res, 0, 6) ? json_null() : json_real(atof(PQgetvalue(res, 0, 6))));
+    json_object_set_new(obj, "active_listings", json_integer(atoi(PQgetvalue(res, 0, 7))));
+    PQclear(res);
+
+    *out = obj;
+    return 0;
+}
+
+static const char* DISTRICT_LIST_SQL =
+    "SELECT d.id, d.name, d.population, d.avg_price_per_sqm, d.coordinates[0], d.coordinates[1], "
+    "(SELECT count(*) FROM properties p WHERE p.district_id = d.id AND p.status = 'active') "
+    "FROM districts d ORDER BY d.name";
+
+int districts_list(PGconn* conn, json_t** out) {
+    PGresult* res = db_query_params(conn, DISTRICT_LIST_SQL, 0, NULL);
+    if (res == NULL) {
+        return -1;
+    }
+
+    json_t* list = json_array();
+    for (int i = 0; i < PQntuples(res); i++) {
+        json_t* obj = json_object();
+        json_object_set_new(obj, "id", json_integer(atoi(PQgetvalue(res, i, 0))));
+        json_object_set_new(obj, "name", json_string(PQgetvalue(res, i, 1)));
+        json_object_set_new(obj, "population",
+                            PQgetisnull(res, i, 2) ? json_null() : json_integer(atoi(PQgetvalue(res, i, 2))));
+        json_object_set_new(obj, "avg_price_per_sqm",
+                            PQgetisnull(res, i, 3) ? json_null() : json_integer(atoi(PQgetvalue(res, i, 3))));
+        json_object_set_new(obj, "latitude",
+                            PQgetisnull(res, i, 4) ? json_null() : json_real(atof(PQgetvalue(res, i, 4))));
+        json_object_set_new(obj, "longitude",
+                            PQgetisnull(res, i, 5) ? json_null() : json_real(atof(PQgetvalue(res, i, 5))));
+        json_object_set_new(obj, "active_listings", json_integer(atoi(PQgetvalue(res, i, 6))));
+        json_array_append_new(list, obj);
+    }
+    PQclear(res);
+
+    *out = list;
+    return 0;
+}
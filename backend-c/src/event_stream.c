@@ -0,0 +1,351 @@
+#include "include/event_stream.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <jansson.h>
+
+#define HEARTBEAT_FRAME ": keep-alive\n\n"
+
+// One serialized SSE frame ("id: ...\nevent: ...\ndata: ...\n\n")
+typedef struct {
+    uint64_t id;
+    stream_event_type_t type;
+    char* frame;
+    size_t length;
+} stream_slot_t;
+
+struct event_subscriber {
+    uint64_t cursor;           // Id of the next event to send
+    unsigned type_mask;
+    int lags;
+    char* carry;               // Frame too large for the caller's buffer
+    size_t carry_length;
+    size_t carry_offset;
+};
+
+static pthread_mutex_t ring_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ring_changed;
+static pthread_once_t ring_once = PTHREAD_ONCE_INIT;
+static stream_slot_t ring[EVENT_STREAM_CAPACITY];
+static uint64_t first_id = 0;      // Id of the first event ever published
+static uint64_t next_id = 0;       // Id the next event will get
+static atomic_int stream_started = 0;
+static int stream_closed = 0;      // Guarded by ring_lock
+
+static atomic_size_t subscriber_count = 0;
+static atomic_uint_fast64_t lagged_count = 0;
+static atomic_uint_fast64_t disconnected_count = 0;
+
+static const char* TYPE_NAMES[] = { "listing", "status", "prediction" };
+
+const char* stream_event_type_to_string(stream_event_type_t type) {
+    return TYPE_NAMES[type];
+}
+
+unsigned event_stream_parse_types(const char* names) {
+    unsigned mask = 0;
+    char copy[128];
+    snprintf(copy, sizeof(copy), "%s", names);
+    char* save = NULL;
+    for (char* name = strtok_r(copy, ",", &save); name != NULL; name = strtok_r(NULL, ",", &save)) {
+        unsigned bit = 0;
+        for (int t = STREAM_EVENT_LISTING; t <= STREAM_EVENT_PREDICTION; t++) {
+            if (strcmp(name, TYPE_NAMES[t]) == 0) {
+                bit = 1u << t;
+            }
+        }
+        if (bit == 0) {
+            return 0;
+        }
+        mask |= bit;
+    }
+    return mask;
+}
+
+// Waits use the monotonic clock so wall clock changes do not stall heartbeats
+static void ring_init_once(void) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&ring_changed, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+static void listing_changed(const property_t* previous, const property_t* current, void* ctx) {
+    (void) ctx;
+    event_stream_publish_listing(previous, current);
+}
+
+void event_stream_init(void) {
+    pthread_once(&ring_once, ring_init_once);
+    pthread_mutex_lock(&ring_lock);
+    if (!atomic_load(&stream_started)) {
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        first_id = next_id = (uint64_t) now.tv_sec * 1000000u + (uint64_t) now.tv_nsec / 1000u;
+        atomic_store(&stream_started, 1);
+        properties_register_ingest_hook(listing_changed, NULL);
+    }
+    pthread_mutex_unlock(&ring_lock);
+}
+
+uint64_t event_stream_publish(stream_event_type_t type, const char* data) {
+    if (!atomic_load(&stream_started)) {
+        return 0;
+    }
+    // Allocate outside the lock; ids are assigned in ring order, so the
+    // frame is formatted under it
+    const char* event = TYPE_NAMES[type];
+    size_t body = strlen("event: \ndata: \n\n") + strlen(event) + strlen(data);
+    char* frame = malloc(32 + body + 1);
+    if (frame == NULL) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&ring_lock);
+    uint64_t id = next_id++;
+    int head = snprintf(frame, 32, "id: %llu\n", (unsigned long long) id);
+    size_t length = (size_t) head + (size_t) snprintf(frame + head, body + 1, "event: %s\ndata: %s\n\n", event, data);
+    stream_slot_t* slot = &ring[id % EVENT_STREAM_CAPACITY];
+    char* old = slot->frame;
+    slot->id = id;
+    slot->type = type;
+    slot->frame = frame;
+    slot->length = length;
+    pthread_cond_broadcast(&ring_changed);
+    pthread_mutex_unlock(&ring_lock);
+    free(old);
+    return id;
+}
+
+static json_t* listing_to_json(const property_t* p) {
+    json_t* json = json_object();
+    json_object_set_new(json, "id", json_integer(p->id));
+    json_object_set_new(json, "district_id", json_integer(p->district_id));
+    json_object_set_new(json, "property_type_id", json_integer(p->type_id));
+    json_object_set_new(json, "num_rooms", json_integer(p->num_rooms));
+    json_object_set_new(json, "area_sqm", json_integer(p->area_sqm));
+    json_object_set_new(json, "price", json_integer(p->price));
+    json_object_set_new(json, "floor", json_integer(p->floor));
+    json_object_set_new(json, "status", json_string(property_status_to_string(p->status)));
+    return json;
+}
+
+static uint64_t publish_json(stream_event_type_t type, json_t* json) {
+    char* data = json_dumps(json, JSON_COMPACT);
+    json_decref(json);
+    if (data == NULL) {
+        return 0;
+    }
+    uint64_t id = event_stream_publish(type, data);
+    free(data);
+    return id;
+}
+
+int event_stream_publish_listing(const property_t* previous, const property_t* current) {
+    if (!atomic_load(&stream_started)) {
+        return 0;
+    }
+    int published = 0;
+    if (previous != NULL && previous->status != current->status) {
+        json_t* json = json_object();
+        json_object_set_new(json, "id", json_integer(current->id));
+        json_object_set_new(json, "district_id", json_integer(current->district_id));
+        json_object_set_new(json, "from", json_string(property_status_to_string(previous->status)));
+        json_object_set_new(json, "to", json_string(property_status_to_string(current->status)));
+        published += publish_json(STREAM_EVENT_STATUS, json) != 0;
+    }
+
+    // Status-only changes need no listing event
+    if (previous == NULL || previous->price != current->price || previous->area_sqm != current->area_sqm ||
+        previous->num_rooms != current->num_rooms || previous->district_id != current->district_id ||
+        previous->type_id != current->type_id || previous->floor != current->floor ||
+        previous->features != current->features) {
+        json_t* json = json_object();
+        json_object_set_new(json, "action", json_string(previous == NULL ? "created" : "updated"));
+        json_object_set_new(json, "listing", listing_to_json(current));
+        if (previous != NULL && previous->price != current->price) {
+            json_object_set_new(json, "previous_price", json_integer(previous->price));
+        }
+        published += publish_json(STREAM_EVENT_LISTING, json) != 0;
+    }
+    return published;
+}
+
+uint64_t event_stream_publish_prediction(int district_id, int room_count, const price_prediction_t* prediction) {
+    if (!atomic_load(&stream_started)) {
+        return 0;
+    }
+    json_t* json = json_object();
+    json_object_set_new(json, "district_id", json_integer(district_id));
+    json_object_set_new(json, "room_count", json_integer(room_count));
+    json_object_set_new(json, "current_avg_price", json_real(prediction->current_avg_price));
+    json_object_set_new(json, "prediction_6m", json_real(prediction->prediction_6m));
+    json_object_set_new(json, "prediction_12m", json_real(prediction->prediction_12m));
+    json_object_set_new(json, "confidence", json_real(prediction->confidence));
+    json_object_set_new(json, "algorithm", json_string(prediction->algorithm));
+    return publish_json(STREAM_EVENT_PREDICTION, json);
+}
+
+event_subscriber_t* event_stream_subscribe(uint64_t last_event_id, unsigned type_mask) {
+    pthread_once(&ring_once, ring_init_once);
+    if (atomic_fetch_add(&subscriber_count, 1) >= EVENT_STREAM_MAX_SUBSCRIBERS) {
+        atomic_fetch_sub(&subscriber_count, 1);
+        return NULL;
+    }
+    event_subscriber_t* subscriber = calloc(1, sizeof(event_subscriber_t));
+    if (subscriber == NULL) {
+        atomic_fetch_sub(&subscriber_count, 1);
+        return NULL;
+    }
+    subscriber->type_mask = type_mask ? type_mask : STREAM_EVENT_ALL;
+
+    pthread_mutex_lock(&ring_lock);
+    // Ids from the future (or another server) start with the next event;
+    // old ids resume there, or resync if the ring no longer holds them
+    if (last_event_id == 0 || last_event_id >= next_id) {
+        subscriber->cursor = next_id;
+    } else {
+        subscriber->cursor = last_event_id + 1;
+    }
+    pthread_mutex_unlock(&ring_lock);
+    return subscriber;
+}
+
+void event_stream_unsubscribe(event_subscriber_t* subscriber) {
+    if (subscriber == NULL) {
+        return;
+    }
+    free(subscriber->carry);
+    free(subscriber);
+    atomic_fetch_sub(&subscriber_count, 1);
+}
+
+// Send what is left of a split frame
+static size_t drain_carry(event_subscriber_t* subscriber, char* buf, size_t max) {
+    size_t n = subscriber->carry_length - subscriber->carry_offset;
+    if (n > max) {
+        n = max;
+    }
+    memcpy(buf, subscriber->carry + subscriber->carry_offset, n);
+    subscriber->carry_offset += n;
+    if (subscriber->carry_offset == subscriber->carry_length) {
+        free(subscriber->carry);
+        subscriber->carry = NULL;
+        subscriber->carry_length = subscriber->carry_offset = 0;
+    }
+    return n;
+}
+
+// Copy a frame, splitting it through the carry buffer if it does not fit
+static size_t emit(event_subscriber_t* subscriber, const char* frame, size_t length, char* buf, size_t max) {
+    if (length <= max) {
+        memcpy(buf, frame, length);
+        return length;
+    }
+    subscriber->carry = malloc(length);
+    if (subscriber->carry == NULL) {
+        return 0;
+    }
+    memcpy(subscriber->carry, frame, length);
+    subscriber->carry_length = length;
+    subscriber->carry_offset = 0;
+    return drain_carry(subscriber, buf, max);
+}
+
+static void deadline_after(struct timespec* deadline, int timeout_ms) {
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    deadline->tv_sec += timeout_ms / 1000;
+    deadline->tv_nsec += (long) (timeout_ms % 1000) * 1000000L;
+    if (deadline->tv_nsec >= 1000000000L) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
+}
+
+ssize_t event_stream_read(event_subscriber_t* subscriber, char* buf, size_t max, int timeout_ms) {
+    if (max == 0) {
+        return -1;
+    }
+    if (subscriber->carry != NULL) {
+        return (ssize_t) drain_carry(subscriber, buf, max);
+    }
+
+    struct timespec deadline;
+    deadline_after(&deadline, timeout_ms);
+    size_t written = 0;
+    int timed_out = 0;
+
+    pthread_mutex_lock(&ring_lock);
+    while (written == 0 && !timed_out) {
+        while (subscriber->cursor >= next_id && !timed_out && !stream_closed) {
+            timed_out = pthread_cond_timedwait(&ring_changed, &ring_lock, &deadline) != 0;
+        }
+        if (stream_closed) {
+            pthread_mutex_unlock(&ring_lock);
+            return -1;
+        }
+
+        uint64_t oldest = next_id - first_id > EVENT_STREAM_CAPACITY ? next_id - EVENT_STREAM_CAPACITY : first_id;
+        if (subscriber->cursor < oldest) {
+            atomic_fetch_add(&lagged_count, 1);
+            if (++subscriber->lags > EVENT_STREAM_MAX_LAGS) {
+                pthread_mutex_unlock(&ring_lock);
+                atomic_fetch_add(&disconnected_count, 1);
+                return -1;
+            }
+            char frame[96];
+            int length = snprintf(frame, sizeof(frame), "event: resync\ndata: {\"from\":%llu}\n\n",
+                                  (unsigned long long) oldest);
+            subscriber->cursor = oldest;
+            written += emit(subscriber, frame, (size_t) length, buf, max);
+        }
+
+        while (subscriber->cursor < next_id && subscriber->carry == NULL) {
+            const stream_slot_t* slot = &ring[subscriber->cursor % EVENT_STREAM_CAPACITY];
+            if (!((subscriber->type_mask >> slot->type) & 1)) {
+                subscriber->cursor++;
+                continue;
+            }
+            if (written > 0 && slot->length > max - written) {
+                break;
+            }
+            size_t n = emit(subscriber, slot->frame, slot->length, buf + written, max - written);
+            if (n == 0) {
+                // Out of memory for the carry buffer
+                pthread_mutex_unlock(&ring_lock);
+                return -1;
+            }
+            written += n;
+            subscriber->cursor++;
+        }
+    }
+    pthread_mutex_unlock(&ring_lock);
+
+    if (written == 0) {
+        size_t length = strlen(HEARTBEAT_FRAME);
+        written = emit(subscriber, HEARTBEAT_FRAME, length, buf, max);
+    }
+    return written > 0 ? (ssize_t) written : -1;
+}
+
+void event_stream_close(void) {
+    pthread_once(&ring_once, ring_init_once);
+    pthread_mutex_lock(&ring_lock);
+    stream_closed = 1;
+    pthread_cond_broadcast(&ring_changed);
+    pthread_mutex_unlock(&ring_lock);
+}
+
+void event_stream_get_stats(event_stream_stats_t* out) {
+    pthread_mutex_lock(&ring_lock);
+    out->last_event_id = next_id > first_id ? next_id - 1 : 0;
+    out->published = next_id - first_id;
+    pthread_mutex_unlock(&ring_lock);
+    out->subscribers = atomic_load(&subscriber_count);
+    out->lagged = atomic_load(&lagged_count);
+    out->disconnected = atomic_load(&disconnected_count);
+}
@@ -0,0 +1,384 @@
+#include "include/prediction.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// Smoothing parameter grids searched when fitting the exponential
+// smoothing models (one-step-ahead squared error is minimized)
+static const double ALPHA_GRID[] = { 0.2, 0.5, 0.8 };
+static const double BETA_GRID[] = { 0.05, 0.2 };
+static const double GAMMA_GRID[] = { 0.1, 0.3 };
+static const double PHI_GRID[] = { 0.8, 0.9, 0.98 };
+
+#define GRID_SIZE(grid) ((int) (sizeof(grid) / sizeof((grid)[0])))
+
+static int calendar_month(int base_month, int offset) {
+    return ((base_month + offset) % FORECAST_SEASON_LENGTH + FORECAST_SEASON_LENGTH) % FORECAST_SEASON_LENGTH;
+}
+
+// Seasonal multiplier for a calendar month (0 = January) used by the
+// linear model
+static double seasonal_factor_for_month(int target_month) {
+    // Q1 (winter): slightly lower prices
+    if (target_month >= 0 && target_month < 3) {
+        return 0.98;
+    }
+    // Q2 (spring): higher activity, higher prices
+    if (target_month >= 3 && target_month < 6) {
+        return 1.03;
+    }
+    // Q3 (summer): stable to slight increase
+    if (target_month >= 6 && target_month < 9) {
+        return 1.01;
+    }
+    // Q4 (fall): slightly lower activity
+    return 0.99;
+}
+
+static void fit_reset(forecast_fit_t* fit, const double* prices, int count, int base_month) {
+    memset(fit, 0, sizeof(*fit));
+    fit->count = count;
+    fit->base_month = calendar_month(base_month, 0);
+    fit->damping = 1.0;
+    fit->last_price = count > 0 ? prices[count - 1] : 0.0;
+}
+
+// Linear regression: y = a + bx with fixed quarterly seasonal factors
+static int linear_fit(const double* prices, int count, int base_month, forecast_fit_t* fit) {
+    fit_reset(fit, prices, count, base_month);
+    if (count < 2) {
+        fit->level = count == 1 ? prices[0] : 0.0;
+        return count == 1 ? 0 : 1;
+    }
+
+    double x_mean = (count - 1) / 2.0;
+    double y_sum = 0.0;
+    for (int i = 0; i < count; i++) {
+        y_sum += prices[i];
+    }
+    double y_mean = y_sum / count;
+
+    double numerator = 0.0;
+    double denominator = 0.0;
+    for (int i = 0; i < count; i++) {
+        double x_diff = i - x_mean;
+        numerator += x_diff * (prices[i] - y_mean);
+        denominator += x_diff * x_diff;
+    }
+
+    // Avoid division by zero
+    double slope = (denominator != 0.0) ? numerator / denominator : 0.0;
+    double intercept = y_mean - slope * x_mean;
+
+    double sse = 0.0;
+    for (int i = 0; i < count; i++) {
+        double residual = prices[i] - (intercept + slope * i);
+        sse += residual * residual;
+    }
+
+    fit->level = intercept;
+    fit->trend = slope;
+    fit->x_mean = x_mean;
+    fit->sxx = denominator;
+    fit->residual_sd = count > 2 ? sqrt(sse / (count - 2)) : 0.0;
+    return 0;
+}
+
+static int linear_residuals(const double* prices, int count, const forecast_fit_t* fit, double* out) {
+    for (int i = 0; i < count; i++) {
+        out[i] = prices[i] - (fit->level + fit->trend * i);
+    }
+    return count;
+}
+
+static double linear_forecast(const forecast_fit_t* fit, int months_ahead, double* out_std_error) {
+    double x_target = fit->count - 1 + months_ahead;
+    double seasonal_factor = seasonal_factor_for_month(calendar_month(fit->base_month, months_ahead));
+    double predicted = (fit->level + fit->trend * x_target) * seasonal_factor;
+
+    // Standard error of a new observation at x_target:
+    // s * sqrt(1 + 1/n + (x_target - x_mean)^2 / Sxx)
+    if (out_std_error != NULL) {
+        *out_std_error = 0.0;
+        if (fit->count > 2 && fit->sxx > 0.0) {
+            double dx = x_target - fit->x_mean;
+            double leverage = 1.0 + 1.0 / fit->count + dx * dx / fit->sxx;
+            *out_std_error = fit->residual_sd * sqrt(leverage) * seasonal_factor;
+        }
+    }
+
+    // Ensure prediction is positive
+    return (predicted > 0) ? predicted : fit->last_price;
+}
+
+// Additive Holt-Winters: one pass with fixed parameters. The first
+// season initializes level, trend and seasonal terms; returns the sum of
+// squared one-step errors over the remaining points.
+static double holt_winters_pass(const double* y, int n, int first_month, double alpha, double beta,
+                                double gamma, forecast_fit_t* out, double* errors) {
+    const int m = FORECAST_SEASON_LENGTH;
+    double first_mean = 0.0, second_mean = 0.0;
+    for (int i = 0; i < m; i++) {
+        first_mean += y[i];
+        second_mean += y[i + m];
+    }
+    first_mean /= m;
+    second_mean /= m;
+
+    double level = first_mean;
+    double trend = (second_mean - first_mean) / m;
+    double seasonal[FORECAST_SEASON_LENGTH];
+    for (int i = 0; i < m; i++) {
+        seasonal[calendar_month(first_month, i)] = y[i] - first_mean;
+    }
+
+    double sse = 0.0;
+    for (int i = m; i < n; i++) {
+        int month = calendar_month(first_month, i);
+        double error = y[i] - (level + trend + seasonal[month]);
+        sse += error * error;
+        if (errors != NULL) {
+            errors[i - m] = error;
+        }
+
+        double new_level = alpha * (y[i] - seasonal[month]) + (1.0 - alpha) * (level + trend);
+        trend = beta * (new_level - level) + (1.0 - beta) * trend;
+        seasonal[month] = gamma * (y[i] - new_level) + (1.0 - gamma) * seasonal[month];
+        level = new_level;
+    }
+
+    if (out != NULL) {
+        out->level = level;
+        out->trend = trend;
+        memcpy(out->seasonal, seasonal, sizeof(seasonal));
+    }
+    return sse;
+}
+
+// Calendar month of the first point of a series
+static int holt_winters_first_month(int count, int base_month) {
+    return calendar_month(base_month, -(count - 1) % FORECAST_SEASON_LENGTH);
+}
+
+static int holt_winters_fit(const double* prices, int count, int base_month, forecast_fit_t* fit) {
+    fit_reset(fit, prices, count, base_month);
+    if (count < 2 * FORECAST_SEASON_LENGTH) {
+        return 1;
+    }
+
+    int first_month = holt_winters_first_month(count, base_month);
+    double best_sse = INFINITY;
+    for (int a = 0; a < GRID_SIZE(ALPHA_GRID); a++) {
+        for (int b = 0; b < GRID_SIZE(BETA_GRID); b++) {
+            for (int g = 0; g < GRID_SIZE(GAMMA_GRID); g++) {
+                double sse = holt_winters_pass(prices, count, first_month, ALPHA_GRID[a], BETA_GRID[b],
+                                               GAMMA_GRID[g], NULL, NULL);
+                if (sse < best_sse) {
+                    best_sse = sse;
+                    fit->alpha = ALPHA_GRID[a];
+                    fit->beta = BETA_GRID[b];
+                    fit->gamma = GAMMA_GRID[g];
+                }
+            }
+        }
+    }
+
+    holt_winters_pass(prices, count, first_month, fit->alpha, fit->beta, fit->gamma, fit, NULL);
+    int errors = count - FORECAST_SEASON_LENGTH;
+    int params = 3 + 2;
+    fit->residual_sd = errors > params ? sqrt(best_sse / (errors - params)) : sqrt(best_sse / errors);
+    return 0;
+}
+
+static int holt_winters_refit(const double* prices, int count, int base_month, forecast_fit_t* fit) {
+    if (count < 2 * FORECAST_SEASON_LENGTH) {
+        return 1;
+    }
+    forecast_fit_t params = *fit;
+    fit_reset(fit, prices, count, base_month);
+    fit->alpha = params.alpha;
+    fit->beta = params.beta;
+    fit->gamma = params.gamma;
+    fit->residual_sd = params.residual_sd;
+    holt_winters_pass(prices, count, holt_winters_first_month(count, base_month), fit->alpha, fit->beta,
+                      fit->gamma, fit, NULL);
+    return 0;
+}
+
+static int holt_winters_residuals(const double* prices, int count, const forecast_fit_t* fit, double* out) {
+    if (count < 2 * FORECAST_SEASON_LENGTH) {
+        return 0;
+    }
+    holt_winters_pass(prices, count, holt_winters_first_month(count, fit->base_month), fit->alpha, fit->beta,
+                      fit->gamma, NULL, out);
+    return count - FORECAST_SEASON_LENGTH;
+}
+
+static double holt_winters_forecast(const forecast_fit_t* fit, int months_ahead, double* out_std_error) {
+    double predicted = fit->level + months_ahead * fit->trend +
+                       fit->seasonal[calendar_month(fit->base_month, months_ahead)];
+
+    // Error-correction form: var_h = s^2 * (1 + sum_{j<h} c_j^2), with
+    // c_j = alpha * (1 + j * beta) + gamma * (1 - alpha) on seasonal lags
+    if (out_std_error != NULL) {
+        double variance_factor = 1.0;
+        for (int j = 1; j < months_ahead; j++) {
+            double c = fit->alpha * (1.0 + j * fit->beta);
+            if (j % FORECAST_SEASON_LENGTH == 0) {
+                c += fit->gamma * (1.0 - fit->alpha);
+            }
+            variance_factor += c * c;
+        }
+        *out_std_error = fit->residual_sd * sqrt(variance_factor);
+    }
+
+    return (predicted > 0) ? predicted : fit->last_price;
+}
+
+// Damped trend (additive, non-seasonal) exponential smoothing pass
+static double damped_trend_pass(const double* y, int n, double alpha, double beta, double phi,
+                                forecast_fit_t* out, double* errors) {
+    double level = y[0];
+    double trend = y[1] - y[0];
+    double sse = 0.0;
+
+    for (int i = 1; i < n; i++) {
+        double error = y[i] - (level + phi * trend);
+        sse += error * error;
+        if (errors != NULL) {
+            errors[i - 1] = error;
+        }
+
+        double new_level = alpha * y[i] + (1.0 - alpha) * (level + phi * trend);
+        trend = beta * (new_level - level) + (1.0 - beta) * phi * trend;
+        level = new_level;
+    }
+
+    if (out != NULL) {
+        out->level = level;
+        out->trend = trend;
+    }
+    return sse;
+}
+
+static int damped_trend_fit(const double* prices, int count, int base_month, forecast_fit_t* fit) {
+    fit_reset(fit, prices, count, base_month);
+    if (count < 4) {
+        return 1;
+    }
+
+    double best_sse = INFINITY;
+    for (int a = 0; a < GRID_SIZE(ALPHA_GRID); a++) {
+        for (int b = 0; b < GRID_SIZE(BETA_GRID); b++) {
+            for (int p = 0; p < GRID_SIZE(PHI_GRID); p++) {
+                double sse = damped_trend_pass(prices, count, ALPHA_GRID[a], BETA_GRID[b], PHI_GRID[p], NULL, NULL);
+                if (sse < best_sse) {
+                    best_sse = sse;
+                    fit->alpha = ALPHA_GRID[a];
+                    fit->beta = BETA_GRID[b];
+                    fit->damping = PHI_GRID[p];
+                }
+            }
+        }
+    }
+
+    damped_trend_pass(prices, count, fit->alpha, fit->beta, fit->damping, fit, NULL);
+    int errors = count - 1;
+    int params = 3;
+    fit->residual_sd = errors > params ? sqrt(best_sse / (errors - params)) : sqrt(best_sse / errors);
+    return 0;
+}
+
+static int damped_trend_refit(const double* prices, int count, int base_month, forecast_fit_t* fit) {
+    if (count < 4) {
+        return 1;
+    }
+    forecast_fit_t params = *fit;
+    fit_reset(fit, prices, count, base_month);
+    fit->alpha = params.alpha;
+    fit->beta = params.beta;
+    fit->damping = params.damping;
+    fit->residual_sd = params.residual_sd;
+    damped_trend_pass(prices, count, fit->alpha, fit->beta, fit->damping, fit, NULL);
+    return 0;
+}
+
+static int damped_trend_residuals(const double* prices, int count, const forecast_fit_t* fit, double* out) {
+    if (count < 4) {
+        return 0;
+    }
+    damped_trend_pass(prices, count, fit->alpha, fit->beta, fit->damping, NULL, out);
+    return count - 1;
+}
+
+static double damped_trend_forecast(const forecast_fit_t* fit, int months_ahead, double* out_std_error) {
+    // level + (phi + phi^2 + ... + phi^h) * trend
+    double phi = fit->damping;
+    double phi_sum = 0.0, phi_power = 1.0;
+    for (int j = 1; j <= months_ahead; j++) {
+        phi_power *= phi;
+        phi_sum += phi_power;
+    }
+    double predicted = fit->level + phi_sum * fit->trend;
+
+    // c_j = alpha * (1 + beta * (phi + ... + phi^j))
+    if (out_std_error != NULL) {
+        double variance_factor = 1.0;
+        double partial = 0.0, power = 1.0;
+        for (int j = 1; j < months_ahead; j++) {
+            power *= phi;
+            partial += power;
+            double c = fit->alpha * (1.0 + fit->beta * partial);
+            variance_factor += c * c;
+        }
+        *out_std_error = fit->residual_sd * sqrt(variance_factor);
+    }
+
+    return (predicted > 0) ? predicted : fit->last_price;
+}
+
+static const forecast_model_t MODELS[] = {
+    { "linear_regression", 2, linear_fit, linear_forecast, linear_fit, linear_residuals, 1 },
+    { "holt_winters", 2 * FORECAST_SEASON_LENGTH, holt_winters_fit, holt_winters_forecast,
+      holt_winters_refit, holt_winters_residuals, 0 },
+    { "damped_trend", 4, damped_trend_fit, damped_trend_forecast, damped_trend_refit, damped_trend_residuals, 0 }
+};
+
+const forecast_model_t* forecast_models(int* out_count) {
+    if (out_count != NULL) {
+        *out_count = (int) (sizeof(MODELS) / sizeof(MODELS[0]));
+    }
+    return MODELS;
+}
+
+const forecast_model_t* forecast_model_find(const char* name) {
+    if (name == NULL) {
+        return NULL;
+    }
+    for (size_t i = 0; i < sizeof(MODELS) / sizeof(MODELS[0]); i++) {
+        if (strcmp(MODELS[i].name, name) == 0) {
+            return &MODELS[i];
+        }
+    }
+    return NULL;
+}
+
+int forecast_fill_gaps(const int* months, const double* prices, int count, double* out) {
+    if (count <= 0) {
+        return 0;
+    }
+    int span = months[count - 1] - months[0] + 1;
+    if (out == NULL) {
+        return span;
+    }
+    out[0] = prices[0];
+    for (int i = 1; i < count; i++) {
+        int from = months[i - 1] - months[0];
+        int gap = months[i] - months[i - 1];
+        for (int k = 1; k < gap; k++) {
+            out[from + k] = prices[i - 1] + (prices[i] - prices[i - 1]) * k / gap;
+        }
+        out[from + gap] = prices[i];
+    }
+    return span;
+}
@@ -0,0 +1,78 @@
+#ifndef ADMISSION_H
+#define ADMISSION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+/**
+ * Admission control
+ *
+ * Every request first passes a per-client token bucket (keyed by IP
+ * address, IPv6 clients by their /64), then the global in-flight limit.
+ * Both checks are lock-free: buckets are single 64-bit words updated
+ * with compare-and-swap in a fixed table (clients hashing to the same
+ * slot share a bucket), and the in-flight count is an atomic counter.
+ * Rejected requests are answered at once instead of queueing: 429 when
+ * the client is over its rate, 503 when the server is saturated, both
+ * with Retry-After.
+ *
+ * Each admitted request also gets a deadline (see db_set_deadline);
+ * requests that run out of time are answered with 504 and counted.
+ */
+
+#define ADMISSION_BUCKETS 65536               // Token bucket slots (power of two)
+#define ADMISSION_DEFAULT_RATE 50             // Requests per second per client
+#define ADMISSION_DEFAULT_BURST 100           // Bucket size
+#define ADMISSION_DEFAULT_MAX_IN_FLIGHT 256   // Requests handled at once
+#define ADMISSION_DEFAULT_DEADLINE_MS 5000    // Routes without their own deadline
+
+typedef enum {
+    ADMISSION_OK = 0,
+    ADMISSION_RATE_LIMITED = -1,   // Client over its rate: 429
+    ADMISSION_OVERLOADED = -2      // In-flight limit reached: 503
+} admission_status_t;
+
+/**
+ * Admission counters
+ */
+typedef struct {
+    uint64_t admitted;
+    uint64_t rate_limited;         // Shed by the per-client buckets
+    uint64_t shed;                 // Shed by the in-flight limit
+    uint64_t deadline_exceeded;    // Admitted requests answered 504
+    size_t in_flight;
+} admission_stats_t;
+
+/**
+ * Set the limits (before serving; the defaults apply otherwise)
+ * @param rate Requests per second per client, 0 to disable rate limiting
+ * @param burst Requests a client may send at once
+ * @param max_in_flight Requests handled at once, 0 for no limit
+ */
+void admission_configure(unsigned int rate, unsigned int burst, unsigned int max_in_flight);
+
+/**
+ * Take a token from the client's bucket
+ * @param addr Client address (NULL is never limited)
+ * @param retry_after_s Receives the seconds until a token is available when limited
+ * @return ADMISSION_OK or ADMISSION_RATE_LIMITED
+ */
+int admission_check_rate(const struct sockaddr* addr, unsigned int* retry_after_s);
+
+/**
+ * Count a request in flight; pair a successful call with admission_leave
+ * @return ADMISSION_OK or ADMISSION_OVERLOADED
+ */
+int admission_enter(void);
+
+void admission_leave(void);
+
+/**
+ * Count a request that ran out of time
+ */
+void admission_record_deadline_exceeded(void);
+
+void admission_get_stats(admission_stats_t* out);
+
+#endif // ADMISSION_H
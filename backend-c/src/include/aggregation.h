@@ -0,0 +1,102 @@
+#ifndef AGGREGATION_H
+#define AGGREGATION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <libpq-fe.h>
+#include "properties.h"
+
+/**
+ * Highest month index tracked by the dirty-month bitmap (year 2311)
+ */
+#define AGGREGATION_MAX_MONTHS 4096
+
+/**
+ * Price history row structure
+ *
+ * One materialized row of the price_history table: the average price per
+ * square meter of all listings of a district and room count that were
+ * listed during a given month.
+ */
+typedef struct {
+    int district_id;           // District ID
+    int room_count;            // Number of rooms
+    int month;                 // Month index (see utils.h)
+    double avg_price_per_sqm;  // Average price per square meter
+    int sample_size;           // Number of listings in the group
+} price_history_row_t;
+
+/**
+ * Initialize the aggregation engine
+ *
+ * Registers a listing ingest hook that marks the months touched by new or
+ * changed listings as dirty, so aggregation_run only recomputes those.
+ */
+void aggregation_init(void);
+
+/**
+ * Mark a month as needing recomputation
+ *
+ * Only months that have seen listing changes should be marked: a dirty
+ * month is rebuilt purely from the listings currently in the store, so
+ * history rows of months without listings are left untouched.
+ */
+void aggregation_mark_dirty(int month);
+
+/**
+ * Group listings by (district, rooms, month) and compute price per sqm
+ *
+ * Each worker aggregates a share of the listings into its own hash table;
+ * the partial tables are merged at the end. Listings without a positive
+ * area or price, or outside `month_mask`, are skipped.
+ *
+ * @param listings Listings to scan
+ * @param count Number of listings
+ * @param month_mask Bitmap of months to include (AGGREGATION_MAX_MONTHS
+ *                   bits), or NULL to include every month
+ * @param workers Number of threads (<= 0 for the CPU count)
+ * @param out_rows Receives a malloc'd array sorted by district, rooms, month
+ * @param out_count Receives the number of rows
+ * @return 0 on success, non-zero on allocation failure or if the worker
+ *         threads could not be started
+ */
+int aggregation_group_by(const property_t* listings, size_t count, const uint64_t* month_mask,
+                         int workers, price_history_row_t** out_rows, size_t* out_count);
+
+/**
+ * Load the persisted price_history table into the in-memory view
+ * @return Number of rows loaded, or -1 on failure
+ */
+int aggregation_load(PGconn* conn);
+
+/**
+ * Recompute dirty months and upsert them into price_history
+ *
+ * Rows for (district, rooms) groups that no longer have listings in a
+ * dirty month are deleted. On failure the dirty months are kept so the
+ * next run retries them.
+ *
+ * @param conn Open database connection, or NULL to only refresh the
+ *             in-memory view
+ * @param workers Number of threads (<= 0 for the CPU count)
+ * @return Number of months recomputed, or -1 on failure
+ */
+int aggregation_run(PGconn* conn, int workers);
+
+/**
+ * Get the most recent months of a series from the in-memory view
+ * @param district_id District ID
+ * @param room_count Number of rooms
+ * @param months Maximum number of months to return
+ * @param out_count Receives the number of rows
+ * @return malloc'd rows in chronological order, or NULL if there are none
+ */
+price_history_row_t* aggregation_get_series(int district_id, int room_count, int months, int* out_count);
+
+/**
+ * Copy the whole in-memory view (sorted by district, rooms, month)
+ * @return malloc'd rows, or NULL if the view is empty
+ */
+price_history_row_t* aggregation_snapshot(size_t* out_count);
+
+#endif // AGGREGATION_H
@@ -3,6 +3,7 @@
 
 #include <microhttpd.h>
 #include <jansson.h>
+#include "response_encoding.h"
 
 /**
  * API Endpoint Handler Types
@@ -16,12 +17,20 @@ typedef enum {
 
 /**
  * API Response structure
+ *
+ * Handlers either set `data` (create_json_response), which the
+ * dispatcher serializes in the format negotiated from the Accept header
+ * (see response_encoding.h), or fill `body` and `content_type`
+ * themselves. `format` holds the negotiated format when the handler is
+ * called, for handlers that serialize on their own.
  */
 typedef struct {
     int status_code;
     char* content_type;
     char* body;
     size_t body_size;
+    json_t* data;
+    response_format_t format;
 } api_response_t;
 
 /**
@@ -30,27 +39,87 @@ typedef struct {
 typedef int (*route_handler_func)(const char* url, const char* query_string, 
                                 const char* request_body, api_response_t* response);
 
+/**
+ * Handler of a route that requires a signed-in user
+ *
+ * The dispatcher verifies the "Authorization: Bearer <token>" header
+ * (see auth.h) and answers 401 itself if it is missing or invalid.
+ */
+typedef int (*user_route_handler_func)(int user_id, const char* url, const char* query_string,
+                                       const char* request_body, api_response_t* response);
+
 /**
  * API Route Definition
+ *
+ * Exactly one of handler and user_handler is set. deadline_ms bounds the
+ * time from the request's arrival to its response, database work
+ * included (0 for ADMISSION_DEFAULT_DEADLINE_MS, see admission.h);
+ * requests past it are answered 504.
  */
 typedef struct {
     const char* path;
     http_method_t method;
     route_handler_func handler;
+    user_route_handler_func user_handler;
+    unsigned int deadline_ms;
 } api_route_t;
 
+#define API_MAX_ROUTE_PARAMS 5    // ":name" segments in a route path
+
+/**
+ * The route table
+ * @param out_count Receives the number of routes
+ */
+const api_route_t* api_routes(size_t* out_count);
+
+/**
+ * Find the route of a request
+ * @param method Request method ("GET", "POST", "PUT" or "DELETE")
+ * @param params Array of API_MAX_ROUTE_PARAMS pointers, set to NULL by
+ *               the caller; receives copies of the URL segments matched
+ *               by ":name" segments, which the caller frees
+ * @return Matching route, or NULL (params are then left untouched)
+ */
+const api_route_t* api_find_route(const char* url, const char* method, char** params);
+
 /**
  * Initialize the API server with specified port
+ *
+ * The port is bound with SO_REUSEPORT, so a new server can start on it
+ * while this one drains.
+ *
  * @param port Port number to listen on
  * @return 0 on success, non-zero on failure
  */
 int api_server_init(unsigned int port);
 
 /**
- * Start the API server (blocking call)
+ * Initialize the API server on a listening socket it is given, such as
+ * a supervisor worker's (see supervisor.h)
+ * @param listen_fd Bound, listening socket
  * @return 0 on success, non-zero on failure
  */
-int api_server_start();
+int api_server_init_socket(int listen_fd);
+
+/**
+ * Block SIGINT, SIGTERM and SIGHUP in the calling thread and the
+ * threads it starts, so api_server_start can wait for them. Call it in
+ * main before any thread is started.
+ */
+void api_server_block_signals(void);
+
+/**
+ * Serve until SIGINT or SIGTERM (blocking call), then drain
+ *
+ * Draining stops accepting connections, ends /api/stream subscriptions
+ * and lets requests in flight finish, with "Connection: close" on their
+ * responses, for up to drain_timeout_ms. Call api_server_stop after.
+ * SIGHUP is ignored here; reloads are done by the supervisor.
+ *
+ * @param drain_timeout_ms Longest time to wait for requests in flight
+ * @return 0 on success, non-zero on failure
+ */
+int api_server_start(unsigned int drain_timeout_ms);
 
 /**
  * Stop the API server
@@ -67,7 +136,8 @@ int api_request_handler(void* cls, struct MHD_Connection* connection,
 
 /**
  * Create a JSON response
- * @param data JSON data to send
+ * @param data JSON data to send (ownership is taken; it is serialized
+ *             in the negotiated format once the handler returns)
  * @param status_code HTTP status code
  * @return api_response_t with JSON data
  */
@@ -81,4 +151,57 @@ api_response_t create_json_response(json_t* data, int status_code);
  */
 api_response_t create_error_response(const char* message, int status_code);
 
+/**
+ * Route handlers
+ *
+ * Each handler fills `response` and returns 0; a non-zero return makes
+ * the dispatcher answer 500.
+ */
+int price_get_trends(const char* url, const char* query_string,
+                     const char* request_body, api_response_t* response);
+int price_get_predictions(const char* url, const char* query_string,
+                          const char* request_body, api_response_t* response);
+int properties_get_all(const char* url, const char* query_string,
+                        const char* request_body, api_response_t* response);
+int properties_get_by_id(const char* url, const char* query_string,
+                         const char* request_body, api_response_t* response);
+int districts_get_all(const char* url, const char* query_string,
+                      const char* request_body, api_response_t* response);
+int districts_get_properties(const char* url, const char* query_string,
+                             const char* request_body, api_response_t* response);
+int districts_get_by_id(const char* url, const char* query_string,
+                        const char* request_body, api_response_t* response);
+int metrics_get(const char* url, const char* query_string,
+                const char* request_body, api_response_t* response);
+int properties_get_valuation(const char* url, const char* query_string,
+                             const char* request_body, api_response_t* response);
+int properties_get_comparables(const char* url, const char* query_string,
+                               const char* request_body, api_response_t* response);
+int properties_get_investment(const char* url, const char* query_string,
+                              const char* request_body, api_response_t* response);
+int investment_get_rankings(const char* url, const char* query_string,
+                            const char* request_body, api_response_t* response);
+int districts_get_stats(const char* url, const char* query_string,
+                        const char* request_body, api_response_t* response);
+int auth_login(const char* url, const char* query_string,
+               const char* request_body, api_response_t* response);
+int auth_register(const char* url, const char* query_string,
+                  const char* request_body, api_response_t* response);
+int auth_logout(const char* url, const char* query_string,
+                const char* request_body, api_response_t* response);
+int user_get_dashboard(int user_id, const char* url, const char* query_string,
+                       const char* request_body, api_response_t* response);
+int user_get_saved_properties(int user_id, const char* url, const char* query_string,
+                              const char* request_body, api_response_t* response);
+int user_save_property(int user_id, const char* url, const char* query_string,
+                       const char* request_body, api_response_t* response);
+int user_unsave_property(int user_id, const char* url, const char* query_string,
+                         const char* request_body, api_response_t* response);
+int user_get_saved_searches(int user_id, const char* url, const char* query_string,
+                            const char* request_body, api_response_t* response);
+int user_save_search(int user_id, const char* url, const char* query_string,
+                     const char* request_body, api_response_t* response);
+int user_delete_saved_search(int user_id, const char* url, const char* query_string,
+                             const char* request_body, api_response_t* response);
+
 #endif // API_HANDLER_H
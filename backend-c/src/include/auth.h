@@ -1,5 +1,141 @@
 #ifndef AUTH_H
 #define AUTH_H
-int register_user(const char* email, const char* password);
-int login_user(const char* email, const char* password);
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * Authentication
+ *
+ * Passwords are bcrypt hashes (cost AUTH_BCRYPT_COST, ~250 ms of CPU
+ * each), so hashing and verification run on a small dedicated worker
+ * pool with a bounded queue instead of on request threads; when the
+ * queue is full callers get AUTH_ERR_BUSY at once.
+ *
+ * Sessions are stateless tokens "<user_id>.<expires>.<token_id>.<mac>",
+ * where mac is the base64url HMAC-SHA256 of the first three fields.
+ * Verifying one takes a single HMAC and a constant-time comparison, plus
+ * a lookup in the in-memory set of revoked token ids; no database access.
+ *
+ * The revoked set belongs to the process: with several worker processes
+ * (see supervisor.h) a token revoked on one worker is still accepted by
+ * the others until it expires.
+ */
+
+#define AUTH_BCRYPT_COST 12
+#define AUTH_HASH_QUEUE_CAPACITY 64        // Pending hash jobs before callers are turned away
+#define AUTH_TOKEN_TTL_SECONDS (7 * 24 * 3600)
+#define AUTH_TOKEN_MAX_LENGTH 128
+#define AUTH_REVOCATION_CAPACITY 65536     // Revoked, unexpired tokens remembered
+#define AUTH_SECRET_TEXT_LENGTH 64         // Hex of a generated 32-byte key
+
+typedef enum {
+    AUTH_OK = 0,
+    AUTH_ERR_INVALID = -1,       // Wrong credentials, or a malformed, forged or expired token
+    AUTH_ERR_BUSY = -2,          // Hash queue full; retry later
+    AUTH_ERR_EXISTS = -3,        // Email already registered
+    AUTH_ERR_REVOKED = -4,       // Token was revoked
+    AUTH_ERR_INTERNAL = -5       // Database or crypto failure
+} auth_status_t;
+
+/**
+ * Authenticated user
+ */
+typedef struct {
+    int id;
+    char email[256];
+    char first_name[101];
+    char last_name[101];
+    int is_admin;
+} auth_user_t;
+
+/**
+ * Auth counters
+ */
+typedef struct {
+    uint64_t hashes;             // Hash and verify jobs completed
+    uint64_t rejected_busy;      // Jobs turned away by a full queue
+    size_t queue_length;
+    size_t revoked;              // Revoked tokens not yet expired
+} auth_stats_t;
+
+/**
+ * Start the password hash workers and set the token signing key
+ * @param secret Signing key (at least 32 bytes), or NULL for a random key
+ *               (tokens then do not survive a restart)
+ * @param workers Hash worker threads (<= 0 for half the CPUs, at least 1)
+ * @return 0 on success, non-zero on failure
+ */
+int auth_init(const char* secret, int workers);
+
+/**
+ * Generate a random signing key as hex text, for processes that must
+ * all sign with the same key but were given none
+ * @param out Buffer of at least AUTH_SECRET_TEXT_LENGTH + 1 bytes
+ * @return 0 on success, non-zero on failure
+ */
+int auth_generate_secret(char* out, size_t out_size);
+
+/**
+ * Stop the hash workers after the queued jobs finish
+ */
+void auth_shutdown(void);
+
+/**
+ * Hash a password on the worker pool
+ * @param out Receives the bcrypt hash string
+ * @return AUTH_OK, AUTH_ERR_BUSY or AUTH_ERR_INTERNAL
+ */
+int auth_hash_password(const char* password, char* out, size_t out_size);
+
+/**
+ * Check a password against a bcrypt hash on the worker pool
+ * @return AUTH_OK, AUTH_ERR_INVALID, AUTH_ERR_BUSY or AUTH_ERR_INTERNAL
+ */
+int auth_verify_password(const char* password, const char* hash);
+
+/**
+ * Issue a session token
+ * @param out Buffer of at least AUTH_TOKEN_MAX_LENGTH bytes
+ * @param out_expires Receives the expiry time (may be NULL)
+ * @return AUTH_OK or AUTH_ERR_INTERNAL
+ */
+int auth_issue_token(int user_id, char* out, size_t out_size, time_t* out_expires);
+
+/**
+ * Verify a session token
+ * @param out_user_id Receives the user id
+ * @return AUTH_OK, AUTH_ERR_INVALID or AUTH_ERR_REVOKED
+ */
+int auth_verify_token(const char* token, int* out_user_id);
+
+/**
+ * Revoke a valid token until it expires
+ * @return AUTH_OK, AUTH_ERR_INVALID, AUTH_ERR_REVOKED, or AUTH_ERR_BUSY
+ *         if the revocation set is full
+ */
+int auth_revoke_token(const char* token);
+
+/**
+ * Create a user (the password is hashed on the worker pool)
+ * @param out Receives the new user
+ * @return AUTH_OK, AUTH_ERR_EXISTS, AUTH_ERR_BUSY or AUTH_ERR_INTERNAL
+ */
+int register_user(const char* email, const char* password, const char* first_name, const char* last_name,
+                  auth_user_t* out);
+
+/**
+ * Check a user's credentials
+ *
+ * Unknown emails are checked against a dummy hash, so they take as long
+ * as wrong passwords.
+ *
+ * @param out Receives the user
+ * @return AUTH_OK, AUTH_ERR_INVALID, AUTH_ERR_BUSY or AUTH_ERR_INTERNAL
+ */
+int login_user(const char* email, const char* password, auth_user_t* out);
+
+void auth_get_stats(auth_stats_t* out);
+
 #endif // AUTH_H
@@ -0,0 +1,121 @@
+#ifndef BACKTEST_H
+#define BACKTEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "prediction.h"
+
+/**
+ * Backtest series structure
+ *
+ * One monthly price series to evaluate. Months may have gaps: models
+ * are fit on the series with missing months interpolated (see
+ * forecast_fill_gaps), and a forecast is only scored when the target
+ * month is present.
+ */
+typedef struct {
+    int district_id;     // District ID (0 for synthetic series)
+    int room_count;      // Number of rooms (series number for synthetic)
+    int count;           // Number of points
+    int* months;         // Month indexes (see utils.h), ascending
+    double* prices;      // Average price per sqm for each month
+} backtest_series_t;
+
+/**
+ * Walk-forward configuration
+ *
+ * Every observed month is a forecast origin once min_train months of
+ * history lead up to it. The model is fit on the gap-filled months up
+ * to the origin (the last `window` months, or all of them when window
+ * is 0) and its forecast `horizon` months past the origin is compared
+ * with the actual value. Origins whose training window is shorter than
+ * the model's min_points are skipped.
+ */
+typedef struct {
+    const forecast_model_t* model; // Model to evaluate (NULL = linear regression)
+    int horizon;          // Months ahead to forecast
+    int min_train;        // Minimum number of training months
+    int window;           // Rolling window length in months (0 = expanding window)
+    double interval_z;    // Normal quantile for the prediction interval
+} backtest_config_t;
+
+/**
+ * Accuracy of one series at one horizon
+ */
+typedef struct {
+    int district_id;
+    int room_count;
+    int forecasts;        // Number of scored forecasts
+    double mae;           // Mean absolute error (price per sqm)
+    double mape;          // Mean absolute percentage error (%)
+    double coverage;      // Share of actuals inside the interval (0.0-1.0)
+} backtest_result_t;
+
+/**
+ * Accuracy over all series, weighted by number of forecasts
+ */
+typedef struct {
+    int series;           // Series with at least one scored forecast
+    long forecasts;       // Total scored forecasts
+    double mae;
+    double mape;
+    double coverage;
+} backtest_summary_t;
+
+/**
+ * Default configuration: linear regression, 80% interval, 12 months
+ * minimum training
+ */
+backtest_config_t backtest_default_config(int horizon);
+
+/**
+ * Run a walk-forward backtest over a single series on the calling thread
+ */
+void backtest_evaluate(const backtest_series_t* series, const backtest_config_t* config,
+                       backtest_result_t* result);
+
+/**
+ * Run a walk-forward backtest over many series in parallel
+ *
+ * Series are claimed a few at a time by each worker (see parallel.h), so
+ * long series do not leave other cores idle.
+ *
+ * @param series Series to evaluate
+ * @param count Number of series
+ * @param config Walk-forward configuration
+ * @param workers Number of threads (<= 0 for the CPU count)
+ * @param results Output array of `count` results (may be NULL)
+ * @param summary Receives the aggregated accuracy
+ * @return 0 on success, non-zero on failure
+ */
+int backtest_run(const backtest_series_t* series, size_t count, const backtest_config_t* config,
+                 int workers, backtest_result_t* results, backtest_summary_t* summary);
+
+/**
+ * Load every series of the open series store (see series_store.h)
+ * @param out_count Receives the number of series
+ * @return malloc'd series (free with backtest_free_series), or NULL
+ */
+backtest_series_t* backtest_load_store(size_t* out_count);
+
+/**
+ * Generate synthetic series: a level around 900/sqm, a random monthly
+ * drift, quarterly seasonality and Gaussian noise
+ * @param count Number of series
+ * @param length Points per series
+ * @param seed Random seed (same seed gives the same series)
+ * @return malloc'd series (free with backtest_free_series), or NULL
+ */
+backtest_series_t* backtest_generate_synthetic(size_t count, int length, uint64_t seed);
+
+void backtest_free_series(backtest_series_t* series, size_t count);
+
+/**
+ * Write a per-series CSV report (one row per series)
+ * @param header Non-zero to write the column header first
+ */
+void backtest_write_csv(FILE* out, const backtest_config_t* config,
+                        const backtest_result_t* results, size_t count, int header);
+
+#endif // BACKTEST_H
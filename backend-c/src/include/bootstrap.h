@@ -0,0 +1,39 @@
+#ifndef BOOTSTRAP_H
+#define BOOTSTRAP_H
+
+#include "prediction.h"
+#include "rng.h"
+
+/**
+ * Resamples drawn per series by the prediction job
+ */
+#define BOOTSTRAP_DEFAULT_RESAMPLES 1000
+
+/**
+ * Residual bootstrap prediction intervals
+ *
+ * The model is fit once. Each resample builds a pseudo-series from the
+ * fitted values plus residuals drawn with replacement, refits the model
+ * with the original smoothing parameters and adds one more resampled
+ * residual, scaled to the horizon, as the future error. With fixed
+ * parameters a refit forecast is a weighted sum of the prices, so the
+ * weights are computed once (one refit per point) and every resample
+ * costs a single dot product instead of a full refit.
+ *
+ * @param model Forecasting model
+ * @param prices Monthly prices, oldest first
+ * @param count Number of prices
+ * @param base_month Calendar month (0 = January) of the last price
+ * @param horizons Months ahead to produce bands for
+ * @param horizon_count Number of horizons
+ * @param resamples Number of bootstrap resamples
+ * @param rng Generator owned by the calling thread
+ * @param out_bands Receives one band per horizon
+ * @return 0 on success, non-zero if the model cannot be fit or has too
+ *         few residuals
+ */
+int forecast_bootstrap(const forecast_model_t* model, const double* prices, int count, int base_month,
+                       const int* horizons, int horizon_count, int resamples, rng_t* rng,
+                       price_band_t* out_bands);
+
+#endif // BOOTSTRAP_H
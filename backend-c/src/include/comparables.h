@@ -0,0 +1,91 @@
+#ifndef COMPARABLES_H
+#define COMPARABLES_H
+
+#include <stddef.h>
+#include <jansson.h>
+#include "properties.h"
+
+/**
+ * Dimensions of the comparables feature space: log area, rooms, floor
+ * position, year built and the two coordinates (in kilometers)
+ */
+#define COMPARABLES_DIMENSIONS 6
+#define COMPARABLES_MAX_K 50
+
+/**
+ * Comparables query options
+ */
+typedef struct {
+    int k;                     // Number of neighbors (1..COMPARABLES_MAX_K)
+    int same_district;         // Only search the subject's district
+    int rooms_tolerance;       // Only search listings within +/- this many rooms (< 0 = any)
+} comparables_query_t;
+
+/**
+ * One comparable listing
+ */
+typedef struct {
+    int property_id;
+    int district_id;
+    int num_rooms;
+    int area_sqm;
+    int price;
+    property_status_t status;
+    float distance;            // Distance in the normalized feature space
+} comparable_t;
+
+/**
+ * Default query: 5 neighbors in the same district, +/- 1 room
+ */
+comparables_query_t comparables_default_query(void);
+
+/**
+ * Query options from a request's query string ("k=8&scope=all&rooms=-1");
+ * arguments not given keep their defaults. scope=all searches every
+ * district; rooms=-1 drops the room filter. k is not range-checked.
+ */
+comparables_query_t comparables_parse_query(const char* query_string);
+
+/**
+ * Rebuild the search index from the listing store
+ *
+ * Listings are sorted by (district, rooms) so each pair is a contiguous
+ * partition, and their normalized features are stored one array per
+ * dimension (structure of arrays). Each dimension is centered and scaled
+ * by its standard deviation and a weight; coordinates are scaled by a
+ * fixed neighborhood radius instead. Missing values sit at the mean.
+ * The index is built outside the query lock and swapped in with a short
+ * write lock.
+ *
+ * @return Number of listings indexed, or -1 on failure
+ */
+long comparables_rebuild(void);
+
+/**
+ * Find the listings closest to a subject listing
+ *
+ * Scans only the partitions allowed by the query, eight listings at a
+ * time, keeping the best k in a bounded max-heap. The subject itself is
+ * never returned.
+ *
+ * @param subject Listing to find comparables for (need not be indexed)
+ * @param query Query options
+ * @param out Receives up to query->k comparables, nearest first
+ * @return Number of comparables found, or -1 if no index is built
+ */
+int comparables_find(const property_t* subject, const comparables_query_t* query, comparable_t* out);
+
+/**
+ * Number of listings in the current index
+ */
+size_t comparables_count(void);
+
+/**
+ * Handler for the comparables API endpoint
+ * @param property_id Subject listing
+ * @param query Query options
+ * @return JSON object, or NULL if the listing is unknown or no index exists
+ */
+json_t* comparables_get_handler(int property_id, const comparables_query_t* query);
+
+#endif // COMPARABLES_H
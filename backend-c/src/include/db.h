@@ -1,6 +1,104 @@
 #ifndef DB_H
 #define DB_H
+#include <stdint.h>
 #include <libpq-fe.h>
+
+#define DB_CANCEL_GRACE_MS 1000   // Wait for a cancelled statement before dropping the connection
+
 PGconn* db_connect(const char *conn_info_str);
 void db_disconnect(PGconn *conn);
+
+/**
+ * Execute a statement that returns no rows (or whose rows are ignored)
+ * @param conn Open connection
+ * @param sql Statement text with $n placeholders
+ * @param n_params Number of text parameters
+ * @param params Parameter values (NULL entries are SQL NULL)
+ * @return 0 on success, non-zero on failure (error is logged)
+ */
+int db_exec_params(PGconn *conn, const char *sql, int n_params, const char *const *params);
+
+/**
+ * Run a query and return its result when it succeeds with tuples
+ * @return PGresult that must be released with PQclear, or NULL on failure
+ */
+PGresult* db_query_params(PGconn *conn, const char *sql, int n_params, const char *const *params);
+
+/**
+ * One statement of a pipeline
+ */
+typedef struct {
+    const char *sql;
+    int n_params;
+    const char *const *params;
+} db_statement_t;
+
+/**
+ * Run several statements in one libpq pipeline: all are sent before any
+ * result is read, so they cost a single network round trip. They run as
+ * one implicit transaction: if one fails, none of them take effect.
+ * @param results Receives one PGresult per statement (release each with PQclear)
+ * @return 0 if every statement succeeded; otherwise non-zero, the error is
+ *         logged and no results are returned
+ */
+int db_pipeline(PGconn *conn, const db_statement_t *statements, int count, PGresult **results);
+
+/**
+ * Request deadlines
+ *
+ * A request thread sets its deadline before calling into the database;
+ * it applies to every call made on that thread until it is cleared.
+ * Under a deadline, statements are sent as a pipeline that first sets
+ * statement_timeout to the time left (local to that transaction, so no
+ * extra round trip), the statement running when the deadline passes is
+ * cancelled with PQcancel, nothing is sent once it has passed, and
+ * db_pool_acquire stops waiting for a connection at the deadline.
+ *
+ * @param deadline_ms Deadline on the monotonic_ms clock (see utils.h), 0 for none
+ */
+void db_set_deadline(long long deadline_ms);
+
+/**
+ * Deadline set on this thread, 0 for none
+ */
+long long db_get_deadline(void);
+
+/**
+ * Whether the current deadline cut a database call short on this thread
+ * since db_set_deadline
+ */
+int db_deadline_hit(void);
+
+typedef struct {
+    uint64_t skipped;        // Statements not sent, the deadline had passed
+    uint64_t cancelled;      // Statements cancelled at the deadline (PQcancel or statement_timeout)
+    uint64_t pool_timeouts;  // Connection waits that ran into the deadline
+} db_deadline_stats_t;
+
+void db_get_deadline_stats(db_deadline_stats_t* out);
+
+/**
+ * Connection pool for request handlers
+ *
+ * The refresh thread keeps its own connection; request handlers borrow
+ * one of these instead, waiting when all are in use.
+ *
+ * @param conn_info_str Connection string
+ * @param size Number of connections to open
+ * @return Number of connections opened (0 if the database is unreachable)
+ */
+int db_pool_init(const char *conn_info_str, int size);
+
+/**
+ * Borrow a pooled connection
+ * @return Connection, or NULL if the pool has no connections
+ */
+PGconn* db_pool_acquire(void);
+
+/**
+ * Return a borrowed connection; broken connections are reset first
+ */
+void db_pool_release(PGconn *conn);
+
+void db_pool_close(void);
 #endif // DB_H
@@ -0,0 +1,103 @@
+#ifndef DISTRICT_STATS_H
+#define DISTRICT_STATS_H
+
+#include <stdint.h>
+#include <jansson.h>
+#include "properties.h"
+
+/**
+ * Minimum number of listings a (district, rooms, type) group needs before
+ * new listings are judged against it rather than a coarser group
+ */
+#define DISTRICT_STATS_MIN_SAMPLES 20
+
+/**
+ * Number of recent outlier listings remembered per district
+ */
+#define DISTRICT_STATS_RECENT_OUTLIERS 16
+
+typedef enum {
+    PRICE_OUTLIER_NONE,
+    PRICE_OUTLIER_LOW,
+    PRICE_OUTLIER_HIGH
+} price_outlier_t;
+
+/**
+ * Price per square meter distribution of a group of listings
+ */
+typedef struct {
+    uint64_t count;
+    double min;
+    double p10;
+    double p25;
+    double p50;
+    double p75;
+    double p90;
+    double max;
+    double lower_fence;        // p25 - 1.5 * IQR
+    double upper_fence;        // p75 + 1.5 * IQR
+} price_distribution_t;
+
+/**
+ * Initialize district statistics
+ *
+ * Registers a listing ingest hook that adds the price per square meter
+ * of each new listing to the quantile sketch of its (district, rooms,
+ * type) group (see quantile_sketch.h) and flags it if it falls outside
+ * the group's IQR fences. Reprices and moves to another group only show
+ * after the next district_stats_rebuild, since a sketch cannot remove
+ * the old observation. The hook does nothing until the first rebuild.
+ */
+void district_stats_init(void);
+
+/**
+ * Rebuild every group's sketch from the listing store
+ *
+ * Each worker sketches a share of the listings into its own groups; the
+ * per-worker sketches are then merged and swapped in. Ingests wait
+ * while the store is scanned (see properties_hold_ingest); listings
+ * added after the scan are applied to the new sketches before the swap.
+ * Must not be called from an ingest hook.
+ *
+ * @param workers Number of threads (<= 0 for the CPU count)
+ * @return Number of listings sketched, or -1 on failure
+ */
+long district_stats_rebuild(int workers);
+
+/**
+ * Price per square meter distribution of a district
+ *
+ * Merges the sketches of the matching groups; no listings are scanned.
+ *
+ * @param district_id District ID
+ * @param num_rooms Number of rooms, or 0 for all
+ * @param type_id Property type ID, or 0 for all
+ * @param out Receives the distribution
+ * @return 0 on success, non-zero if no listing matches
+ */
+int district_stats_get(int district_id, int num_rooms, int type_id, price_distribution_t* out);
+
+/**
+ * Judge a listing's price per square meter against its group
+ *
+ * Uses the listing's (district, rooms, type) group when it has at least
+ * DISTRICT_STATS_MIN_SAMPLES listings, else (district, rooms), else the
+ * district.
+ *
+ * @return PRICE_OUTLIER_LOW or _HIGH outside the IQR fences, otherwise
+ *         PRICE_OUTLIER_NONE (also when there is too little data)
+ */
+price_outlier_t district_stats_classify(const property_t* listing);
+
+const char* price_outlier_to_string(price_outlier_t outlier);
+
+/**
+ * Handler for the district statistics API endpoint
+ * @param district_id District ID
+ * @param num_rooms Number of rooms, or 0 for all
+ * @param type_id Property type ID, or 0 for all
+ * @return JSON object, or NULL if the district has no listings
+ */
+json_t* district_stats_handler(int district_id, int num_rooms, int type_id);
+
+#endif // DISTRICT_STATS_H
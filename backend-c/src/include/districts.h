@@ -1,4 +1,25 @@
 #ifndef DISTRICTS_H
 #define DISTRICTS_H
+
+#include <libpq-fe.h>
+#include <jansson.h>
+
 void get_districts_json();
+
+/**
+ * Load a district with its number of active listings
+ * @param conn Open database connection
+ * @param out Receives the JSON object when found
+ * @return 0 if found, 1 if there is no such district, -1 on failure
+ */
+int districts_get_detail(PGconn* conn, int district_id, json_t** out);
+
+/**
+ * Load every district with its number of active listings, by name
+ * @param conn Open database connection
+ * @param out Receives the JSON array
+ * @return 0 on success, -1 on failure
+ */
+int districts_list(PGconn* conn, json_t** out);
+
 #endif // DISTRICTS_H
@@ -0,0 +1,122 @@
+#ifndef EVENT_STREAM_H
+#define EVENT_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "properties.h"
+#include "prediction.h"
+
+/**
+ * Change feed for GET /api/stream (Server-Sent Events)
+ *
+ * Events are serialized once into SSE frames and kept in a single ring
+ * shared by all subscribers; each subscriber only holds a cursor into
+ * it, so publishing costs the same however many clients are connected.
+ * Subscribers that fall more than EVENT_STREAM_CAPACITY events behind
+ * skip to the oldest retained event and receive a "resync" event; after
+ * EVENT_STREAM_MAX_LAGS such skips they are disconnected.
+ */
+
+#define EVENT_STREAM_CAPACITY 4096        // Events retained for slow or reconnecting clients
+#define EVENT_STREAM_MAX_SUBSCRIBERS 256
+#define EVENT_STREAM_MAX_LAGS 3
+#define EVENT_STREAM_HEARTBEAT_MS 15000   // Keep-alive comment after this long without events
+
+typedef enum {
+    STREAM_EVENT_LISTING,      // New listing, or a listing whose attributes changed
+    STREAM_EVENT_STATUS,       // Status transition (active / pending / sold)
+    STREAM_EVENT_PREDICTION    // Updated price prediction of a series
+} stream_event_type_t;
+
+#define STREAM_EVENT_ALL ((1u << STREAM_EVENT_LISTING) | (1u << STREAM_EVENT_STATUS) | (1u << STREAM_EVENT_PREDICTION))
+
+typedef struct event_subscriber event_subscriber_t;
+
+/**
+ * Feed counters
+ */
+typedef struct {
+    uint64_t last_event_id;    // 0 if nothing was published yet
+    uint64_t published;
+    size_t subscribers;
+    uint64_t lagged;           // Skips over events lost to the ring
+    uint64_t disconnected;     // Subscribers dropped for lagging repeatedly
+} event_stream_stats_t;
+
+/**
+ * Start the feed
+ *
+ * Registers a listing ingest hook that publishes new listings, changed
+ * listings and status transitions. Nothing is published before this is
+ * called, so call it once the initial listings are loaded. Event ids
+ * start from the current time in microseconds, so ids from before a
+ * restart are older than every new one.
+ */
+void event_stream_init(void);
+
+/**
+ * Publish an event
+ * @param type Event type
+ * @param data JSON text (must not contain newlines)
+ * @return Event id, or 0 if the feed is not started or on failure
+ */
+uint64_t event_stream_publish(stream_event_type_t type, const char* data);
+
+/**
+ * Publish the listing events for one ingested listing
+ * @param previous Listing before the change, or NULL if it is new
+ * @param current Listing after the change
+ * @return Number of events published
+ */
+int event_stream_publish_listing(const property_t* previous, const property_t* current);
+
+/**
+ * Publish an updated prediction of a (district, rooms) series
+ * @return Event id, or 0 if the feed is not started or on failure
+ */
+uint64_t event_stream_publish_prediction(int district_id, int room_count, const price_prediction_t* prediction);
+
+/**
+ * Add a subscriber
+ * @param last_event_id Resume after this event id, or 0 to start with the next event
+ * @param type_mask Bit (1 << type) for each stream_event_type_t wanted
+ * @return Subscriber, or NULL if EVENT_STREAM_MAX_SUBSCRIBERS are connected
+ */
+event_subscriber_t* event_stream_subscribe(uint64_t last_event_id, unsigned type_mask);
+
+/**
+ * Write the subscriber's next SSE frames to buf
+ *
+ * Blocks until at least one event is available or timeout_ms passes, in
+ * which case a keep-alive comment is written instead. Frames larger
+ * than max are split across calls.
+ *
+ * @return Bytes written (> 0), or -1 if the subscriber was disconnected
+ */
+ssize_t event_stream_read(event_subscriber_t* subscriber, char* buf, size_t max, int timeout_ms);
+
+/**
+ * End every stream, e.g. before the server drains
+ *
+ * Blocked and later reads return -1 at once, so subscribers disconnect
+ * and reconnect elsewhere with their Last-Event-ID.
+ */
+void event_stream_close(void);
+
+/**
+ * Remove a subscriber
+ */
+void event_stream_unsubscribe(event_subscriber_t* subscriber);
+
+/**
+ * Parse a comma-separated list of event type names into a type mask
+ * @return Mask, or 0 if a name is unknown
+ */
+unsigned event_stream_parse_types(const char* names);
+
+const char* stream_event_type_to_string(stream_event_type_t type);
+
+void event_stream_get_stats(event_stream_stats_t* out);
+
+#endif // EVENT_STREAM_H
@@ -0,0 +1,266 @@
+#ifndef INVESTMENT_H
+#define INVESTMENT_H
+
+#include <stddef.h>
+#include <jansson.h>
+#include "properties.h"
+
+/**
+ * Investment analytics
+ *
+ * Server-side port of frontend-react/src/utils/advancedInvestmentCalculator.js
+ * (ROI, MIRR, CFROI, DSCR, break-even, sensitivity analysis and
+ * amortization schedules). Metrics are computed over structure-of-arrays
+ * batches, several listings per vector operation, so whole result sets
+ * can be ranked by yield.
+ */
+
+#define INVESTMENT_SENSITIVITY_STEPS 5
+#define INVESTMENT_SENSITIVITY_PARAMETERS 5
+#define INVESTMENT_MAX_RANKING 500   // Largest offset + limit of a ranking
+
+/**
+ * Financing and operating assumptions
+ *
+ * Rates are fractions (0.05 = 5%). Defaults match the neutral scenario
+ * of the investment analysis page.
+ */
+typedef struct {
+    double down_payment;       // Share of the price paid up front (0 < x <= 1)
+    double interest_rate;      // Annual mortgage rate
+    double property_tax_rate;  // Annual tax as a share of the price
+    double insurance_rate;     // Annual insurance as a share of the price
+    double maintenance_rate;   // Annual maintenance as a share of the price
+    double monthly_hoa;        // Monthly association fee (EUR)
+    double vacancy_rate;       // Share of the year the unit stands empty
+    double management_rate;    // Management fee as a share of collected rent
+    double rent_yield;         // Monthly gross rent as a share of market value
+    double finance_rate;       // MIRR rate for negative cash flows
+    double reinvest_rate;      // MIRR rate for positive cash flows
+    double default_growth;     // Appreciation used when no prediction exists
+    double land_share;         // Non-depreciable share of the price
+    double depreciation_years; // Depreciation period of the building
+    double tax_bracket;        // Investor's marginal income tax rate
+    int loan_term_years;       // Mortgage term
+    int holding_years;         // Holding period of ROI and MIRR
+} investment_assumptions_t;
+
+/**
+ * Batch inputs, one array per attribute
+ */
+typedef struct {
+    const double* prices;        // Purchase price
+    const double* monthly_rents; // Gross monthly rent (> 0)
+    const double* growth_rates;  // Annual appreciation
+} investment_inputs_t;
+
+/**
+ * Batch outputs, one array per metric; every array must hold the batch
+ */
+typedef struct {
+    double* monthly_mortgage;     // Monthly principal and interest
+    double* monthly_cash_flow;    // Monthly cash flow after debt service
+    double* net_operating_income; // Annual NOI
+    double* cap_rate;             // NOI / price
+    double* cash_on_cash;         // Annual cash flow / down payment
+    double* dscr;                 // NOI / annual debt service (0 without a loan)
+    double* break_even_occupancy; // Occupancy covering all costs (capped at 1)
+    double* roi;                  // Total ROI over the holding period (on price)
+    double* annualized_roi;       // Annualized total ROI
+    double* mirr;                 // Modified IRR on the down payment
+    double* cfroi;                // First-year cash-flow ROI on the down payment
+} investment_outputs_t;
+
+/**
+ * Metrics of one listing
+ */
+typedef struct {
+    int property_id;
+    int district_id;
+    int num_rooms;
+    int price;
+    double monthly_rent;
+    double growth_rate;
+    double monthly_mortgage;
+    double monthly_cash_flow;
+    double net_operating_income;
+    double cap_rate;
+    double cash_on_cash;
+    double dscr;
+    double gross_rent_multiplier;
+    double break_even_occupancy;
+    double roi;
+    double annualized_roi;
+    double mirr;
+    double cfroi;
+} investment_metrics_t;
+
+/**
+ * One mortgage payment of an amortization schedule
+ */
+typedef struct {
+    int payment_number;
+    double payment;
+    double principal;
+    double interest;
+    double remaining_balance;
+} investment_payment_t;
+
+/**
+ * One row of the sensitivity grid: a metric re-evaluated with one
+ * parameter moved by each variation (the middle variation is 0)
+ */
+typedef struct {
+    const char* parameter;     // purchase_price, interest_rate, rental_income, vacancy_rate, appreciation_rate
+    const char* unit;          // "percent" (relative change) or "points" (percentage points)
+    const char* metric;        // monthly_cash_flow or roi
+    double variations[INVESTMENT_SENSITIVITY_STEPS];
+    double values[INVESTMENT_SENSITIVITY_STEPS];
+} investment_sensitivity_t;
+
+/**
+ * Ranking filter (0 = any)
+ */
+typedef struct {
+    int district_id;
+    int num_rooms;
+    int max_price;
+} investment_filter_t;
+
+/**
+ * Default assumptions (neutral scenario)
+ */
+investment_assumptions_t investment_default_assumptions(void);
+
+/**
+ * Check assumptions for values the formulas cannot handle
+ * @return 0 if valid, non-zero otherwise
+ */
+int investment_validate_assumptions(const investment_assumptions_t* assumptions);
+
+/**
+ * Apply one query argument ("down_payment=30") to assumptions. Rates
+ * are given in percent, as on the investment analysis page: down_payment,
+ * interest_rate, rent_yield, vacancy_rate; also loan_term and years
+ * (holding period) in years, hoa in EUR per month.
+ * @return 1 if the argument is an assumption, 0 otherwise
+ */
+int investment_parse_assumption(const char* argument, investment_assumptions_t* assumptions);
+
+/**
+ * Apply one query argument (district, rooms or max_price) to a ranking filter
+ * @return 1 if the argument is a filter, 0 otherwise
+ */
+int investment_parse_filter(const char* argument, investment_filter_t* filter);
+
+/**
+ * Monthly mortgage payment (principal and interest)
+ * @param principal Loan amount
+ * @param annual_rate Annual interest rate
+ * @param years Loan term
+ * @return Monthly payment
+ */
+double investment_monthly_payment(double principal, double annual_rate, int years);
+
+/**
+ * Evaluate every metric for a batch of listings
+ *
+ * Everything that depends only on the assumptions (payment and balance
+ * factors, MIRR compounding factors) is computed once per call; the
+ * per-listing arithmetic then runs four listings per vector operation.
+ *
+ * @param assumptions Financing and operating assumptions (validated)
+ * @param in Batch inputs
+ * @param n Number of listings
+ * @param out Batch outputs
+ */
+void investment_evaluate(const investment_assumptions_t* assumptions, const investment_inputs_t* in, size_t n,
+                         const investment_outputs_t* out);
+
+/**
+ * Monthly amortization schedule of a mortgage
+ * @param principal Loan amount
+ * @param annual_rate Annual interest rate
+ * @param years Loan term
+ * @param out Receives years * 12 payments
+ * @return Number of payments written
+ */
+int investment_amortization(double principal, double annual_rate, int years, investment_payment_t* out);
+
+/**
+ * Sensitivity grid of one listing
+ *
+ * Purchase price, rent and vacancy and interest rate changes are
+ * reported as monthly cash flow, appreciation changes as ROI over the
+ * holding period.
+ *
+ * @param assumptions Base assumptions
+ * @param price Purchase price
+ * @param monthly_rent Gross monthly rent
+ * @param growth_rate Annual appreciation
+ * @param out Receives INVESTMENT_SENSITIVITY_PARAMETERS rows
+ */
+void investment_sensitivity(const investment_assumptions_t* assumptions, double price, double monthly_rent,
+                            double growth_rate, investment_sensitivity_t* out);
+
+/**
+ * Rebuild the ranking batch from the listing store
+ *
+ * Snapshots every active listing into structure-of-arrays form with its
+ * estimated rent and growth rate: rent is the district's mean asking
+ * price per square meter times the area times the rent yield, growth is
+ * the published 12-month prediction of the listing's (district, rooms)
+ * series, capped at +/- 20% a year. Rankings under the default
+ * assumptions are precomputed. Call after new listings or predictions.
+ *
+ * @return Number of listings in the batch, or -1 on failure
+ */
+long investment_rebuild(void);
+
+/**
+ * Estimate a listing's monthly rent and growth rate the way the batch does
+ * @return 0 on success, non-zero if no batch is built
+ */
+int investment_listing_inputs(const property_t* listing, const investment_assumptions_t* assumptions,
+                              double* out_monthly_rent, double* out_growth_rate);
+
+/**
+ * Rank active listings by total ROI over the holding period, best first
+ *
+ * With NULL assumptions the precomputed default ordering is walked;
+ * otherwise every listing is re-evaluated in parallel and the best
+ * offset + limit are kept in per-worker bounded heaps.
+ *
+ * @param assumptions Assumptions, or NULL for the defaults
+ * @param filter Filter, or NULL for all listings
+ * @param offset Number of top listings to skip
+ * @param limit Maximum number of listings to return
+ * @param out Receives up to limit listings
+ * @return Number of listings written, or -1 if no batch is built or
+ *         offset + limit exceeds INVESTMENT_MAX_RANKING
+ */
+int investment_rank(const investment_assumptions_t* assumptions, const investment_filter_t* filter,
+                    size_t offset, size_t limit, investment_metrics_t* out);
+
+/**
+ * Number of listings in the current batch
+ */
+size_t investment_count(void);
+
+/**
+ * Handler for the listing investment API endpoint
+ * @param property_id Listing to analyze
+ * @param assumptions Assumptions (validated)
+ * @param monthly_schedule Non-zero for a monthly instead of a yearly schedule
+ * @return JSON object, or NULL if the listing is unknown or no batch exists
+ */
+json_t* investment_get_handler(int property_id, const investment_assumptions_t* assumptions, int monthly_schedule);
+
+/**
+ * Handler for the investment rankings API endpoint
+ * @return JSON object, or NULL on failure
+ */
+json_t* investment_rankings_handler(const investment_assumptions_t* assumptions, const investment_filter_t* filter,
+                                    size_t offset, size_t limit);
+
+#endif // INVESTMENT_H
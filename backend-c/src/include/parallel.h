@@ -0,0 +1,38 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stddef.h>
+
+/**
+ * Parallel range task
+ *
+ * Called with a half-open range [begin, end) of work items and the index
+ * of the worker running it (0 .. workers-1), so callers can keep
+ * per-worker state such as partial hash tables or random generators
+ * without locking.
+ */
+typedef void (*parallel_task_func)(size_t begin, size_t end, int worker, void* ctx);
+
+/**
+ * Number of workers to use by default (online CPU count, at least 1)
+ */
+int parallel_default_workers(void);
+
+/**
+ * Run a task over [0, count) on a set of worker threads
+ *
+ * Work is handed out in chunks from a shared atomic cursor, so workers
+ * that finish early keep claiming chunks from the remaining range. This
+ * keeps all cores busy even when item costs vary widely (e.g. series of
+ * very different lengths).
+ *
+ * @param count Number of work items
+ * @param chunk Items claimed per grab (0 picks a size automatically)
+ * @param workers Number of threads (<= 0 uses parallel_default_workers())
+ * @param task Task to run for each claimed chunk
+ * @param ctx Opaque pointer passed to the task
+ * @return Number of workers actually used, or -1 on failure
+ */
+int parallel_for(size_t count, size_t chunk, int workers, parallel_task_func task, void* ctx);
+
+#endif // PARALLEL_H
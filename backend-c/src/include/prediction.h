@@ -3,6 +3,7 @@
 
 #include <time.h>
 #include <jansson.h>
+#include <libpq-fe.h>
 
 /**
  * Price trend data point structure
@@ -14,12 +15,22 @@
  */
 typedef struct {
     time_t date;        // Date of the data point
+    double price;       // Average price per square meter
     int district_id;    // District ID
     int room_count;     // Number of rooms
-    double price;       // Average price per square meter
     int sample_size;    // Number of properties used in the calculation
 } price_trend_point_t;
 
+/**
+ * Prediction interval: 10th, 50th and 90th percentile of the forecast
+ * distribution (all zero when no interval is available)
+ */
+typedef struct {
+    double p10;
+    double p50;
+    double p90;
+} price_band_t;
+
 /**
  * Price prediction result structure
  * 
@@ -33,14 +44,106 @@ typedef struct {
     double prediction_12m;     // 12-month prediction
     double confidence;         // Confidence level (0.0-1.0)
     time_t prediction_date;    // Date the prediction was made
+    const char* algorithm;     // Forecasting model used (see forecast_model_t)
+    price_band_t band_6m;      // Bootstrap interval of the 6-month prediction
+    price_band_t band_12m;     // Bootstrap interval of the 12-month prediction
 } price_prediction_t;
 
+/**
+ * Number of months in a seasonal cycle
+ */
+#define FORECAST_SEASON_LENGTH 12
+
+/**
+ * Fitted forecasting model state
+ *
+ * Holds everything a model needs to forecast from the end of the series
+ * it was fit on. Fields not used by a model are left at zero.
+ */
+typedef struct {
+    double level;              // Level at the last point (intercept for linear)
+    double trend;              // Trend per month (slope for linear)
+    double damping;            // Trend damping factor phi (damped trend)
+    double alpha;              // Level smoothing
+    double beta;               // Trend smoothing
+    double gamma;              // Seasonal smoothing
+    double seasonal[FORECAST_SEASON_LENGTH]; // Additive seasonal terms by calendar month
+    double residual_sd;        // Standard deviation of in-sample residuals
+    double last_price;         // Last observed price (fallback forecast)
+    double x_mean;             // Linear: mean of x
+    double sxx;                // Linear: sum of squared x deviations
+    int count;                 // Number of points fit
+    int base_month;            // Calendar month (0 = January) of the last point
+} forecast_fit_t;
+
+/**
+ * Forecasting model interface
+ *
+ * Every model fits on a plain array of monthly prices (oldest first)
+ * and forecasts any number of months past its last point. `name` is the
+ * value stored in price_predictions.algorithm.
+ */
+typedef struct {
+    const char* name;
+    int min_points;  // Fewer points than this cannot be fit
+    int (*fit)(const double* prices, int count, int base_month, forecast_fit_t* fit);
+    double (*forecast)(const forecast_fit_t* fit, int months_ahead, double* out_std_error);
+    // Re-estimate the state of `fit` on new prices, keeping its smoothing
+    // parameters (no parameter search); the forecast is then linear in
+    // the prices
+    int (*refit)(const double* prices, int count, int base_month, forecast_fit_t* fit);
+    // One-step in-sample errors of a fit; writes up to `count` values
+    // for the last points of the series and returns how many
+    int (*residuals)(const double* prices, int count, const forecast_fit_t* fit, double* out);
+    // Non-zero when the forecast standard error already includes the
+    // parameter estimation error (linear regression's does)
+    int std_error_includes_estimation;
+} forecast_model_t;
+
+/**
+ * Get the registered forecasting models
+ *
+ * The registry holds linear regression (linear_regression), additive
+ * Holt-Winters exponential smoothing (holt_winters) and damped trend
+ * exponential smoothing (damped_trend). The first entry is the default
+ * model used when nothing better is known.
+ *
+ * @param out_count Receives the number of models
+ * @return Static array of models
+ */
+const forecast_model_t* forecast_models(int* out_count);
+
+/**
+ * Find a model by name
+ * @return The model, or NULL if no model has that name
+ */
+const forecast_model_t* forecast_model_find(const char* name);
+
+/**
+ * Spread a series with missing months over consecutive months
+ *
+ * Models fit by position, so a series built from listings, which often
+ * skips months, must be filled first or its trend and seasonal phase
+ * are off. Missing months are interpolated linearly between the
+ * observed months on either side.
+ *
+ * @param months Month indexes (see utils.h), strictly ascending
+ * @param prices Price of each month
+ * @param count Number of points
+ * @param out Receives months[count - 1] - months[0] + 1 prices, oldest
+ *            first (NULL to only get the length)
+ * @return Number of consecutive months (0 when count is 0)
+ */
+int forecast_fill_gaps(const int* months, const double* prices, int count, double* out);
+
 /**
  * Get historical price trends for a specific district and room count
  *
  * This function retrieves historical price trend data for a specific
- * district and property type over a specified time period. In a full
- * implementation, this would query the database for actual historical data.
+ * district and property type over a specified time period. Data comes
+ * from the mmap'd series store (see series_store.h), then the in-memory
+ * price_history view (see aggregation.h); demo data is returned while
+ * neither has the series.
  *
  * @param district_id District ID
  * @param room_count Number of rooms
@@ -53,9 +156,10 @@ price_trend_point_t* get_price_trends(int district_id, int room_count, int month
 /**
  * Get price prediction for a specific district and room count
  *
- * This function generates price predictions for a specific district and
- * property type. It uses the historical data and applies a prediction
- * algorithm to forecast prices 6 and 12 months into the future.
+ * This function returns price predictions for a specific district and
+ * property type, as published by the last prediction_job_run (a lookup,
+ * nothing is computed on request). Demo values are returned for series
+ * without a published prediction.
  *
  * @param district_id District ID
  * @param room_count Number of rooms
@@ -77,12 +181,33 @@ price_prediction_t predict_prices(int district_id, int room_count);
  */
 double linear_regression_predict(price_trend_point_t* data, int count, int months_ahead);
 
+/**
+ * Linear regression forecast on a plain price array
+ *
+ * Core of linear_regression_predict, with the seasonal adjustment taken
+ * relative to `base_month` instead of the wall clock so it can be
+ * evaluated on historical windows (see backtest.h).
+ *
+ * @param prices Monthly prices, oldest first
+ * @param count Number of prices
+ * @param base_month Calendar month (0 = January) of the last price
+ * @param months_ahead Number of months to predict ahead
+ * @param out_std_error If not NULL, receives the standard error of the
+ *                      forecast (0 when it cannot be estimated)
+ * @return Predicted price
+ */
+double linear_regression_forecast(const double* prices, int count, int base_month, int months_ahead,
+                                  double* out_std_error);
+
 /**
  * Calculate confidence level for the prediction
  *
  * This function calculates a confidence level for the prediction based on
  * the quality and consistency of the historical data. It considers factors
  * such as sample size, data variance, and amount of available history.
+ * Published predictions do not use it: their confidence is the backtest
+ * interval coverage and their bands come from the residual bootstrap
+ * (see bootstrap.h).
  *
  * @param data Array of price_trend_point_t
  * @param count Number of data points
@@ -90,6 +215,39 @@ double linear_regression_predict(price_trend_point_t* data, int count, int month
  */
 double calculate_prediction_confidence(price_trend_point_t* data, int count);
 
+/**
+ * Fit every model on every series in the series store and publish the best
+ *
+ * Each (district, rooms) series is handled by a worker: every model that
+ * can be fit is scored with a walk-forward backtest (see backtest.h), and
+ * its 6- and 12-month forecasts are written to price_predictions. The
+ * model with the lowest backtest MAPE becomes the one served by
+ * predict_prices.
+ *
+ * @param conn Open database connection, or NULL to only update the lookup
+ * @param workers Number of threads (<= 0 for the CPU count)
+ * @return Number of series predicted, or -1 on failure (nothing is then
+ *         written or published)
+ */
+int prediction_job_run(PGconn* conn, int workers);
+
+/**
+ * Load the best persisted prediction per series from price_predictions
+ *
+ * Lets a restarted server answer from the last job run before the next
+ * one finishes. Only the latest run of each series is read, so forecasts
+ * of older runs with other target dates never mix in.
+ *
+ * @return Number of series loaded, or -1 on failure
+ */
+int prediction_load(PGconn* conn);
+
+/**
+ * Look up the published prediction for a series
+ * @return 0 if found, non-zero otherwise
+ */
+int prediction_lookup(int district_id, int room_count, price_prediction_t* out);
+
 /**
  * Handler for trend API endpoint
  *
@@ -1,4 +1,197 @@
 #ifndef PROPERTIES_H
 #define PROPERTIES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <libpq-fe.h>
+#include <jansson.h>
+
 void get_properties_json();
+
+/**
+ * Listing status values (properties.status)
+ */
+typedef enum {
+    PROPERTY_STATUS_ACTIVE,
+    PROPERTY_STATUS_PENDING,
+    PROPERTY_STATUS_SOLD
+} property_status_t;
+
+/**
+ * Property listing structure
+ *
+ * In-memory copy of the numeric columns of a row in the properties
+ * table. Text columns (title, address, description) stay in the
+ * database; analytics only need the attributes below. Feature ids above
+ * 64 are not tracked.
+ */
+typedef struct {
+    int id;                 // properties.id
+    int district_id;        // District ID
+    int type_id;            // Property type ID
+    int num_rooms;          // Number of rooms
+    int area_sqm;           // Area in square meters
+    int price;              // Asking price (EUR)
+    int floor;              // Floor (0 if unknown)
+    int total_floors;       // Floors in the building (0 if unknown)
+    int year_built;         // Year built (0 if unknown)
+    int month_listed;       // Month index of date_listed (see utils.h)
+    property_status_t status;
+    double latitude;        // coordinates[0]
+    double longitude;       // coordinates[1]
+    uint64_t features;      // Bit (feature_id - 1) set for each property_to_features row
+} property_t;
+
+/**
+ * Ingest hook
+ *
+ * Called after a listing has been added or changed in the in-memory
+ * store. `previous` is NULL for a new listing, otherwise it holds the
+ * values before the change. Hooks run on the ingesting thread, outside
+ * the store lock, and must not call properties_ingest themselves.
+ */
+typedef void (*property_ingest_hook)(const property_t* previous, const property_t* current, void* ctx);
+
+/**
+ * Register a hook to be notified of ingested listings
+ * @return 0 on success, non-zero if the hook table is full
+ */
+int properties_register_ingest_hook(property_ingest_hook hook, void* ctx);
+
+/**
+ * Add or update listings in the in-memory store and notify hooks
+ * @param rows Listings to ingest (matched by id)
+ * @param count Number of listings
+ * @return 0 on success, non-zero on allocation failure
+ */
+int properties_ingest(const property_t* rows, size_t count);
+
+#define PROPERTIES_REFRESH_OVERLAP 300   // Seconds re-read before the watermark
+
+/**
+ * Load listings changed since the last refresh from the database
+ *
+ * The first call loads the whole table; later calls fetch rows whose
+ * updated_at is at or past the previous high-water mark less
+ * PROPERTIES_REFRESH_OVERLAP seconds, so rows of transactions that
+ * commit after later-stamped ones are still seen, and pass those that
+ * differ from the store through properties_ingest. A transaction
+ * committing more than the overlap after its updated_at is missed.
+ * Deleted rows are never seen; only a full reload (a restart) drops
+ * them.
+ *
+ * @param conn Open database connection
+ * @return Number of new or changed rows ingested, or -1 on failure
+ */
+int properties_refresh(PGconn* conn);
+
+/**
+ * Read access to the listing store
+ *
+ * properties_acquire takes a shared lock and returns the current array
+ * of listings; it must be paired with properties_release. The pointer
+ * is only valid until the release.
+ */
+const property_t* properties_acquire(size_t* out_count);
+void properties_release(void);
+
+/**
+ * Hold off ingests (properties_ingest, properties_open_snapshot)
+ *
+ * Waits for an ingest in progress to finish running its hooks, so every
+ * listing in the store has been seen by the hooks and no hook runs until
+ * properties_resume_ingest. Lets a hook's owner rebuild from the store
+ * without losing or double-counting changes. Must not be called from a
+ * hook.
+ */
+void properties_hold_ingest(void);
+void properties_resume_ingest(void);
+
+/**
+ * Default location of the listing snapshot (overridable with
+ * LISTINGS_SNAPSHOT_PATH)
+ */
+#define PROPERTIES_SNAPSHOT_DEFAULT_PATH "data/listings.bin"
+
+/**
+ * Listing snapshots
+ *
+ * A snapshot file is a 32-byte header (magic "MILS", format version,
+ * record size, listing count, data version) followed by the property_t
+ * records sorted by id. It is written by the process that ingests from
+ * the database and mapped read-only by the others, which then serve
+ * the listings straight from the shared page cache instead of holding
+ * a copy each. Files written by a build with another property_t layout
+ * are rejected.
+ */
+
+/**
+ * Write the current listings to `path`, replacing it atomically
+ * (temporary file, fsync, rename)
+ * @return 0 on success, non-zero on failure
+ */
+int properties_publish_snapshot(const char* path);
+
+/**
+ * Map a snapshot file and serve it as the listing store
+ *
+ * Ingest hooks are called for each listing that is new or changed
+ * relative to the store it replaces, as properties_ingest would. A
+ * later properties_ingest copies the mapped listings to memory first.
+ *
+ * @return 0 on success, non-zero if the file is missing or invalid
+ */
+int properties_open_snapshot(const char* path);
+
+/**
+ * Copy a single listing by id
+ * @return 0 if found, non-zero otherwise
+ */
+int properties_find(int property_id, property_t* out);
+
+/**
+ * Parse a properties.status value
+ */
+property_status_t property_status_from_string(const char* status);
+const char* property_status_to_string(property_status_t status);
+
+/**
+ * Load the full listing page of a property: all columns plus district
+ * and type names, image URLs (primary first) and feature names
+ * @param conn Open database connection
+ * @param out Receives the JSON object when found
+ * @return 0 if found, 1 if there is no such property, -1 on failure
+ */
+int properties_get_detail(PGconn* conn, int property_id, json_t** out);
+
+#define PROPERTIES_LIST_DEFAULT_LIMIT 50
+#define PROPERTIES_LIST_MAX_LIMIT 200
+
+/**
+ * Filter and page of a listing search (0 leaves a filter unset)
+ */
+typedef struct {
+    int district_id;
+    int num_rooms;
+    int min_price;          // EUR, inclusive
+    int max_price;          // EUR, inclusive
+    int limit;              // Rows per page (1 .. PROPERTIES_LIST_MAX_LIMIT)
+    int offset;
+} properties_filter_t;
+
+/**
+ * Parse "district_id=..&rooms=..&min_price=..&max_price=..&limit=..&offset=.."
+ * (NULL or missing arguments keep their defaults)
+ */
+properties_filter_t properties_parse_filter(const char* query_string);
+
+/**
+ * Load one page of listings, newest first, with district name and
+ * primary image URL
+ * @param conn Open database connection
+ * @param out Receives the JSON array
+ * @return 0 on success, -1 on failure
+ */
+int properties_list(PGconn* conn, const properties_filter_t* filter, json_t** out);
+
 #endif // PROPERTIES_H
@@ -0,0 +1,80 @@
+#ifndef QUANTILE_SKETCH_H
+#define QUANTILE_SKETCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "rng.h"
+
+#define QUANTILE_SKETCH_MAX_LEVELS 40
+#define QUANTILE_SKETCH_DEFAULT_K 200   // About 1.7% rank error
+
+/**
+ * KLL quantile sketch
+ *
+ * Summarizes a stream of values in memory independent of its length
+ * (about 3k values) and answers quantile queries with a normalized
+ * rank error of about 1.7% at the default k = 200. Level h holds
+ * values standing for 2^h inputs each; when the sketch is full, the
+ * lowest full level is sorted and every other value (odd or even, at
+ * random) is promoted to the next level. Updates are amortized constant
+ * time in the stream length, and two sketches of the same k merge into
+ * one with the same guarantees, so partial sketches built by worker
+ * threads can be combined.
+ *
+ * A sketch is not thread-safe; callers serialize access.
+ */
+typedef struct {
+    int k;
+    int num_levels;
+    uint64_t count;            // Number of values seen
+    uint32_t retained;         // Values held across all levels
+    uint32_t capacity;         // Values the current levels may hold
+    float min;
+    float max;
+    float* levels[QUANTILE_SKETCH_MAX_LEVELS];
+    uint32_t sizes[QUANTILE_SKETCH_MAX_LEVELS];
+    uint32_t allocated[QUANTILE_SKETCH_MAX_LEVELS];
+    rng_t rng;                 // Picks the half kept by each compaction
+} quantile_sketch_t;
+
+/**
+ * Initialize an empty sketch
+ * @param sketch Sketch to initialize
+ * @param k Accuracy parameter (>= 8; QUANTILE_SKETCH_DEFAULT_K if 0)
+ * @param seed Seed of the compaction coin flips
+ */
+void quantile_sketch_init(quantile_sketch_t* sketch, int k, uint64_t seed);
+
+/**
+ * Free the memory held by a sketch (the struct itself is the caller's)
+ */
+void quantile_sketch_free(quantile_sketch_t* sketch);
+
+/**
+ * Add a value
+ * @return 0 on success, non-zero on allocation failure
+ */
+int quantile_sketch_update(quantile_sketch_t* sketch, float value);
+
+/**
+ * Merge another sketch into this one (the other is not modified)
+ * @return 0 on success, non-zero on allocation failure or different k
+ */
+int quantile_sketch_merge(quantile_sketch_t* sketch, const quantile_sketch_t* other);
+
+/**
+ * Estimate several quantiles in one pass
+ * @param sketch Sketch to query
+ * @param fractions Quantile fractions in [0, 1], any order
+ * @param count Number of fractions
+ * @param out Receives one value per fraction
+ * @return 0 on success, non-zero if the sketch is empty or on allocation failure
+ */
+int quantile_sketch_quantiles(const quantile_sketch_t* sketch, const double* fractions, int count, double* out);
+
+/**
+ * Number of values retained (memory use is this times sizeof(float))
+ */
+size_t quantile_sketch_retained(const quantile_sketch_t* sketch);
+
+#endif // QUANTILE_SKETCH_H
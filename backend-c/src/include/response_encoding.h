@@ -0,0 +1,81 @@
+#ifndef RESPONSE_ENCODING_H
+#define RESPONSE_ENCODING_H
+
+#include <stddef.h>
+#include <jansson.h>
+
+/**
+ * Response encodings
+ *
+ * Responses are built as JSON values and serialized in the format the
+ * client asks for in its Accept header: JSON (the default), CBOR
+ * (RFC 8949) or MessagePack. The binary formats keep the structure of
+ * the JSON document but write numbers as binary instead of text, and
+ * pack numeric arrays as typed arrays:
+ *
+ * - Arrays of at least RESPONSE_TYPED_ARRAY_MIN integers become int8,
+ *   int16 or int32 arrays (the narrowest that holds every element);
+ *   arrays with any real become float32 arrays when float32 holds every
+ *   element exactly (as for prices from the series store), and stay
+ *   plain arrays otherwise. Nothing is rounded.
+ * - CBOR uses the RFC 8746 little-endian typed array tags (72 sint8,
+ *   77 sint16, 78 sint32, 85 float32) around a byte string.
+ * - MessagePack uses the ext types below, little-endian as well, so
+ *   clients can view the payload as Int32Array/Float32Array directly.
+ *
+ * Scalar reals are written as float32 when that is exact, float64
+ * otherwise.
+ */
+
+#define RESPONSE_TYPED_ARRAY_MIN 4   // Shorter numeric arrays stay plain arrays
+
+#define MSGPACK_EXT_FLOAT32_ARRAY 1
+#define MSGPACK_EXT_INT8_ARRAY 2
+#define MSGPACK_EXT_INT16_ARRAY 3
+#define MSGPACK_EXT_INT32_ARRAY 4
+
+typedef enum {
+    RESPONSE_FORMAT_JSON = 0,
+    RESPONSE_FORMAT_CBOR,
+    RESPONSE_FORMAT_MSGPACK
+} response_format_t;
+
+/**
+ * Pick the response format from an Accept header
+ *
+ * Media ranges are weighed by their q value; among equal weights the
+ * first listed wins. application/cbor, application/msgpack (also
+ * application/x-msgpack and application/vnd.msgpack) and
+ * application/json are recognized; anything else, wildcards and a
+ * missing header mean JSON.
+ */
+response_format_t response_format_negotiate(const char* accept);
+
+/**
+ * Content-Type of a format
+ */
+const char* response_format_content_type(response_format_t format);
+
+/**
+ * Short name of a format ("json", "cbor", "msgpack"), e.g. for cache keys
+ */
+const char* response_format_name(response_format_t format);
+
+/**
+ * Serialize a value
+ * @param data Value to encode (not released)
+ * @param out_body Receives the malloc'd body (NUL-terminated for JSON)
+ * @param out_length Receives the body length
+ * @return 0 on success, non-zero on failure
+ */
+int response_encode(json_t* data, response_format_t format, char** out_body, size_t* out_length);
+
+/**
+ * Turn an array of objects into an object of arrays, one per key of
+ * the first object, so numeric columns can be sent as typed arrays
+ * (missing values become null)
+ * @return New object, or NULL if records is not an array of objects
+ */
+json_t* response_records_to_columns(json_t* records);
+
+#endif // RESPONSE_ENCODING_H
@@ -0,0 +1,66 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+/**
+ * xoshiro256** pseudo-random generator state
+ *
+ * Small, fast and thread-safe as long as each thread owns its state;
+ * replaces the global rand(). The same seed always produces the same
+ * sequence.
+ */
+typedef struct {
+    uint64_t s[4];
+} rng_t;
+
+/**
+ * Seed a generator (the seed is expanded with splitmix64)
+ */
+void rng_seed(rng_t* rng, uint64_t seed);
+
+/**
+ * Derive a seed from a base seed and two keys, e.g. a (district, rooms)
+ * series, so per-series streams do not depend on which thread runs them
+ */
+uint64_t rng_seed_for(uint64_t seed, int key1, int key2);
+
+static inline uint64_t rng_rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+/**
+ * Next 64 random bits
+ */
+static inline uint64_t rng_next(rng_t* rng) {
+    uint64_t* s = rng->s;
+    uint64_t result = rng_rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rng_rotl(s[3], 45);
+    return result;
+}
+
+/**
+ * Uniform integer in [0, bound) (multiply-shift; bias is below 2^-32
+ * for the small bounds used here)
+ */
+static inline uint32_t rng_below(rng_t* rng, uint32_t bound) {
+    return (uint32_t) (((rng_next(rng) >> 32) * (uint64_t) bound) >> 32);
+}
+
+/**
+ * Uniform double in [0, 1)
+ */
+double rng_uniform(rng_t* rng);
+
+/**
+ * Standard normal sample (Box-Muller)
+ */
+double rng_gaussian(rng_t* rng);
+
+#endif // RNG_H
@@ -0,0 +1,139 @@
+#ifndef SAVED_SEARCH_H
+#define SAVED_SEARCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <libpq-fe.h>
+#include "properties.h"
+
+/**
+ * Saved-search matching engine
+ *
+ * Every user_saved_searches.search_params object is compiled into a
+ * fixed-size predicate and posted in an inverted index under its most
+ * selective attribute: the districts, room counts, (district, rooms)
+ * pairs or price buckets it accepts, whichever covers the smallest share
+ * of current listings (searches without any of these go to a match-all
+ * list). A listing is then checked only against the searches posted
+ * under its own district, room count, district and room count, price
+ * bucket and the match-all list; each search sits in at most one of them.
+ *
+ * Recognized search_params keys (all optional, unknown keys ignored):
+ * district_id or district_ids (1..64), num_rooms or rooms, min_rooms,
+ * max_rooms, min_price, max_price, min_area, max_area, type_id or type,
+ * features (feature ids that must all be present).
+ */
+
+#define SAVED_SEARCH_MAX_DISTRICT 64
+#define SAVED_SEARCH_QUEUE_CAPACITY (1 << 20)   // Alerts held before the next flush
+
+typedef enum {
+    SEARCH_ALERT_NEW_LISTING,  // A new listing matches
+    SEARCH_ALERT_NOW_MATCHING  // A changed listing (e.g. price drop) matches for the first time
+} search_alert_reason_t;
+
+/**
+ * One notification for a user
+ */
+typedef struct {
+    int user_id;
+    int search_id;
+    int property_id;
+    search_alert_reason_t reason;
+} search_alert_t;
+
+/**
+ * Engine counters
+ */
+typedef struct {
+    size_t searches;            // Searches in the index
+    uint64_t listings_matched;  // Listings run through the index
+    uint64_t candidates_checked;// Predicates evaluated
+    uint64_t alerts_queued;
+    uint64_t alerts_dropped;    // Lost to a full queue
+    size_t queue_length;
+} saved_search_stats_t;
+
+/**
+ * Register the listing ingest hook
+ *
+ * New listings, and listings whose searchable attributes changed, are
+ * queued for saved_search_match_pending while any search is indexed.
+ */
+void saved_search_init(void);
+
+/**
+ * Add or replace a saved search
+ * @param search_id user_saved_searches.id
+ * @param user_id Owner
+ * @param search_params JSON filter object
+ * @return 0 on success, non-zero if the filter is invalid
+ */
+int saved_search_add(int search_id, int user_id, const char* search_params);
+
+/**
+ * Remove a saved search
+ * @return 0 if removed, non-zero if unknown
+ */
+int saved_search_remove(int search_id);
+
+/**
+ * Re-post every search under its most selective attribute
+ *
+ * Selectivity is estimated from the current listing store; searches
+ * added later are posted with the estimates of the last reindex.
+ */
+void saved_search_reindex(void);
+
+/**
+ * Replace all searches with the contents of user_saved_searches and reindex
+ *
+ * Nothing is reloaded while the table's row count, highest id and latest
+ * updated_at stay the same as at the previous load.
+ *
+ * @param conn Open database connection
+ * @return Number of searches loaded, or -1 on failure
+ */
+long saved_search_load(PGconn* conn);
+
+/**
+ * Match listings against the index and queue the resulting alerts
+ *
+ * An alert is raised for every search an active listing matches, unless
+ * `previous` also matched it.
+ *
+ * @param listings Listings to match
+ * @param previous NULL, or per listing its values before the change
+ *                 (entries with id 0 are new listings)
+ * @param count Number of listings
+ * @param workers Number of threads (<= 0 for the CPU count)
+ * @return Number of alerts queued, or -1 on failure
+ */
+long saved_search_match(const property_t* listings, const property_t* previous, size_t count, int workers);
+
+/**
+ * Match the listings queued by the ingest hook since the last call
+ * @return Number of alerts queued, or -1 on failure
+ */
+long saved_search_match_pending(int workers);
+
+/**
+ * Take alerts from the notification queue, oldest first
+ * @return Number of alerts written to out
+ */
+size_t saved_search_dequeue(search_alert_t* out, size_t max);
+
+/**
+ * Write queued alerts to user_notifications
+ *
+ * Alerts are put back in the queue if the insert fails.
+ *
+ * @return Number of alerts written, or -1 on failure
+ */
+long saved_search_flush(PGconn* conn);
+
+void saved_search_get_stats(saved_search_stats_t* out);
+
+const char* search_alert_reason_to_string(search_alert_reason_t reason);
+
+#endif // SAVED_SEARCH_H
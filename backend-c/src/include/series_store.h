@@ -0,0 +1,98 @@
+#ifndef SERIES_STORE_H
+#define SERIES_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <libpq-fe.h>
+#include "aggregation.h"
+
+/**
+ * On-disk format version; files with another version are rejected
+ */
+#define SERIES_STORE_FORMAT_VERSION 1
+
+/**
+ * Default location of the series file (overridable with SERIES_STORE_PATH)
+ */
+#define SERIES_STORE_DEFAULT_PATH "data/price_series.bin"
+
+/**
+ * Binary time-series store for price history
+ *
+ * File layout (little-endian):
+ *   header     magic "MIRS", format version, data version, series count,
+ *              directory offset, file size, directory checksum
+ *   directory  one 32-byte entry per series, sorted by (district, rooms):
+ *              district, rooms, point count, first month, data offset,
+ *              month bytes, sample bytes
+ *   data       per series: float32 prices, then varint month deltas,
+ *              then varint sample sizes
+ *
+ * The file is mmap'd read-only, so opening it costs a header and
+ * directory check regardless of how much history it holds; series are
+ * decoded on demand.
+ */
+
+/**
+ * Write a store file from price history rows and replace `path` atomically
+ *
+ * The file is written to a temporary name, fsync'd and renamed over
+ * `path`, so readers either see the old or the new file, never a partial
+ * one.
+ *
+ * @param path Destination file
+ * @param rows Rows sorted by district, rooms, month (as produced by
+ *             aggregation_snapshot)
+ * @param count Number of rows
+ * @param data_version Version stamp written to the header (0 = now)
+ * @return 0 on success, non-zero on failure
+ */
+int series_store_build(const char* path, const price_history_row_t* rows, size_t count, uint64_t data_version);
+
+/**
+ * Rebuild the store file from the price_history table and reopen it
+ * @return 0 on success, non-zero on failure
+ */
+int series_store_rebuild_from_db(PGconn* conn, const char* path);
+
+/**
+ * Map a store file and make it the one served to readers
+ *
+ * Any previously opened store is unmapped once current readers finish.
+ *
+ * @return 0 on success, non-zero if the file is missing or invalid
+ */
+int series_store_open(const char* path);
+
+/**
+ * Unmap the current store
+ */
+void series_store_close(void);
+
+/**
+ * Data version of the open store (0 if none), for cache validation
+ */
+uint64_t series_store_version(void);
+
+/**
+ * Number of series in the open store
+ */
+size_t series_store_count(void);
+
+/**
+ * Get the (district, rooms) key of the series at `index`
+ * @return 0 on success, non-zero if the index is out of range
+ */
+int series_store_key(size_t index, int* district_id, int* room_count);
+
+/**
+ * Decode the most recent months of a series
+ * @param district_id District ID
+ * @param room_count Number of rooms
+ * @param months Maximum number of months to return
+ * @param out_count Receives the number of rows
+ * @return malloc'd rows in chronological order, or NULL if not found
+ */
+price_history_row_t* series_store_get_series(int district_id, int room_count, int months, int* out_count);
+
+#endif // SERIES_STORE_H
@@ -0,0 +1,62 @@
+#ifndef SINGLEFLIGHT_H
+#define SINGLEFLIGHT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Request coalescing ("singleflight")
+ *
+ * Identical requests that arrive while the same work is already running
+ * do not run it again: the first caller for a key executes the loader,
+ * later callers for that key wait for it and receive a copy of the same
+ * serialized response. Nothing is cached; once the loader has returned,
+ * the next call for the key runs it again.
+ */
+
+#define SINGLEFLIGHT_BUCKETS 256
+#define SINGLEFLIGHT_MAX_KEY 128   // Longer keys are not coalesced
+#define SINGLEFLIGHT_TIMEOUT (-2)  // A waiter's deadline passed before the run finished
+
+/**
+ * Loader: produce the serialized response for a key
+ * @param ctx Caller context
+ * @param out_body Receives a malloc'd body (may be left NULL)
+ * @param out_length Receives the body length
+ * @return Result code handed unchanged to every caller (e.g. an HTTP status)
+ */
+typedef int (*singleflight_fn)(void* ctx, char** out_body, size_t* out_length);
+
+/**
+ * Coalescing counters
+ */
+typedef struct {
+    uint64_t calls;          // singleflight_do calls
+    uint64_t executions;     // Loader runs
+    uint64_t coalesced;      // Calls answered by another caller's run
+    uint64_t timeouts;       // Waiters that gave up at their deadline
+    size_t in_flight;        // Keys whose loader is running now
+} singleflight_stats_t;
+
+/**
+ * Run the loader for a key, or wait for the run already in flight
+ * @param key Identity of the request (same key, same response)
+ * @param fn Loader, run by at most one caller per key at a time
+ * @param ctx Loader context (only used by the caller that runs it)
+ * @param deadline_ms The caller's deadline on the monotonic_ms clock (see
+ *        utils.h), 0 for none: a waiter stops waiting for another
+ *        caller's run then. The caller that runs the loader is bounded
+ *        by the loader itself.
+ * @param out_body Receives the caller's own copy of the body (free with free)
+ * @param out_length Receives the body length
+ * @param out_shared If not NULL, set to 1 when the result came from another caller's run
+ * @return The loader's result code, SINGLEFLIGHT_TIMEOUT if the deadline
+ *         passed while waiting (no body), or -1 if the body could not be
+ *         copied
+ */
+int singleflight_do(const char* key, singleflight_fn fn, void* ctx, long long deadline_ms,
+                    char** out_body, size_t* out_length, int* out_shared);
+
+void singleflight_get_stats(singleflight_stats_t* out);
+
+#endif // SINGLEFLIGHT_H
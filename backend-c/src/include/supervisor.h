@@ -0,0 +1,78 @@
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+/**
+ * Multi-process serving with zero-downtime reload
+ *
+ * The supervisor opens one listening socket per worker slot, all bound
+ * to the same port with SO_REUSEPORT so the kernel spreads new
+ * connections across them, and runs one worker process per slot. Each
+ * worker is the server binary re-executed with its slot's socket (the
+ * SUPERVISOR_* environment variables below); it reports ready once it
+ * serves, see supervisor_notify_ready.
+ *
+ * On SIGHUP the supervisor execs a new generation of workers on the
+ * same sockets, from the binary now at the original path, so a new
+ * build is picked up. Only once every new worker is ready are the old
+ * ones sent SIGTERM: they stop accepting and finish what they have,
+ * while connections queued on the sockets, which the supervisor keeps
+ * open, go to the new workers. If a new worker fails or is not ready
+ * within the ready timeout, the reload is abandoned and the old
+ * generation keeps serving. Until the old workers exit, both
+ * generations serve side by side, each with its own in-process state.
+ *
+ * Workers that die are restarted (after a second if they die within a
+ * second of starting). SIGTERM or SIGINT drains all workers and ends
+ * supervisor_run.
+ */
+
+#define SUPERVISOR_MAX_WORKERS 64
+#define SUPERVISOR_DEFAULT_READY_TIMEOUT 300  // seconds
+#define SUPERVISOR_DEFAULT_DRAIN_TIMEOUT 30   // seconds
+#define SUPERVISOR_KILL_GRACE_MS 5000         // Past the drain timeout, then SIGKILL
+
+#define SUPERVISOR_ENV_SLOT "SUPERVISOR_SLOT"
+#define SUPERVISOR_ENV_LISTEN_FD "SUPERVISOR_LISTEN_FD"
+#define SUPERVISOR_ENV_READY_FD "SUPERVISOR_READY_FD"
+
+/**
+ * Supervisor settings
+ */
+typedef struct {
+    unsigned int port;            // 0 picks a free port for all slots
+    int workers;                  // Worker processes (1 .. SUPERVISOR_MAX_WORKERS)
+    char* const* argv;            // Worker command line, run from this binary's path
+    unsigned int ready_timeout_s; // New generation must be ready within this (0 for the default)
+    unsigned int drain_timeout_s; // Draining workers get this long (0 for the default)
+} supervisor_config_t;
+
+/**
+ * Run workers until SIGTERM or SIGINT
+ *
+ * Must be called before any thread is started: it blocks signals for
+ * itself and forks.
+ *
+ * @return 0 after a clean shutdown, non-zero if the sockets could not
+ *         be opened or the first workers could not be started
+ */
+int supervisor_run(const supervisor_config_t* config);
+
+/**
+ * Slot of this process when run as a worker
+ * @return Slot (0 .. workers - 1), or -1 outside supervisor mode
+ */
+int supervisor_worker_slot(void);
+
+/**
+ * Listening socket handed to this worker
+ * @return File descriptor, or -1 outside supervisor mode
+ */
+int supervisor_listen_socket(void);
+
+/**
+ * Tell the supervisor this worker serves (no-op outside supervisor
+ * mode; only the first call counts)
+ */
+void supervisor_notify_ready(void);
+
+#endif // SUPERVISOR_H
@@ -1,4 +1,73 @@
 #ifndef USER_DASHBOARD_H
 #define USER_DASHBOARD_H
-void get_user_dashboard_json();
+
+#include <jansson.h>
+#include <libpq-fe.h>
+#include "user_writes.h"
+
+/**
+ * User dashboard
+ *
+ * Everything the dashboard page shows, loaded with one libpq pipeline
+ * (a single round trip): the user, their saved properties, their saved
+ * searches and their unread saved-search alerts. Each saved property
+ * is joined in memory with the prediction currently served for its
+ * (district, rooms) series, so the page needs no per-district requests.
+ *
+ * Saved properties and searches include the user's pending write-behind
+ * mutations (see user_writes.h), so users read their own writes.
+ */
+
+#define USER_DASHBOARD_MAX_NOTIFICATIONS 20   // Most recent unread alerts returned
+
+/**
+ * Queries of the dashboard pipeline, in the order they are sent
+ */
+typedef enum {
+    DASHBOARD_QUERY_USER,
+    DASHBOARD_QUERY_PROPERTIES,
+    DASHBOARD_QUERY_SEARCHES,
+    DASHBOARD_QUERY_NOTIFICATIONS,
+    DASHBOARD_QUERY_COUNT
+} dashboard_query_t;
+
+/**
+ * Load a user's dashboard
+ * @param conn Open connection (not in pipeline mode)
+ * @param user_id Authenticated user
+ * @return JSON object, NULL if the user does not exist or the queries failed
+ */
+json_t* user_dashboard_get(PGconn* conn, int user_id);
+
+/**
+ * Assemble the dashboard from the pipeline results
+ *
+ * Columns are those of the dashboard queries; exposed so the assembly
+ * can be exercised without a database.
+ *
+ * @param results One result per dashboard_query_t
+ * @param overlay Pending mutations of the user
+ * @return JSON object, NULL if the user row is missing
+ */
+json_t* user_dashboard_build(PGresult* const* results, const user_writes_overlay_t* overlay);
+
+/**
+ * Load a user's saved properties (with predictions), as in the dashboard
+ * @return JSON array, NULL on failure
+ */
+json_t* user_saved_properties_get(PGconn* conn, int user_id);
+
+/**
+ * Load a user's saved searches, as in the dashboard
+ * @return JSON array, NULL on failure
+ */
+json_t* user_saved_searches_get(PGconn* conn, int user_id);
+
+/**
+ * JSON form of a saved search
+ * @param params search_params as JSON text
+ * @param created_at Date text, or NULL
+ */
+json_t* user_saved_search_json(int id, const char* name, const char* params, const char* created_at);
+
 #endif // USER_DASHBOARD_H
@@ -0,0 +1,182 @@
+#ifndef USER_WRITES_H
+#define USER_WRITES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <libpq-fe.h>
+
+/**
+ * Write-behind queue for saved properties and saved searches
+ *
+ * Saving or removing a property and creating or deleting a saved search
+ * are acknowledged as soon as they are queued. Pending mutations are
+ * kept per user and coalesced by key: toggling the same property
+ * several times leaves only the last state, and deleting a search that
+ * never reached the database cancels it. A flusher thread writes
+ * everything pending every USER_WRITES_FLUSH_INTERVAL_MS as one
+ * multi-row statement per kind, all committed together in a single
+ * pipelined transaction.
+ *
+ * Mutations stay visible through user_writes_overlay until their batch
+ * has committed, so users always read their own writes. A failed
+ * flush keeps them pending for the next one, and shutdown flushes
+ * whatever is left before returning.
+ */
+
+#define USER_WRITES_FLUSH_INTERVAL_MS 200   // Longest a mutation waits for its commit while the database is up
+#define USER_WRITES_FLUSH_BATCH 4096        // Mutations written per transaction
+#define USER_WRITES_MAX_PENDING 65536       // Mutations queued before callers are turned away
+#define USER_WRITES_ID_BLOCK 64             // Saved-search ids reserved from the sequence at a time
+
+typedef enum {
+    USER_WRITES_OK = 0,
+    USER_WRITES_ERR_BUSY = -1,       // Too many pending mutations; retry later
+    USER_WRITES_ERR_NO_IDS = -2,     // No reserved saved-search id left (see user_writes_reserve_ids)
+    USER_WRITES_ERR_INTERNAL = -3    // Out of memory
+} user_writes_status_t;
+
+/**
+ * A saved search created through the queue
+ */
+typedef struct {
+    int id;
+    int user_id;
+    char* name;          // May be NULL
+    char* params;        // search_params as JSON text
+    time_t created_at;
+} user_search_row_t;
+
+/**
+ * One flush: the rows of each multi-row statement. The save and unsave
+ * arrays are (user id, property id) pairs, the delete arrays (user id,
+ * search id) pairs.
+ */
+typedef struct {
+    const int* save_users;
+    const int* save_properties;
+    size_t save_count;
+    const int* unsave_users;
+    const int* unsave_properties;
+    size_t unsave_count;
+    const user_search_row_t* created_searches;
+    size_t create_count;
+    const int* delete_users;
+    const int* delete_searches;
+    size_t delete_count;
+} user_writes_batch_t;
+
+/**
+ * Batch writer
+ * @return 0 once the whole batch is committed, non-zero if none of it is
+ */
+typedef int (*user_writes_writer)(const user_writes_batch_t* batch, void* ctx);
+
+/**
+ * Pending mutations of one user, as the overlay for their reads
+ */
+typedef struct {
+    int* saved_properties;               // Saved, possibly not yet in user_saved_properties
+    size_t saved_count;
+    int* unsaved_properties;             // Removed, possibly still in user_saved_properties
+    size_t unsaved_count;
+    user_search_row_t* created_searches; // Created, possibly not yet in user_saved_searches
+    size_t created_count;
+    int* deleted_searches;               // Deleted, possibly still in user_saved_searches
+    size_t deleted_count;
+} user_writes_overlay_t;
+
+/**
+ * Queue counters
+ */
+typedef struct {
+    uint64_t mutations;          // Mutations accepted
+    uint64_t coalesced;          // Mutations that replaced or cancelled a pending one
+    uint64_t rejected_busy;
+    uint64_t flushes;            // Committed batches (one transaction each)
+    uint64_t rows_written;
+    uint64_t failed_flushes;
+    size_t pending;
+    size_t reserved_ids;
+} user_writes_stats_t;
+
+/**
+ * Start the flusher thread; it borrows pooled connections (db_pool_acquire)
+ * @return 0 on success, non-zero on failure
+ */
+int user_writes_start(void);
+
+/**
+ * Stop the flusher and write everything still pending
+ * @return Number of mutations that could not be written (0 when all are durable)
+ */
+size_t user_writes_shutdown(void);
+
+/**
+ * Queue saving a property to a user's saved properties
+ * @return USER_WRITES_OK, USER_WRITES_ERR_BUSY or USER_WRITES_ERR_INTERNAL
+ */
+int user_writes_save_property(int user_id, int property_id);
+
+/**
+ * Queue removing a property from a user's saved properties
+ * @return USER_WRITES_OK, USER_WRITES_ERR_BUSY or USER_WRITES_ERR_INTERNAL
+ */
+int user_writes_unsave_property(int user_id, int property_id);
+
+/**
+ * Queue creating a saved search
+ * @param name Search name (may be NULL)
+ * @param params search_params as JSON text
+ * @param out Receives the new search, with its final id (release with
+ *            user_writes_free_search_row); may be NULL
+ * @return USER_WRITES_OK, USER_WRITES_ERR_BUSY, USER_WRITES_ERR_NO_IDS or
+ *         USER_WRITES_ERR_INTERNAL
+ */
+int user_writes_create_search(int user_id, const char* name, const char* params, user_search_row_t* out);
+
+/**
+ * Queue deleting one of a user's saved searches (searches of other users are left alone)
+ * @return USER_WRITES_OK, USER_WRITES_ERR_BUSY or USER_WRITES_ERR_INTERNAL
+ */
+int user_writes_delete_search(int user_id, int search_id);
+
+/**
+ * Reserve a block of saved-search ids from the user_saved_searches sequence
+ * @return Number of ids now available, or -1 on failure
+ */
+int user_writes_reserve_ids(PGconn* conn);
+
+/**
+ * Add already reserved saved-search ids to the pool
+ * @return Number of ids now available
+ */
+size_t user_writes_add_ids(const int* ids, size_t count);
+
+/**
+ * Write pending mutations, at most USER_WRITES_FLUSH_BATCH per batch,
+ * until none are left or a batch fails
+ * @return Mutations written, or -1 if a batch failed (it stays pending)
+ */
+long user_writes_flush_with(user_writes_writer writer, void* ctx);
+
+/**
+ * Write pending mutations to the database (user_writes_flush_with the
+ * pipelined database writer)
+ * @return Mutations written, or -1 on failure
+ */
+long user_writes_flush(PGconn* conn);
+
+/**
+ * Copy the pending mutations of a user
+ * @return 0 on success, non-zero on failure
+ */
+int user_writes_overlay(int user_id, user_writes_overlay_t* out);
+
+void user_writes_overlay_free(user_writes_overlay_t* overlay);
+
+void user_writes_free_search_row(user_search_row_t* row);
+
+void user_writes_get_stats(user_writes_stats_t* out);
+
+#endif // USER_WRITES_H
@@ -1,4 +1,57 @@
 #ifndef UTILS_H
 #define UTILS_H
+
+#include <stddef.h>
+
 void print_stub(const char* func);
+
+/**
+ * Month index helpers
+ *
+ * Monthly series (price_history, predictions) are keyed by a month index:
+ * the number of whole months since January 1970. Month 0 is 1970-01.
+ */
+int month_index_from_date(const char* date_str);
+int month_index_from_ym(int year, int month);
+void month_index_to_date(int month_index, char* out, size_t out_size);
+int month_index_current(void);
+
+/**
+ * Milliseconds on the monotonic clock (for deadlines and rate limits)
+ */
+long long monotonic_ms(void);
+
+/**
+ * Growable string buffer used to build SQL array literals and
+ * response bodies without fixed-size stack buffers.
+ */
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+} string_buffer_t;
+
+void string_buffer_init(string_buffer_t* sb);
+int string_buffer_append(string_buffer_t* sb, const char* text, size_t length);
+int string_buffer_appendf(string_buffer_t* sb, const char* format, ...);
+void string_buffer_free(string_buffer_t* sb);
+
+/**
+ * Append one decoded query argument as "key=value" (just "key" when
+ * value is NULL), '&'-separated from the previous one. '&' and '%' in
+ * the key or value are written as %26 and %25, so a value cannot add
+ * arguments. Route handlers get the query string rebuilt this way.
+ *
+ * @return 0 on success, -1 on allocation failure
+ */
+int query_string_append(string_buffer_t* sb, const char* key, const char* value);
+
+/**
+ * Dot product of two double arrays
+ *
+ * Uses four independent accumulators so the additions can be spread
+ * over SIMD lanes without relaxing floating-point ordering.
+ */
+double dot_product(const double* a, const double* b, int n);
+
 #endif // UTILS_H
@@ -0,0 +1,107 @@
+#ifndef VALUATION_H
+#define VALUATION_H
+
+#include <stddef.h>
+#include <jansson.h>
+#include "properties.h"
+
+/**
+ * Feature layout of the hedonic model
+ *
+ * Every listing is packed into VALUATION_DIMENSION doubles: an intercept,
+ * log area, rooms, floor position, building age terms, then one-hot
+ * district and property type columns and one column per feature flag.
+ * Districts, types and feature ids beyond the limits below fall into the
+ * baseline (all zero) category.
+ */
+#define VALUATION_MAX_DISTRICTS 16
+#define VALUATION_MAX_TYPES 8
+#define VALUATION_MAX_FEATURES 32
+#define VALUATION_NUMERIC_COLUMNS 10
+#define VALUATION_DIMENSION (VALUATION_NUMERIC_COLUMNS + VALUATION_MAX_DISTRICTS + \
+                             VALUATION_MAX_TYPES + VALUATION_MAX_FEATURES)
+
+/**
+ * Valuation of one listing
+ */
+typedef struct {
+    int property_id;
+    int asking_price;          // Listing price (EUR)
+    double estimated_price;    // Model price (EUR)
+    double low;                // 10th percentile of the model price
+    double high;               // 90th percentile of the model price
+    double difference_pct;     // (asking - estimated) / estimated * 100
+    const char* verdict;       // "undervalued", "fair" or "overvalued"
+} valuation_t;
+
+/**
+ * Model summary
+ */
+typedef struct {
+    long samples;              // Listings in the normal equations
+    double residual_sd;        // Residual standard deviation of log price
+    double r_squared;          // Share of log price variance explained
+    int stale;                 // Ingest changed the data since the last solve
+} valuation_stats_t;
+
+/**
+ * Initialize the valuation model
+ *
+ * Registers a listing ingest hook that applies each change to the normal
+ * equations as a rank-one update (removing the previous version of the
+ * listing, adding the new one), so the model can be re-solved without
+ * rescanning all listings.
+ */
+void valuation_init(void);
+
+/**
+ * Pack a listing into the model's feature vector
+ * @param out VALUATION_DIMENSION doubles
+ */
+void valuation_pack_features(const property_t* property, double* out);
+
+/**
+ * Train the model on every listing in the store
+ *
+ * Workers accumulate X'X and X'y over blocks of listings packed
+ * column-wise, the partial sums are merged and the ridge-regularized
+ * system is solved with a blocked Cholesky factorization. Must not run
+ * concurrently with properties_ingest.
+ *
+ * @param workers Number of threads (<= 0 for the CPU count)
+ * @return 0 on success, non-zero on failure
+ */
+int valuation_train(int workers);
+
+/**
+ * Re-solve the model if ingested listings changed the normal equations
+ * @return 1 if the model was re-solved, 0 if it was current, -1 on failure
+ */
+int valuation_update(void);
+
+/**
+ * Value listings with the current model
+ *
+ * Scoring is a dot product per listing under one shared lock, so a whole
+ * result page costs microseconds.
+ *
+ * @param properties Listings to value
+ * @param count Number of listings
+ * @param out Receives one valuation per listing
+ * @return 0 on success, non-zero if no model has been trained
+ */
+int valuation_estimate(const property_t* properties, size_t count, valuation_t* out);
+
+/**
+ * Get the current model summary
+ */
+void valuation_get_stats(valuation_stats_t* out);
+
+/**
+ * Handler for the valuation API endpoint
+ * @param property_id Listing to value
+ * @return JSON object, or NULL if the listing is unknown or no model exists
+ */
+json_t* valuation_get_handler(int property_id);
+
+#endif // VALUATION_H
@@ -0,0 +1,1029 @@
+#include "include/investment.h"
+#include "include/prediction.h"
+#include "include/parallel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#define LANES 4
+#define BLOCK 256              // Listings evaluated per call in ranking loops
+#define MAX_GROWTH 0.20        // Cap on predicted annual appreciation
+
+// Four double-precision lanes (two SSE or one AVX register)
+typedef double double_lanes_t __attribute__((vector_size(LANES * sizeof(double))));
+typedef long long mask_lanes_t __attribute__((vector_size(LANES * sizeof(long long))));
+
+// Everything that only depends on the assumptions
+typedef struct {
+    double down_payment;
+    double loan_share;         // Loan per unit of price
+    double payment_factor;     // Monthly payment per unit of loan
+    double balance_year1;      // Loan share left after 12 payments
+    double balance_hold;       // Loan share left at the end of the holding period
+    double operating_share;    // Annual tax, insurance and maintenance per unit of price
+    double hoa_annual;
+    double rent_collected;     // Share of gross rent left after vacancy and management
+    double rent_after_fees;    // Share of gross rent left after management
+    double tax_benefit_share;  // Annual depreciation tax benefit per unit of price
+    double mirr_reinvest;      // Future value factor of the first n-1 yearly flows
+    double mirr_finance;       // Present value factor of the first n-1 yearly flows
+    double mirr_finance_last;  // Present value factor of the last yearly flow
+    double years;
+} factors_t;
+
+typedef struct {
+    int district_id;
+    double price_per_sqm;
+} district_price_t;
+
+typedef struct {
+    size_t count;
+    int* ids;
+    int* district_ids;
+    int* rooms;
+    double* prices;
+    double* market_values;     // Area times the district's mean asking price per sqm
+    double* growth_rates;      // NAN when the series has no prediction
+    double* default_roi;       // ROI under the default assumptions
+    size_t* by_roi;            // Rows by default ROI, best first
+    district_price_t* districts;   // Sorted by district id
+    size_t district_count;
+    double price_per_sqm;      // Fallback for unknown districts
+} investment_batch_t;
+
+typedef struct {
+    double roi;
+    size_t row;
+} rank_entry_t;
+
+static pthread_rwlock_t batch_lock = PTHREAD_RWLOCK_INITIALIZER;
+static investment_batch_t* current_batch = NULL;
+
+investment_assumptions_t investment_default_assumptions(void) {
+    investment_assumptions_t a = {
+        .down_payment = 0.20,
+        .interest_rate = 0.05,
+        .property_tax_rate = 0.005,
+        .insurance_rate = 0.003,
+        .maintenance_rate = 0.01,
+        .monthly_hoa = 0.0,
+        .vacancy_rate = 0.05,
+        .management_rate = 0.10,
+        .rent_yield = 0.005,
+        .finance_rate = 0.05,
+        .reinvest_rate = 0.03,
+        .default_growth = 0.03,
+        .land_share = 0.20,
+        .depreciation_years = 27.5,
+        .tax_bracket = 0.24,
+        .loan_term_years = 25,
+        .holding_years = 10
+    };
+    return a;
+}
+
+int investment_validate_assumptions(const investment_assumptions_t* a) {
+    if (!(a->down_payment > 0.0 && a->down_payment <= 1.0) ||
+        !(a->interest_rate >= 0.0 && a->interest_rate < 1.0) ||
+        !(a->vacancy_rate >= 0.0 && a->vacancy_rate < 1.0) ||
+        !(a->management_rate >= 0.0 && a->management_rate < 1.0) ||
+        !(a->rent_yield > 0.0 && a->rent_yield < 1.0) ||
+        !(a->finance_rate > -1.0 && a->reinvest_rate > -1.0) ||
+        !(a->default_growth > -1.0) ||
+        !(a->property_tax_rate >= 0.0 && a->insurance_rate >= 0.0 && a->maintenance_rate >= 0.0) ||
+        !(a->monthly_hoa >= 0.0) ||
+        !(a->land_share >= 0.0 && a->land_share <= 1.0 && a->depreciation_years > 0.0) ||
+        a->loan_term_years < 1 || a->loan_term_years > 50 ||
+        a->holding_years < 1 || a->holding_years > 50) {
+        return 1;
+    }
+    return 0;
+}
+
+int investment_parse_assumption(const char* argument, investment_assumptions_t* a) {
+    if (strncmp(argument, "down_payment=", 13) == 0) {
+        a->down_payment = atof(argument + 13) / 100.0;
+    } else if (strncmp(argument, "interest_rate=", 14) == 0) {
+        a->interest_rate = atof(argument + 14) / 100.0;
+    } else if (strncmp(argument, "loan_term=", 10) == 0) {
+        a->loan_term_years = atoi(argument + 10);
+    } else if (strncmp(argument, "years=", 6) == 0) {
+        a->holding_years = atoi(argument + 6);
+    } else if (strncmp(argument, "rent_yield=", 11) == 0) {
+        a->rent_yield = atof(argument + 11) / 100.0;
+    } else if (strncmp(argument, "vacancy_rate=", 13) == 0) {
+        a->vacancy_rate = atof(argument + 13) / 100.0;
+    } else if (strncmp(argument, "hoa=", 4) == 0) {
+        a->monthly_hoa = atof(argument + 4);
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+int investment_parse_filter(const char* argument, investment_filter_t* filter) {
+    if (strncmp(argument, "district=", 9) == 0) {
+        filter->district_id = atoi(argument + 9);
+    } else if (strncmp(argument, "rooms=", 6) == 0) {
+        filter->num_rooms = atoi(argument + 6);
+    } else if (strncmp(argument, "max_price=", 10) == 0) {
+        filter->max_price = atoi(argument + 10);
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+double investment_monthly_payment(double principal, double annual_rate, int years) {
+    double r = annual_rate / 12.0;
+    int n = years * 12;
+    if (r == 0.0) {
+        return principal / n;
+    }
+    double growth = pow(1.0 + r, n);
+    return principal * r * growth / (growth - 1.0);
+}
+
+// Share of the loan still owed after `paid` monthly payments
+static double balance_share(double annual_rate, int years, int paid) {
+    int n = years * 12;
+    if (paid >= n) {
+        return 0.0;
+    }
+    double r = annual_rate / 12.0;
+    if (r == 0.0) {
+        return 1.0 - (double) paid / n;
+    }
+    double total = pow(1.0 + r, n);
+    return (total - pow(1.0 + r, paid)) / (total - 1.0);
+}
+
+static void compute_factors(const investment_assumptions_t* a, factors_t* f) {
+    int n = a->holding_years;
+    f->down_payment = a->down_payment;
+    f->loan_share = 1.0 - a->down_payment;
+    f->payment_factor = investment_monthly_payment(1.0, a->interest_rate, a->loan_term_years);
+    f->balance_year1 = balance_share(a->interest_rate, a->loan_term_years, 12);
+    f->balance_hold = balance_share(a->interest_rate, a->loan_term_years, n * 12);
+    f->operating_share = a->property_tax_rate + a->insurance_rate + a->maintenance_rate;
+    f->hoa_annual = a->monthly_hoa * 12.0;
+    f->rent_collected = (1.0 - a->vacancy_rate) * (1.0 - a->management_rate);
+    f->rent_after_fees = 1.0 - a->management_rate;
+    f->tax_benefit_share = (1.0 - a->land_share) / a->depreciation_years * a->tax_bracket;
+
+    // MIRR over n yearly flows, the last one including the sale: flow i
+    // is compounded n-i-1 years at the reinvest rate when positive and
+    // discounted i+1 years at the finance rate when negative
+    f->mirr_reinvest = 0.0;
+    f->mirr_finance = 0.0;
+    for (int i = 0; i < n - 1; i++) {
+        f->mirr_reinvest += pow(1.0 + a->reinvest_rate, n - i - 1);
+        f->mirr_finance += pow(1.0 + a->finance_rate, -(i + 1));
+    }
+    f->mirr_finance_last = pow(1.0 + a->finance_rate, -n);
+    f->years = n;
+}
+
+// Lane-wise select, max and min; macros rather than functions so no
+// vector crosses a call boundary (AVX-sized vectors have no fixed ABI
+// on baseline x86-64)
+#define LANES_SELECT(mask, a, b) \
+    ((double_lanes_t) (((mask_lanes_t) (a) & (mask)) | ((mask_lanes_t) (b) & ~(mask))))
+#define LANES_MAX(a, b) LANES_SELECT((mask_lanes_t) ((a) > (b)), a, b)
+#define LANES_MIN(a, b) LANES_SELECT((mask_lanes_t) ((a) < (b)), a, b)
+
+typedef struct {
+    double_lanes_t monthly_mortgage;
+    double_lanes_t monthly_cash_flow;
+    double_lanes_t net_operating_income;
+    double_lanes_t cap_rate;
+    double_lanes_t cash_on_cash;
+    double_lanes_t dscr;
+    double_lanes_t break_even_occupancy;
+    double_lanes_t roi;
+    double_lanes_t annualized_roi;
+    double_lanes_t mirr;
+    double_lanes_t cfroi;
+} result_lanes_t;
+
+static void evaluate_lanes(const factors_t* f, const double_lanes_t* price_lanes, const double_lanes_t* rent_lanes,
+                           const double_lanes_t* growth_lanes, result_lanes_t* r) {
+    const double_lanes_t zero = { 0 };
+    const double_lanes_t one = zero + 1.0;
+    double_lanes_t price = *price_lanes, rent = *rent_lanes, growth = *growth_lanes;
+
+    double_lanes_t loan = price * f->loan_share;
+    double_lanes_t investment = price * f->down_payment;
+    r->monthly_mortgage = loan * f->payment_factor;
+    double_lanes_t debt_service = r->monthly_mortgage * 12.0;
+    double_lanes_t gross_rent = rent * 12.0;
+    double_lanes_t fixed_costs = price * f->operating_share + f->hoa_annual;
+
+    double_lanes_t noi = gross_rent * f->rent_collected - fixed_costs;
+    double_lanes_t cash_flow = noi - debt_service;
+    r->net_operating_income = noi;
+    r->monthly_cash_flow = cash_flow / 12.0;
+    r->cap_rate = noi / price;
+    r->cash_on_cash = cash_flow / investment;
+    r->dscr = f->loan_share > 0.0 ? noi / debt_service : zero;
+    r->break_even_occupancy = LANES_MIN((debt_service + fixed_costs) / (gross_rent * f->rent_after_fees), one);
+
+    // Appreciation needs a power per lane
+    double_lanes_t appreciation;
+    for (int l = 0; l < LANES; l++) {
+        appreciation[l] = pow(1.0 + growth[l], f->years);
+    }
+    double_lanes_t future_value = price * appreciation;
+    r->roi = appreciation - 1.0 + cash_flow * f->years / price;
+
+    // Yearly flows are the cash flow; the last adds the equity at sale
+    double_lanes_t last_flow = cash_flow + future_value - loan * f->balance_hold;
+    double_lanes_t positive = LANES_MAX(cash_flow, zero) * f->mirr_reinvest + LANES_MAX(last_flow, zero);
+    double_lanes_t negative = investment - LANES_MIN(cash_flow, zero) * f->mirr_finance -
+                              LANES_MIN(last_flow, zero) * f->mirr_finance_last;
+    double_lanes_t ratio = positive / negative;
+    double_lanes_t total = 1.0 + r->roi;
+    for (int l = 0; l < LANES; l++) {
+        r->mirr[l] = ratio[l] > 0.0 ? pow(ratio[l], 1.0 / f->years) - 1.0 : -1.0;
+        r->annualized_roi[l] = total[l] > 0.0 ? pow(total[l], 1.0 / f->years) - 1.0 : -1.0;
+    }
+
+    double_lanes_t principal_paid = loan * (1.0 - f->balance_year1);
+    r->cfroi = (cash_flow + principal_paid + price * growth + price * f->tax_benefit_share) / investment;
+}
+
+static void store_lanes(const result_lanes_t* r, const investment_outputs_t* out, size_t i, size_t n) {
+    size_t bytes = n * sizeof(double);
+    memcpy(&out->monthly_mortgage[i], &r->monthly_mortgage, bytes);
+    memcpy(&out->monthly_cash_flow[i], &r->monthly_cash_flow, bytes);
+    memcpy(&out->net_operating_income[i], &r->net_operating_income, bytes);
+    memcpy(&out->cap_rate[i], &r->cap_rate, bytes);
+    memcpy(&out->cash_on_cash[i], &r->cash_on_cash, bytes);
+    memcpy(&out->dscr[i], &r->dscr, bytes);
+    memcpy(&out->break_even_occupancy[i], &r->break_even_occupancy, bytes);
+    memcpy(&out->roi[i], &r->roi, bytes);
+    memcpy(&out->annualized_roi[i], &r->annualized_roi, bytes);
+    memcpy(&out->mirr[i], &r->mirr, bytes);
+    memcpy(&out->cfroi[i], &r->cfroi, bytes);
+}
+
+static void evaluate_factors(const factors_t* f, const investment_inputs_t* in, size_t n,
+                             const investment_outputs_t* out) {
+    result_lanes_t r;
+    size_t i = 0;
+    for (; i + LANES <= n; i += LANES) {
+        double_lanes_t price, rent, growth;
+        memcpy(&price, &in->prices[i], sizeof(price));
+        memcpy(&rent, &in->monthly_rents[i], sizeof(rent));
+        memcpy(&growth, &in->growth_rates[i], sizeof(growth));
+        evaluate_lanes(f, &price, &rent, &growth, &r);
+        store_lanes(&r, out, i, LANES);
+    }
+    if (i < n) {
+        // Pad the tail with a harmless listing
+        double_lanes_t growth = { 0 };
+        double_lanes_t price = growth + 1.0, rent = growth + 1.0;
+        for (size_t l = 0; i + l < n; l++) {
+            price[l] = in->prices[i + l];
+            rent[l] = in->monthly_rents[i + l];
+            growth[l] = in->growth_rates[i + l];
+        }
+        evaluate_lanes(f, &price, &rent, &growth, &r);
+        store_lanes(&r, out, i, n - i);
+    }
+}
+
+void investment_evaluate(const investment_assumptions_t* assumptions, const investment_inputs_t* in, size_t n,
+                         const investment_outputs_t* out) {
+    factors_t f;
+    compute_factors(assumptions, &f);
+    evaluate_factors(&f, in, n, out);
+}
+
+int investment_amortization(double principal, double annual_rate, int years, investment_payment_t* out) {
+    double r = annual_rate / 12.0;
+    int n = years * 12;
+    double payment = investment_monthly_payment(principal, annual_rate, years);
+    double balance = principal;
+    for (int i = 0; i < n; i++) {
+        double interest = balance * r;
+        double principal_paid = payment - interest;
+        balance -= principal_paid;
+        out[i].payment_number = i + 1;
+        out[i].payment = payment;
+        out[i].principal = principal_paid;
+        out[i].interest = interest;
+        out[i].remaining_balance = balance > 0.0 ? balance : 0.0;  // Rounding can leave -0.000001
+    }
+    return n;
+}
+
+// Evaluate one listing under the given assumptions
+static void evaluate_one(const investment_assumptions_t* a, double price, double rent, double growth,
+                         double* out_cash_flow, double* out_roi) {
+    double values[11];
+    investment_inputs_t in = { &price, &rent, &growth };
+    investment_outputs_t out = {
+        &values[0], &values[1], &values[2], &values[3], &values[4], &values[5],
+        &values[6], &values[7], &values[8], &values[9], &values[10]
+    };
+    investment_evaluate(a, &in, 1, &out);
+    *out_cash_flow = *out.monthly_cash_flow;
+    *out_roi = *out.roi;
+}
+
+void investment_sensitivity(const investment_assumptions_t* assumptions, double price, double monthly_rent,
+                            double growth_rate, investment_sensitivity_t* out) {
+    static const double percent_steps[INVESTMENT_SENSITIVITY_STEPS] = { -10, -5, 0, 5, 10 };
+    static const double rate_steps[INVESTMENT_SENSITIVITY_STEPS] = { -1, -0.5, 0, 0.5, 1 };
+    static const double vacancy_steps[INVESTMENT_SENSITIVITY_STEPS] = { -3, -2, 0, 2, 3 };
+    static const double growth_steps[INVESTMENT_SENSITIVITY_STEPS] = { -2, -1, 0, 1, 2 };
+
+    out[0] = (investment_sensitivity_t) { "purchase_price", "percent", "monthly_cash_flow", { 0 }, { 0 } };
+    out[1] = (investment_sensitivity_t) { "interest_rate", "points", "monthly_cash_flow", { 0 }, { 0 } };
+    out[2] = (investment_sensitivity_t) { "rental_income", "percent", "monthly_cash_flow", { 0 }, { 0 } };
+    out[3] = (investment_sensitivity_t) { "vacancy_rate", "points", "monthly_cash_flow", { 0 }, { 0 } };
+    out[4] = (investment_sensitivity_t) { "appreciation_rate", "points", "roi", { 0 }, { 0 } };
+
+    for (int s = 0; s < INVESTMENT_SENSITIVITY_STEPS; s++) {
+        double roi;
+        investment_assumptions_t a = *assumptions;
+
+        out[0].variations[s] = percent_steps[s];
+        evaluate_one(&a, price * (1.0 + percent_steps[s] / 100.0), monthly_rent, growth_rate,
+                     &out[0].values[s], &roi);
+
+        out[1].variations[s] = rate_steps[s];
+        a.interest_rate = fmax(assumptions->interest_rate + rate_steps[s] / 100.0, 0.0);
+        evaluate_one(&a, price, monthly_rent, growth_rate, &out[1].values[s], &roi);
+        a.interest_rate = assumptions->interest_rate;
+
+        out[2].variations[s] = percent_steps[s];
+        evaluate_one(&a, price, monthly_rent * (1.0 + percent_steps[s] / 100.0), growth_rate,
+                     &out[2].values[s], &roi);
+
+        out[3].variations[s] = vacancy_steps[s];
+        a.vacancy_rate = fmin(fmax(assumptions->vacancy_rate + vacancy_steps[s] / 100.0, 0.0), 0.99);
+        evaluate_one(&a, price, monthly_rent, growth_rate, &out[3].values[s], &roi);
+        a.vacancy_rate = assumptions->vacancy_rate;
+
+        double cash_flow;
+        out[4].variations[s] = growth_steps[s];
+        evaluate_one(&a, price, monthly_rent, growth_rate + growth_steps[s] / 100.0, &cash_flow, &out[4].values[s]);
+    }
+}
+
+static void batch_free(investment_batch_t* batch) {
+    if (batch == NULL) {
+        return;
+    }
+    free(batch->ids);
+    free(batch->district_ids);
+    free(batch->rooms);
+    free(batch->prices);
+    free(batch->market_values);
+    free(batch->growth_rates);
+    free(batch->default_roi);
+    free(batch->by_roi);
+    free(batch->districts);
+    free(batch);
+}
+
+static double district_price_per_sqm(const investment_batch_t* batch, int district_id) {
+    size_t lo = 0, hi = batch->district_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (batch->districts[mid].district_id < district_id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo < batch->district_count && batch->districts[lo].district_id == district_id) {
+        return batch->districts[lo].price_per_sqm;
+    }
+    return batch->price_per_sqm;
+}
+
+// Published 12-month growth of a series, NAN without a prediction
+static double series_growth(int district_id, int num_rooms) {
+    price_prediction_t prediction;
+    if (prediction_lookup(district_id, num_rooms, &prediction) != 0 || prediction.current_avg_price <= 0.0) {
+        return NAN;
+    }
+    double growth = prediction.prediction_12m / prediction.current_avg_price - 1.0;
+    return fmin(fmax(growth, -MAX_GROWTH), MAX_GROWTH);
+}
+
+static int compare_districts(const void* a, const void* b) {
+    int x = ((const district_price_t*) a)->district_id;
+    int y = ((const district_price_t*) b)->district_id;
+    return (x > y) - (x < y);
+}
+
+// Mean asking price per sqm by district, with the overall mean as fallback
+static int build_district_prices(investment_batch_t* batch, const property_t* listings, size_t n) {
+    size_t capacity = 16, count = 0;
+    district_price_t* districts = malloc(sizeof(district_price_t) * capacity);
+    long* samples = malloc(sizeof(long) * capacity);
+    if (districts == NULL || samples == NULL) {
+        free(districts);
+        free(samples);
+        return -1;
+    }
+
+    double total = 0.0;
+    long total_samples = 0;
+    size_t last = 0;
+    for (size_t i = 0; i < n; i++) {
+        const property_t* p = &listings[i];
+        if (p->price <= 0 || p->area_sqm <= 0) {
+            continue;
+        }
+        // Listings of a district tend to arrive together; check the last hit first
+        size_t d = last;
+        if (d >= count || districts[d].district_id != p->district_id) {
+            for (d = 0; d < count && districts[d].district_id != p->district_id; d++) {
+            }
+        }
+        if (d == count) {
+            if (count == capacity) {
+                capacity *= 2;
+                district_price_t* grown = realloc(districts, sizeof(district_price_t) * capacity);
+                long* grown_samples = grown ? realloc(samples, sizeof(long) * capacity) : NULL;
+                if (grown == NULL || grown_samples == NULL) {
+                    free(grown ? grown : districts);
+                    free(samples);
+                    return -1;
+                }
+                districts = grown;
+                samples = grown_samples;
+            }
+            districts[d].district_id = p->district_id;
+            districts[d].price_per_sqm = 0.0;
+            samples[d] = 0;
+            count++;
+        }
+        double per_sqm = (double) p->price / p->area_sqm;
+        districts[d].price_per_sqm += per_sqm;
+        samples[d]++;
+        total += per_sqm;
+        total_samples++;
+        last = d;
+    }
+    for (size_t d = 0; d < count; d++) {
+        districts[d].price_per_sqm /= samples[d];
+    }
+    free(samples);
+    qsort(districts, count, sizeof(district_price_t), compare_districts);
+
+    batch->districts = districts;
+    batch->district_count = count;
+    batch->price_per_sqm = total_samples ? total / total_samples : 0.0;
+    return 0;
+}
+
+// Gather inputs of batch rows under the given assumptions
+static void gather_inputs(const investment_batch_t* batch, const investment_assumptions_t* a, const size_t* rows,
+                          size_t n, double* prices, double* rents, double* growth) {
+    for (size_t i = 0; i < n; i++) {
+        size_t row = rows[i];
+        double g = batch->growth_rates[row];
+        prices[i] = batch->prices[row];
+        rents[i] = batch->market_values[row] * a->rent_yield;
+        growth[i] = isnan(g) ? a->default_growth : g;
+    }
+}
+
+// Per-block scratch space for the evaluation of BLOCK listings
+typedef struct {
+    size_t rows[BLOCK];
+    double prices[BLOCK];
+    double rents[BLOCK];
+    double growth[BLOCK];
+    double values[11][BLOCK];
+} block_t;
+
+static void evaluate_block(const investment_batch_t* batch, const investment_assumptions_t* a, const factors_t* f,
+                           block_t* block, size_t n, investment_outputs_t* out) {
+    gather_inputs(batch, a, block->rows, n, block->prices, block->rents, block->growth);
+    *out = (investment_outputs_t) {
+        block->values[0], block->values[1], block->values[2], block->values[3], block->values[4],
+        block->values[5], block->values[6], block->values[7], block->values[8], block->values[9],
+        block->values[10]
+    };
+    investment_inputs_t in = { block->prices, block->rents, block->growth };
+    evaluate_factors(f, &in, n, out);
+}
+
+static int compare_by_default_roi(const void* a, const void* b, void* ctx) {
+    const double* roi = ctx;
+    size_t x = *(const size_t*) a, y = *(const size_t*) b;
+    if (roi[x] != roi[y]) {
+        return roi[x] > roi[y] ? -1 : 1;
+    }
+    return (x > y) - (x < y);
+}
+
+static investment_batch_t* batch_build(const property_t* listings, size_t total) {
+    investment_batch_t* batch = calloc(1, sizeof(investment_batch_t));
+    if (batch == NULL || build_district_prices(batch, listings, total) != 0) {
+        batch_free(batch);
+        return NULL;
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i < total; i++) {
+        n += listings[i].status == PROPERTY_STATUS_ACTIVE && listings[i].price > 0 && listings[i].area_sqm > 0;
+    }
+    size_t alloc = n ? n : 1;
+    batch->ids = malloc(sizeof(int) * alloc);
+    batch->district_ids = malloc(sizeof(int) * alloc);
+    batch->rooms = malloc(sizeof(int) * alloc);
+    batch->prices = malloc(sizeof(double) * alloc);
+    batch->market_values = malloc(sizeof(double) * alloc);
+    batch->growth_rates = malloc(sizeof(double) * alloc);
+    batch->default_roi = malloc(sizeof(double) * alloc);
+    batch->by_roi = malloc(sizeof(size_t) * alloc);
+    block_t* block = malloc(sizeof(block_t));
+    if (!batch->ids || !batch->district_ids || !batch->rooms || !batch->prices || !batch->market_values ||
+        !batch->growth_rates || !batch->default_roi || !batch->by_roi || !block) {
+        free(block);
+        batch_free(batch);
+        return NULL;
+    }
+
+    // Listings of one series share a growth rate; remember the last lookup
+    int last_district = 0, last_rooms = -1;
+    double last_growth = NAN;
+    size_t row = 0;
+    for (size_t i = 0; i < total; i++) {
+        const property_t* p = &listings[i];
+        if (p->status != PROPERTY_STATUS_ACTIVE || p->price <= 0 || p->area_sqm <= 0) {
+            continue;
+        }
+        if (p->district_id != last_district || p->num_rooms != last_rooms) {
+            last_district = p->district_id;
+            last_rooms = p->num_rooms;
+            last_growth = series_growth(p->district_id, p->num_rooms);
+        }
+        batch->ids[row] = p->id;
+        batch->district_ids[row] = p->district_id;
+        batch->rooms[row] = p->num_rooms;
+        batch->prices[row] = p->price;
+        batch->market_values[row] = p->area_sqm * district_price_per_sqm(batch, p->district_id);
+        batch->growth_rates[row] = last_growth;
+        row++;
+    }
+    batch->count = n;
+
+    // Precompute the ranking under the default assumptions
+    investment_assumptions_t defaults = investment_default_assumptions();
+    factors_t f;
+    compute_factors(&defaults, &f);
+    for (size_t begin = 0; begin < n; begin += BLOCK) {
+        size_t count = n - begin < BLOCK ? n - begin : BLOCK;
+        for (size_t i = 0; i < count; i++) {
+            block->rows[i] = begin + i;
+        }
+        investment_outputs_t out;
+        evaluate_block(batch, &defaults, &f, block, count, &out);
+        memcpy(&batch->default_roi[begin], out.roi, count * sizeof(double));
+    }
+    free(block);
+
+    for (size_t i = 0; i < n; i++) {
+        batch->by_roi[i] = i;
+    }
+    qsort_r(batch->by_roi, n, sizeof(size_t), compare_by_default_roi, batch->default_roi);
+    return batch;
+}
+
+long investment_rebuild(void) {
+    size_t n = 0;
+    const property_t* listings = properties_acquire(&n);
+    investment_batch_t* batch = batch_build(listings, n);
+    properties_release();
+    if (batch == NULL) {
+        return -1;
+    }
+
+    pthread_rwlock_wrlock(&batch_lock);
+    investment_batch_t* old = current_batch;
+    current_batch = batch;
+    pthread_rwlock_unlock(&batch_lock);
+
+    batch_free(old);
+    return (long) batch->count;
+}
+
+size_t investment_count(void) {
+    pthread_rwlock_rdlock(&batch_lock);
+    size_t n = current_batch ? current_batch->count : 0;
+    pthread_rwlock_unlock(&batch_lock);
+    return n;
+}
+
+int investment_listing_inputs(const property_t* listing, const investment_assumptions_t* assumptions,
+                              double* out_monthly_rent, double* out_growth_rate) {
+    pthread_rwlock_rdlock(&batch_lock);
+    if (current_batch == NULL) {
+        pthread_rwlock_unlock(&batch_lock);
+        return 1;
+    }
+    double per_sqm = district_price_per_sqm(current_batch, listing->district_id);
+    pthread_rwlock_unlock(&batch_lock);
+
+    double growth = series_growth(listing->district_id, listing->num_rooms);
+    *out_monthly_rent = listing->area_sqm * per_sqm * assumptions->rent_yield;
+    *out_growth_rate = isnan(growth) ? assumptions->default_growth : growth;
+    return 0;
+}
+
+static int matches_filter(const investment_batch_t* batch, const investment_filter_t* filter, size_t row) {
+    return filter == NULL ||
+           ((filter->district_id == 0 || batch->district_ids[row] == filter->district_id) &&
+            (filter->num_rooms == 0 || batch->rooms[row] == filter->num_rooms) &&
+            (filter->max_price == 0 || batch->prices[row] <= filter->max_price));
+}
+
+// Higher ROI first, then lower row for a stable order
+static int rank_better(const rank_entry_t* a, const rank_entry_t* b) {
+    return a->roi > b->roi || (a->roi == b->roi && a->row < b->row);
+}
+
+// Bounded min-heap: the root is the worst of the best k so far
+static void heap_offer(rank_entry_t* heap, size_t* size, size_t k, rank_entry_t entry) {
+    size_t i;
+    if (*size < k) {
+        i = (*size)++;
+        while (i > 0 && rank_better(&heap[(i - 1) / 2], &entry)) {
+            heap[i] = heap[(i - 1) / 2];
+            i = (i - 1) / 2;
+        }
+    } else if (rank_better(&entry, &heap[0])) {
+        i = 0;
+        for (;;) {
+            size_t child = 2 * i + 1;
+            if (child >= k) {
+                break;
+            }
+            if (child + 1 < k && rank_better(&heap[child], &heap[child + 1])) {
+                child++;
+            }
+            if (!rank_better(&entry, &heap[child])) {
+                break;
+            }
+            heap[i] = heap[child];
+            i = child;
+        }
+    } else {
+        return;
+    }
+    heap[i] = entry;
+}
+
+static int compare_rank_entries(const void* a, const void* b) {
+    const rank_entry_t* x = a;
+    const rank_entry_t* y = b;
+    return rank_better(x, y) ? -1 : (rank_better(y, x) ? 1 : 0);
+}
+
+typedef struct {
+    const investment_batch_t* batch;
+    const investment_assumptions_t* assumptions;
+    const investment_filter_t* filter;
+    factors_t factors;
+    size_t k;
+    rank_entry_t* heaps;       // k entries per worker
+    size_t* heap_sizes;
+    block_t* blocks;           // One per worker
+} rank_context_t;
+
+static void rank_task(size_t begin, size_t end, int worker, void* arg) {
+    rank_context_t* ctx = arg;
+    block_t* block = &ctx->blocks[worker];
+    rank_entry_t* heap = &ctx->heaps[(size_t) worker * ctx->k];
+    size_t* size = &ctx->heap_sizes[worker];
+
+    size_t i = begin;
+    while (i < end) {
+        // Collect up to BLOCK listings that pass the filter
+        size_t count = 0;
+        for (; i < end && count < BLOCK; i++) {
+            if (matches_filter(ctx->batch, ctx->filter, i)) {
+                block->rows[count++] = i;
+            }
+        }
+        if (count == 0) {
+            continue;
+        }
+        investment_outputs_t out;
+        evaluate_block(ctx->batch, ctx->assumptions, &ctx->factors, block, count, &out);
+        for (size_t j = 0; j < count; j++) {
+            rank_entry_t entry = { out.roi[j], block->rows[j] };
+            heap_offer(heap, size, ctx->k, entry);
+        }
+    }
+}
+
+// Write full metrics of the chosen rows
+static void fill_metrics(const investment_batch_t* batch, const investment_assumptions_t* a, const size_t* rows,
+                         size_t n, investment_metrics_t* out) {
+    block_t* block = malloc(sizeof(block_t));
+    if (block == NULL) {
+        return;
+    }
+    factors_t f;
+    compute_factors(a, &f);
+    for (size_t begin = 0; begin < n; begin += BLOCK) {
+        size_t count = n - begin < BLOCK ? n - begin : BLOCK;
+        memcpy(block->rows, &rows[begin], count * sizeof(size_t));
+        investment_outputs_t values;
+        evaluate_block(batch, a, &f, block, count, &values);
+        for (size_t i = 0; i < count; i++) {
+            size_t row = block->rows[i];
+            investment_metrics_t* m = &out[begin + i];
+            m->property_id = batch->ids[row];
+            m->district_id = batch->district_ids[row];
+            m->num_rooms = batch->rooms[row];
+            m->price = (int) batch->prices[row];
+            m->monthly_rent = block->rents[i];
+            m->growth_rate = block->growth[i];
+            m->monthly_mortgage = values.monthly_mortgage[i];
+            m->monthly_cash_flow = values.monthly_cash_flow[i];
+            m->net_operating_income = values.net_operating_income[i];
+            m->cap_rate = values.cap_rate[i];
+            m->cash_on_cash = values.cash_on_cash[i];
+            m->dscr = values.dscr[i];
+            m->gross_rent_multiplier = block->prices[i] / (block->rents[i] * 12.0);
+            m->break_even_occupancy = values.break_even_occupancy[i];
+            m->roi = values.roi[i];
+            m->annualized_roi = values.annualized_roi[i];
+            m->mirr = values.mirr[i];
+            m->cfroi = values.cfroi[i];
+        }
+    }
+    free(block);
+}
+
+// Rank by re-evaluating every listing under custom assumptions
+static long rank_custom(const investment_batch_t* batch, const investment_assumptions_t* a,
+                        const investment_filter_t* filter, size_t k, size_t* out_rows) {
+    int workers = parallel_default_workers();
+    rank_context_t ctx = { .batch = batch, .assumptions = a, .filter = filter, .k = k };
+    compute_factors(a, &ctx.factors);
+    ctx.heaps = malloc(sizeof(rank_entry_t) * k * workers);
+    ctx.heap_sizes = calloc((size_t) workers, sizeof(size_t));
+    ctx.blocks = malloc(sizeof(block_t) * workers);
+    if (ctx.heaps == NULL || ctx.heap_sizes == NULL || ctx.blocks == NULL) {
+        free(ctx.heaps);
+        free(ctx.heap_sizes);
+        free(ctx.blocks);
+        return -1;
+    }
+
+    long found = -1;
+    if (parallel_for(batch->count, 16384, workers, rank_task, &ctx) >= 0) {
+        // Merge the per-worker heaps
+        size_t merged = 0;
+        for (int w = 0; w < workers; w++) {
+            memmove(&ctx.heaps[merged], &ctx.heaps[(size_t) w * k], ctx.heap_sizes[w] * sizeof(rank_entry_t));
+            merged += ctx.heap_sizes[w];
+        }
+        qsort(ctx.heaps, merged, sizeof(rank_entry_t), compare_rank_entries);
+        found = (long) (merged < k ? merged : k);
+        for (long i = 0; i < found; i++) {
+            out_rows[i] = ctx.heaps[i].row;
+        }
+    }
+    free(ctx.heaps);
+    free(ctx.heap_sizes);
+    free(ctx.blocks);
+    return found;
+}
+
+int investment_rank(const investment_assumptions_t* assumptions, const investment_filter_t* filter,
+                    size_t offset, size_t limit, investment_metrics_t* out) {
+    size_t k = offset + limit;
+    if (k > INVESTMENT_MAX_RANKING || limit == 0) {
+        return limit == 0 ? 0 : -1;
+    }
+    size_t rows[INVESTMENT_MAX_RANKING];
+
+    pthread_rwlock_rdlock(&batch_lock);
+    const investment_batch_t* batch = current_batch;
+    if (batch == NULL) {
+        pthread_rwlock_unlock(&batch_lock);
+        return -1;
+    }
+
+    long found = 0;
+    investment_assumptions_t defaults = investment_default_assumptions();
+    if (assumptions == NULL) {
+        for (size_t i = 0; i < batch->count && (size_t) found < k; i++) {
+            size_t row = batch->by_roi[i];
+            if (matches_filter(batch, filter, row)) {
+                rows[found++] = row;
+            }
+        }
+        assumptions = &defaults;
+    } else {
+        found = rank_custom(batch, assumptions, filter, k, rows);
+    }
+
+    int written = 0;
+    if (found > (long) offset) {
+        written = (int) (found - (long) offset);
+        fill_metrics(batch, assumptions, &rows[offset], (size_t) written, out);
+    }
+    pthread_rwlock_unlock(&batch_lock);
+    return found < 0 ? -1 : written;
+}
+
+static json_t* assumptions_json(const investment_assumptions_t* a) {
+    json_t* json = json_object();
+    json_object_set_new(json, "down_payment", json_real(a->down_payment));
+    json_object_set_new(json, "interest_rate", json_real(a->interest_rate));
+    json_object_set_new(json, "loan_term_years", json_integer(a->loan_term_years));
+    json_object_set_new(json, "holding_years", json_integer(a->holding_years));
+    json_object_set_new(json, "rent_yield", json_real(a->rent_yield));
+    json_object_set_new(json, "vacancy_rate", json_real(a->vacancy_rate));
+    json_object_set_new(json, "management_rate", json_real(a->management_rate));
+    json_object_set_new(json, "monthly_hoa", json_real(a->monthly_hoa));
+    return json;
+}
+
+static json_t* metrics_json(const investment_metrics_t* m) {
+    json_t* json = json_object();
+    json_object_set_new(json, "id", json_integer(m->property_id));
+    json_object_set_new(json, "district_id", json_integer(m->district_id));
+    json_object_set_new(json, "num_rooms", json_integer(m->num_rooms));
+    json_object_set_new(json, "price", json_integer(m->price));
+    json_object_set_new(json, "monthly_rent", json_real(m->monthly_rent));
+    json_object_set_new(json, "growth_rate", json_real(m->growth_rate));
+    json_object_set_new(json, "monthly_mortgage", json_real(m->monthly_mortgage));
+    json_object_set_new(json, "monthly_cash_flow", json_real(m->monthly_cash_flow));
+    json_object_set_new(json, "net_operating_income", json_real(m->net_operating_income));
+    json_object_set_new(json, "cap_rate", json_real(m->cap_rate));
+    json_object_set_new(json, "cash_on_cash", json_real(m->cash_on_cash));
+    json_object_set_new(json, "dscr", json_real(m->dscr));
+    json_object_set_new(json, "gross_rent_multiplier", json_real(m->gross_rent_multiplier));
+    json_object_set_new(json, "break_even_occupancy", json_real(m->break_even_occupancy));
+    json_object_set_new(json, "roi", json_real(m->roi));
+    json_object_set_new(json, "annualized_roi", json_real(m->annualized_roi));
+    json_object_set_new(json, "mirr", json_real(m->mirr));
+    json_object_set_new(json, "cfroi", json_real(m->cfroi));
+    return json;
+}
+
+static json_t* schedule_json(double loan, const investment_assumptions_t* a, int monthly) {
+    int n = a->loan_term_years * 12;
+    investment_payment_t* payments = malloc(sizeof(investment_payment_t) * n);
+    if (payments == NULL) {
+        return json_null();
+    }
+    investment_amortization(loan, a->interest_rate, a->loan_term_years, payments);
+
+    json_t* rows = json_array();
+    double principal = 0.0, interest = 0.0;
+    for (int i = 0; i < n; i++) {
+        const investment_payment_t* p = &payments[i];
+        if (monthly) {
+            json_t* row = json_object();
+            json_object_set_new(row, "payment_number", json_integer(p->payment_number));
+            json_object_set_new(row, "payment", json_real(p->payment));
+            json_object_set_new(row, "principal", json_real(p->principal));
+            json_object_set_new(row, "interest", json_real(p->interest));
+            json_object_set_new(row, "remaining_balance", json_real(p->remaining_balance));
+            json_array_append_new(rows, row);
+            continue;
+        }
+        principal += p->principal;
+        interest += p->interest;
+        if ((i + 1) % 12 == 0) {
+            json_t* row = json_object();
+            json_object_set_new(row, "year", json_integer((i + 1) / 12));
+            json_object_set_new(row, "principal", json_real(principal));
+            json_object_set_new(row, "interest", json_real(interest));
+            json_object_set_new(row, "remaining_balance", json_real(p->remaining_balance));
+            json_array_append_new(rows, row);
+            principal = interest = 0.0;
+        }
+    }
+
+    json_t* json = json_object();
+    json_object_set_new(json, "loan_amount", json_real(loan));
+    json_object_set_new(json, "monthly_payment", json_real(n > 0 ? payments[0].payment : 0.0));
+    json_object_set_new(json, "period", json_string(monthly ? "monthly" : "yearly"));
+    json_object_set_new(json, "payments", rows);
+    free(payments);
+    return json;
+}
+
+json_t* investment_get_handler(int property_id, const investment_assumptions_t* assumptions, int monthly_schedule) {
+    property_t listing;
+    double rent, growth;
+    if (properties_find(property_id, &listing) != 0 || listing.price <= 0 || listing.area_sqm <= 0 ||
+        investment_listing_inputs(&listing, assumptions, &rent, &growth) != 0 || rent <= 0.0) {
+        return NULL;
+    }
+
+    double price = listing.price;
+    double values[11];
+    investment_inputs_t in = { &price, &rent, &growth };
+    investment_outputs_t out = {
+        &values[0], &values[1], &values[2], &values[3], &values[4], &values[5],
+        &values[6], &values[7], &values[8], &values[9], &values[10]
+    };
+    investment_evaluate(assumptions, &in, 1, &out);
+
+    investment_metrics_t m = {
+        .property_id = listing.id,
+        .district_id = listing.district_id,
+        .num_rooms = listing.num_rooms,
+        .price = listing.price,
+        .monthly_rent = rent,
+        .growth_rate = growth,
+        .monthly_mortgage = *out.monthly_mortgage,
+        .monthly_cash_flow = *out.monthly_cash_flow,
+        .net_operating_income = *out.net_operating_income,
+        .cap_rate = *out.cap_rate,
+        .cash_on_cash = *out.cash_on_cash,
+        .dscr = *out.dscr,
+        .gross_rent_multiplier = price / (rent * 12.0),
+        .break_even_occupancy = *out.break_even_occupancy,
+        .roi = *out.roi,
+        .annualized_roi = *out.annualized_roi,
+        .mirr = *out.mirr,
+        .cfroi = *out.cfroi
+    };
+    json_t* json = metrics_json(&m);
+    json_object_set_new(json, "assumptions", assumptions_json(assumptions));
+
+    // Monthly cash needed to cover all costs at lower occupancy
+    double monthly_costs = m.monthly_mortgage + price * (assumptions->property_tax_rate + assumptions->insurance_rate +
+                           assumptions->maintenance_rate) / 12.0 + assumptions->monthly_hoa;
+    double collected = rent * (1.0 - assumptions->management_rate);
+    json_t* break_even = json_object();
+    json_object_set_new(break_even, "occupancy", json_real(m.break_even_occupancy));
+    json_object_set_new(break_even, "cash_needed_at_90", json_real(fmax(monthly_costs - collected * 0.9, 0.0)));
+    json_object_set_new(break_even, "cash_needed_at_80", json_real(fmax(monthly_costs - collected * 0.8, 0.0)));
+    json_object_set_new(break_even, "cash_needed_at_70", json_real(fmax(monthly_costs - collected * 0.7, 0.0)));
+    json_object_set_new(json, "break_even", break_even);
+
+    investment_sensitivity_t grid[INVESTMENT_SENSITIVITY_PARAMETERS];
+    investment_sensitivity(assumptions, price, rent, growth, grid);
+    json_t* sensitivity = json_array();
+    for (int p = 0; p < INVESTMENT_SENSITIVITY_PARAMETERS; p++) {
+        json_t* points = json_array();
+        for (int s = 0; s < INVESTMENT_SENSITIVITY_STEPS; s++) {
+            json_t* point = json_object();
+            json_object_set_new(point, "variation", json_real(grid[p].variations[s]));
+            json_object_set_new(point, "value", json_real(grid[p].values[s]));
+            json_array_append_new(points, point);
+        }
+        json_t* row = json_object();
+        json_object_set_new(row, "parameter", json_string(grid[p].parameter));
+        json_object_set_new(row, "unit", json_string(grid[p].unit));
+        json_object_set_new(row, "metric", json_string(grid[p].metric));
+        json_object_set_new(row, "points", points);
+        json_array_append_new(sensitivity, row);
+    }
+    json_object_set_new(json, "sensitivity", sensitivity);
+
+    json_object_set_new(json, "amortization",
+                        schedule_json(price * (1.0 - assumptions->down_payment), assumptions, monthly_schedule));
+    return json;
+}
+
+json_t* investment_rankings_handler(const investment_assumptions_t* assumptions, const investment_filter_t* filter,
+                                    size_t offset, size_t limit) {
+    investment_metrics_t* ranked = malloc(sizeof(investment_metrics_t) * (limit ? limit : 1));
+    if (ranked == NULL) {
+        return NULL;
+    }
+    int n = investment_rank(assumptions, filter, offset, limit, ranked);
+    if (n < 0) {
+        free(ranked);
+        return NULL;
+    }
+
+    investment_assumptions_t defaults = investment_default_assumptions();
+    json_t* list = json_array();
+    for (int i = 0; i < n; i++) {
+        json_array_append_new(list, metrics_json(&ranked[i]));
+    }
+    free(ranked);
+
+    json_t* json_obj = json_object();
+    json_object_set_new(json_obj, "sort", json_string("roi"));
+    json_object_set_new(json_obj, "offset", json_integer((json_int_t) offset));
+    json_object_set_new(json_obj, "limit", json_integer((json_int_t) limit));
+    json_object_set_new(json_obj, "total_listings", json_integer((json_int_t) investment_count()));
+    json_object_set_new(json_obj, "assumptions", assumptions_json(assumptions ? assumptions : &defaults));
+    json_object_set_new(json_obj, "listings", list);
+    return json_obj;
+}
@@ -1,5 +1,307 @@
+#include "include/api_handler.h"
+#include "include/db.h"
+#include "include/auth.h"
+#include "include/user_writes.h"
+#include "include/properties.h"
+#include "include/aggregation.h"
+#include "include/series_store.h"
+#include "include/prediction.h"
+#include "include/valuation.h"
+#include "include/comparables.h"
+#include "include/investment.h"
+#include "include/district_stats.h"
+#include "include/saved_search.h"
+#include "include/event_stream.h"
+#include "include/admission.h"
+#include "include/supervisor.h"
 #include <stdio.h>
-int main() {
-    printf("[STUB] main.c running.\n");
-    return 0;
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#define DEFAULT_PORT 8080
+#define DEFAULT_CONN_INFO "dbname=moldova_insight"
+#define DEFAULT_REFRESH_INTERVAL 900  // seconds
+#define DEFAULT_DB_POOL_SIZE 4        // Connections shared by request threads
+#define SNAPSHOT_POLL_INTERVAL 5      // seconds between snapshot checks in other workers
+// Seconds another worker waits at start for a first snapshot, inside
+// the supervisor's ready timeout
+#define SNAPSHOT_WAIT_TIMEOUT (SUPERVISOR_DEFAULT_READY_TIMEOUT - 60)
+
+typedef struct {
+    PGconn* conn;
+    const char* store_path;
+    const char* snapshot_path;   // Listings published for other workers, or NULL
+    unsigned int interval;
+} refresh_context_t;
+
+typedef struct {
+    PGconn* conn;                // For predictions, which stay in the database
+    const char* store_path;
+    const char* snapshot_path;
+    struct stat listings_seen;
+    struct stat series_seen;
+} follow_context_t;
+
+// Write the aggregated view to the series store and serve the new file
+static void publish_series_store(const char* path) {
+    size_t count = 0;
+    price_history_row_t* rows = aggregation_snapshot(&count);
+    if (rows != NULL && series_store_build(path, rows, count, 0) == 0) {
+        series_store_open(path);
+    }
+    free(rows);
+}
+
+// Pull new listings and rebuild everything derived from them
+static void refresh_all(PGconn* conn, const char* store_path, const char* snapshot_path) {
+    // Pick up added and deleted searches before new listings are matched
+    saved_search_load(conn);
+    if (properties_refresh(conn) > 0) {
+        comparables_rebuild();
+        // Picks up reprices and moves, which the ingest hook leaves out
+        district_stats_rebuild(0);
+    }
+    saved_search_match_pending(0);
+    saved_search_flush(conn);
+    valuation_update();
+    if (aggregation_run(conn, 0) > 0) {
+        publish_series_store(store_path);
+    }
+    prediction_job_run(conn, 0);
+    // Rankings use the fresh predictions as growth rates
+    investment_rebuild();
+    // Last, so workers reading it find the predictions stored
+    if (snapshot_path != NULL) {
+        properties_publish_snapshot(snapshot_path);
+    }
+}
+
+static void* refresh_thread(void* arg) {
+    refresh_context_t* ctx = arg;
+    for (;;) {
+        sleep(ctx->interval);
+        refresh_all(ctx->conn, ctx->store_path, ctx->snapshot_path);
+    }
+    return NULL;
+}
+
+// Whether a published file was replaced (publishing renames a new file
+// over it) since `seen`, which is then updated
+static int file_replaced(const char* path, struct stat* seen) {
+    struct stat st;
+    if (stat(path, &st) != 0 || (st.st_ino == seen->st_ino && st.st_dev == seen->st_dev)) {
+        return 0;
+    }
+    *seen = st;
+    return 1;
+}
+
+// Serve what the primary worker last published; derived indexes are
+// rebuilt here, the listings themselves stay in the shared mapping
+static void follow_snapshots(follow_context_t* ctx) {
+    if (file_replaced(ctx->snapshot_path, &ctx->listings_seen) &&
+        properties_open_snapshot(ctx->snapshot_path) == 0) {
+        comparables_rebuild();
+        district_stats_rebuild(0);
+        valuation_update();
+        if (ctx->conn != NULL) {
+            prediction_load(ctx->conn);
+        }
+        investment_rebuild();
+    }
+    if (file_replaced(ctx->store_path, &ctx->series_seen)) {
+        series_store_open(ctx->store_path);
+    }
+}
+
+static void* follow_thread(void* arg) {
+    follow_context_t* ctx = arg;
+    for (;;) {
+        sleep(SNAPSHOT_POLL_INTERVAL);
+        follow_snapshots(ctx);
+    }
+    return NULL;
+}
+
+int main(int argc, char** argv) {
+    (void) argc;
+    const char* conn_info = getenv("DATABASE_URL");
+    const char* port_str = getenv("PORT");
+    const char* store_path = getenv("SERIES_STORE_PATH");
+    const char* snapshot_path = getenv("LISTINGS_SNAPSHOT_PATH");
+    const char* interval_str = getenv("REFRESH_INTERVAL");
+    const char* pool_str = getenv("DB_POOL_SIZE");
+    const char* rate_str = getenv("RATE_LIMIT_RPS");
+    const char* burst_str = getenv("RATE_LIMIT_BURST");
+    const char* in_flight_str = getenv("MAX_IN_FLIGHT");
+    const char* workers_str = getenv("WORKERS");
+    const char* drain_str = getenv("DRAIN_TIMEOUT");
+    unsigned int port = port_str ? (unsigned int) atoi(port_str) : DEFAULT_PORT;
+    unsigned int drain_timeout = drain_str ? (unsigned int) atoi(drain_str) : SUPERVISOR_DEFAULT_DRAIN_TIMEOUT;
+    if (store_path == NULL) {
+        store_path = SERIES_STORE_DEFAULT_PATH;
+    }
+    if (snapshot_path == NULL) {
+        snapshot_path = PROPERTIES_SNAPSHOT_DEFAULT_PATH;
+    }
+
+    // With WORKERS set this process only supervises; the workers it
+    // starts run this binary again with a slot (see supervisor.h)
+    int slot = supervisor_worker_slot();
+    if (slot < 0 && workers_str != NULL && atoi(workers_str) > 0) {
+        // Every worker, in every generation, must sign with the same key
+        // or a session would only be valid on the worker that issued it
+        char generated_secret[AUTH_SECRET_TEXT_LENGTH + 1];
+        if (getenv("AUTH_TOKEN_SECRET") == NULL) {
+            if (auth_generate_secret(generated_secret, sizeof(generated_secret)) != 0 ||
+                setenv("AUTH_TOKEN_SECRET", generated_secret, 1) != 0) {
+                fprintf(stderr, "Could not generate a token signing key\n");
+                return 1;
+            }
+            fprintf(stderr, "AUTH_TOKEN_SECRET not set; sessions end when the supervisor stops\n");
+        }
+        fprintf(stderr, "Logouts are remembered per worker; a revoked token stays valid on other workers until it expires\n");
+        supervisor_config_t supervisor = { port, atoi(workers_str), argv, 0, drain_timeout };
+        return supervisor_run(&supervisor);
+    }
+    // A single process or worker 0 loads from the database; other
+    // workers serve the snapshots it publishes
+    int primary = slot <= 0;
+
+    // Shutdown signals are for api_server_start, not for any thread
+    api_server_block_signals();
+
+    // Shed load early rather than queue it without bound
+    admission_configure(rate_str ? (unsigned int) atoi(rate_str) : ADMISSION_DEFAULT_RATE,
+                        burst_str ? (unsigned int) atoi(burst_str) : ADMISSION_DEFAULT_BURST,
+                        in_flight_str ? (unsigned int) atoi(in_flight_str) : ADMISSION_DEFAULT_MAX_IN_FLIGHT);
+
+    aggregation_init();
+    valuation_init();
+    district_stats_init();
+    // Alerts are matched by the primary only, so each is raised once
+    if (primary) {
+        saved_search_init();
+    }
+
+    // Password hashing gets its own workers so logins never stall request threads
+    if (auth_init(getenv("AUTH_TOKEN_SECRET"), 0) != 0) {
+        return 1;
+    }
+    if (slot < 0 && getenv("AUTH_TOKEN_SECRET") == NULL) {
+        fprintf(stderr, "AUTH_TOKEN_SECRET not set; sessions end on restart\n");
+    }
+    if (db_pool_init(conn_info ? conn_info : DEFAULT_CONN_INFO,
+                     pool_str ? atoi(pool_str) : DEFAULT_DB_POOL_SIZE) <= 0) {
+        fprintf(stderr, "No pooled database connections; login and registration are unavailable\n");
+    }
+    // Saved property and search changes are written behind, in batches
+    user_writes_start();
+
+    // Serve trends from the last published series file right away
+    static follow_context_t follow;
+    if (file_replaced(store_path, &follow.series_seen) && series_store_open(store_path) == 0) {
+        printf("Series store loaded: %zu series\n", series_store_count());
+    }
+
+    // A single process serves while it catches up; workers only join
+    // the shared sockets once loaded (the others once worker 0's
+    // snapshot is mapped), so a reload never serves cold
+    if (slot < 0 && api_server_init(port) != 0) {
+        return 1;
+    }
+
+    PGconn* conn = db_connect(conn_info ? conn_info : DEFAULT_CONN_INFO);
+    if (primary && conn != NULL) {
+        aggregation_load(conn);
+        prediction_load(conn);
+        properties_refresh(conn);
+        valuation_train(0);
+        district_stats_rebuild(0);
+        // Listings loaded before the searches raise no alerts
+        saved_search_load(conn);
+        comparables_rebuild();
+        aggregation_run(conn, 0);
+        publish_series_store(store_path);
+        prediction_job_run(conn, 0);
+        investment_rebuild();
+        if (slot >= 0) {
+            properties_publish_snapshot(snapshot_path);
+        }
+    } else if (primary) {
+        fprintf(stderr, "Running without a database; serving stored or demo data\n");
+    } else {
+        follow.conn = conn;
+        follow.store_path = store_path;
+        follow.snapshot_path = snapshot_path;
+        // On a first start worker 0 is still loading; wait for what it
+        // publishes rather than report ready with no listings. A reload
+        // finds the previous generation's snapshot at once
+        int mapped = 0;
+        for (int waited = 0; ; waited++) {
+            mapped = file_replaced(snapshot_path, &follow.listings_seen) &&
+                     properties_open_snapshot(snapshot_path) == 0;
+            if (mapped || waited >= SNAPSHOT_WAIT_TIMEOUT) {
+                break;
+            }
+            // Retry a file that could not be mapped, not only new ones
+            memset(&follow.listings_seen, 0, sizeof(follow.listings_seen));
+            sleep(1);
+        }
+        if (mapped) {
+            size_t count = 0;
+            properties_acquire(&count);
+            properties_release();
+            printf("Listing snapshot mapped: %zu listings\n", count);
+        } else {
+            // Worker 0 may have no database; serve, and map a snapshot
+            // once one is published
+            memset(&follow.listings_seen, 0, sizeof(follow.listings_seen));
+            fprintf(stderr, "No listing snapshot after %d seconds; serving without listings\n",
+                    SNAPSHOT_WAIT_TIMEOUT);
+        }
+        if (conn != NULL) {
+            prediction_load(conn);
+        }
+        valuation_train(0);
+        district_stats_rebuild(0);
+        comparables_rebuild();
+        investment_rebuild();
+    }
+
+    // Stream changes from here on; the initial load is not an event
+    event_stream_init();
+
+    if (slot >= 0 && api_server_init_socket(supervisor_listen_socket()) != 0) {
+        return 1;
+    }
+
+    // The refresh (or follow) thread owns the connection from here on
+    static refresh_context_t refresh;
+    pthread_t refresh_tid;
+    refresh.conn = conn;
+    refresh.store_path = store_path;
+    refresh.snapshot_path = slot >= 0 ? snapshot_path : NULL;
+    refresh.interval = interval_str ? (unsigned int) atoi(interval_str) : DEFAULT_REFRESH_INTERVAL;
+    if (primary && conn != NULL && refresh.interval > 0) {
+        if (pthread_create(&refresh_tid, NULL, refresh_thread, &refresh) == 0) {
+            pthread_detach(refresh_tid);
+        }
+    } else if (!primary) {
+        if (pthread_create(&refresh_tid, NULL, follow_thread, &follow) == 0) {
+            pthread_detach(refresh_tid);
+        }
+    }
+
+    supervisor_notify_ready();
+    int rc = api_server_start(drain_timeout * 1000);
+    api_server_stop();
+    user_writes_shutdown();
+    auth_shutdown();
+    db_pool_close();
+    db_disconnect(conn);
+    return rc;
 }
@@ -0,0 +1,102 @@
+#include "include/parallel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+
+typedef struct {
+    size_t count;
+    size_t chunk;
+    atomic_size_t next;
+    parallel_task_func task;
+    void* ctx;
+} parallel_job_t;
+
+typedef struct {
+    parallel_job_t* job;
+    int worker;
+} parallel_worker_t;
+
+int parallel_default_workers(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (int) cpus : 1;
+}
+
+// Claim chunks until the range is exhausted
+static void parallel_drain(parallel_job_t* job, int worker) {
+    for (;;) {
+        size_t begin = atomic_fetch_add_explicit(&job->next, job->chunk, memory_order_relaxed);
+        if (begin >= job->count) {
+            break;
+        }
+        size_t end = begin + job->chunk;
+        if (end > job->count) {
+            end = job->count;
+        }
+        job->task(begin, end, worker, job->ctx);
+    }
+}
+
+static void* parallel_thread_main(void* arg) {
+    parallel_worker_t* w = arg;
+    parallel_drain(w->job, w->worker);
+    return NULL;
+}
+
+int parallel_for(size_t count, size_t chunk, int workers, parallel_task_func task, void* ctx) {
+    if (count == 0) {
+        return 0;
+    }
+    if (workers <= 0) {
+        workers = parallel_default_workers();
+    }
+    if ((size_t) workers > count) {
+        workers = (int) count;
+    }
+    if (chunk == 0) {
+        // Aim for ~8 grabs per worker so stragglers can be balanced out
+        chunk = count / ((size_t) workers * 8);
+        if (chunk == 0) {
+            chunk = 1;
+        }
+    }
+
+    parallel_job_t job = { .count = count, .chunk = chunk, .task = task, .ctx = ctx };
+    atomic_init(&job.next, 0);
+
+    if (workers == 1) {
+        parallel_drain(&job, 0);
+        return 1;
+    }
+
+    pthread_t* threads = malloc(sizeof(pthread_t) * (size_t) workers);
+    parallel_worker_t* args = malloc(sizeof(parallel_worker_t) * (size_t) workers);
+    if (threads == NULL || args == NULL) {
+        free(threads);
+        free(args);
+        return -1;
+    }
+
+    // Worker 0 runs on the calling thread
+    int started = 1;
+    for (int i = 1; i < workers; i++) {
+        args[i].job = &job;
+        args[i].worker = i;
+        if (pthread_create(&threads[i], NULL, parallel_thread_main, &args[i]) != 0) {
+            fprintf(stderr, "parallel_for: failed to start worker %d\n", i);
+            break;
+        }
+        started++;
+    }
+
+    parallel_drain(&job, 0);
+
+    for (int i = 1; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    free(threads);
+    free(args);
+    return started;
+}
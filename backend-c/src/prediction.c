@@ -1,27 +1,72 @@
 #include "include/prediction.h"
 #include "include/db.h"
+#include "include/aggregation.h"
+#include "include/series_store.h"
+#include "include/backtest.h"
+#include "include/parallel.h"
+#include "include/utils.h"
+#include "include/rng.h"
+#include "include/bootstrap.h"
+#include "include/event_stream.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <math.h>
+#include <pthread.h>
 #include <jansson.h>
 
 // Get historical price trends for a specific district and room count
 price_trend_point_t* get_price_trends(int district_id, int room_count, int months, int* out_count) {
-    printf("[STUB] get_price_trends called for district %d, %d rooms, %d months\n", 
-           district_id, room_count, months);
-    
-    // Return dummy data for the visual MVP
+    // Serve from the mmap'd series store, then the in-memory price_history view
+    int history_count = 0;
+    price_history_row_t* history = series_store_get_series(district_id, room_count, months, &history_count);
+    if (history == NULL) {
+        history = aggregation_get_series(district_id, room_count, months, &history_count);
+    }
+    if (history != NULL) {
+        price_trend_point_t* trends = malloc(sizeof(price_trend_point_t) * history_count);
+        if (trends == NULL) {
+            free(history);
+            *out_count = 0;
+            return NULL;
+        }
+
+        for (int i = 0; i < history_count; i++) {
+            struct tm month_tm = {0};
+            month_tm.tm_year = 70 + history[i].month / 12;
+            month_tm.tm_mon = history[i].month % 12;
+            month_tm.tm_mday = 1;
+            month_tm.tm_hour = 12;
+            month_tm.tm_isdst = -1;
+
+            trends[i].date = mktime(&month_tm);
+            trends[i].district_id = district_id;
+            trends[i].room_count = room_count;
+            trends[i].price = history[i].avg_price_per_sqm;
+            trends[i].sample_size = history[i].sample_size;
+        }
+
+        free(history);
+        *out_count = history_count;
+        return trends;
+    }
+
+    // No aggregated history yet: return dummy data for the visual MVP
     *out_count = 12; // 12 months of data
     price_trend_point_t* trends = malloc(sizeof(price_trend_point_t) * (*out_count));
     
     time_t now = time(NULL);
-    struct tm* current_tm = localtime(&now);
+    struct tm current;
+    struct tm* current_tm = localtime_r(&now, &current);
     
     // Start 12 months ago
     current_tm->tm_year -= 1;
     
+    // Per-series generator: deterministic and safe to call from any thread
+    rng_t rng;
+    rng_seed(&rng, rng_seed_for(0, district_id, room_count));
+    
     for (int i = 0; i < *out_count; i++) {
         // Move forward one month for each data point
         current_tm->tm_mon += 1;
@@ -49,7 +94,7 @@ price_trend_point_t* get_price_trends(int district_id, int room_count, int month
         
         // Add a small upward trend (about 5-7% annual growth)
         trends[i].price = base_price * (1.0 + (0.005 * i));
-        trends[i].sample_size = 30 + (rand() % 20); // Random sample size between 30-50
+        trends[i].sample_size = 30 + (int) rng_below(&rng, 20); // Random sample size between 30-50
     }
     
     return trends;
@@ -57,11 +102,13 @@ price_trend_point_t* get_price_trends(int district_id, int room_count, int month
 
 // Get price prediction for a specific district and room count
 price_prediction_t predict_prices(int district_id, int room_count) {
-    printf("[STUB] predict_prices called for district %d, %d rooms\n", 
-           district_id, room_count);
-    
     price_prediction_t prediction;
     
+    // Serve the prediction published by the last job run
+    if (prediction_lookup(district_id, room_count, &prediction) == 0) {
+        return prediction;
+    }
+    
     // Get the current average price based on district and room count
     double current_price = 0.0;
     if (district_id == 1) { // Botanica
@@ -79,97 +126,434 @@ price_prediction_t predict_prices(int district_id, int room_count) {
     prediction.prediction_12m = current_price * 1.07;  // 7% increase in 12 months
     prediction.confidence = 0.85; // 85% confidence
     prediction.prediction_date = time(NULL); // Current date
+    prediction.algorithm = "demo";
+    memset(&prediction.band_6m, 0, sizeof(prediction.band_6m));
+    memset(&prediction.band_12m, 0, sizeof(prediction.band_12m));
     
     return prediction;
 }
 
+// Published predictions, sorted by (district, rooms) for binary search
+typedef struct {
+    int district_id;
+    int room_count;
+    price_prediction_t prediction;
+} series_prediction_t;
+
+static pthread_rwlock_t lookup_lock = PTHREAD_RWLOCK_INITIALIZER;
+static series_prediction_t* lookup_table = NULL;
+static size_t lookup_count = 0;
+
+// Replace the lookup table; takes ownership of `table`
+static void prediction_publish(series_prediction_t* table, size_t count) {
+    pthread_rwlock_wrlock(&lookup_lock);
+    series_prediction_t* old = lookup_table;
+    lookup_table = table;
+    lookup_count = count;
+    pthread_rwlock_unlock(&lookup_lock);
+    free(old);
+}
+
+int prediction_lookup(int district_id, int room_count, price_prediction_t* out) {
+    int rc = 1;
+    pthread_rwlock_rdlock(&lookup_lock);
+    size_t lo = 0, hi = lookup_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const series_prediction_t* e = &lookup_table[mid];
+        if (e->district_id < district_id || (e->district_id == district_id && e->room_count < room_count)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo < lookup_count && lookup_table[lo].district_id == district_id && lookup_table[lo].room_count == room_count) {
+        *out = lookup_table[lo].prediction;
+        rc = 0;
+    }
+    pthread_rwlock_unlock(&lookup_lock);
+    return rc;
+}
+
+// Forecast of one model for one series, as produced by the job
+typedef struct {
+    int valid;
+    double prediction_6m;
+    double prediction_12m;
+    double confidence;
+    double backtest_mape;
+    int has_bands;             // Bands are only computed for the best model
+    price_band_t band_6m;
+    price_band_t band_12m;
+} model_forecast_t;
+
+typedef struct {
+    const backtest_series_t* series;
+    const forecast_model_t* models;
+    int model_count;
+    model_forecast_t* forecasts;   // series x models
+    int* best;                     // Best model per series (-1 if none)
+} prediction_job_t;
+
+// Base seed of the bootstrap generators; each series derives its own
+// stream from it, so bands do not depend on thread scheduling
+#define PREDICTION_BOOTSTRAP_SEED 0x6d6f6c646f7661ull
+
+// Fit and score every model on one series, then bootstrap the best one
+static void prediction_job_task(size_t begin, size_t end, int worker, void* ctx) {
+    (void) worker;
+    prediction_job_t* job = ctx;
+
+    double* filled = NULL;
+    int filled_capacity = 0;
+    for (size_t i = begin; i < end; i++) {
+        const backtest_series_t* s = &job->series[i];
+        model_forecast_t* forecasts = &job->forecasts[i * (size_t) job->model_count];
+        int best = -1;
+        job->best[i] = -1;
+        for (int m = 0; m < job->model_count; m++) {
+            memset(&forecasts[m], 0, sizeof(forecasts[m]));
+        }
+
+        // Fit on consecutive months, as the backtest that scores the
+        // models does (see forecast_fill_gaps)
+        int count = forecast_fill_gaps(s->months, s->prices, s->count, NULL);
+        if (count == 0) {
+            continue;
+        }
+        if (count > filled_capacity) {
+            double* grown = realloc(filled, sizeof(double) * (size_t) count);
+            if (grown == NULL) {
+                continue;
+            }
+            filled = grown;
+            filled_capacity = count;
+        }
+        forecast_fill_gaps(s->months, s->prices, s->count, filled);
+        int base_month = s->months[s->count - 1] % FORECAST_SEASON_LENGTH;
+
+        for (int m = 0; m < job->model_count; m++) {
+            const forecast_model_t* model = &job->models[m];
+            model_forecast_t* out = &forecasts[m];
+
+            forecast_fit_t fit;
+            if (count < model->min_points || model->fit(filled, count, base_month, &fit) != 0) {
+                continue;
+            }
+
+            backtest_config_t config = backtest_default_config(6);
+            config.model = model;
+            backtest_result_t score;
+            backtest_evaluate(s, &config, &score);
+
+            out->valid = 1;
+            out->prediction_6m = model->forecast(&fit, 6, NULL);
+            out->prediction_12m = model->forecast(&fit, 12, NULL);
+            // Share of historical forecasts that landed inside the interval
+            out->confidence = score.forecasts > 0 ? score.coverage : 0.5;
+            out->backtest_mape = score.forecasts > 0 ? score.mape : INFINITY;
+
+            // Lowest backtest MAPE wins; the first registered model wins
+            // ties and series too short to backtest
+            if (best < 0 || out->backtest_mape < forecasts[best].backtest_mape) {
+                best = m;
+            }
+        }
+
+        job->best[i] = best;
+        if (best < 0) {
+            continue;
+        }
+
+        static const int horizons[2] = { 6, 12 };
+        price_band_t bands[2];
+        rng_t rng;
+        rng_seed(&rng, rng_seed_for(PREDICTION_BOOTSTRAP_SEED, s->district_id, s->room_count));
+        if (forecast_bootstrap(&job->models[best], filled, count, base_month, horizons, 2,
+                               BOOTSTRAP_DEFAULT_RESAMPLES, &rng, bands) == 0) {
+            forecasts[best].has_bands = 1;
+            forecasts[best].band_6m = bands[0];
+            forecasts[best].band_12m = bands[1];
+        }
+    }
+    free(filled);
+}
+
+// Write every model's forecasts for every series to price_predictions
+static int prediction_persist(PGconn* conn, const prediction_job_t* job, size_t series_count) {
+    static const char* sql =
+        "INSERT INTO price_predictions (district_id, room_count, prediction_date, predicted_price_per_sqm, "
+        "confidence_level, algorithm, backtest_mape, predicted_p10, predicted_p50, predicted_p90) "
+        "SELECT * FROM unnest($1::int[], $2::int[], $3::date[], $4::int[], $5::numeric[], $6::text[], "
+        "$7::numeric[], $8::int[], $9::int[], $10::int[]) "
+        "ON CONFLICT (district_id, room_count, prediction_date, algorithm) DO UPDATE SET "
+        "predicted_price_per_sqm = EXCLUDED.predicted_price_per_sqm, "
+        "confidence_level = EXCLUDED.confidence_level, backtest_mape = EXCLUDED.backtest_mape, "
+        "predicted_p10 = EXCLUDED.predicted_p10, predicted_p50 = EXCLUDED.predicted_p50, "
+        "predicted_p90 = EXCLUDED.predicted_p90, created_at = CURRENT_TIMESTAMP";
+
+    enum { COLUMNS = 10 };
+    string_buffer_t columns[COLUMNS];
+    for (int c = 0; c < COLUMNS; c++) {
+        string_buffer_init(&columns[c]);
+        string_buffer_append(&columns[c], "{", 1);
+    }
+
+    int rows = 0;
+    char date_str[16];
+    for (size_t i = 0; i < series_count; i++) {
+        const backtest_series_t* s = &job->series[i];
+        if (s->district_id <= 0) {
+            continue;
+        }
+        for (int m = 0; m < job->model_count; m++) {
+            const model_forecast_t* f = &job->forecasts[i * (size_t) job->model_count + (size_t) m];
+            if (!f->valid) {
+                continue;
+            }
+            for (int h = 6; h <= 12; h += 6) {
+                const char* sep = rows > 0 ? "," : "";
+                const price_band_t* band = h == 6 ? &f->band_6m : &f->band_12m;
+                month_index_to_date(s->months[s->count - 1] + h, date_str, sizeof(date_str));
+                string_buffer_appendf(&columns[0], "%s%d", sep, s->district_id);
+                string_buffer_appendf(&columns[1], "%s%d", sep, s->room_count);
+                string_buffer_appendf(&columns[2], "%s%s", sep, date_str);
+                string_buffer_appendf(&columns[3], "%s%ld", sep, lround(h == 6 ? f->prediction_6m : f->prediction_12m));
+                string_buffer_appendf(&columns[4], "%s%.2f", sep, f->confidence * 100.0);
+                string_buffer_appendf(&columns[5], "%s%s", sep, job->models[m].name);
+                if (isfinite(f->backtest_mape)) {
+                    string_buffer_appendf(&columns[6], "%s%.3f", sep, f->backtest_mape);
+                } else {
+                    string_buffer_appendf(&columns[6], "%sNULL", sep);
+                }
+                if (f->has_bands) {
+                    string_buffer_appendf(&columns[7], "%s%ld", sep, lround(band->p10));
+                    string_buffer_appendf(&columns[8], "%s%ld", sep, lround(band->p50));
+                    string_buffer_appendf(&columns[9], "%s%ld", sep, lround(band->p90));
+                } else {
+                    for (int c = 7; c < COLUMNS; c++) {
+                        string_buffer_appendf(&columns[c], "%sNULL", sep);
+                    }
+                }
+                rows++;
+            }
+        }
+    }
+
+    const char* params[COLUMNS];
+    for (int c = 0; c < COLUMNS; c++) {
+        string_buffer_append(&columns[c], "}", 1);
+        params[c] = columns[c].data;
+    }
+
+    int rc = rows > 0 ? db_exec_params(conn, sql, COLUMNS, params) : 0;
+
+    for (int c = 0; c < COLUMNS; c++) {
+        string_buffer_free(&columns[c]);
+    }
+    return rc;
+}
+
+int prediction_job_run(PGconn* conn, int workers) {
+    size_t series_count = 0;
+    backtest_series_t* series = backtest_load_store(&series_count);
+    if (series_count == 0) {
+        return 0;
+    }
+
+    prediction_job_t job;
+    job.series = series;
+    job.models = forecast_models(&job.model_count);
+    job.forecasts = calloc(series_count * (size_t) job.model_count, sizeof(model_forecast_t));
+    job.best = malloc(sizeof(int) * series_count);
+    series_prediction_t* table = calloc(series_count, sizeof(series_prediction_t));
+    if (job.forecasts == NULL || job.best == NULL || table == NULL) {
+        free(job.forecasts);
+        free(job.best);
+        free(table);
+        backtest_free_series(series, series_count);
+        return -1;
+    }
+
+    // Without the workers job.best was never filled in
+    if (parallel_for(series_count, 1, workers, prediction_job_task, &job) < 0) {
+        free(job.forecasts);
+        free(job.best);
+        free(table);
+        backtest_free_series(series, series_count);
+        return -1;
+    }
+
+    time_t now = time(NULL);
+    size_t published = 0;
+    for (size_t i = 0; i < series_count; i++) {
+        int best = job.best[i];
+        if (best < 0) {
+            continue;
+        }
+        const model_forecast_t* forecast = &job.forecasts[i * (size_t) job.model_count + (size_t) best];
+
+        series_prediction_t* entry = &table[published++];
+        entry->district_id = series[i].district_id;
+        entry->room_count = series[i].room_count;
+        entry->prediction.current_avg_price = series[i].prices[series[i].count - 1];
+        entry->prediction.prediction_6m = forecast->prediction_6m;
+        entry->prediction.prediction_12m = forecast->prediction_12m;
+        entry->prediction.confidence = forecast->confidence;
+        entry->prediction.prediction_date = now;
+        entry->prediction.algorithm = job.models[best].name;
+        entry->prediction.band_6m = forecast->band_6m;
+        entry->prediction.band_12m = forecast->band_12m;
+    }
+
+    int rc = 0;
+    if (conn != NULL) {
+        rc = prediction_persist(conn, &job, series_count);
+    }
+    // Tell stream subscribers about every series whose forecast moved
+    for (size_t i = 0; i < published; i++) {
+        price_prediction_t old;
+        const series_prediction_t* entry = &table[i];
+        if (prediction_lookup(entry->district_id, entry->room_count, &old) != 0 ||
+            lround(old.prediction_6m) != lround(entry->prediction.prediction_6m) ||
+            lround(old.prediction_12m) != lround(entry->prediction.prediction_12m)) {
+            event_stream_publish_prediction(entry->district_id, entry->room_count, &entry->prediction);
+        }
+    }
+    prediction_publish(table, published);
+
+    free(job.forecasts);
+    free(job.best);
+    backtest_free_series(series, series_count);
+
+    if (rc != 0) {
+        return -1;
+    }
+    printf("Prediction job published %zu series\n", published);
+    return (int) published;
+}
+
+int prediction_load(PGconn* conn) {
+    // Only the latest run of each series counts: a job run writes every
+    // model's two horizons in one statement, so its rows share one
+    // created_at. A model's 6-month row is its earliest target date in
+    // the run; horizons are taken from that, not from row order.
+    static const char* sql =
+        "WITH latest AS ("
+        "  SELECT district_id, room_count, max(created_at) AS created_at "
+        "  FROM price_predictions GROUP BY district_id, room_count"
+        "), run AS ("
+        "  SELECT p.*, 6 + (extract(year FROM age(p.prediction_date, min(p.prediction_date) OVER w)) * 12 + "
+        "  extract(month FROM age(p.prediction_date, min(p.prediction_date) OVER w)))::int AS horizon "
+        "  FROM price_predictions p JOIN latest l USING (district_id, room_count, created_at) "
+        "  WINDOW w AS (PARTITION BY p.district_id, p.room_count, p.algorithm)"
+        "), best AS ("
+        "  SELECT DISTINCT ON (district_id, room_count) district_id, room_count, algorithm "
+        "  FROM run ORDER BY district_id, room_count, backtest_mape NULLS LAST, algorithm"
+        ") "
+        "SELECT r.district_id, r.room_count, r.algorithm, r.predicted_price_per_sqm, "
+        "COALESCE(r.confidence_level, 0), extract(epoch FROM r.created_at)::bigint, "
+        "COALESCE(r.predicted_p10, 0), COALESCE(r.predicted_p50, 0), COALESCE(r.predicted_p90, 0), r.horizon "
+        "FROM run r JOIN best b USING (district_id, room_count, algorithm) "
+        "WHERE r.horizon IN (6, 12) "
+        "ORDER BY r.district_id, r.room_count, r.horizon";
+
+    PGresult* res = db_query_params(conn, sql, 0, NULL);
+    if (res == NULL) {
+        return -1;
+    }
+
+    int n = PQntuples(res);
+    series_prediction_t* table = calloc((size_t) (n > 0 ? n : 1), sizeof(series_prediction_t));
+    if (table == NULL) {
+        PQclear(res);
+        return -1;
+    }
+
+    // Rows come grouped by series; each fills the horizon it is for
+    size_t count = 0;
+    for (int i = 0; i < n; i++) {
+        int district_id = atoi(PQgetvalue(res, i, 0));
+        int room_count = atoi(PQgetvalue(res, i, 1));
+        double price = atof(PQgetvalue(res, i, 3));
+        int horizon = atoi(PQgetvalue(res, i, 9));
+        price_band_t band = {
+            .p10 = atof(PQgetvalue(res, i, 6)),
+            .p50 = atof(PQgetvalue(res, i, 7)),
+            .p90 = atof(PQgetvalue(res, i, 8))
+        };
+
+        if (count == 0 || table[count - 1].district_id != district_id || table[count - 1].room_count != room_count) {
+            series_prediction_t* entry = &table[count++];
+            const forecast_model_t* model = forecast_model_find(PQgetvalue(res, i, 2));
+            entry->district_id = district_id;
+            entry->room_count = room_count;
+            entry->prediction.confidence = atof(PQgetvalue(res, i, 4)) / 100.0;
+            entry->prediction.prediction_date = (time_t) atoll(PQgetvalue(res, i, 5));
+            entry->prediction.algorithm = model ? model->name : forecast_models(NULL)[0].name;
+
+            int points = 0;
+            price_history_row_t* latest = series_store_get_series(district_id, room_count, 1, &points);
+            entry->prediction.current_avg_price = latest ? latest[0].avg_price_per_sqm : price;
+            free(latest);
+        }
+        series_prediction_t* entry = &table[count - 1];
+        if (horizon == 6) {
+            entry->prediction.prediction_6m = price;
+            entry->prediction.band_6m = band;
+        } else {
+            entry->prediction.prediction_12m = price;
+            entry->prediction.band_12m = band;
+        }
+    }
+    PQclear(res);
+
+    prediction_publish(table, count);
+    return (int) count;
+}
+
 // Generate prediction based on linear regression
 double linear_regression_predict(price_trend_point_t* data, int count, int months_ahead) {
-    printf("[Implementation] linear_regression_predict called for %d data points, %d months ahead\n", 
-           count, months_ahead);
-    
     if (count < 2) {
         return 0.0; // Not enough data points
     }
     
-    // Simple linear regression implementation
-    // y = a + bx where:
-    // b = sum((x_i - x_mean)(y_i - y_mean)) / sum((x_i - x_mean)^2)
-    // a = y_mean - b * x_mean
-    
-    // Calculate x_mean and y_mean
-    double x_sum = 0.0;
-    double y_sum = 0.0;
-    
-    for (int i = 0; i < count; i++) {
-        x_sum += i;
-        y_sum += data[i].price;
+    double* prices = malloc(sizeof(double) * count);
+    if (prices == NULL) {
+        return data[count-1].price;
     }
-    
-    double x_mean = x_sum / count;
-    double y_mean = y_sum / count;
-    
-    // Calculate b (slope)
-    double numerator = 0.0;
-    double denominator = 0.0;
-    
     for (int i = 0; i < count; i++) {
-        double x_diff = i - x_mean;
-        double y_diff = data[i].price - y_mean;
-        
-        numerator += x_diff * y_diff;
-        denominator += x_diff * x_diff;
+        prices[i] = data[i].price;
     }
     
-    // Avoid division by zero
-    double slope = (denominator != 0.0) ? numerator / denominator : 0.0;
-    
-    // Calculate a (intercept)
-    double intercept = y_mean - slope * x_mean;
-    
-    // Predict price for months_ahead
-    double predicted_price = intercept + slope * (count - 1 + months_ahead);
-    
-    // Apply seasonal adjustment (simplified)
-    double seasonal_factor = 1.0;
-    
-    // Determine current month
+    // Seasonality is relative to the current month
     time_t now = time(NULL);
-    struct tm* current_tm = localtime(&now);
-    int current_month = current_tm->tm_mon;
-    
-    // Predict month (current + months_ahead)
-    int target_month = (current_month + months_ahead) % 12;
+    struct tm current_tm;
+    localtime_r(&now, &current_tm);
     
-    // Apply seasonal factors
-    // Q1 (winter): slightly lower prices
-    if (target_month >= 0 && target_month < 3) {
-        seasonal_factor = 0.98;
-    }
-    // Q2 (spring): higher activity, higher prices
-    else if (target_month >= 3 && target_month < 6) {
-        seasonal_factor = 1.03;
-    }
-    // Q3 (summer): stable to slight increase
-    else if (target_month >= 6 && target_month < 9) {
-        seasonal_factor = 1.01;
+    double predicted_price = linear_regression_forecast(prices, count, current_tm.tm_mon, months_ahead, NULL);
+    free(prices);
+    return predicted_price;
+}
+
+// Linear regression forecast on a plain price array
+double linear_regression_forecast(const double* prices, int count, int base_month, int months_ahead,
+                                  double* out_std_error) {
+    if (out_std_error != NULL) {
+        *out_std_error = 0.0;
     }
-    // Q4 (fall): slightly lower activity
-    else {
-        seasonal_factor = 0.99;
+    if (count < 2) {
+        return count == 1 ? prices[0] : 0.0;
     }
     
-    // Apply seasonal adjustment
-    predicted_price *= seasonal_factor;
-    
-    // Ensure prediction is positive
-    return (predicted_price > 0) ? predicted_price : data[count-1].price;
+    const forecast_model_t* linear = forecast_model_find("linear_regression");
+    forecast_fit_t fit;
+    linear->fit(prices, count, base_month, &fit);
+    return linear->forecast(&fit, months_ahead, out_std_error);
 }
 
 // Calculate confidence level for the prediction
 double calculate_prediction_confidence(price_trend_point_t* data, int count) {
-    printf("[Implementation] calculate_prediction_confidence called for %d data points\n", count);
-    
     // This calculates confidence based on:
     // 1. Amount of data available (more data = higher confidence)
     // 2. Consistency of trends (lower variance = higher confidence)
@@ -240,41 +624,45 @@ double calculate_prediction_confidence(price_trend_point_t* data, int count) {
 
 // Handler for trend API endpoint
 json_t* price_get_trends_handler(int district_id, int room_count, int months) {
-    printf("[STUB] price_get_trends_handler called for district %d, %d rooms, %d months\n", 
-           district_id, room_count, months);
-    
     int count = 0;
     price_trend_point_t* trends = get_price_trends(district_id, room_count, months, &count);
     
-    json_t* json_array = json_array();
+    json_t* points = json_array();
     
     for (int i = 0; i < count; i++) {
         char date_str[11]; // YYYY-MM-DD format
-        struct tm* tm_info = localtime(&trends[i].date);
-        strftime(date_str, sizeof(date_str), "%Y-%m-%d", tm_info);
+        struct tm tm_info;
+        localtime_r(&trends[i].date, &tm_info);
+        strftime(date_str, sizeof(date_str), "%Y-%m-%d", &tm_info);
         
         json_t* point = json_object();
         json_object_set_new(point, "date", json_string(date_str));
         json_object_set_new(point, "price", json_real(trends[i].price));
         json_object_set_new(point, "sample_size", json_integer(trends[i].sample_size));
         
-        json_array_append_new(json_array, point);
+        json_array_append_new(points, point);
     }
     
     free(trends);
-    return json_array;
+    return points;
+}
+
+static json_t* price_band_to_json(const price_band_t* band) {
+    json_t* obj = json_object();
+    json_object_set_new(obj, "p10", json_real(band->p10));
+    json_object_set_new(obj, "p50", json_real(band->p50));
+    json_object_set_new(obj, "p90", json_real(band->p90));
+    return obj;
 }
 
 // Handler for prediction API endpoint
 json_t* price_get_predictions_handler(int district_id, int room_count) {
-    printf("[STUB] price_get_predictions_handler called for district %d, %d rooms\n", 
-           district_id, room_count);
-    
     price_prediction_t prediction = predict_prices(district_id, room_count);
     
     char date_str[11]; // YYYY-MM-DD format
-    struct tm* tm_info = localtime(&prediction.prediction_date);
-    strftime(date_str, sizeof(date_str), "%Y-%m-%d", tm_info);
+    struct tm tm_info;
+    localtime_r(&prediction.prediction_date, &tm_info);
+    strftime(date_str, sizeof(date_str), "%Y-%m-%d", &tm_info);
     
     json_t* json_obj = json_object();
     json_object_set_new(json_obj, "current_avg_price", json_real(prediction.current_avg_price));
@@ -282,6 +670,15 @@ json_t* price_get_predictions_handler(int district_id, int room_count) {
     json_object_set_new(json_obj, "prediction_12m", json_real(prediction.prediction_12m));
     json_object_set_new(json_obj, "confidence", json_real(prediction.confidence));
     json_object_set_new(json_obj, "prediction_date", json_string(date_str));
+    json_object_set_new(json_obj, "algorithm", json_string(prediction.algorithm));
+    
+    // Bootstrap bands, when the prediction job produced them
+    if (prediction.band_6m.p50 > 0.0 && prediction.band_12m.p50 > 0.0) {
+        json_t* bands = json_object();
+        json_object_set_new(bands, "6m", price_band_to_json(&prediction.band_6m));
+        json_object_set_new(bands, "12m", price_band_to_json(&prediction.band_12m));
+        json_object_set_new(json_obj, "bands", bands);
+    }
     
     return json_obj;
 }
@@ -1,5 +1,705 @@
 #include "include/properties.h"
+#include "include/db.h"
+#include "include/utils.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <libgen.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define MAX_INGEST_HOOKS 16
+
+typedef struct {
+    property_ingest_hook hook;
+    void* ctx;
+} ingest_hook_entry_t;
+
+// In-memory listing store. `slots` maps property id -> index in `rows`
+// using open addressing (0 marks an empty slot; ids are SERIAL, so > 0).
+static pthread_rwlock_t store_lock = PTHREAD_RWLOCK_INITIALIZER;
+static property_t* rows = NULL;
+static size_t row_count = 0;
+static size_t row_capacity = 0;
+static int* slot_ids = NULL;
+static size_t* slot_index = NULL;
+static size_t slot_capacity = 0;
+
+// Mapped snapshot backing `rows` (see properties_open_snapshot). Its rows
+// are sorted by id and found by binary search, so there are no slots.
+static void* snapshot_base = NULL;
+static size_t snapshot_size = 0;
+
+// Serializes writers (ingest, snapshot swaps), so the rows a swap
+// compares stay mapped while its hooks run
+static pthread_mutex_t writer_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char SNAPSHOT_MAGIC[4] = { 'M', 'I', 'L', 'S' };
+#define SNAPSHOT_FORMAT_VERSION 1
+
+typedef struct {
+    char magic[4];
+    uint32_t format_version;
+    uint32_t record_size;      // sizeof(property_t) of the writer
+    uint32_t reserved;
+    uint64_t count;
+    uint64_t data_version;     // Wall clock ns at publication
+} snapshot_header_t;
+
+_Static_assert(sizeof(snapshot_header_t) == 32, "snapshot header must be 32 bytes");
+
+static pthread_mutex_t hooks_lock = PTHREAD_MUTEX_INITIALIZER;
+static ingest_hook_entry_t hooks[MAX_INGEST_HOOKS];
+static int hook_count = 0;
+
+// High-water mark for incremental refresh (epoch seconds of updated_at)
+static char refresh_watermark[64] = "0";
+
 void get_properties_json() {
     printf("[STUB] get_properties_json called.\n");
 }
+
+property_status_t property_status_from_string(const char* status) {
+    if (status != NULL && strcmp(status, "sold") == 0) {
+        return PROPERTY_STATUS_SOLD;
+    }
+    if (status != NULL && strcmp(status, "pending") == 0) {
+        return PROPERTY_STATUS_PENDING;
+    }
+    return PROPERTY_STATUS_ACTIVE;
+}
+
+const char* property_status_to_string(property_status_t status) {
+    switch (status) {
+        case PROPERTY_STATUS_SOLD: return "sold";
+        case PROPERTY_STATUS_PENDING: return "pending";
+        default: return "active";
+    }
+}
+
+int properties_register_ingest_hook(property_ingest_hook hook, void* ctx) {
+    pthread_mutex_lock(&hooks_lock);
+    if (hook_count >= MAX_INGEST_HOOKS) {
+        pthread_mutex_unlock(&hooks_lock);
+        return 1;
+    }
+    hooks[hook_count].hook = hook;
+    hooks[hook_count].ctx = ctx;
+    hook_count++;
+    pthread_mutex_unlock(&hooks_lock);
+    return 0;
+}
+
+static size_t slot_hash(int id, size_t capacity) {
+    // Fibonacci hashing; capacity is a power of two
+    return (size_t) (((unsigned int) id * 2654435769u)) & (capacity - 1);
+}
+
+// Returns the slot for `id`: either the slot holding it or the empty slot
+// where it would be inserted. Caller holds the write lock or read lock.
+static size_t slot_find(int id) {
+    size_t slot = slot_hash(id, slot_capacity);
+    while (slot_ids[slot] != 0 && slot_ids[slot] != id) {
+        slot = (slot + 1) & (slot_capacity - 1);
+    }
+    return slot;
+}
+
+static int slots_grow(size_t min_rows) {
+    size_t capacity = slot_capacity ? slot_capacity : 1024;
+    while (capacity < min_rows * 2) {
+        capacity *= 2;
+    }
+    if (capacity == slot_capacity) {
+        return 0;
+    }
+
+    int* new_ids = calloc(capacity, sizeof(int));
+    size_t* new_index = malloc(capacity * sizeof(size_t));
+    if (new_ids == NULL || new_index == NULL) {
+        free(new_ids);
+        free(new_index);
+        return 1;
+    }
+
+    free(slot_ids);
+    free(slot_index);
+    slot_ids = new_ids;
+    slot_index = new_index;
+    slot_capacity = capacity;
+
+    for (size_t i = 0; i < row_count; i++) {
+        size_t slot = slot_find(rows[i].id);
+        slot_ids[slot] = rows[i].id;
+        slot_index[slot] = i;
+    }
+    return 0;
+}
+
+// Copy mapped listings to memory so they can be changed. Caller holds
+// the write lock.
+static int detach_snapshot(void) {
+    if (snapshot_base == NULL) {
+        return 0;
+    }
+    size_t capacity = 1024;
+    while (capacity < row_count) {
+        capacity *= 2;
+    }
+    property_t* copy = malloc(sizeof(property_t) * capacity);
+    if (copy == NULL) {
+        return 1;
+    }
+    memcpy(copy, rows, sizeof(property_t) * row_count);
+    munmap(snapshot_base, snapshot_size);
+    snapshot_base = NULL;
+    snapshot_size = 0;
+    rows = copy;
+    row_capacity = capacity;
+    return slots_grow(row_count);
+}
+
+static int copy_hooks(ingest_hook_entry_t* out) {
+    pthread_mutex_lock(&hooks_lock);
+    int active_hooks = hook_count;
+    memcpy(out, hooks, sizeof(ingest_hook_entry_t) * (size_t) active_hooks);
+    pthread_mutex_unlock(&hooks_lock);
+    return active_hooks;
+}
+
+int properties_ingest(const property_t* incoming, size_t count) {
+    if (count == 0) {
+        return 0;
+    }
+
+    // Changes are collected so hooks can run without holding the store lock
+    property_t* previous = malloc(sizeof(property_t) * count);
+    int* is_update = malloc(sizeof(int) * count);
+    if (previous == NULL || is_update == NULL) {
+        free(previous);
+        free(is_update);
+        return 1;
+    }
+
+    pthread_mutex_lock(&writer_lock);
+    pthread_rwlock_wrlock(&store_lock);
+    if (detach_snapshot() != 0) {
+        pthread_rwlock_unlock(&store_lock);
+        pthread_mutex_unlock(&writer_lock);
+        free(previous);
+        free(is_update);
+        return 1;
+    }
+
+    if (row_count + count > row_capacity) {
+        size_t capacity = row_capacity ? row_capacity : 1024;
+        while (capacity < row_count + count) {
+            capacity *= 2;
+        }
+        property_t* grown = realloc(rows, sizeof(property_t) * capacity);
+        if (grown == NULL) {
+            pthread_rwlock_unlock(&store_lock);
+            pthread_mutex_unlock(&writer_lock);
+            free(previous);
+            free(is_update);
+            return 1;
+        }
+        rows = grown;
+        row_capacity = capacity;
+    }
+    if (slots_grow(row_count + count) != 0) {
+        pthread_rwlock_unlock(&store_lock);
+        pthread_mutex_unlock(&writer_lock);
+        free(previous);
+        free(is_update);
+        return 1;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        size_t slot = slot_find(incoming[i].id);
+        if (slot_ids[slot] == incoming[i].id) {
+            previous[i] = rows[slot_index[slot]];
+            is_update[i] = 1;
+            rows[slot_index[slot]] = incoming[i];
+        } else {
+            is_update[i] = 0;
+            slot_ids[slot] = incoming[i].id;
+            slot_index[slot] = row_count;
+            rows[row_count++] = incoming[i];
+        }
+    }
+
+    pthread_rwlock_unlock(&store_lock);
+
+    ingest_hook_entry_t hook_copy[MAX_INGEST_HOOKS];
+    int active_hooks = copy_hooks(hook_copy);
+    for (size_t i = 0; i < count; i++) {
+        for (int h = 0; h < active_hooks; h++) {
+            hook_copy[h].hook(is_update[i] ? &previous[i] : NULL, &incoming[i], hook_copy[h].ctx);
+        }
+    }
+    pthread_mutex_unlock(&writer_lock);
+
+    free(previous);
+    free(is_update);
+    return 0;
+}
+
+// Fields compared field by field: struct padding is not meaningful
+static int properties_equal(const property_t* a, const property_t* b) {
+    return a->id == b->id && a->district_id == b->district_id && a->type_id == b->type_id &&
+           a->num_rooms == b->num_rooms && a->area_sqm == b->area_sqm && a->price == b->price &&
+           a->floor == b->floor && a->total_floors == b->total_floors && a->year_built == b->year_built &&
+           a->month_listed == b->month_listed && a->status == b->status && a->latitude == b->latitude &&
+           a->longitude == b->longitude && a->features == b->features;
+}
+
+int properties_refresh(PGconn* conn) {
+    static const char* sql =
+        "SELECT id, district_id, COALESCE(type_id, 0), num_rooms, area_sqm, price, "
+        "COALESCE(floor, 0), COALESCE(total_floors, 0), COALESCE(year_built, 0), "
+        "to_char(date_listed, 'YYYY-MM-DD'), status, "
+        "COALESCE(coordinates[0], 0), COALESCE(coordinates[1], 0), "
+        "extract(epoch FROM updated_at), "
+        "COALESCE((SELECT bit_or(1::bigint << (f.feature_id - 1)) FROM property_to_features f "
+        "          WHERE f.property_id = properties.id AND f.feature_id BETWEEN 1 AND 64), 0) "
+        "FROM properties WHERE extract(epoch FROM updated_at) >= $1::double precision - $2::double precision "
+        "ORDER BY updated_at";
+
+    // updated_at is set when a transaction starts, so a row can commit
+    // after rows stamped later than it; look back over the overlap and
+    // drop the rows already ingested unchanged
+    char overlap[16];
+    snprintf(overlap, sizeof(overlap), "%d", strcmp(refresh_watermark, "0") == 0 ? 0 : PROPERTIES_REFRESH_OVERLAP);
+    const char* params[2] = { refresh_watermark, overlap };
+    PGresult* res = db_query_params(conn, sql, 2, params);
+    if (res == NULL) {
+        return -1;
+    }
+
+    int n = PQntuples(res);
+    if (n == 0) {
+        PQclear(res);
+        return 0;
+    }
+
+    property_t* batch = malloc(sizeof(property_t) * (size_t) n);
+    if (batch == NULL) {
+        PQclear(res);
+        return -1;
+    }
+
+    int changed = 0;
+    for (int i = 0; i < n; i++) {
+        property_t* p = &batch[changed];
+        p->id = atoi(PQgetvalue(res, i, 0));
+        p->district_id = atoi(PQgetvalue(res, i, 1));
+        p->type_id = atoi(PQgetvalue(res, i, 2));
+        p->num_rooms = atoi(PQgetvalue(res, i, 3));
+        p->area_sqm = atoi(PQgetvalue(res, i, 4));
+        p->price = atoi(PQgetvalue(res, i, 5));
+        p->floor = atoi(PQgetvalue(res, i, 6));
+        p->total_floors = atoi(PQgetvalue(res, i, 7));
+        p->year_built = atoi(PQgetvalue(res, i, 8));
+        p->month_listed = month_index_from_date(PQgetvalue(res, i, 9));
+        p->status = property_status_from_string(PQgetvalue(res, i, 10));
+        p->latitude = atof(PQgetvalue(res, i, 11));
+        p->longitude = atof(PQgetvalue(res, i, 12));
+        p->features = (uint64_t) strtoll(PQgetvalue(res, i, 14), NULL, 10);
+
+        property_t stored;
+        if (properties_find(p->id, &stored) != 0 || !properties_equal(&stored, p)) {
+            changed++;
+        }
+    }
+
+    snprintf(refresh_watermark, sizeof(refresh_watermark), "%s", PQgetvalue(res, n - 1, 13));
+    PQclear(res);
+
+    int rc = changed > 0 ? properties_ingest(batch, (size_t) changed) : 0;
+    free(batch);
+    return rc == 0 ? changed : -1;
+}
+
+const property_t* properties_acquire(size_t* out_count) {
+    pthread_rwlock_rdlock(&store_lock);
+    *out_count = row_count;
+    return rows;
+}
+
+void properties_release(void) {
+    pthread_rwlock_unlock(&store_lock);
+}
+
+void properties_hold_ingest(void) {
+    pthread_mutex_lock(&writer_lock);
+}
+
+void properties_resume_ingest(void) {
+    pthread_mutex_unlock(&writer_lock);
+}
+
+// Binary search of listings sorted by id
+static const property_t* find_sorted(const property_t* sorted, size_t count, int id) {
+    size_t low = 0, high = count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (sorted[mid].id < id) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low < count && sorted[low].id == id ? &sorted[low] : NULL;
+}
+
+int properties_find(int property_id, property_t* out) {
+    int found = 1;
+    pthread_rwlock_rdlock(&store_lock);
+    if (snapshot_base != NULL) {
+        const property_t* hit = find_sorted(rows, row_count, property_id);
+        if (hit != NULL) {
+            *out = *hit;
+            found = 0;
+        }
+    } else if (slot_capacity > 0 && property_id > 0) {
+        size_t slot = slot_find(property_id);
+        if (slot_ids[slot] == property_id) {
+            *out = rows[slot_index[slot]];
+            found = 0;
+        }
+    }
+    pthread_rwlock_unlock(&store_lock);
+    return found;
+}
+
+static int compare_by_id(const void* a, const void* b) {
+    int x = ((const property_t*) a)->id, y = ((const property_t*) b)->id;
+    return (x > y) - (x < y);
+}
+
+static int write_all(int fd, const void* data, size_t length) {
+    const char* p = data;
+    while (length > 0) {
+        ssize_t written = write(fd, p, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return 1;
+        }
+        p += written;
+        length -= (size_t) written;
+    }
+    return 0;
+}
+
+int properties_publish_snapshot(const char* path) {
+    pthread_rwlock_rdlock(&store_lock);
+    size_t count = row_count;
+    property_t* sorted = malloc(sizeof(property_t) * (count ? count : 1));
+    if (sorted != NULL && count > 0) {
+        memcpy(sorted, rows, sizeof(property_t) * count);
+    }
+    pthread_rwlock_unlock(&store_lock);
+    if (sorted == NULL) {
+        return 1;
+    }
+    qsort(sorted, count, sizeof(property_t), compare_by_id);
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    snapshot_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.format_version = SNAPSHOT_FORMAT_VERSION;
+    header.record_size = sizeof(property_t);
+    header.count = count;
+    header.data_version = (uint64_t) now.tv_sec * 1000000000ull + (uint64_t) now.tv_nsec;
+
+    // Write next to the destination, then rename over it
+    char dir_buf[512];
+    snprintf(dir_buf, sizeof(dir_buf), "%s", path);
+    const char* dir = dirname(dir_buf);
+    mkdir(dir, 0755);
+
+    char tmp_path[512];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp.%ld", path, (long) getpid());
+
+    int rc = 1;
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        if (write_all(fd, &header, sizeof(header)) == 0 &&
+            write_all(fd, sorted, sizeof(property_t) * count) == 0 &&
+            fsync(fd) == 0) {
+            rc = 0;
+        }
+        close(fd);
+    }
+    if (rc == 0 && rename(tmp_path, path) != 0) {
+        rc = 1;
+    }
+    if (rc == 0) {
+        int dir_fd = open(dir, O_RDONLY);
+        if (dir_fd >= 0) {
+            fsync(dir_fd);
+            close(dir_fd);
+        }
+    } else {
+        fprintf(stderr, "Failed to write listing snapshot %s: %s\n", path, strerror(errno));
+        unlink(tmp_path);
+    }
+    free(sorted);
+    return rc;
+}
+
+static int snapshot_validate(const unsigned char* base, size_t size) {
+    if (size < sizeof(snapshot_header_t)) {
+        return 1;
+    }
+    const snapshot_header_t* header = (const snapshot_header_t*) base;
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 ||
+        header->format_version != SNAPSHOT_FORMAT_VERSION || header->record_size != sizeof(property_t) ||
+        header->count > (size - sizeof(snapshot_header_t)) / sizeof(property_t) ||
+        sizeof(snapshot_header_t) + header->count * sizeof(property_t) != size) {
+        return 1;
+    }
+    // Lookups rely on the order
+    const property_t* records = (const property_t*) (base + sizeof(snapshot_header_t));
+    for (uint64_t i = 1; i < header->count; i++) {
+        if (records[i].id <= records[i - 1].id) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int properties_open_snapshot(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return 1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return 1;
+    }
+    size_t size = (size_t) st.st_size;
+    void* mapping = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return 1;
+    }
+    if (snapshot_validate(mapping, size) != 0) {
+        fprintf(stderr, "Listing snapshot %s is invalid or from another build\n", path);
+        munmap(mapping, size);
+        return 1;
+    }
+    const property_t* current = (const property_t*) ((const unsigned char*) mapping + sizeof(snapshot_header_t));
+    size_t count = (size_t) ((const snapshot_header_t*) mapping)->count;
+
+    pthread_mutex_lock(&writer_lock);
+    pthread_rwlock_wrlock(&store_lock);
+    property_t* old_rows = rows;
+    size_t old_count = row_count;
+    void* old_base = snapshot_base;
+    size_t old_size = snapshot_size;
+    rows = (property_t*) current;
+    row_count = count;
+    row_capacity = 0;
+    snapshot_base = mapping;
+    snapshot_size = size;
+    free(slot_ids);
+    free(slot_index);
+    slot_ids = NULL;
+    slot_index = NULL;
+    slot_capacity = 0;
+    pthread_rwlock_unlock(&store_lock);
+
+    // Hooks see what changed, as if the new listings had been ingested.
+    // Nothing else references the old rows now, so in-memory ones can
+    // be sorted in place.
+    if (old_base == NULL && old_count > 0) {
+        qsort(old_rows, old_count, sizeof(property_t), compare_by_id);
+    }
+    ingest_hook_entry_t hook_copy[MAX_INGEST_HOOKS];
+    int active_hooks = copy_hooks(hook_copy);
+    size_t j = 0;
+    for (size_t i = 0; i < count && active_hooks > 0; i++) {
+        while (j < old_count && old_rows[j].id < current[i].id) {
+            j++;
+        }
+        const property_t* previous = j < old_count && old_rows[j].id == current[i].id ? &old_rows[j] : NULL;
+        if (previous != NULL && properties_equal(previous, &current[i])) {
+            continue;
+        }
+        for (int h = 0; h < active_hooks; h++) {
+            hook_copy[h].hook(previous, &current[i], hook_copy[h].ctx);
+        }
+    }
+    pthread_mutex_unlock(&writer_lock);
+
+    if (old_base != NULL) {
+        munmap(old_base, old_size);
+    } else {
+        free(old_rows);
+    }
+    return 0;
+}
+
+static const char* PROPERTY_DETAIL_SQL =
+    "SELECT p.id, p.title, p.address, p.district_id, d.name, p.type_id, t.name, p.num_rooms, p.area_sqm, "
+    "p.price, p.currency, p.floor, p.total_floors, p.year_built, p.description, "
+    "p.coordinates[0], p.coordinates[1], p.status, to_char(p.date_listed, 'YYYY-MM-DD'), "
+    "COALESCE((SELECT json_agg(i.image_url ORDER BY i.is_primary DESC, i.id) "
+    "          FROM property_images i WHERE i.property_id = p.id), '[]'), "
+    "COALESCE((SELECT json_agg(f.name ORDER BY f.name) FROM property_to_features pf "
+    "          JOIN property_features f ON f.id = pf.feature_id WHERE pf.property_id = p.id), '[]') "
+    "FROM properties p "
+    "LEFT JOIN districts d ON d.id = p.district_id "
+    "LEFT JOIN property_types t ON t.id = p.type_id "
+    "WHERE p.id = $1";
+
+// Text column, or JSON null for SQL NULL
+static json_t* text_or_null(PGresult* res, int row, int column) {
+    return PQgetisnull(res, row, column) ? json_null() : json_string(PQgetvalue(res, row, column));
+}
+
+static json_t* int_or_null(PGresult* res, int row, int column) {
+    return PQgetisnull(res, row, column) ? json_null() : json_integer(atoi(PQgetvalue(res, row, column)));
+}
+
+static json_t* real_or_null(PGresult* res, int row, int column) {
+    return PQgetisnull(res, row, column) ? json_null() : json_real(atof(PQgetvalue(res, row, column)));
+}
+
+int properties_get_detail(PGconn* conn, int property_id, json_t** out) {
+    char id_text[16];
+    snprintf(id_text, sizeof(id_text), "%d", property_id);
+    const char* params[] = { id_text };
+    PGresult* res = db_query_params(conn, PROPERTY_DETAIL_SQL, 1, params);
+    if (res == NULL) {
+        return -1;
+    }
+    if (PQntuples(res) == 0) {
+        PQclear(res);
+        return 1;
+    }
+
+    int area_sqm = atoi(PQgetvalue(res, 0, 8));
+    int price = atoi(PQgetvalue(res, 0, 9));
+    json_t* obj = json_object();
+    json_object_set_new(obj, "id", json_integer(atoi(PQgetvalue(res, 0, 0))));
+    json_object_set_new(obj, "title", json_string(PQgetvalue(res, 0, 1)));
+    json_object_set_new(obj, "address", json_string(PQgetvalue(res, 0, 2)));
+    json_object_set_new(obj, "district_id", int_or_null(res, 0, 3));
+    json_object_set_new(obj, "district_name", text_or_null(res, 0, 4));
+    json_object_set_new(obj, "type_id", int_or_null(res, 0, 5));
+    json_object_set_new(obj, "type_name", text_or_null(res, 0, 6));
+    json_object_set_new(obj, "num_rooms", json_integer(atoi(PQgetvalue(res, 0, 7))));
+    json_object_set_new(obj, "area_sqm", json_integer(area_sqm));
+    json_object_set_new(obj, "price", json_integer(price));
+    json_object_set_new(obj, "price_per_sqm", json_real(area_sqm > 0 ? (double) price / area_sqm : 0.0));
+    json_object_set_new(obj, "currency", text_or_null(res, 0, 10));
+    json_object_set_new(obj, "floor", int_or_null(res, 0, 11));
+    json_object_set_new(obj, "total_floors", int_or_null(res, 0, 12));
+    json_object_set_new(obj, "year_built", int_or_null(res, 0, 13));
+    json_object_set_new(obj, "description", text_or_null(res, 0, 14));
+    json_object_set_new(obj, "latitude", real_or_null(res, 0, 15));
+    json_object_set_new(obj, "longitude", real_or_null(res, 0, 16));
+    json_object_set_new(obj, "status", text_or_null(res, 0, 17));
+    json_object_set_new(obj, "date_listed", text_or_null(res, 0, 18));
+    json_t* images = json_loads(PQgetvalue(res, 0, 19), 0, NULL);
+    json_t* features = json_loads(PQgetvalue(res, 0, 20), 0, NULL);
+    json_object_set_new(obj, "images", images ? images : json_array());
+    json_object_set_new(obj, "features", features ? features : json_array());
+    PQclear(res);
+
+    *out = obj;
+    return 0;
+}
+
+properties_filter_t properties_parse_filter(const char* query_string) {
+    properties_filter_t filter = { .limit = PROPERTIES_LIST_DEFAULT_LIMIT };
+    if (query_string == NULL) {
+        return filter;
+    }
+    char query_copy[256];
+    char* saveptr = NULL;
+    snprintf(query_copy, sizeof(query_copy), "%s", query_string);
+
+    for (char* token = strtok_r(query_copy, "&", &saveptr); token; token = strtok_r(NULL, "&", &saveptr)) {
+        if (strncmp(token, "district_id=", 12) == 0) {
+            filter.district_id = atoi(token + 12);
+        } else if (strncmp(token, "rooms=", 6) == 0) {
+            filter.num_rooms = atoi(token + 6);
+        } else if (strncmp(token, "min_price=", 10) == 0) {
+            filter.min_price = atoi(token + 10);
+        } else if (strncmp(token, "max_price=", 10) == 0) {
+            filter.max_price = atoi(token + 10);
+        } else if (strncmp(token, "limit=", 6) == 0) {
+            filter.limit = atoi(token + 6);
+        } else if (strncmp(token, "offset=", 7) == 0) {
+            filter.offset = atoi(token + 7);
+        }
+    }
+    return filter;
+}
+
+// Unset filters are passed as NULL, which matches every row
+static const char* PROPERTY_LIST_SQL =
+    "SELECT p.id, p.title, p.address, p.district_id, d.name, p.num_rooms, p.area_sqm, p.price, "
+    "p.currency, p.status, to_char(p.date_listed, 'YYYY-MM-DD'), "
+    "(SELECT i.image_url FROM property_images i WHERE i.property_id = p.id "
+    " ORDER BY i.is_primary DESC, i.id LIMIT 1) "
+    "FROM properties p "
+    "LEFT JOIN districts d ON d.id = p.district_id "
+    "WHERE ($1::int IS NULL OR p.district_id = $1) AND ($2::int IS NULL OR p.num_rooms = $2) "
+    "AND ($3::int IS NULL OR p.price >= $3) AND ($4::int IS NULL OR p.price <= $4) "
+    "ORDER BY p.date_listed DESC, p.id DESC "
+    "LIMIT $5 OFFSET $6";
+
+int properties_list(PGconn* conn, const properties_filter_t* filter, json_t** out) {
+    char text[6][16];
+    const int values[6] = { filter->district_id, filter->num_rooms, filter->min_price, filter->max_price,
+                            filter->limit, filter->offset };
+    const char* params[6];
+    for (int i = 0; i < 6; i++) {
+        snprintf(text[i], sizeof(text[i]), "%d", values[i]);
+        params[i] = i < 4 && values[i] == 0 ? NULL : text[i];
+    }
+    PGresult* res = db_query_params(conn, PROPERTY_LIST_SQL, 6, params);
+    if (res == NULL) {
+        return -1;
+    }
+
+    json_t* list = json_array();
+    for (int i = 0; i < PQntuples(res); i++) {
+        int area_sqm = atoi(PQgetvalue(res, i, 6));
+        int price = atoi(PQgetvalue(res, i, 7));
+        json_t* obj = json_object();
+        json_object_set_new(obj, "id", json_integer(atoi(PQgetvalue(res, i, 0))));
+        json_object_set_new(obj, "title", json_string(PQgetvalue(res, i, 1)));
+        json_object_set_new(obj, "address", json_string(PQgetvalue(res, i, 2)));
+        json_object_set_new(obj, "district_id", int_or_null(res, i, 3));
+        json_object_set_new(obj, "district_name", text_or_null(res, i, 4));
+        json_object_set_new(obj, "num_rooms", json_integer(atoi(PQgetvalue(res, i, 5))));
+        json_object_set_new(obj, "area_sqm", json_integer(area_sqm));
+        json_object_set_new(obj, "price", json_integer(price));
+        json_object_set_new(obj, "price_per_sqm", json_real(area_sqm > 0 ? (double) price / area_sqm : 0.0));
+        json_object_set_new(obj, "currency", text_or_null(res, i, 8));
+        json_object_set_new(obj, "status", text_or_null(res, i, 9));
+        json_object_set_new(obj, "date_listed", text_or_null(res, i, 10));
+        json_object_set_new(obj, "image_url", text_or_null(res, i, 11));
+        json_array_append_new(list, obj);
+    }
+    PQclear(res);
+
+    *out = list;
+    return 0;
+}
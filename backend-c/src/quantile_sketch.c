@@ -0,0 +1,222 @@
+#include "include/quantile_sketch.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define MIN_LEVEL_CAPACITY 2
+
+typedef struct {
+    float value;
+    uint64_t weight;
+} weighted_value_t;
+
+void quantile_sketch_init(quantile_sketch_t* sketch, int k, uint64_t seed) {
+    memset(sketch, 0, sizeof(*sketch));
+    sketch->k = k > 0 ? (k < 8 ? 8 : k) : QUANTILE_SKETCH_DEFAULT_K;
+    rng_seed(&sketch->rng, seed);
+}
+
+void quantile_sketch_free(quantile_sketch_t* sketch) {
+    for (int h = 0; h < sketch->num_levels; h++) {
+        free(sketch->levels[h]);
+    }
+    memset(sketch->levels, 0, sizeof(sketch->levels));
+    sketch->num_levels = 0;
+    sketch->retained = sketch->capacity = 0;
+}
+
+// Capacity of level h: k at the top, shrinking by 2/3 per level below
+static uint32_t level_capacity(const quantile_sketch_t* sketch, int h) {
+    double capacity = sketch->k;
+    for (int depth = sketch->num_levels - 1 - h; depth > 0; depth--) {
+        capacity *= 2.0 / 3.0;
+    }
+    uint32_t c = (uint32_t) ceil(capacity);
+    return c < MIN_LEVEL_CAPACITY ? MIN_LEVEL_CAPACITY : c;
+}
+
+static uint32_t total_capacity(const quantile_sketch_t* sketch) {
+    uint32_t total = 0;
+    for (int h = 0; h < sketch->num_levels; h++) {
+        total += level_capacity(sketch, h);
+    }
+    return total;
+}
+
+size_t quantile_sketch_retained(const quantile_sketch_t* sketch) {
+    return sketch->retained;
+}
+
+static int add_level(quantile_sketch_t* sketch) {
+    if (sketch->num_levels == QUANTILE_SKETCH_MAX_LEVELS) {
+        return -1;
+    }
+    int h = sketch->num_levels++;
+    sketch->levels[h] = NULL;
+    sketch->sizes[h] = 0;
+    sketch->allocated[h] = 0;
+    sketch->capacity = total_capacity(sketch);
+    return 0;
+}
+
+static int reserve(quantile_sketch_t* sketch, int h, uint32_t size) {
+    if (size <= sketch->allocated[h]) {
+        return 0;
+    }
+    uint32_t allocated = sketch->allocated[h] ? sketch->allocated[h] : 16;
+    while (allocated < size) {
+        allocated *= 2;
+    }
+    float* grown = realloc(sketch->levels[h], sizeof(float) * allocated);
+    if (grown == NULL) {
+        return -1;
+    }
+    sketch->levels[h] = grown;
+    sketch->allocated[h] = allocated;
+    return 0;
+}
+
+static int compare_floats(const void* a, const void* b) {
+    float x = *(const float*) a;
+    float y = *(const float*) b;
+    return (x > y) - (x < y);
+}
+
+// Halve level h into level h+1; an odd item out stays behind
+static int compact_level(quantile_sketch_t* sketch, int h) {
+    if (h + 1 == sketch->num_levels && add_level(sketch) != 0) {
+        return -1;
+    }
+    float* items = sketch->levels[h];
+    uint32_t size = sketch->sizes[h];
+    uint32_t pairs = size / 2;
+    if (reserve(sketch, h + 1, sketch->sizes[h + 1] + pairs) != 0) {
+        return -1;
+    }
+
+    qsort(items, size, sizeof(float), compare_floats);
+    uint32_t start = size - 2 * pairs;      // 1 if odd: items[0] stays
+    uint32_t offset = (uint32_t) (rng_next(&sketch->rng) >> 63);
+    float* above = &sketch->levels[h + 1][sketch->sizes[h + 1]];
+    for (uint32_t i = 0; i < pairs; i++) {
+        above[i] = items[start + 2 * i + offset];
+    }
+    sketch->sizes[h + 1] += pairs;
+    sketch->sizes[h] = start;
+    sketch->retained -= pairs;
+    return 0;
+}
+
+// Compact the lowest full levels until the sketch fits its capacity
+static int compress(quantile_sketch_t* sketch) {
+    while (sketch->retained >= sketch->capacity) {
+        int h = 0;
+        while (h < sketch->num_levels - 1 && sketch->sizes[h] < level_capacity(sketch, h)) {
+            h++;
+        }
+        if (compact_level(sketch, h) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int quantile_sketch_update(quantile_sketch_t* sketch, float value) {
+    if (sketch->num_levels == 0 && add_level(sketch) != 0) {
+        return -1;
+    }
+    if (reserve(sketch, 0, sketch->sizes[0] + 1) != 0) {
+        return -1;
+    }
+    if (sketch->count == 0 || value < sketch->min) {
+        sketch->min = value;
+    }
+    if (sketch->count == 0 || value > sketch->max) {
+        sketch->max = value;
+    }
+    sketch->levels[0][sketch->sizes[0]++] = value;
+    sketch->retained++;
+    sketch->count++;
+    return sketch->retained < sketch->capacity ? 0 : compress(sketch);
+}
+
+int quantile_sketch_merge(quantile_sketch_t* sketch, const quantile_sketch_t* other) {
+    if (other->count == 0) {
+        return 0;
+    }
+    if (other->k != sketch->k) {
+        return -1;
+    }
+    while (sketch->num_levels < other->num_levels) {
+        if (add_level(sketch) != 0) {
+            return -1;
+        }
+    }
+    for (int h = 0; h < other->num_levels; h++) {
+        if (reserve(sketch, h, sketch->sizes[h] + other->sizes[h]) != 0) {
+            return -1;
+        }
+        memcpy(&sketch->levels[h][sketch->sizes[h]], other->levels[h], sizeof(float) * other->sizes[h]);
+        sketch->sizes[h] += other->sizes[h];
+    }
+    sketch->retained += other->retained;
+    if (sketch->count == 0 || other->min < sketch->min) {
+        sketch->min = other->min;
+    }
+    if (sketch->count == 0 || other->max > sketch->max) {
+        sketch->max = other->max;
+    }
+    sketch->count += other->count;
+    return compress(sketch);
+}
+
+static int compare_weighted(const void* a, const void* b) {
+    float x = ((const weighted_value_t*) a)->value;
+    float y = ((const weighted_value_t*) b)->value;
+    return (x > y) - (x < y);
+}
+
+int quantile_sketch_quantiles(const quantile_sketch_t* sketch, const double* fractions, int count, double* out) {
+    size_t retained = sketch->retained;
+    if (sketch->count == 0 || retained == 0) {
+        return -1;
+    }
+    weighted_value_t* values = malloc(sizeof(weighted_value_t) * retained);
+    if (values == NULL) {
+        return -1;
+    }
+    size_t n = 0;
+    for (int h = 0; h < sketch->num_levels; h++) {
+        for (uint32_t i = 0; i < sketch->sizes[h]; i++) {
+            values[n].value = sketch->levels[h][i];
+            values[n].weight = (uint64_t) 1 << h;
+            n++;
+        }
+    }
+    qsort(values, n, sizeof(weighted_value_t), compare_weighted);
+
+    // Compaction preserves total weight, so it equals the count
+    for (int q = 0; q < count; q++) {
+        double fraction = fractions[q];
+        if (fraction <= 0.0) {
+            out[q] = sketch->min;
+            continue;
+        }
+        if (fraction >= 1.0) {
+            out[q] = sketch->max;
+            continue;
+        }
+        double target = fraction * (double) sketch->count;
+        uint64_t cumulative = 0;
+        size_t i = 0;
+        for (; i + 1 < n; i++) {
+            cumulative += values[i].weight;
+            if ((double) cumulative >= target) {
+                break;
+            }
+        }
+        out[q] = values[i].value;
+    }
+    free(values);
+    return 0;
+}
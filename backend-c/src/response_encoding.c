@@ -0,0 +1,478 @@
+#include "include/response_encoding.h"
+#include "include/utils.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+
+// RFC 8746 typed array tags (little-endian variants)
+#define CBOR_TAG_SINT8_ARRAY 72
+#define CBOR_TAG_SINT16_LE_ARRAY 77
+#define CBOR_TAG_SINT32_LE_ARRAY 78
+#define CBOR_TAG_FLOAT32_LE_ARRAY 85
+
+typedef enum {
+    TYPED_NONE,
+    TYPED_INT8,
+    TYPED_INT16,
+    TYPED_INT32,
+    TYPED_FLOAT32
+} typed_kind_t;
+
+// Output buffer; the first failed append sticks
+typedef struct {
+    string_buffer_t sb;
+    int failed;
+} writer_t;
+
+static void put(writer_t* w, const void* bytes, size_t length) {
+    if (!w->failed && string_buffer_append(&w->sb, bytes, length) != 0) {
+        w->failed = 1;
+    }
+}
+
+static void put_byte(writer_t* w, uint8_t byte) {
+    put(w, &byte, 1);
+}
+
+// Big-endian integer of `size` bytes
+static void put_be(writer_t* w, uint64_t value, int size) {
+    uint8_t bytes[8];
+    for (int i = 0; i < size; i++) {
+        bytes[i] = (uint8_t) (value >> (8 * (size - 1 - i)));
+    }
+    put(w, bytes, (size_t) size);
+}
+
+static int fits_float32(double value) {
+    return isnan(value) || (double) (float) value == value;
+}
+
+static uint32_t float32_bits(double value) {
+    float f = (float) value;
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+static uint64_t float64_bits(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+// Typed array kind that holds every element exactly, or TYPED_NONE
+static typed_kind_t typed_kind_of(json_t* array) {
+    size_t count = json_array_size(array);
+    if (count < RESPONSE_TYPED_ARRAY_MIN) {
+        return TYPED_NONE;
+    }
+    int has_real = 0, all_float32 = 1;
+    json_int_t lo = 0, hi = 0;
+    for (size_t i = 0; i < count; i++) {
+        json_t* value = json_array_get(array, i);
+        if (json_is_real(value)) {
+            has_real = 1;
+        } else if (json_is_integer(value)) {
+            json_int_t v = json_integer_value(value);
+            lo = v < lo ? v : lo;
+            hi = v > hi ? v : hi;
+        } else {
+            return TYPED_NONE;
+        }
+        all_float32 = all_float32 && fits_float32(json_number_value(value));
+    }
+    if (has_real) {
+        // Reals that need a double stay a plain array, encoded one by one
+        return all_float32 ? TYPED_FLOAT32 : TYPED_NONE;
+    }
+    if (lo >= INT8_MIN && hi <= INT8_MAX) {
+        return TYPED_INT8;
+    }
+    if (lo >= INT16_MIN && hi <= INT16_MAX) {
+        return TYPED_INT16;
+    }
+    if (lo >= INT32_MIN && hi <= INT32_MAX) {
+        return TYPED_INT32;
+    }
+    return TYPED_NONE;
+}
+
+static size_t typed_width(typed_kind_t kind) {
+    switch (kind) {
+        case TYPED_INT8: return 1;
+        case TYPED_INT16: return 2;
+        default: return 4;
+    }
+}
+
+// Elements of a typed array, little-endian
+static void put_typed_elements(writer_t* w, json_t* array, typed_kind_t kind) {
+    size_t count = json_array_size(array);
+    size_t width = typed_width(kind);
+    uint8_t chunk[256];
+    size_t used = 0;
+    for (size_t i = 0; i < count; i++) {
+        json_t* value = json_array_get(array, i);
+        uint32_t bits = kind == TYPED_FLOAT32 ? float32_bits(json_number_value(value))
+                                              : (uint32_t) json_integer_value(value);
+        for (size_t b = 0; b < width; b++) {
+            chunk[used++] = (uint8_t) (bits >> (8 * b));
+        }
+        if (used + 4 > sizeof(chunk)) {
+            put(w, chunk, used);
+            used = 0;
+        }
+    }
+    put(w, chunk, used);
+}
+
+// CBOR
+
+static void cbor_head(writer_t* w, int major, uint64_t value) {
+    uint8_t type = (uint8_t) (major << 5);
+    if (value < 24) {
+        put_byte(w, type | (uint8_t) value);
+    } else if (value <= 0xff) {
+        put_byte(w, type | 24);
+        put_be(w, value, 1);
+    } else if (value <= 0xffff) {
+        put_byte(w, type | 25);
+        put_be(w, value, 2);
+    } else if (value <= 0xffffffffULL) {
+        put_byte(w, type | 26);
+        put_be(w, value, 4);
+    } else {
+        put_byte(w, type | 27);
+        put_be(w, value, 8);
+    }
+}
+
+static void cbor_text(writer_t* w, const char* text, size_t length) {
+    cbor_head(w, 3, length);
+    put(w, text, length);
+}
+
+static void cbor_value(writer_t* w, json_t* value) {
+    switch (json_typeof(value)) {
+        case JSON_OBJECT: {
+            cbor_head(w, 5, json_object_size(value));
+            for (void* iter = json_object_iter(value); iter != NULL; iter = json_object_iter_next(value, iter)) {
+                const char* key = json_object_iter_key(iter);
+                cbor_text(w, key, strlen(key));
+                cbor_value(w, json_object_iter_value(iter));
+            }
+            break;
+        }
+        case JSON_ARRAY: {
+            size_t count = json_array_size(value);
+            typed_kind_t kind = typed_kind_of(value);
+            if (kind != TYPED_NONE) {
+                static const int tags[] = {
+                    [TYPED_INT8] = CBOR_TAG_SINT8_ARRAY,
+                    [TYPED_INT16] = CBOR_TAG_SINT16_LE_ARRAY,
+                    [TYPED_INT32] = CBOR_TAG_SINT32_LE_ARRAY,
+                    [TYPED_FLOAT32] = CBOR_TAG_FLOAT32_LE_ARRAY
+                };
+                cbor_head(w, 6, (uint64_t) tags[kind]);
+                cbor_head(w, 2, count * typed_width(kind));
+                put_typed_elements(w, value, kind);
+                break;
+            }
+            cbor_head(w, 4, count);
+            for (size_t i = 0; i < count; i++) {
+                cbor_value(w, json_array_get(value, i));
+            }
+            break;
+        }
+        case JSON_STRING:
+            cbor_text(w, json_string_value(value), json_string_length(value));
+            break;
+        case JSON_INTEGER: {
+            json_int_t v = json_integer_value(value);
+            if (v >= 0) {
+                cbor_head(w, 0, (uint64_t) v);
+            } else {
+                cbor_head(w, 1, (uint64_t) -(v + 1));
+            }
+            break;
+        }
+        case JSON_REAL: {
+            double v = json_real_value(value);
+            if (fits_float32(v)) {
+                put_byte(w, 0xfa);
+                put_be(w, float32_bits(v), 4);
+            } else {
+                put_byte(w, 0xfb);
+                put_be(w, float64_bits(v), 8);
+            }
+            break;
+        }
+        case JSON_TRUE:
+            put_byte(w, 0xf5);
+            break;
+        case JSON_FALSE:
+            put_byte(w, 0xf4);
+            break;
+        default:
+            put_byte(w, 0xf6);
+            break;
+    }
+}
+
+// MessagePack
+
+// Length-prefixed header: `fix` covers lengths up to fix_max, then the
+// 8-bit (when given), 16-bit and 32-bit forms
+static void msgpack_length(writer_t* w, size_t length, uint8_t fix, size_t fix_max,
+                           int code8, uint8_t code16, uint8_t code32) {
+    if (length <= fix_max) {
+        put_byte(w, fix | (uint8_t) length);
+    } else if (code8 >= 0 && length <= 0xff) {
+        put_byte(w, (uint8_t) code8);
+        put_be(w, length, 1);
+    } else if (length <= 0xffff) {
+        put_byte(w, code16);
+        put_be(w, length, 2);
+    } else {
+        put_byte(w, code32);
+        put_be(w, length, 4);
+    }
+}
+
+static void msgpack_text(writer_t* w, const char* text, size_t length) {
+    msgpack_length(w, length, 0xa0, 31, 0xd9, 0xda, 0xdb);
+    put(w, text, length);
+}
+
+static void msgpack_integer(writer_t* w, json_int_t v) {
+    if (v >= 0) {
+        if (v < 128) {
+            put_byte(w, (uint8_t) v);
+        } else if (v <= 0xff) {
+            put_byte(w, 0xcc);
+            put_be(w, (uint64_t) v, 1);
+        } else if (v <= 0xffff) {
+            put_byte(w, 0xcd);
+            put_be(w, (uint64_t) v, 2);
+        } else if (v <= 0xffffffffLL) {
+            put_byte(w, 0xce);
+            put_be(w, (uint64_t) v, 4);
+        } else {
+            put_byte(w, 0xcf);
+            put_be(w, (uint64_t) v, 8);
+        }
+    } else if (v >= -32) {
+        put_byte(w, (uint8_t) (int8_t) v);
+    } else if (v >= INT8_MIN) {
+        put_byte(w, 0xd0);
+        put_be(w, (uint64_t) v, 1);
+    } else if (v >= INT16_MIN) {
+        put_byte(w, 0xd1);
+        put_be(w, (uint64_t) v, 2);
+    } else if (v >= INT32_MIN) {
+        put_byte(w, 0xd2);
+        put_be(w, (uint64_t) v, 4);
+    } else {
+        put_byte(w, 0xd3);
+        put_be(w, (uint64_t) v, 8);
+    }
+}
+
+static void msgpack_value(writer_t* w, json_t* value) {
+    switch (json_typeof(value)) {
+        case JSON_OBJECT: {
+            msgpack_length(w, json_object_size(value), 0x80, 15, -1, 0xde, 0xdf);
+            for (void* iter = json_object_iter(value); iter != NULL; iter = json_object_iter_next(value, iter)) {
+                const char* key = json_object_iter_key(iter);
+                msgpack_text(w, key, strlen(key));
+                msgpack_value(w, json_object_iter_value(iter));
+            }
+            break;
+        }
+        case JSON_ARRAY: {
+            size_t count = json_array_size(value);
+            typed_kind_t kind = typed_kind_of(value);
+            if (kind != TYPED_NONE) {
+                static const uint8_t types[] = {
+                    [TYPED_INT8] = MSGPACK_EXT_INT8_ARRAY,
+                    [TYPED_INT16] = MSGPACK_EXT_INT16_ARRAY,
+                    [TYPED_INT32] = MSGPACK_EXT_INT32_ARRAY,
+                    [TYPED_FLOAT32] = MSGPACK_EXT_FLOAT32_ARRAY
+                };
+                // ext 8/16/32: payload size, then the type
+                size_t size = count * typed_width(kind);
+                int size_bytes = size <= 0xff ? 1 : (size <= 0xffff ? 2 : 4);
+                put_byte(w, size_bytes == 1 ? 0xc7 : (size_bytes == 2 ? 0xc8 : 0xc9));
+                put_be(w, size, size_bytes);
+                put_byte(w, types[kind]);
+                put_typed_elements(w, value, kind);
+                break;
+            }
+            msgpack_length(w, count, 0x90, 15, -1, 0xdc, 0xdd);
+            for (size_t i = 0; i < count; i++) {
+                msgpack_value(w, json_array_get(value, i));
+            }
+            break;
+        }
+        case JSON_STRING:
+            msgpack_text(w, json_string_value(value), json_string_length(value));
+            break;
+        case JSON_INTEGER:
+            msgpack_integer(w, json_integer_value(value));
+            break;
+        case JSON_REAL: {
+            double v = json_real_value(value);
+            if (fits_float32(v)) {
+                put_byte(w, 0xca);
+                put_be(w, float32_bits(v), 4);
+            } else {
+                put_byte(w, 0xcb);
+                put_be(w, float64_bits(v), 8);
+            }
+            break;
+        }
+        case JSON_TRUE:
+            put_byte(w, 0xc3);
+            break;
+        case JSON_FALSE:
+            put_byte(w, 0xc2);
+            break;
+        default:
+            put_byte(w, 0xc0);
+            break;
+    }
+}
+
+int response_encode(json_t* data, response_format_t format, char** out_body, size_t* out_length) {
+    *out_body = NULL;
+    *out_length = 0;
+    if (format == RESPONSE_FORMAT_JSON) {
+        *out_body = json_dumps(data, JSON_COMPACT);
+        if (*out_body == NULL) {
+            return 1;
+        }
+        *out_length = strlen(*out_body);
+        return 0;
+    }
+
+    writer_t w = { .failed = 0 };
+    string_buffer_init(&w.sb);
+    if (format == RESPONSE_FORMAT_CBOR) {
+        cbor_value(&w, data);
+    } else {
+        msgpack_value(&w, data);
+    }
+    if (w.failed || w.sb.data == NULL) {
+        string_buffer_free(&w.sb);
+        return 1;
+    }
+    *out_body = w.sb.data;
+    *out_length = w.sb.length;
+    return 0;
+}
+
+// Format of one media type, -1 if not one we produce
+static int format_of_media_type(const char* type, size_t length) {
+    static const struct {
+        const char* type;
+        response_format_t format;
+    } known[] = {
+        { "application/json", RESPONSE_FORMAT_JSON },
+        { "application/cbor", RESPONSE_FORMAT_CBOR },
+        { "application/msgpack", RESPONSE_FORMAT_MSGPACK },
+        { "application/x-msgpack", RESPONSE_FORMAT_MSGPACK },
+        { "application/vnd.msgpack", RESPONSE_FORMAT_MSGPACK },
+        { "application/*", RESPONSE_FORMAT_JSON },
+        { "*/*", RESPONSE_FORMAT_JSON }
+    };
+    for (size_t i = 0; i < sizeof(known) / sizeof(known[0]); i++) {
+        if (strlen(known[i].type) == length && strncasecmp(type, known[i].type, length) == 0) {
+            return (int) known[i].format;
+        }
+    }
+    return -1;
+}
+
+response_format_t response_format_negotiate(const char* accept) {
+    if (accept == NULL) {
+        return RESPONSE_FORMAT_JSON;
+    }
+    response_format_t best = RESPONSE_FORMAT_JSON;
+    double best_q = 0.0;
+    const char* item = accept;
+    while (*item != '\0') {
+        size_t item_length = strcspn(item, ",");
+        const char* type = item;
+        while (type < item + item_length && (*type == ' ' || *type == '\t')) {
+            type++;
+        }
+        size_t type_length = strcspn(type, ";, \t");
+        if (type + type_length > item + item_length) {
+            type_length = (size_t) (item + item_length - type);
+        }
+
+        double q = 1.0;
+        for (const char* p = type + type_length; p < item + item_length; p++) {
+            if (*p == ';') {
+                const char* param = p + 1;
+                while (*param == ' ' || *param == '\t') {
+                    param++;
+                }
+                if ((param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+                    q = atof(param + 2);
+                }
+            }
+        }
+
+        int format = format_of_media_type(type, type_length);
+        if (format >= 0 && q > best_q) {
+            best = (response_format_t) format;
+            best_q = q;
+        }
+        item += item_length;
+        if (*item == ',') {
+            item++;
+        }
+    }
+    return best;
+}
+
+const char* response_format_content_type(response_format_t format) {
+    switch (format) {
+        case RESPONSE_FORMAT_CBOR: return "application/cbor";
+        case RESPONSE_FORMAT_MSGPACK: return "application/msgpack";
+        default: return "application/json";
+    }
+}
+
+const char* response_format_name(response_format_t format) {
+    switch (format) {
+        case RESPONSE_FORMAT_CBOR: return "cbor";
+        case RESPONSE_FORMAT_MSGPACK: return "msgpack";
+        default: return "json";
+    }
+}
+
+json_t* response_records_to_columns(json_t* records) {
+    json_t* first = json_array_get(records, 0);
+    if (!json_is_array(records) || (first != NULL && !json_is_object(first))) {
+        return NULL;
+    }
+    json_t* columns = json_object();
+    if (first == NULL) {
+        return columns;
+    }
+    size_t count = json_array_size(records);
+    for (void* iter = json_object_iter(first); iter != NULL; iter = json_object_iter_next(first, iter)) {
+        const char* key = json_object_iter_key(iter);
+        json_t* column = json_array();
+        for (size_t i = 0; i < count; i++) {
+            json_t* value = json_object_get(json_array_get(records, i), key);
+            json_array_append_new(column, value ? json_incref(value) : json_null());
+        }
+        json_object_set_new(columns, key, column);
+    }
+    return columns;
+}
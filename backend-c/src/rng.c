@@ -0,0 +1,34 @@
+#include "include/rng.h"
+#include <math.h>
+
+static uint64_t splitmix64(uint64_t* state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+void rng_seed(rng_t* rng, uint64_t seed) {
+    uint64_t state = seed;
+    for (int i = 0; i < 4; i++) {
+        rng->s[i] = splitmix64(&state);
+    }
+}
+
+uint64_t rng_seed_for(uint64_t seed, int key1, int key2) {
+    uint64_t state = seed ^ ((uint64_t) (uint32_t) key1 << 32 | (uint32_t) key2);
+    return splitmix64(&state);
+}
+
+double rng_uniform(rng_t* rng) {
+    return (rng_next(rng) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+double rng_gaussian(rng_t* rng) {
+    double u1 = rng_uniform(rng);
+    double u2 = rng_uniform(rng);
+    if (u1 < 1e-300) {
+        u1 = 1e-300;
+    }
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
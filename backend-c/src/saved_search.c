@@ -0,0 +1,912 @@
+#include "include/saved_search.h"
+#include "include/parallel.h"
+#include "include/utils.h"
+#include "include/db.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <jansson.h>
+
+#define ROOM_BUCKETS 8             // 0 .. 6 rooms exactly, then 7 or more
+#define PRICE_BUCKETS 48
+#define PRICE_BUCKET_BASE 10000.0  // Upper bound of the first price bucket
+#define PRICE_BUCKET_RATIO 1.2     // Each further bucket is 20% wider
+#define MAX_POSTINGS 16            // Families needing more copies of a search are not used
+#define MATCH_CHUNK 64
+#define FLUSH_BATCH 10000
+
+// Posting list layout: one list per district, room bucket, price bucket
+// and (district, room bucket) pair, then the match-all list
+#define DISTRICT_LISTS 0
+#define ROOM_LISTS (DISTRICT_LISTS + SAVED_SEARCH_MAX_DISTRICT)
+#define PRICE_LISTS (ROOM_LISTS + ROOM_BUCKETS)
+#define DISTRICT_ROOM_LISTS (PRICE_LISTS + PRICE_BUCKETS)
+#define ALL_LIST (DISTRICT_ROOM_LISTS + SAVED_SEARCH_MAX_DISTRICT * ROOM_BUCKETS)
+#define LIST_COUNT (ALL_LIST + 1)
+
+typedef enum {
+    FAMILY_DISTRICT,
+    FAMILY_ROOMS,
+    FAMILY_PRICE,
+    FAMILY_DISTRICT_ROOMS,
+    FAMILY_ALL
+} search_family_t;
+
+// A search_params object compiled to ranges; unset bounds are 0 / INT_MAX
+typedef struct {
+    uint64_t district_mask;    // Bit (district_id - 1), 0 = any district
+    uint64_t required_features;
+    int search_id;
+    int user_id;
+    int type_id;               // 0 = any type
+    int min_rooms;
+    int max_rooms;
+    int min_price;
+    int max_price;
+    int min_area;
+    int max_area;
+} compiled_search_t;
+
+typedef struct {
+    compiled_search_t* items;
+    size_t count;
+    size_t capacity;
+} posting_list_t;
+
+typedef struct {
+    compiled_search_t search;
+    search_family_t family;
+} search_entry_t;
+
+// Queued by the ingest hook; previous.id is 0 for new listings
+typedef struct {
+    property_t previous;
+    property_t current;
+} pending_change_t;
+
+static pthread_rwlock_t index_lock = PTHREAD_RWLOCK_INITIALIZER;
+static posting_list_t lists[LIST_COUNT];
+static search_entry_t* entries = NULL;     // Dense, in no particular order
+static size_t entry_count = 0;
+static size_t entry_capacity = 0;
+static int32_t* slots = NULL;              // Open addressing: search_id -> entries index, -1 = empty
+static size_t slot_capacity = 0;
+static uint64_t histogram[LIST_COUNT];     // Active listings per list at the last reindex
+static uint64_t histogram_total = 0;
+static atomic_size_t indexed_searches = 0;
+
+static pthread_mutex_t pending_lock = PTHREAD_MUTEX_INITIALIZER;
+static pending_change_t* pending = NULL;
+static size_t pending_count = 0;
+static size_t pending_capacity = 0;
+
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static search_alert_t* queue = NULL;
+static size_t queue_head = 0;
+static size_t queue_count = 0;
+
+static atomic_uint_fast64_t listings_matched = 0;
+static atomic_uint_fast64_t candidates_checked = 0;
+static atomic_uint_fast64_t alerts_queued = 0;
+static atomic_uint_fast64_t alerts_dropped = 0;
+
+const char* search_alert_reason_to_string(search_alert_reason_t reason) {
+    switch (reason) {
+        case SEARCH_ALERT_NOW_MATCHING: return "now_matching";
+        default: return "new_listing";
+    }
+}
+
+static int room_bucket(int rooms) {
+    if (rooms <= 0) {
+        return 0;
+    }
+    return rooms < ROOM_BUCKETS - 1 ? rooms : ROOM_BUCKETS - 1;
+}
+
+static int price_bucket(int price) {
+    if (price <= PRICE_BUCKET_BASE) {
+        return 0;
+    }
+    int b = 1 + (int) (log(price / PRICE_BUCKET_BASE) / log(PRICE_BUCKET_RATIO));
+    return b < PRICE_BUCKETS ? b : PRICE_BUCKETS - 1;
+}
+
+// ----- Compiling search_params -----
+
+// Integers, reals and numeric strings are accepted; null and "" leave the bound unset
+static int read_number(json_t* value, int* out) {
+    if (value == NULL || json_is_null(value)) {
+        return 0;
+    }
+    double v;
+    if (json_is_number(value)) {
+        v = json_number_value(value);
+    } else if (json_is_string(value)) {
+        const char* text = json_string_value(value);
+        char* end;
+        if (text[0] == '\0') {
+            return 0;
+        }
+        v = strtod(text, &end);
+        if (*end != '\0') {
+            return -1;
+        }
+    } else {
+        return -1;
+    }
+    if (!isfinite(v) || v < 0.0 || v > INT_MAX) {
+        return -1;
+    }
+    *out = (int) v;
+    return 0;
+}
+
+// Read an id (or an array of ids) in 1..64 into a bitmask
+static int read_id_mask(json_t* value, uint64_t* mask) {
+    if (json_is_array(value)) {
+        size_t i;
+        json_t* item;
+        json_array_foreach(value, i, item) {
+            if (read_id_mask(item, mask) != 0) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+    int id = 0;
+    if (read_number(value, &id) != 0 || id > SAVED_SEARCH_MAX_DISTRICT) {
+        return -1;
+    }
+    if (id > 0) {
+        *mask |= (uint64_t) 1 << (id - 1);
+    }
+    return 0;
+}
+
+static int compile_search(int search_id, int user_id, const char* search_params, compiled_search_t* out) {
+    json_error_t error;
+    json_t* root = json_loads(search_params, 0, &error);
+    if (root == NULL) {
+        return -1;
+    }
+    if (!json_is_object(root)) {
+        json_decref(root);
+        return -1;
+    }
+
+    memset(out, 0, sizeof(*out));
+    out->search_id = search_id;
+    out->user_id = user_id;
+    out->max_rooms = out->max_price = out->max_area = INT_MAX;
+    int rooms = 0;
+    int rc = 0;
+    rc |= read_id_mask(json_object_get(root, "district_id"), &out->district_mask);
+    rc |= read_id_mask(json_object_get(root, "district_ids"), &out->district_mask);
+    rc |= read_id_mask(json_object_get(root, "features"), &out->required_features);
+    rc |= read_number(json_object_get(root, "type_id"), &out->type_id);
+    rc |= read_number(json_object_get(root, "type"), &out->type_id);
+    rc |= read_number(json_object_get(root, "num_rooms"), &rooms);
+    rc |= read_number(json_object_get(root, "rooms"), &rooms);
+    rc |= read_number(json_object_get(root, "min_rooms"), &out->min_rooms);
+    rc |= read_number(json_object_get(root, "max_rooms"), &out->max_rooms);
+    rc |= read_number(json_object_get(root, "min_price"), &out->min_price);
+    rc |= read_number(json_object_get(root, "max_price"), &out->max_price);
+    rc |= read_number(json_object_get(root, "min_area"), &out->min_area);
+    rc |= read_number(json_object_get(root, "max_area"), &out->max_area);
+    json_decref(root);
+
+    if (rooms > 0) {
+        out->min_rooms = out->max_rooms = rooms;
+    }
+    // A bound of 0 means "no limit" in the search form
+    if (out->max_rooms == 0) {
+        out->max_rooms = INT_MAX;
+    }
+    if (out->max_price == 0) {
+        out->max_price = INT_MAX;
+    }
+    if (out->max_area == 0) {
+        out->max_area = INT_MAX;
+    }
+    if (rc != 0 || out->min_rooms > out->max_rooms || out->min_price > out->max_price ||
+        out->min_area > out->max_area) {
+        return -1;
+    }
+    return 0;
+}
+
+static inline int search_matches(const compiled_search_t* s, const property_t* p) {
+    return (s->district_mask == 0 ||
+            (p->district_id > 0 && p->district_id <= SAVED_SEARCH_MAX_DISTRICT &&
+             (s->district_mask >> (p->district_id - 1)) & 1)) &&
+           p->num_rooms >= s->min_rooms && p->num_rooms <= s->max_rooms &&
+           p->price >= s->min_price && p->price <= s->max_price &&
+           p->area_sqm >= s->min_area && p->area_sqm <= s->max_area &&
+           (s->type_id == 0 || p->type_id == s->type_id) &&
+           (p->features & s->required_features) == s->required_features;
+}
+
+// ----- Index -----
+
+// Lists a search is posted in under a family; returns how many (0 if
+// the family does not constrain the search)
+static int family_lists(const compiled_search_t* s, search_family_t family, int* out) {
+    int n = 0;
+    switch (family) {
+        case FAMILY_DISTRICT:
+            for (int d = 0; d < SAVED_SEARCH_MAX_DISTRICT; d++) {
+                if ((s->district_mask >> d) & 1) {
+                    out[n++] = DISTRICT_LISTS + d;
+                }
+            }
+            break;
+        case FAMILY_ROOMS:
+            if (s->min_rooms > 0 || s->max_rooms < INT_MAX) {
+                for (int b = room_bucket(s->min_rooms); b <= room_bucket(s->max_rooms); b++) {
+                    out[n++] = ROOM_LISTS + b;
+                }
+            }
+            break;
+        case FAMILY_PRICE:
+            if (s->min_price > 0 || s->max_price < INT_MAX) {
+                for (int b = price_bucket(s->min_price); b <= price_bucket(s->max_price); b++) {
+                    out[n++] = PRICE_LISTS + b;
+                }
+            }
+            break;
+        case FAMILY_DISTRICT_ROOMS:
+            if (s->district_mask != 0 && (s->min_rooms > 0 || s->max_rooms < INT_MAX)) {
+                int first = room_bucket(s->min_rooms), last = room_bucket(s->max_rooms);
+                for (int d = 0; d < SAVED_SEARCH_MAX_DISTRICT; d++) {
+                    if (!((s->district_mask >> d) & 1)) {
+                        continue;
+                    }
+                    if (n + last - first + 1 > MAX_POSTINGS) {
+                        return 0;
+                    }
+                    for (int b = first; b <= last; b++) {
+                        out[n++] = DISTRICT_ROOM_LISTS + d * ROOM_BUCKETS + b;
+                    }
+                }
+            }
+            break;
+        case FAMILY_ALL:
+            out[n++] = ALL_LIST;
+            break;
+    }
+    return n;
+}
+
+// Family whose lists hold the smallest share of listings (add-one
+// smoothed, so uniform before the first reindex)
+static search_family_t choose_family(const compiled_search_t* s) {
+    static const int sizes[4] = {
+        SAVED_SEARCH_MAX_DISTRICT, ROOM_BUCKETS, PRICE_BUCKETS, SAVED_SEARCH_MAX_DISTRICT * ROOM_BUCKETS
+    };
+    search_family_t best = FAMILY_ALL;
+    double best_share = 1.0;
+    int ids[SAVED_SEARCH_MAX_DISTRICT];
+    for (int f = FAMILY_DISTRICT; f <= FAMILY_DISTRICT_ROOMS; f++) {
+        int n = family_lists(s, (search_family_t) f, ids);
+        if (n == 0 || n > MAX_POSTINGS) {
+            continue;
+        }
+        double hits = 0.0;
+        for (int i = 0; i < n; i++) {
+            hits += (double) histogram[ids[i]] + 1.0;
+        }
+        double share = hits / ((double) histogram_total + sizes[f]);
+        if (share < best_share) {
+            best_share = share;
+            best = (search_family_t) f;
+        }
+    }
+    return best;
+}
+
+static int list_push(posting_list_t* list, const compiled_search_t* s) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 16;
+        compiled_search_t* grown = realloc(list->items, sizeof(compiled_search_t) * capacity);
+        if (grown == NULL) {
+            return -1;
+        }
+        list->items = grown;
+        list->capacity = capacity;
+    }
+    list->items[list->count++] = *s;
+    return 0;
+}
+
+static void list_remove(posting_list_t* list, int search_id) {
+    for (size_t i = 0; i < list->count; i++) {
+        if (list->items[i].search_id == search_id) {
+            list->items[i] = list->items[--list->count];
+            return;
+        }
+    }
+}
+
+static int post_entry(const search_entry_t* entry) {
+    int ids[SAVED_SEARCH_MAX_DISTRICT];
+    int n = family_lists(&entry->search, entry->family, ids);
+    for (int i = 0; i < n; i++) {
+        if (list_push(&lists[ids[i]], &entry->search) != 0) {
+            for (int j = 0; j < i; j++) {
+                list_remove(&lists[ids[j]], entry->search.search_id);
+            }
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void unpost_entry(const search_entry_t* entry) {
+    int ids[SAVED_SEARCH_MAX_DISTRICT];
+    int n = family_lists(&entry->search, entry->family, ids);
+    for (int i = 0; i < n; i++) {
+        list_remove(&lists[ids[i]], entry->search.search_id);
+    }
+}
+
+static size_t slot_of(int search_id) {
+    uint32_t h = (uint32_t) search_id * 2654435761u;
+    return h & (slot_capacity - 1);
+}
+
+// Slot holding search_id, or the empty slot where it would go
+static size_t find_slot(int search_id) {
+    size_t i = slot_of(search_id);
+    while (slots[i] >= 0 && entries[slots[i]].search.search_id != search_id) {
+        i = (i + 1) & (slot_capacity - 1);
+    }
+    return i;
+}
+
+static int grow_slots(size_t wanted) {
+    size_t capacity = slot_capacity ? slot_capacity : 1024;
+    while (capacity < wanted * 2) {
+        capacity *= 2;
+    }
+    if (capacity == slot_capacity) {
+        return 0;
+    }
+    int32_t* grown = malloc(sizeof(int32_t) * capacity);
+    if (grown == NULL) {
+        return -1;
+    }
+    free(slots);
+    slots = grown;
+    slot_capacity = capacity;
+    memset(slots, 0xff, sizeof(int32_t) * capacity);
+    for (size_t e = 0; e < entry_count; e++) {
+        slots[find_slot(entries[e].search.search_id)] = (int32_t) e;
+    }
+    return 0;
+}
+
+// Linear probing deletion: shift later members of the cluster back
+static void clear_slot(size_t i) {
+    slots[i] = -1;
+    size_t j = i;
+    for (;;) {
+        j = (j + 1) & (slot_capacity - 1);
+        if (slots[j] < 0) {
+            return;
+        }
+        size_t home = slot_of(entries[slots[j]].search.search_id);
+        // Move j into the hole unless its home lies cyclically in (i, j]
+        if ((j > i && (home <= i || home > j)) || (j < i && home <= i && home > j)) {
+            slots[i] = slots[j];
+            slots[j] = -1;
+            i = j;
+        }
+    }
+}
+
+static int remove_locked(int search_id) {
+    if (entry_count == 0) {
+        return -1;
+    }
+    size_t slot = find_slot(search_id);
+    if (slots[slot] < 0) {
+        return -1;
+    }
+    size_t e = (size_t) slots[slot];
+    unpost_entry(&entries[e]);
+    clear_slot(slot);
+    if (e != --entry_count) {
+        entries[e] = entries[entry_count];
+        slots[find_slot(entries[e].search.search_id)] = (int32_t) e;
+    }
+    atomic_store(&indexed_searches, entry_count);
+    return 0;
+}
+
+static int add_locked(const compiled_search_t* search) {
+    if (slot_capacity > 0) {
+        remove_locked(search->search_id);
+    }
+    if (grow_slots(entry_count + 1) != 0) {
+        return -1;
+    }
+    if (entry_count == entry_capacity) {
+        size_t capacity = entry_capacity ? entry_capacity * 2 : 1024;
+        search_entry_t* grown = realloc(entries, sizeof(search_entry_t) * capacity);
+        if (grown == NULL) {
+            return -1;
+        }
+        entries = grown;
+        entry_capacity = capacity;
+    }
+    search_entry_t* entry = &entries[entry_count];
+    entry->search = *search;
+    entry->family = choose_family(search);
+    if (post_entry(entry) != 0) {
+        return -1;
+    }
+    slots[find_slot(search->search_id)] = (int32_t) entry_count++;
+    atomic_store(&indexed_searches, entry_count);
+    return 0;
+}
+
+int saved_search_add(int search_id, int user_id, const char* search_params) {
+    compiled_search_t search;
+    if (search_params == NULL || compile_search(search_id, user_id, search_params, &search) != 0) {
+        return -1;
+    }
+    pthread_rwlock_wrlock(&index_lock);
+    int rc = add_locked(&search);
+    pthread_rwlock_unlock(&index_lock);
+    return rc;
+}
+
+int saved_search_remove(int search_id) {
+    pthread_rwlock_wrlock(&index_lock);
+    int rc = remove_locked(search_id);
+    pthread_rwlock_unlock(&index_lock);
+    return rc;
+}
+
+static void clear_lists(void) {
+    for (int l = 0; l < LIST_COUNT; l++) {
+        lists[l].count = 0;
+    }
+}
+
+// Count the active listings each posting list would be probed for
+static void compute_histogram(void) {
+    memset(histogram, 0, sizeof(histogram));
+    histogram_total = 0;
+    size_t count = 0;
+    const property_t* listings = properties_acquire(&count);
+    for (size_t i = 0; i < count; i++) {
+        const property_t* p = &listings[i];
+        if (p->status != PROPERTY_STATUS_ACTIVE) {
+            continue;
+        }
+        if (p->district_id > 0 && p->district_id <= SAVED_SEARCH_MAX_DISTRICT) {
+            histogram[DISTRICT_LISTS + p->district_id - 1]++;
+            histogram[DISTRICT_ROOM_LISTS + (p->district_id - 1) * ROOM_BUCKETS + room_bucket(p->num_rooms)]++;
+        }
+        histogram[ROOM_LISTS + room_bucket(p->num_rooms)]++;
+        histogram[PRICE_LISTS + price_bucket(p->price)]++;
+        histogram_total++;
+    }
+    properties_release();
+}
+
+static void reindex_locked(void) {
+    compute_histogram();
+    clear_lists();
+    size_t kept = 0;
+    for (size_t e = 0; e < entry_count; e++) {
+        entries[e].family = choose_family(&entries[e].search);
+        if (post_entry(&entries[e]) != 0) {
+            // Out of memory: fall back to a single copy
+            entries[e].family = FAMILY_ALL;
+            if (post_entry(&entries[e]) != 0) {
+                continue;
+            }
+        }
+        entries[kept++] = entries[e];
+    }
+    entry_count = kept;
+    if (slot_capacity > 0) {
+        memset(slots, 0xff, sizeof(int32_t) * slot_capacity);
+        for (size_t e = 0; e < entry_count; e++) {
+            slots[find_slot(entries[e].search.search_id)] = (int32_t) e;
+        }
+    }
+    atomic_store(&indexed_searches, entry_count);
+}
+
+void saved_search_reindex(void) {
+    pthread_rwlock_wrlock(&index_lock);
+    reindex_locked();
+    pthread_rwlock_unlock(&index_lock);
+}
+
+// Row count, newest id and newest update of user_saved_searches, so
+// unchanged tables are not recompiled on every refresh
+static int table_fingerprint(PGconn* conn, char* out, size_t size) {
+    PGresult* res = db_query_params(conn,
+        "SELECT count(*), COALESCE(max(id), 0), COALESCE(max(updated_at)::text, '') FROM user_saved_searches",
+        0, NULL);
+    if (res == NULL) {
+        return -1;
+    }
+    snprintf(out, size, "%s/%s/%s", PQgetvalue(res, 0, 0), PQgetvalue(res, 0, 1), PQgetvalue(res, 0, 2));
+    PQclear(res);
+    return 0;
+}
+
+long saved_search_load(PGconn* conn) {
+    static char loaded_fingerprint[96] = "";
+    char fingerprint[96];
+    if (table_fingerprint(conn, fingerprint, sizeof(fingerprint)) != 0) {
+        return -1;
+    }
+    if (strcmp(fingerprint, loaded_fingerprint) == 0) {
+        return (long) atomic_load(&indexed_searches);
+    }
+
+    PGresult* res = db_query_params(conn, "SELECT id, user_id, search_params::text FROM user_saved_searches", 0, NULL);
+    if (res == NULL) {
+        return -1;
+    }
+    int rows = PQntuples(res);
+    compiled_search_t* compiled = malloc(sizeof(compiled_search_t) * (size_t) (rows > 0 ? rows : 1));
+    if (compiled == NULL) {
+        PQclear(res);
+        return -1;
+    }
+    size_t valid = 0;
+    for (int r = 0; r < rows; r++) {
+        int user_id = PQgetisnull(res, r, 1) ? 0 : atoi(PQgetvalue(res, r, 1));
+        if (compile_search(atoi(PQgetvalue(res, r, 0)), user_id, PQgetvalue(res, r, 2), &compiled[valid]) == 0) {
+            valid++;
+        } else {
+            fprintf(stderr, "Skipping saved search %s: invalid search_params\n", PQgetvalue(res, r, 0));
+        }
+    }
+    PQclear(res);
+
+    long loaded = 0;
+    pthread_rwlock_wrlock(&index_lock);
+    entry_count = 0;
+    clear_lists();
+    if (slot_capacity > 0) {
+        memset(slots, 0xff, sizeof(int32_t) * slot_capacity);
+    }
+    compute_histogram();
+    for (size_t i = 0; i < valid; i++) {
+        if (add_locked(&compiled[i]) == 0) {
+            loaded++;
+        }
+    }
+    atomic_store(&indexed_searches, entry_count);
+    pthread_rwlock_unlock(&index_lock);
+    free(compiled);
+    snprintf(loaded_fingerprint, sizeof(loaded_fingerprint), "%s", fingerprint);
+    return loaded;
+}
+
+// ----- Notification queue -----
+
+static int ensure_queue(void) {
+    if (queue == NULL) {
+        queue = malloc(sizeof(search_alert_t) * SAVED_SEARCH_QUEUE_CAPACITY);
+    }
+    return queue != NULL ? 0 : -1;
+}
+
+// Append alerts; those that do not fit are counted as dropped
+static size_t enqueue_alerts(const search_alert_t* alerts, size_t count) {
+    pthread_mutex_lock(&queue_lock);
+    size_t accepted = 0;
+    if (ensure_queue() == 0) {
+        accepted = SAVED_SEARCH_QUEUE_CAPACITY - queue_count;
+        if (accepted > count) {
+            accepted = count;
+        }
+        for (size_t i = 0; i < accepted; i++) {
+            queue[(queue_head + queue_count + i) % SAVED_SEARCH_QUEUE_CAPACITY] = alerts[i];
+        }
+        queue_count += accepted;
+    }
+    pthread_mutex_unlock(&queue_lock);
+    atomic_fetch_add(&alerts_queued, accepted);
+    atomic_fetch_add(&alerts_dropped, count - accepted);
+    return accepted;
+}
+
+// Put alerts back at the front in their original order
+static void requeue_alerts(const search_alert_t* alerts, size_t count) {
+    pthread_mutex_lock(&queue_lock);
+    size_t room = SAVED_SEARCH_QUEUE_CAPACITY - queue_count;
+    size_t accepted = count < room ? count : room;
+    for (size_t i = accepted; i > 0; i--) {
+        queue_head = (queue_head + SAVED_SEARCH_QUEUE_CAPACITY - 1) % SAVED_SEARCH_QUEUE_CAPACITY;
+        queue[queue_head] = alerts[i - 1];
+    }
+    queue_count += accepted;
+    pthread_mutex_unlock(&queue_lock);
+    atomic_fetch_add(&alerts_dropped, count - accepted);
+}
+
+size_t saved_search_dequeue(search_alert_t* out, size_t max) {
+    pthread_mutex_lock(&queue_lock);
+    size_t taken = queue_count < max ? queue_count : max;
+    for (size_t i = 0; i < taken; i++) {
+        out[i] = queue[(queue_head + i) % SAVED_SEARCH_QUEUE_CAPACITY];
+    }
+    if (taken > 0) {
+        queue_head = (queue_head + taken) % SAVED_SEARCH_QUEUE_CAPACITY;
+        queue_count -= taken;
+    }
+    pthread_mutex_unlock(&queue_lock);
+    return taken;
+}
+
+// ----- Matching -----
+
+typedef struct {
+    search_alert_t* alerts;
+    size_t count;
+    size_t capacity;
+    uint64_t checked;
+} worker_alerts_t;
+
+typedef struct {
+    const property_t* listings;
+    const property_t* previous;
+    worker_alerts_t* workers;
+    atomic_int failed;
+} match_job_t;
+
+static int push_alert(worker_alerts_t* w, const compiled_search_t* s, int property_id, search_alert_reason_t reason) {
+    if (w->count == w->capacity) {
+        size_t capacity = w->capacity ? w->capacity * 2 : 256;
+        search_alert_t* grown = realloc(w->alerts, sizeof(search_alert_t) * capacity);
+        if (grown == NULL) {
+            return -1;
+        }
+        w->alerts = grown;
+        w->capacity = capacity;
+    }
+    search_alert_t* a = &w->alerts[w->count++];
+    a->user_id = s->user_id;
+    a->search_id = s->search_id;
+    a->property_id = property_id;
+    a->reason = reason;
+    return 0;
+}
+
+// Alert for every search in the list that matches current but not previous
+static void scan_list(const posting_list_t* list, const property_t* current, const property_t* previous,
+                      search_alert_reason_t reason, worker_alerts_t* w, int* failed) {
+    const compiled_search_t* items = list->items;
+    for (size_t i = 0; i < list->count; i++) {
+        if (!search_matches(&items[i], current)) {
+            continue;
+        }
+        if (previous != NULL && search_matches(&items[i], previous)) {
+            continue;
+        }
+        if (push_alert(w, &items[i], current->id, reason) != 0) {
+            *failed = 1;
+            return;
+        }
+    }
+    w->checked += list->count;
+}
+
+static void match_range(size_t begin, size_t end, int worker, void* ctx) {
+    match_job_t* job = ctx;
+    worker_alerts_t* w = &job->workers[worker];
+    int failed = 0;
+    for (size_t i = begin; i < end && !failed; i++) {
+        const property_t* p = &job->listings[i];
+        if (p->status != PROPERTY_STATUS_ACTIVE) {
+            continue;
+        }
+        search_alert_reason_t reason = SEARCH_ALERT_NEW_LISTING;
+        const property_t* previous = NULL;
+        if (job->previous != NULL && job->previous[i].id != 0) {
+            reason = SEARCH_ALERT_NOW_MATCHING;
+            // Only an active listing that matched before suppresses an alert
+            if (job->previous[i].status == PROPERTY_STATUS_ACTIVE) {
+                previous = &job->previous[i];
+            }
+        }
+
+        if (p->district_id > 0 && p->district_id <= SAVED_SEARCH_MAX_DISTRICT) {
+            scan_list(&lists[DISTRICT_LISTS + p->district_id - 1], p, previous, reason, w, &failed);
+            scan_list(&lists[DISTRICT_ROOM_LISTS + (p->district_id - 1) * ROOM_BUCKETS + room_bucket(p->num_rooms)],
+                      p, previous, reason, w, &failed);
+        }
+        scan_list(&lists[ROOM_LISTS + room_bucket(p->num_rooms)], p, previous, reason, w, &failed);
+        scan_list(&lists[PRICE_LISTS + price_bucket(p->price)], p, previous, reason, w, &failed);
+        scan_list(&lists[ALL_LIST], p, previous, reason, w, &failed);
+    }
+    if (failed) {
+        atomic_store(&job->failed, 1);
+    }
+}
+
+long saved_search_match(const property_t* listings, const property_t* previous, size_t count, int workers) {
+    if (count == 0) {
+        return 0;
+    }
+    if (workers <= 0) {
+        workers = parallel_default_workers();
+    }
+    match_job_t job;
+    job.listings = listings;
+    job.previous = previous;
+    job.workers = calloc((size_t) workers, sizeof(worker_alerts_t));
+    atomic_init(&job.failed, 0);
+    if (job.workers == NULL) {
+        return -1;
+    }
+
+    pthread_rwlock_rdlock(&index_lock);
+    int used = parallel_for(count, MATCH_CHUNK, workers, match_range, &job);
+    pthread_rwlock_unlock(&index_lock);
+
+    long queued = 0;
+    uint64_t checked = 0;
+    for (int w = 0; w < workers; w++) {
+        queued += (long) enqueue_alerts(job.workers[w].alerts, job.workers[w].count);
+        checked += job.workers[w].checked;
+        free(job.workers[w].alerts);
+    }
+    free(job.workers);
+    atomic_fetch_add(&listings_matched, count);
+    atomic_fetch_add(&candidates_checked, checked);
+    return used < 0 || atomic_load(&job.failed) ? -1 : queued;
+}
+
+// ----- Ingest hook -----
+
+static int searchable_change(const property_t* previous, const property_t* current) {
+    return previous->status != current->status || previous->price != current->price ||
+           previous->district_id != current->district_id || previous->num_rooms != current->num_rooms ||
+           previous->area_sqm != current->area_sqm || previous->type_id != current->type_id ||
+           previous->features != current->features;
+}
+
+// Listing ingest hook: queue new active listings and changed ones for
+// the next saved_search_match_pending
+static void saved_search_on_ingest(const property_t* previous, const property_t* current, void* ctx) {
+    (void) ctx;
+    if (atomic_load(&indexed_searches) == 0 || current->status != PROPERTY_STATUS_ACTIVE) {
+        return;
+    }
+    if (previous != NULL && !searchable_change(previous, current)) {
+        return;
+    }
+
+    pthread_mutex_lock(&pending_lock);
+    if (pending_count == pending_capacity) {
+        size_t capacity = pending_capacity ? pending_capacity * 2 : 256;
+        pending_change_t* grown = realloc(pending, sizeof(pending_change_t) * capacity);
+        if (grown == NULL) {
+            pthread_mutex_unlock(&pending_lock);
+            return;
+        }
+        pending = grown;
+        pending_capacity = capacity;
+    }
+    pending_change_t* change = &pending[pending_count++];
+    if (previous != NULL) {
+        change->previous = *previous;
+    } else {
+        memset(&change->previous, 0, sizeof(change->previous));
+    }
+    change->current = *current;
+    pthread_mutex_unlock(&pending_lock);
+}
+
+void saved_search_init(void) {
+    properties_register_ingest_hook(saved_search_on_ingest, NULL);
+}
+
+long saved_search_match_pending(int workers) {
+    pthread_mutex_lock(&pending_lock);
+    pending_change_t* changes = pending;
+    size_t count = pending_count;
+    pending = NULL;
+    pending_count = pending_capacity = 0;
+    pthread_mutex_unlock(&pending_lock);
+    if (count == 0) {
+        free(changes);
+        return 0;
+    }
+
+    property_t* current = malloc(sizeof(property_t) * count);
+    property_t* previous = malloc(sizeof(property_t) * count);
+    long queued = -1;
+    if (current != NULL && previous != NULL) {
+        for (size_t i = 0; i < count; i++) {
+            current[i] = changes[i].current;
+            previous[i] = changes[i].previous;
+        }
+        queued = saved_search_match(current, previous, count, workers);
+    }
+    free(current);
+    free(previous);
+    free(changes);
+    return queued;
+}
+
+// ----- Persistence -----
+
+static int persist_alerts(PGconn* conn, const search_alert_t* alerts, size_t count) {
+    static const char* sql =
+        "INSERT INTO user_notifications (user_id, saved_search_id, property_id, reason) "
+        "SELECT * FROM unnest($1::int[], $2::int[], $3::int[], $4::text[]) "
+        "ON CONFLICT (saved_search_id, property_id) DO NOTHING";
+
+    enum { COLUMNS = 4 };
+    string_buffer_t columns[COLUMNS];
+    for (int c = 0; c < COLUMNS; c++) {
+        string_buffer_init(&columns[c]);
+        string_buffer_append(&columns[c], "{", 1);
+    }
+    for (size_t i = 0; i < count; i++) {
+        const char* sep = i > 0 ? "," : "";
+        string_buffer_appendf(&columns[0], "%s%d", sep, alerts[i].user_id);
+        string_buffer_appendf(&columns[1], "%s%d", sep, alerts[i].search_id);
+        string_buffer_appendf(&columns[2], "%s%d", sep, alerts[i].property_id);
+        string_buffer_appendf(&columns[3], "%s%s", sep, search_alert_reason_to_string(alerts[i].reason));
+    }
+
+    const char* params[COLUMNS];
+    int failed = 0;
+    for (int c = 0; c < COLUMNS; c++) {
+        failed |= string_buffer_append(&columns[c], "}", 1) != 0;
+        params[c] = columns[c].data;
+    }
+    int rc = failed ? -1 : db_exec_params(conn, sql, COLUMNS, params);
+    for (int c = 0; c < COLUMNS; c++) {
+        string_buffer_free(&columns[c]);
+    }
+    return rc;
+}
+
+long saved_search_flush(PGconn* conn) {
+    search_alert_t* batch = malloc(sizeof(search_alert_t) * FLUSH_BATCH);
+    if (batch == NULL) {
+        return -1;
+    }
+    long written = 0;
+    size_t n;
+    while ((n = saved_search_dequeue(batch, FLUSH_BATCH)) > 0) {
+        if (persist_alerts(conn, batch, n) != 0) {
+            requeue_alerts(batch, n);
+            written = -1;
+            break;
+        }
+        written += (long) n;
+    }
+    free(batch);
+    return written;
+}
+
+void saved_search_get_stats(saved_search_stats_t* out) {
+    out->searches = atomic_load(&indexed_searches);
+    out->listings_matched = atomic_load(&listings_matched);
+    out->candidates_checked = atomic_load(&candidates_checked);
+    out->alerts_queued = atomic_load(&alerts_queued);
+    out->alerts_dropped = atomic_load(&alerts_dropped);
+    pthread_mutex_lock(&queue_lock);
+    out->queue_length = queue_count;
+    pthread_mutex_unlock(&queue_lock);
+}
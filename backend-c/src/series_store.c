@@ -0,0 +1,438 @@
+#include "include/series_store.h"
+#include "include/db.h"
+#include "include/utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <libgen.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "series_store writes native little-endian files"
+#endif
+
+static const char STORE_MAGIC[4] = { 'M', 'I', 'R', 'S' };
+
+typedef struct {
+    char magic[4];
+    uint32_t format_version;
+    uint64_t data_version;
+    uint32_t series_count;
+    uint32_t directory_checksum;
+    uint64_t directory_offset;
+    uint64_t file_size;
+    uint64_t reserved;
+} store_header_t;
+
+typedef struct {
+    int32_t district_id;
+    int32_t room_count;
+    uint32_t point_count;
+    int32_t first_month;
+    uint64_t data_offset;
+    uint32_t month_bytes;
+    uint32_t sample_bytes;
+} store_entry_t;
+
+_Static_assert(sizeof(store_header_t) == 48, "store header must be 48 bytes");
+_Static_assert(sizeof(store_entry_t) == 32, "store directory entry must be 32 bytes");
+
+// Currently mapped store; readers hold the read lock while decoding
+static pthread_rwlock_t store_lock = PTHREAD_RWLOCK_INITIALIZER;
+static const unsigned char* store_base = NULL;
+static size_t store_size = 0;
+static const store_header_t* store_header = NULL;
+static const store_entry_t* store_directory = NULL;
+
+static uint32_t fnv1a32(const unsigned char* data, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void put_varint(string_buffer_t* sb, uint32_t value) {
+    unsigned char bytes[5];
+    size_t n = 0;
+    while (value >= 0x80) {
+        bytes[n++] = (unsigned char) (value | 0x80);
+        value >>= 7;
+    }
+    bytes[n++] = (unsigned char) value;
+    string_buffer_append(sb, (const char*) bytes, n);
+}
+
+// Decode one varint; returns the number of bytes consumed or 0 if truncated
+static size_t get_varint(const unsigned char* p, const unsigned char* end, uint32_t* value) {
+    uint32_t result = 0;
+    int shift = 0;
+    const unsigned char* start = p;
+    while (p < end && shift <= 28) {
+        unsigned char byte = *p++;
+        result |= (uint32_t) (byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return (size_t) (p - start);
+        }
+        shift += 7;
+    }
+    return 0;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+static int write_all(int fd, const void* data, size_t length) {
+    const char* p = data;
+    while (length > 0) {
+        ssize_t written = write(fd, p, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return 1;
+        }
+        p += written;
+        length -= (size_t) written;
+    }
+    return 0;
+}
+
+int series_store_build(const char* path, const price_history_row_t* rows, size_t count, uint64_t data_version) {
+    // Count series (rows are grouped by district, rooms)
+    size_t series_count = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (i == 0 || rows[i].district_id != rows[i - 1].district_id || rows[i].room_count != rows[i - 1].room_count) {
+            series_count++;
+        }
+    }
+
+    store_entry_t* directory = calloc(series_count ? series_count : 1, sizeof(store_entry_t));
+    if (directory == NULL) {
+        return 1;
+    }
+
+    string_buffer_t data;
+    string_buffer_init(&data);
+    size_t data_start = sizeof(store_header_t) + series_count * sizeof(store_entry_t);
+
+    size_t s = 0;
+    for (size_t i = 0; i < count; s++) {
+        size_t end = i;
+        while (end < count && rows[end].district_id == rows[i].district_id && rows[end].room_count == rows[i].room_count) {
+            end++;
+        }
+
+        // Keep float arrays 4-byte aligned inside the mapping
+        static const char padding[4] = { 0 };
+        if (data.length % 4 != 0) {
+            string_buffer_append(&data, padding, 4 - data.length % 4);
+        }
+
+        store_entry_t* entry = &directory[s];
+        entry->district_id = rows[i].district_id;
+        entry->room_count = rows[i].room_count;
+        entry->point_count = (uint32_t) (end - i);
+        entry->first_month = rows[i].month;
+        entry->data_offset = data_start + data.length;
+
+        for (size_t j = i; j < end; j++) {
+            float price = (float) rows[j].avg_price_per_sqm;
+            string_buffer_append(&data, (const char*) &price, sizeof(price));
+        }
+
+        size_t mark = data.length;
+        for (size_t j = i; j < end; j++) {
+            put_varint(&data, j == i ? 0 : (uint32_t) (rows[j].month - rows[j - 1].month));
+        }
+        entry->month_bytes = (uint32_t) (data.length - mark);
+
+        mark = data.length;
+        for (size_t j = i; j < end; j++) {
+            put_varint(&data, rows[j].sample_size > 0 ? (uint32_t) rows[j].sample_size : 0);
+        }
+        entry->sample_bytes = (uint32_t) (data.length - mark);
+
+        i = end;
+    }
+
+    store_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, STORE_MAGIC, sizeof(STORE_MAGIC));
+    header.format_version = SERIES_STORE_FORMAT_VERSION;
+    header.data_version = data_version ? data_version : now_ns();
+    header.series_count = (uint32_t) series_count;
+    header.directory_offset = sizeof(store_header_t);
+    header.file_size = data_start + data.length;
+    header.directory_checksum = fnv1a32((const unsigned char*) directory, series_count * sizeof(store_entry_t));
+
+    // Write next to the destination, then rename over it
+    char dir_buf[512];
+    snprintf(dir_buf, sizeof(dir_buf), "%s", path);
+    const char* dir = dirname(dir_buf);
+    mkdir(dir, 0755);
+
+    char tmp_path[512];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp.%ld", path, (long) getpid());
+
+    int rc = 1;
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        if (write_all(fd, &header, sizeof(header)) == 0 &&
+            write_all(fd, directory, series_count * sizeof(store_entry_t)) == 0 &&
+            (data.length == 0 || write_all(fd, data.data, data.length) == 0) &&
+            fsync(fd) == 0) {
+            rc = 0;
+        }
+        close(fd);
+    }
+
+    if (rc == 0 && rename(tmp_path, path) != 0) {
+        rc = 1;
+    }
+    if (rc == 0) {
+        int dir_fd = open(dir, O_RDONLY);
+        if (dir_fd >= 0) {
+            fsync(dir_fd);
+            close(dir_fd);
+        }
+    } else {
+        fprintf(stderr, "Failed to write series store %s: %s\n", path, strerror(errno));
+        unlink(tmp_path);
+    }
+
+    string_buffer_free(&data);
+    free(directory);
+    return rc;
+}
+
+int series_store_rebuild_from_db(PGconn* conn, const char* path) {
+    static const char* sql =
+        "SELECT district_id, room_count, to_char(date, 'YYYY-MM-DD'), avg_price_per_sqm, COALESCE(sample_size, 0) "
+        "FROM price_history WHERE district_id IS NOT NULL AND room_count IS NOT NULL "
+        "ORDER BY district_id, room_count, date";
+
+    PGresult* res = db_query_params(conn, sql, 0, NULL);
+    if (res == NULL) {
+        return 1;
+    }
+
+    int n = PQntuples(res);
+    price_history_row_t* rows = malloc(sizeof(price_history_row_t) * (size_t) (n > 0 ? n : 1));
+    if (rows == NULL) {
+        PQclear(res);
+        return 1;
+    }
+    for (int i = 0; i < n; i++) {
+        rows[i].district_id = atoi(PQgetvalue(res, i, 0));
+        rows[i].room_count = atoi(PQgetvalue(res, i, 1));
+        rows[i].month = month_index_from_date(PQgetvalue(res, i, 2));
+        rows[i].avg_price_per_sqm = atof(PQgetvalue(res, i, 3));
+        rows[i].sample_size = atoi(PQgetvalue(res, i, 4));
+    }
+    PQclear(res);
+
+    int rc = series_store_build(path, rows, (size_t) n, 0);
+    free(rows);
+    return rc != 0 ? rc : series_store_open(path);
+}
+
+static int series_store_validate(const unsigned char* base, size_t size) {
+    if (size < sizeof(store_header_t)) {
+        return 1;
+    }
+    const store_header_t* header = (const store_header_t*) base;
+    if (memcmp(header->magic, STORE_MAGIC, sizeof(STORE_MAGIC)) != 0 ||
+        header->format_version != SERIES_STORE_FORMAT_VERSION ||
+        header->file_size != size) {
+        return 1;
+    }
+
+    size_t directory_size = (size_t) header->series_count * sizeof(store_entry_t);
+    if (header->directory_offset < sizeof(store_header_t) || header->directory_offset > size ||
+        directory_size > size - header->directory_offset) {
+        return 1;
+    }
+    if (fnv1a32(base + header->directory_offset, directory_size) != header->directory_checksum) {
+        return 1;
+    }
+
+    const store_entry_t* directory = (const store_entry_t*) (base + header->directory_offset);
+    for (uint32_t i = 0; i < header->series_count; i++) {
+        const store_entry_t* e = &directory[i];
+        uint64_t span = (uint64_t) e->point_count * sizeof(float) + e->month_bytes + e->sample_bytes;
+        if (e->data_offset % 4 != 0 || e->data_offset > size || span > size - e->data_offset) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int series_store_open(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return 1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return 1;
+    }
+
+    size_t size = (size_t) st.st_size;
+    void* mapping = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return 1;
+    }
+
+    if (series_store_validate(mapping, size) != 0) {
+        fprintf(stderr, "Series store %s is invalid or has an old format\n", path);
+        munmap(mapping, size);
+        return 1;
+    }
+    madvise(mapping, size, MADV_RANDOM);
+
+    pthread_rwlock_wrlock(&store_lock);
+    const unsigned char* old_base = store_base;
+    size_t old_size = store_size;
+    store_base = mapping;
+    store_size = size;
+    store_header = (const store_header_t*) store_base;
+    store_directory = (const store_entry_t*) (store_base + store_header->directory_offset);
+    pthread_rwlock_unlock(&store_lock);
+
+    if (old_base != NULL) {
+        munmap((void*) old_base, old_size);
+    }
+    return 0;
+}
+
+void series_store_close(void) {
+    pthread_rwlock_wrlock(&store_lock);
+    if (store_base != NULL) {
+        munmap((void*) store_base, store_size);
+    }
+    store_base = NULL;
+    store_size = 0;
+    store_header = NULL;
+    store_directory = NULL;
+    pthread_rwlock_unlock(&store_lock);
+}
+
+uint64_t series_store_version(void) {
+    pthread_rwlock_rdlock(&store_lock);
+    uint64_t version = store_header ? store_header->data_version : 0;
+    pthread_rwlock_unlock(&store_lock);
+    return version;
+}
+
+size_t series_store_count(void) {
+    pthread_rwlock_rdlock(&store_lock);
+    size_t count = store_header ? store_header->series_count : 0;
+    pthread_rwlock_unlock(&store_lock);
+    return count;
+}
+
+int series_store_key(size_t index, int* district_id, int* room_count) {
+    int rc = 1;
+    pthread_rwlock_rdlock(&store_lock);
+    if (store_header != NULL && index < store_header->series_count) {
+        *district_id = store_directory[index].district_id;
+        *room_count = store_directory[index].room_count;
+        rc = 0;
+    }
+    pthread_rwlock_unlock(&store_lock);
+    return rc;
+}
+
+// Binary search the directory; caller holds the read lock
+static const store_entry_t* find_entry(int district_id, int room_count) {
+    size_t lo = 0, hi = store_header->series_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const store_entry_t* e = &store_directory[mid];
+        if (e->district_id < district_id || (e->district_id == district_id && e->room_count < room_count)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo < store_header->series_count && store_directory[lo].district_id == district_id &&
+        store_directory[lo].room_count == room_count) {
+        return &store_directory[lo];
+    }
+    return NULL;
+}
+
+price_history_row_t* series_store_get_series(int district_id, int room_count, int months, int* out_count) {
+    *out_count = 0;
+    if (months <= 0) {
+        return NULL;
+    }
+
+    pthread_rwlock_rdlock(&store_lock);
+    const store_entry_t* e = store_header ? find_entry(district_id, room_count) : NULL;
+    if (e == NULL || e->point_count == 0) {
+        pthread_rwlock_unlock(&store_lock);
+        return NULL;
+    }
+
+    uint32_t n = e->point_count;
+    uint32_t skip = n > (uint32_t) months ? n - (uint32_t) months : 0;
+    price_history_row_t* rows = malloc(sizeof(price_history_row_t) * (n - skip));
+    if (rows == NULL) {
+        pthread_rwlock_unlock(&store_lock);
+        return NULL;
+    }
+
+    const float* prices = (const float*) (store_base + e->data_offset);
+    const unsigned char* month_p = store_base + e->data_offset + (size_t) n * sizeof(float);
+    const unsigned char* month_end = month_p + e->month_bytes;
+    const unsigned char* sample_p = month_end;
+    const unsigned char* sample_end = sample_p + e->sample_bytes;
+
+    int month = e->first_month;
+    int ok = 1;
+    for (uint32_t i = 0; i < n && ok; i++) {
+        uint32_t delta = 0, sample = 0;
+        size_t used = get_varint(month_p, month_end, &delta);
+        size_t used_sample = get_varint(sample_p, sample_end, &sample);
+        if (used == 0 || used_sample == 0) {
+            ok = 0;
+            break;
+        }
+        month_p += used;
+        sample_p += used_sample;
+        month += (int) delta;
+
+        if (i >= skip) {
+            price_history_row_t* row = &rows[i - skip];
+            row->district_id = district_id;
+            row->room_count = room_count;
+            row->month = month;
+            row->avg_price_per_sqm = prices[i];
+            row->sample_size = (int) sample;
+        }
+    }
+    pthread_rwlock_unlock(&store_lock);
+
+    if (!ok) {
+        free(rows);
+        return NULL;
+    }
+    *out_count = (int) (n - skip);
+    return rows;
+}
@@ -0,0 +1,183 @@
+#include "include/singleflight.h"
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+
+// A loader run in progress. Once done it leaves the table; the waiters
+// still holding it copy the result and the last one out frees it.
+typedef struct flight {
+    char key[SINGLEFLIGHT_MAX_KEY];
+    int done;
+    int waiters;
+    int code;
+    char* body;
+    size_t length;
+    pthread_cond_t finished;
+    struct flight* next;
+} flight_t;
+
+static pthread_mutex_t flights_lock = PTHREAD_MUTEX_INITIALIZER;
+static flight_t* buckets[SINGLEFLIGHT_BUCKETS];
+static size_t in_flight = 0;
+
+static atomic_uint_fast64_t calls = 0;
+static atomic_uint_fast64_t executions = 0;
+static atomic_uint_fast64_t coalesced = 0;
+static atomic_uint_fast64_t timeouts = 0;
+
+// FNV-1a
+static size_t bucket_of(const char* key) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*) key; *p; p++) {
+        hash = (hash ^ *p) * 16777619u;
+    }
+    return hash % SINGLEFLIGHT_BUCKETS;
+}
+
+static char* copy_body(const char* body, size_t length) {
+    char* copy = malloc(length + 1);
+    if (copy != NULL) {
+        memcpy(copy, body, length);
+        copy[length] = '\0';
+    }
+    return copy;
+}
+
+static void free_flight(flight_t* flight) {
+    pthread_cond_destroy(&flight->finished);
+    free(flight->body);
+    free(flight);
+}
+
+// Wait for another caller's run, until the caller's deadline, and take
+// a copy of its result
+static int join_flight(flight_t* flight, long long deadline_ms, char** out_body, size_t* out_length) {
+    flight->waiters++;
+    struct timespec until;
+    until.tv_sec = (time_t) (deadline_ms / 1000);
+    until.tv_nsec = (long) (deadline_ms % 1000) * 1000000L;
+    while (!flight->done) {
+        if (deadline_ms <= 0) {
+            pthread_cond_wait(&flight->finished, &flights_lock);
+        } else if (pthread_cond_timedwait(&flight->finished, &flights_lock, &until) == ETIMEDOUT &&
+                   !flight->done) {
+            // The run goes on; whoever finishes it last frees it
+            flight->waiters--;
+            atomic_fetch_add(&timeouts, 1);
+            return SINGLEFLIGHT_TIMEOUT;
+        }
+    }
+    int code = flight->code;
+    *out_body = NULL;
+    *out_length = flight->length;
+    if (flight->body != NULL) {
+        *out_body = copy_body(flight->body, flight->length);
+        if (*out_body == NULL) {
+            code = -1;
+        }
+    }
+    if (--flight->waiters == 0) {
+        free_flight(flight);
+    }
+    return code;
+}
+
+int singleflight_do(const char* key, singleflight_fn fn, void* ctx, long long deadline_ms,
+                    char** out_body, size_t* out_length, int* out_shared) {
+    atomic_fetch_add(&calls, 1);
+    if (out_shared != NULL) {
+        *out_shared = 0;
+    }
+    *out_body = NULL;
+    *out_length = 0;
+
+    size_t key_length = strlen(key);
+    if (key_length >= SINGLEFLIGHT_MAX_KEY) {
+        atomic_fetch_add(&executions, 1);
+        return fn(ctx, out_body, out_length);
+    }
+
+    size_t bucket = bucket_of(key);
+    pthread_mutex_lock(&flights_lock);
+    for (flight_t* flight = buckets[bucket]; flight != NULL; flight = flight->next) {
+        if (strcmp(flight->key, key) == 0) {
+            atomic_fetch_add(&coalesced, 1);
+            int code = join_flight(flight, deadline_ms, out_body, out_length);
+            pthread_mutex_unlock(&flights_lock);
+            if (out_shared != NULL) {
+                *out_shared = 1;
+            }
+            return code;
+        }
+    }
+
+    flight_t* flight = calloc(1, sizeof(flight_t));
+    if (flight == NULL) {
+        // Run uncoalesced rather than fail the request
+        pthread_mutex_unlock(&flights_lock);
+        atomic_fetch_add(&executions, 1);
+        return fn(ctx, out_body, out_length);
+    }
+    memcpy(flight->key, key, key_length + 1);
+    // Waiters' deadlines are on the monotonic clock
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&flight->finished, &attr);
+    pthread_condattr_destroy(&attr);
+    flight->next = buckets[bucket];
+    buckets[bucket] = flight;
+    in_flight++;
+    pthread_mutex_unlock(&flights_lock);
+
+    atomic_fetch_add(&executions, 1);
+    char* body = NULL;
+    size_t length = 0;
+    int code = fn(ctx, &body, &length);
+
+    pthread_mutex_lock(&flights_lock);
+    for (flight_t** link = &buckets[bucket]; *link != NULL; link = &(*link)->next) {
+        if (*link == flight) {
+            *link = flight->next;
+            break;
+        }
+    }
+    in_flight--;
+    if (flight->waiters == 0) {
+        // Nobody joined: hand the body over without copying it
+        pthread_mutex_unlock(&flights_lock);
+        free_flight(flight);
+        *out_body = body;
+        *out_length = length;
+        return code;
+    }
+    flight->code = code;
+    flight->body = body;
+    flight->length = length;
+    flight->done = 1;
+    pthread_cond_broadcast(&flight->finished);
+
+    // The caller that ran the loader takes its copy like everyone else
+    *out_length = length;
+    if (body != NULL) {
+        *out_body = copy_body(body, length);
+        if (*out_body == NULL) {
+            code = -1;
+        }
+    }
+    pthread_mutex_unlock(&flights_lock);
+    return code;
+}
+
+void singleflight_get_stats(singleflight_stats_t* out) {
+    out->calls = atomic_load(&calls);
+    out->executions = atomic_load(&executions);
+    out->coalesced = atomic_load(&coalesced);
+    out->timeouts = atomic_load(&timeouts);
+    pthread_mutex_lock(&flights_lock);
+    out->in_flight = in_flight;
+    pthread_mutex_unlock(&flights_lock);
+}
@@ -0,0 +1,461 @@
+#include "include/supervisor.h"
+#include "include/utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#define POLL_INTERVAL_MS 250
+#define RESTART_BACKOFF_MS 1000   // Workers dying this soon after starting are restarted this much later
+
+// Room for the serving generation, a starting one and draining ones
+#define WORKER_TABLE_SIZE (SUPERVISOR_MAX_WORKERS * 3)
+
+typedef enum {
+    WORKER_FREE = 0,
+    WORKER_STARTING,     // Forked, not ready yet
+    WORKER_READY,
+    WORKER_DRAINING,     // Sent SIGTERM
+    WORKER_BACKOFF       // Died young; restarted at since_ms
+} worker_state_t;
+
+typedef struct {
+    worker_state_t state;
+    pid_t pid;
+    int slot;
+    unsigned int generation;
+    int ready_fd;        // Read end of the readiness pipe while starting
+    long long since_ms;  // When started or told to drain (backoff: when to restart)
+} worker_t;
+
+static worker_t table[WORKER_TABLE_SIZE];
+static int listeners[SUPERVISOR_MAX_WORKERS];
+static int slot_count = 0;
+static char* const* worker_argv = NULL;
+static char exe_path[PATH_MAX];
+
+static unsigned int serving = 0;           // Generation answering requests
+static unsigned int pending = 0;           // Generation being started by a reload, 0 if none
+static unsigned int last_generation = 0;
+static int stopping = 0;
+static long long ready_timeout_ms = 0;
+static long long drain_timeout_ms = 0;
+
+static atomic_int ready_sent = 0;
+
+static int open_listener(unsigned int port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    int on = 1;
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons((uint16_t) port);
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) != 0 ||
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) != 0 ||
+        bind(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static unsigned int bound_port(int fd) {
+    struct sockaddr_in addr;
+    socklen_t length = sizeof(addr);
+    if (getsockname(fd, (struct sockaddr*) &addr, &length) != 0) {
+        return 0;
+    }
+    return ntohs(addr.sin_port);
+}
+
+static worker_t* free_entry(void) {
+    for (int i = 0; i < WORKER_TABLE_SIZE; i++) {
+        if (table[i].state == WORKER_FREE) {
+            return &table[i];
+        }
+    }
+    return NULL;
+}
+
+static int free_entries(void) {
+    int count = 0;
+    for (int i = 0; i < WORKER_TABLE_SIZE; i++) {
+        count += table[i].state == WORKER_FREE;
+    }
+    return count;
+}
+
+static void release_entry(worker_t* w) {
+    if (w->ready_fd >= 0) {
+        close(w->ready_fd);
+    }
+    memset(w, 0, sizeof(*w));
+    w->ready_fd = -1;
+}
+
+// Fork and exec a worker on its slot's socket
+static int spawn_worker(int slot, unsigned int generation) {
+    worker_t* w = free_entry();
+    int ready[2];
+    if (w == NULL || pipe2(ready, O_CLOEXEC) != 0) {
+        return 1;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(ready[0]);
+        close(ready[1]);
+        return 1;
+    }
+    if (pid == 0) {
+        // Only this slot's socket and the pipe survive the exec
+        sigset_t none;
+        sigemptyset(&none);
+        sigprocmask(SIG_SETMASK, &none, NULL);
+        fcntl(listeners[slot], F_SETFD, 0);
+        fcntl(ready[1], F_SETFD, 0);
+        char value[16];
+        snprintf(value, sizeof(value), "%d", slot);
+        setenv(SUPERVISOR_ENV_SLOT, value, 1);
+        snprintf(value, sizeof(value), "%d", listeners[slot]);
+        setenv(SUPERVISOR_ENV_LISTEN_FD, value, 1);
+        snprintf(value, sizeof(value), "%d", ready[1]);
+        setenv(SUPERVISOR_ENV_READY_FD, value, 1);
+        execv(exe_path, worker_argv);
+        fprintf(stderr, "Failed to exec %s: %s\n", exe_path, strerror(errno));
+        _exit(127);
+    }
+
+    close(ready[1]);
+    w->state = WORKER_STARTING;
+    w->pid = pid;
+    w->slot = slot;
+    w->generation = generation;
+    w->ready_fd = ready[0];
+    w->since_ms = monotonic_ms();
+    printf("Worker %d (generation %u) started: pid %ld\n", slot, generation, (long) pid);
+    return 0;
+}
+
+static void drain_worker(worker_t* w, long long now) {
+    if (w->state == WORKER_BACKOFF) {
+        release_entry(w);
+        return;
+    }
+    kill(w->pid, SIGTERM);
+    w->state = WORKER_DRAINING;
+    w->since_ms = now;
+}
+
+// Give up on the generation being started; it drains like an old one
+static void abort_reload(const char* reason) {
+    fprintf(stderr, "Reload to generation %u abandoned (%s); generation %u keeps serving\n",
+            pending, reason, serving);
+    long long now = monotonic_ms();
+    for (int i = 0; i < WORKER_TABLE_SIZE; i++) {
+        worker_t* w = &table[i];
+        if (w->state != WORKER_FREE && w->state != WORKER_DRAINING && w->generation == pending) {
+            drain_worker(w, now);
+        }
+    }
+    pending = 0;
+}
+
+static void start_reload(void) {
+    if (stopping || pending != 0) {
+        printf("SIGHUP ignored: %s\n", stopping ? "shutting down" : "a reload is in progress");
+        return;
+    }
+    if (free_entries() < slot_count) {
+        printf("SIGHUP ignored: too many workers still draining\n");
+        return;
+    }
+    pending = ++last_generation;
+    printf("Reloading: starting generation %u\n", pending);
+    for (int slot = 0; slot < slot_count; slot++) {
+        if (spawn_worker(slot, pending) != 0) {
+            abort_reload("fork failed");
+            return;
+        }
+    }
+}
+
+// Once every slot of the new generation is ready, it takes over
+static void check_reload(void) {
+    if (pending == 0) {
+        return;
+    }
+    int ready = 0;
+    for (int i = 0; i < WORKER_TABLE_SIZE; i++) {
+        ready += table[i].state == WORKER_READY && table[i].generation == pending;
+    }
+    if (ready < slot_count) {
+        return;
+    }
+    long long now = monotonic_ms();
+    for (int i = 0; i < WORKER_TABLE_SIZE; i++) {
+        worker_t* w = &table[i];
+        if (w->state != WORKER_FREE && w->state != WORKER_DRAINING && w->generation != pending) {
+            drain_worker(w, now);
+        }
+    }
+    printf("Reload complete: generation %u serving, generation %u draining\n", pending, serving);
+    serving = pending;
+    pending = 0;
+}
+
+static void stop_all(void) {
+    stopping = 1;
+    long long now = monotonic_ms();
+    for (int i = 0; i < WORKER_TABLE_SIZE; i++) {
+        worker_t* w = &table[i];
+        if (w->state != WORKER_FREE && w->state != WORKER_DRAINING) {
+            drain_worker(w, now);
+        }
+    }
+}
+
+static void reap_workers(void) {
+    int status;
+    pid_t pid;
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        worker_t* w = NULL;
+        for (int i = 0; i < WORKER_TABLE_SIZE && w == NULL; i++) {
+            if (table[i].state != WORKER_FREE && table[i].state != WORKER_BACKOFF && table[i].pid == pid) {
+                w = &table[i];
+            }
+        }
+        if (w == NULL) {
+            continue;
+        }
+
+        if (w->state == WORKER_DRAINING) {
+            printf("Worker %d (generation %u) exited after draining\n", w->slot, w->generation);
+            release_entry(w);
+            continue;
+        }
+        if (WIFSIGNALED(status)) {
+            fprintf(stderr, "Worker %d (generation %u, pid %ld) killed by signal %d\n",
+                    w->slot, w->generation, (long) pid, WTERMSIG(status));
+        } else {
+            fprintf(stderr, "Worker %d (generation %u, pid %ld) exited with status %d\n",
+                    w->slot, w->generation, (long) pid, WEXITSTATUS(status));
+        }
+
+        int slot = w->slot;
+        unsigned int generation = w->generation;
+        long long now = monotonic_ms();
+        int died_young = now - w->since_ms < RESTART_BACKOFF_MS;
+        release_entry(w);
+        if (stopping) {
+            continue;
+        }
+        if (generation == pending) {
+            abort_reload("a new worker died");
+        } else if (generation == serving && (died_young || spawn_worker(slot, generation) != 0)) {
+            // The entry is still free when the spawn failed
+            w->state = WORKER_BACKOFF;
+            w->slot = slot;
+            w->generation = generation;
+            w->since_ms = now + RESTART_BACKOFF_MS;
+        }
+    }
+}
+
+static void check_timers(void) {
+    long long now = monotonic_ms();
+    for (int i = 0; i < WORKER_TABLE_SIZE; i++) {
+        worker_t* w = &table[i];
+        if (w->state == WORKER_STARTING && w->generation == pending && now - w->since_ms > ready_timeout_ms) {
+            abort_reload("not ready in time");
+        } else if (w->state == WORKER_DRAINING && now - w->since_ms > drain_timeout_ms + SUPERVISOR_KILL_GRACE_MS) {
+            kill(w->pid, SIGKILL);
+        } else if (w->state == WORKER_BACKOFF && now >= w->since_ms) {
+            int slot = w->slot;
+            unsigned int generation = w->generation;
+            release_entry(w);
+            if (!stopping && generation == serving && spawn_worker(slot, generation) != 0) {
+                // Try again later
+                w->state = WORKER_BACKOFF;
+                w->slot = slot;
+                w->generation = generation;
+                w->since_ms = now + RESTART_BACKOFF_MS;
+            }
+        }
+    }
+}
+
+static int live_workers(void) {
+    int count = 0;
+    for (int i = 0; i < WORKER_TABLE_SIZE; i++) {
+        count += table[i].state != WORKER_FREE && table[i].state != WORKER_BACKOFF;
+    }
+    return count;
+}
+
+static void close_listeners(void) {
+    for (int slot = 0; slot < slot_count; slot++) {
+        if (listeners[slot] >= 0) {
+            close(listeners[slot]);
+        }
+    }
+    slot_count = 0;
+}
+
+int supervisor_run(const supervisor_config_t* config) {
+    if (config->workers < 1 || config->workers > SUPERVISOR_MAX_WORKERS || config->argv == NULL) {
+        fprintf(stderr, "Supervisor needs 1 to %d workers\n", SUPERVISOR_MAX_WORKERS);
+        return 1;
+    }
+    // Reloads exec whatever binary is at this path then
+    ssize_t length = readlink("/proc/self/exe", exe_path, sizeof(exe_path) - 1);
+    if (length <= 0) {
+        fprintf(stderr, "Cannot resolve the server binary: %s\n", strerror(errno));
+        return 1;
+    }
+    exe_path[length] = '\0';
+    worker_argv = config->argv;
+    ready_timeout_ms = 1000LL * (config->ready_timeout_s ? config->ready_timeout_s : SUPERVISOR_DEFAULT_READY_TIMEOUT);
+    drain_timeout_ms = 1000LL * (config->drain_timeout_s ? config->drain_timeout_s : SUPERVISOR_DEFAULT_DRAIN_TIMEOUT);
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    for (int i = 0; i < WORKER_TABLE_SIZE; i++) {
+        release_entry(&table[i]);
+    }
+    unsigned int port = config->port;
+    for (slot_count = 0; slot_count < config->workers; slot_count++) {
+        listeners[slot_count] = open_listener(port);
+        if (listeners[slot_count] < 0) {
+            fprintf(stderr, "Failed to listen on port %u: %s\n", port, strerror(errno));
+            close_listeners();
+            return 1;
+        }
+        port = bound_port(listeners[slot_count]);
+    }
+
+    sigset_t signals, saved;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGHUP);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &signals, &saved);
+    int signal_fd = signalfd(-1, &signals, SFD_CLOEXEC | SFD_NONBLOCK);
+    if (signal_fd < 0) {
+        sigprocmask(SIG_SETMASK, &saved, NULL);
+        close_listeners();
+        return 1;
+    }
+
+    int rc = 0;
+    serving = last_generation = 1;
+    pending = 0;
+    stopping = 0;
+    printf("Supervisor %ld: %d workers on port %u\n", (long) getpid(), slot_count, port);
+    for (int slot = 0; slot < slot_count; slot++) {
+        if (spawn_worker(slot, serving) != 0) {
+            fprintf(stderr, "Failed to start worker %d\n", slot);
+            stop_all();
+            rc = 1;
+            break;
+        }
+    }
+
+    while (!stopping || live_workers() > 0) {
+        struct pollfd fds[1 + WORKER_TABLE_SIZE];
+        worker_t* owners[1 + WORKER_TABLE_SIZE];
+        nfds_t nfds = 1;
+        fds[0].fd = signal_fd;
+        fds[0].events = POLLIN;
+        for (int i = 0; i < WORKER_TABLE_SIZE; i++) {
+            if (table[i].state == WORKER_STARTING && table[i].ready_fd >= 0) {
+                fds[nfds].fd = table[i].ready_fd;
+                fds[nfds].events = POLLIN;
+                owners[nfds++] = &table[i];
+            }
+        }
+        if (poll(fds, nfds, POLL_INTERVAL_MS) < 0 && errno != EINTR) {
+            rc = 1;
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            struct signalfd_siginfo info;
+            while (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+                if (info.ssi_signo == SIGCHLD) {
+                    reap_workers();
+                } else if (info.ssi_signo == SIGHUP) {
+                    start_reload();
+                } else if (!stopping) {
+                    printf("Stopping: draining %d workers\n", live_workers());
+                    stop_all();
+                }
+            }
+        }
+        for (nfds_t i = 1; i < nfds; i++) {
+            if (fds[i].revents == 0 || owners[i]->state != WORKER_STARTING) {
+                continue;
+            }
+            char byte;
+            if (read(owners[i]->ready_fd, &byte, 1) == 1) {
+                owners[i]->state = WORKER_READY;
+                printf("Worker %d (generation %u) ready\n", owners[i]->slot, owners[i]->generation);
+            }
+            // Ready or gone (its exit is reaped on SIGCHLD)
+            close(owners[i]->ready_fd);
+            owners[i]->ready_fd = -1;
+        }
+        check_reload();
+        check_timers();
+    }
+
+    close(signal_fd);
+    sigprocmask(SIG_SETMASK, &saved, NULL);
+    close_listeners();
+    printf("Supervisor stopped\n");
+    return rc;
+}
+
+static int env_fd(const char* name) {
+    const char* value = getenv(name);
+    if (value == NULL || *value == '\0') {
+        return -1;
+    }
+    char* end = NULL;
+    long fd = strtol(value, &end, 10);
+    return *end == '\0' && fd >= 0 && fd <= INT_MAX ? (int) fd : -1;
+}
+
+int supervisor_worker_slot(void) {
+    return env_fd(SUPERVISOR_ENV_SLOT);
+}
+
+int supervisor_listen_socket(void) {
+    return env_fd(SUPERVISOR_ENV_LISTEN_FD);
+}
+
+void supervisor_notify_ready(void) {
+    int fd = env_fd(SUPERVISOR_ENV_READY_FD);
+    if (fd < 0 || atomic_exchange(&ready_sent, 1)) {
+        return;
+    }
+    ssize_t written;
+    do {
+        written = write(fd, "R", 1);
+    } while (written < 0 && errno == EINTR);
+    close(fd);
+}
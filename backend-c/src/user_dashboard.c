@@ -1,5 +1,268 @@
 #include "include/user_dashboard.h"
+#include "include/db.h"
+#include "include/prediction.h"
+#include "include/utils.h"
 #include <stdio.h>
-void get_user_dashboard_json() {
-    printf("[STUB] get_user_dashboard_json called.\n");
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define STRINGIFY(x) #x
+#define TO_STRING(x) STRINGIFY(x)
+
+// The pipeline: every statement takes the user id as $1; the properties
+// statement also takes the ids saved but possibly not yet written as $2
+static const char* DASHBOARD_SQL[DASHBOARD_QUERY_COUNT] = {
+    [DASHBOARD_QUERY_USER] =
+        "SELECT id, email, first_name, last_name, is_admin FROM users WHERE id = $1",
+    [DASHBOARD_QUERY_PROPERTIES] =
+        // Driven by the user's saves (primary key lookup) plus the pending
+        // ids, so only those listings are read; a pending id already
+        // saved keeps its saved time
+        "SELECT p.id, p.title, p.address, p.district_id, d.name, p.type_id, p.num_rooms, p.area_sqm, p.price, "
+        "p.currency, p.status, to_char(p.date_listed, 'YYYY-MM-DD'), "
+        "to_char(s.created_at, 'YYYY-MM-DD\"T\"HH24:MI:SS'), "
+        "(SELECT i.image_url FROM property_images i WHERE i.property_id = p.id "
+        " ORDER BY i.is_primary DESC, i.id LIMIT 1) "
+        "FROM (SELECT property_id, max(created_at) AS created_at FROM ("
+        "  SELECT property_id, created_at FROM user_saved_properties WHERE user_id = $1 "
+        "  UNION ALL SELECT unnest($2::int[]), NULL) saved GROUP BY property_id) s "
+        "JOIN properties p ON p.id = s.property_id "
+        "LEFT JOIN districts d ON d.id = p.district_id "
+        "ORDER BY s.created_at DESC NULLS FIRST, p.id",
+    [DASHBOARD_QUERY_SEARCHES] =
+        "SELECT id, name, search_params, to_char(created_at, 'YYYY-MM-DD') "
+        "FROM user_saved_searches WHERE user_id = $1 ORDER BY created_at DESC, id",
+    [DASHBOARD_QUERY_NOTIFICATIONS] =
+        "SELECT id, saved_search_id, property_id, reason, to_char(created_at, 'YYYY-MM-DD\"T\"HH24:MI:SS'), "
+        "count(*) OVER () "
+        "FROM user_notifications WHERE user_id = $1 AND read_at IS NULL "
+        "ORDER BY created_at DESC, id DESC LIMIT " TO_STRING(USER_DASHBOARD_MAX_NOTIFICATIONS)
+};
+
+// Text column, or JSON null for SQL NULL
+static json_t* text_or_null(PGresult* res, int row, int column) {
+    return PQgetisnull(res, row, column) ? json_null() : json_string(PQgetvalue(res, row, column));
+}
+
+static int int_value(PGresult* res, int row, int column) {
+    return atoi(PQgetvalue(res, row, column));
+}
+
+// Currently served prediction of the property's series, with the
+// listing's price carried forward by the predicted growth
+static json_t* prediction_json(int district_id, int num_rooms, int price) {
+    price_prediction_t prediction;
+    if (prediction_lookup(district_id, num_rooms, &prediction) != 0) {
+        return json_null();
+    }
+    json_t* obj = json_object();
+    json_object_set_new(obj, "current_avg_price", json_real(prediction.current_avg_price));
+    json_object_set_new(obj, "prediction_6m", json_real(prediction.prediction_6m));
+    json_object_set_new(obj, "prediction_12m", json_real(prediction.prediction_12m));
+    json_object_set_new(obj, "confidence", json_real(prediction.confidence));
+    json_object_set_new(obj, "algorithm", json_string(prediction.algorithm));
+    if (prediction.current_avg_price > 0.0) {
+        json_object_set_new(obj, "estimated_value_12m",
+                            json_real(price * prediction.prediction_12m / prediction.current_avg_price));
+    }
+    return obj;
+}
+
+static json_t* user_json(PGresult* res) {
+    json_t* obj = json_object();
+    json_object_set_new(obj, "id", json_integer(int_value(res, 0, 0)));
+    json_object_set_new(obj, "email", json_string(PQgetvalue(res, 0, 1)));
+    json_object_set_new(obj, "first_name", text_or_null(res, 0, 2));
+    json_object_set_new(obj, "last_name", text_or_null(res, 0, 3));
+    json_object_set_new(obj, "is_admin", json_boolean(PQgetvalue(res, 0, 4)[0] == 't'));
+    return obj;
+}
+
+static int contains(const int* ids, size_t count, int id) {
+    for (size_t i = 0; i < count; i++) {
+        if (ids[i] == id) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static json_t* saved_properties_json(PGresult* res, const user_writes_overlay_t* overlay) {
+    json_t* array = json_array();
+    for (int i = 0; i < PQntuples(res); i++) {
+        if (contains(overlay->unsaved_properties, overlay->unsaved_count, int_value(res, i, 0))) {
+            continue;
+        }
+        int district_id = int_value(res, i, 3);
+        int num_rooms = int_value(res, i, 6);
+        int area_sqm = int_value(res, i, 7);
+        int price = int_value(res, i, 8);
+
+        json_t* obj = json_object();
+        json_object_set_new(obj, "id", json_integer(int_value(res, i, 0)));
+        json_object_set_new(obj, "title", json_string(PQgetvalue(res, i, 1)));
+        json_object_set_new(obj, "address", json_string(PQgetvalue(res, i, 2)));
+        json_object_set_new(obj, "district_id", json_integer(district_id));
+        json_object_set_new(obj, "district_name", text_or_null(res, i, 4));
+        json_object_set_new(obj, "type_id", json_integer(int_value(res, i, 5)));
+        json_object_set_new(obj, "num_rooms", json_integer(num_rooms));
+        json_object_set_new(obj, "area_sqm", json_integer(area_sqm));
+        json_object_set_new(obj, "price", json_integer(price));
+        json_object_set_new(obj, "price_per_sqm", json_real(area_sqm > 0 ? (double) price / area_sqm : 0.0));
+        json_object_set_new(obj, "currency", text_or_null(res, i, 9));
+        json_object_set_new(obj, "status", text_or_null(res, i, 10));
+        json_object_set_new(obj, "date_listed", text_or_null(res, i, 11));
+        json_object_set_new(obj, "saved_at", text_or_null(res, i, 12));
+        json_object_set_new(obj, "image_url", text_or_null(res, i, 13));
+        json_object_set_new(obj, "prediction", prediction_json(district_id, num_rooms, price));
+        json_array_append_new(array, obj);
+    }
+    return array;
+}
+
+json_t* user_saved_search_json(int id, const char* name, const char* params, const char* created_at) {
+    json_t* filters = params ? json_loads(params, 0, NULL) : NULL;
+    json_t* obj = json_object();
+    json_object_set_new(obj, "id", json_integer(id));
+    json_object_set_new(obj, "name", name ? json_string(name) : json_null());
+    json_object_set_new(obj, "filters", filters ? filters : json_object());
+    json_object_set_new(obj, "created_at", created_at ? json_string(created_at) : json_null());
+    return obj;
+}
+
+// Searches created but not yet written come first, as the newest
+static json_t* saved_searches_json(PGresult* res, const user_writes_overlay_t* overlay) {
+    json_t* array = json_array();
+    for (size_t i = overlay->created_count; i-- > 0;) {
+        const user_search_row_t* row = &overlay->created_searches[i];
+        char date[11];
+        struct tm tm_info;
+        localtime_r(&row->created_at, &tm_info);
+        strftime(date, sizeof(date), "%Y-%m-%d", &tm_info);
+        json_array_append_new(array, user_saved_search_json(row->id, row->name, row->params, date));
+    }
+    for (int i = 0; i < PQntuples(res); i++) {
+        int id = int_value(res, i, 0);
+        int pending = 0;
+        for (size_t c = 0; c < overlay->created_count && !pending; c++) {
+            pending = overlay->created_searches[c].id == id;
+        }
+        if (pending || contains(overlay->deleted_searches, overlay->deleted_count, id)) {
+            continue;
+        }
+        json_array_append_new(array, user_saved_search_json(id, PQgetisnull(res, i, 1) ? NULL : PQgetvalue(res, i, 1),
+                                                            PQgetvalue(res, i, 2),
+                                                            PQgetisnull(res, i, 3) ? NULL : PQgetvalue(res, i, 3)));
+    }
+    return array;
+}
+
+static json_t* notifications_json(PGresult* res) {
+    json_t* recent = json_array();
+    for (int i = 0; i < PQntuples(res); i++) {
+        json_t* obj = json_object();
+        json_object_set_new(obj, "id", json_integer(atoll(PQgetvalue(res, i, 0))));
+        json_object_set_new(obj, "saved_search_id", json_integer(int_value(res, i, 1)));
+        json_object_set_new(obj, "property_id", json_integer(int_value(res, i, 2)));
+        json_object_set_new(obj, "reason", json_string(PQgetvalue(res, i, 3)));
+        json_object_set_new(obj, "created_at", text_or_null(res, i, 4));
+        json_array_append_new(recent, obj);
+    }
+    json_t* obj = json_object();
+    json_object_set_new(obj, "unread", json_integer(PQntuples(res) > 0 ? atoll(PQgetvalue(res, 0, 5)) : 0));
+    json_object_set_new(obj, "recent", recent);
+    return obj;
+}
+
+json_t* user_dashboard_build(PGresult* const* results, const user_writes_overlay_t* overlay) {
+    if (PQntuples(results[DASHBOARD_QUERY_USER]) != 1) {
+        return NULL;
+    }
+    json_t* dashboard = json_object();
+    json_object_set_new(dashboard, "user", user_json(results[DASHBOARD_QUERY_USER]));
+    json_object_set_new(dashboard, "saved_properties", saved_properties_json(results[DASHBOARD_QUERY_PROPERTIES], overlay));
+    json_object_set_new(dashboard, "saved_searches", saved_searches_json(results[DASHBOARD_QUERY_SEARCHES], overlay));
+    json_object_set_new(dashboard, "notifications", notifications_json(results[DASHBOARD_QUERY_NOTIFICATIONS]));
+    return dashboard;
+}
+
+// "{1,2,3}" array literal of the ids saved but possibly not yet written
+static int pending_ids_param(const user_writes_overlay_t* overlay, string_buffer_t* sb) {
+    string_buffer_init(sb);
+    int failed = string_buffer_append(sb, "{", 1) != 0;
+    for (size_t i = 0; i < overlay->saved_count; i++) {
+        failed |= string_buffer_appendf(sb, "%s%d", i > 0 ? "," : "", overlay->saved_properties[i]) != 0;
+    }
+    failed |= string_buffer_append(sb, "}", 1) != 0;
+    return failed ? -1 : 0;
+}
+
+json_t* user_dashboard_get(PGconn* conn, int user_id) {
+    // Take the overlay before querying: a batch committed in between
+    // then shows up in both, which applying the overlay tolerates
+    user_writes_overlay_t overlay;
+    if (user_writes_overlay(user_id, &overlay) != 0) {
+        return NULL;
+    }
+    string_buffer_t pending;
+    if (pending_ids_param(&overlay, &pending) != 0) {
+        string_buffer_free(&pending);
+        user_writes_overlay_free(&overlay);
+        return NULL;
+    }
+
+    char user_param[16];
+    snprintf(user_param, sizeof(user_param), "%d", user_id);
+    const char* params[2] = { user_param, pending.data };
+
+    db_statement_t statements[DASHBOARD_QUERY_COUNT];
+    for (int i = 0; i < DASHBOARD_QUERY_COUNT; i++) {
+        statements[i] = (db_statement_t) { DASHBOARD_SQL[i], i == DASHBOARD_QUERY_PROPERTIES ? 2 : 1, params };
+    }
+
+    PGresult* results[DASHBOARD_QUERY_COUNT];
+    json_t* dashboard = NULL;
+    if (db_pipeline(conn, statements, DASHBOARD_QUERY_COUNT, results) == 0) {
+        dashboard = user_dashboard_build(results, &overlay);
+        for (int i = 0; i < DASHBOARD_QUERY_COUNT; i++) {
+            PQclear(results[i]);
+        }
+    }
+    string_buffer_free(&pending);
+    user_writes_overlay_free(&overlay);
+    return dashboard;
+}
+
+// Run one of the dashboard statements on its own and render its rows
+static json_t* get_list(PGconn* conn, int user_id, dashboard_query_t query,
+                        json_t* (*render)(PGresult*, const user_writes_overlay_t*)) {
+    user_writes_overlay_t overlay;
+    if (user_writes_overlay(user_id, &overlay) != 0) {
+        return NULL;
+    }
+    string_buffer_t pending;
+    json_t* list = NULL;
+    if (pending_ids_param(&overlay, &pending) == 0) {
+        char user_param[16];
+        snprintf(user_param, sizeof(user_param), "%d", user_id);
+        const char* params[2] = { user_param, pending.data };
+        PGresult* res = db_query_params(conn, DASHBOARD_SQL[query], query == DASHBOARD_QUERY_PROPERTIES ? 2 : 1,
+                                        params);
+        if (res != NULL) {
+            list = render(res, &overlay);
+            PQclear(res);
+        }
+    }
+    string_buffer_free(&pending);
+    user_writes_overlay_free(&overlay);
+    return list;
+}
+
+json_t* user_saved_properties_get(PGconn* conn, int user_id) {
+    return get_list(conn, user_id, DASHBOARD_QUERY_PROPERTIES, saved_properties_json);
+}
+
+json_t* user_saved_searches_get(PGconn* conn, int user_id) {
+    return get_list(conn, user_id, DASHBOARD_QUERY_SEARCHES, saved_searches_json);
 }
@@ -0,0 +1,736 @@
+#include "include/user_writes.h"
+#include "include/db.h"
+#include "include/utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <jansson.h>
+
+#define USER_BUCKETS 4096          // Power of two
+#define SHUTDOWN_FLUSH_ATTEMPTS 3
+
+typedef enum {
+    OP_SAVE_PROPERTY,
+    OP_UNSAVE_PROPERTY,
+    OP_CREATE_SEARCH,
+    OP_DELETE_SEARCH
+} op_kind_t;
+
+// Latest pending mutation of one key (a property or a search of the user)
+typedef struct {
+    op_kind_t kind;
+    int target_id;             // Property id or search id
+    uint64_t version;          // Changes on every mutation of the key
+    int flushing;              // An earlier or the current version is being written
+    char* name;                // OP_CREATE_SEARCH
+    char* params;
+    time_t created_at;
+} pending_op_t;
+
+typedef struct user_ops {
+    int user_id;
+    pending_op_t* ops;
+    size_t count;
+    size_t capacity;
+    struct user_ops* next;
+} user_ops_t;
+
+// Key and version of a mutation included in the batch being written
+typedef struct {
+    int user_id;
+    int is_search;
+    int target_id;
+    uint64_t version;
+} flushed_op_t;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t flush_wanted = PTHREAD_COND_INITIALIZER;
+static user_ops_t* buckets[USER_BUCKETS];
+static size_t pending_count = 0;
+static uint64_t next_version = 1;
+
+static int* id_pool = NULL;        // Reserved saved-search ids, taken from id_head
+static size_t id_head = 0;
+static size_t id_count = 0;
+static size_t id_capacity = 0;
+
+// Serializes flushes so only one batch is in flight
+static pthread_mutex_t flush_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_t flusher_thread;
+static int flusher_running = 0;
+static int stopping = 0;
+
+static atomic_uint_fast64_t mutations = 0;
+static atomic_uint_fast64_t coalesced = 0;
+static atomic_uint_fast64_t rejected_busy = 0;
+static atomic_uint_fast64_t flushes = 0;
+static atomic_uint_fast64_t rows_written = 0;
+static atomic_uint_fast64_t failed_flushes = 0;
+
+static int is_search_kind(op_kind_t kind) {
+    return kind == OP_CREATE_SEARCH || kind == OP_DELETE_SEARCH;
+}
+
+static user_ops_t** bucket_of(int user_id) {
+    return &buckets[((uint32_t) user_id * 2654435761u) & (USER_BUCKETS - 1)];
+}
+
+static user_ops_t* find_user_locked(int user_id) {
+    for (user_ops_t* u = *bucket_of(user_id); u != NULL; u = u->next) {
+        if (u->user_id == user_id) {
+            return u;
+        }
+    }
+    return NULL;
+}
+
+static void free_op(pending_op_t* op) {
+    free(op->name);
+    free(op->params);
+    op->name = NULL;
+    op->params = NULL;
+}
+
+// Unlink and free a user without pending mutations
+static void drop_user_locked(user_ops_t* user) {
+    for (user_ops_t** link = bucket_of(user->user_id); *link != NULL; link = &(*link)->next) {
+        if (*link == user) {
+            *link = user->next;
+            break;
+        }
+    }
+    free(user->ops);
+    free(user);
+}
+
+static void remove_op_locked(user_ops_t* user, size_t index) {
+    free_op(&user->ops[index]);
+    user->ops[index] = user->ops[--user->count];
+    pending_count--;
+    if (user->count == 0) {
+        drop_user_locked(user);
+    }
+}
+
+static pending_op_t* find_op_locked(user_ops_t* user, int is_search, int target_id, size_t* index) {
+    for (size_t i = 0; i < user->count; i++) {
+        if (is_search_kind(user->ops[i].kind) == is_search && user->ops[i].target_id == target_id) {
+            if (index != NULL) {
+                *index = i;
+            }
+            return &user->ops[i];
+        }
+    }
+    return NULL;
+}
+
+// Record a mutation, replacing or cancelling the pending one of its key.
+// Takes ownership of name and params.
+static int queue_op(int user_id, op_kind_t kind, int target_id, char* name, char* params, time_t created_at) {
+    pthread_mutex_lock(&lock);
+    user_ops_t* user = find_user_locked(user_id);
+    size_t index = 0;
+    pending_op_t* op = user ? find_op_locked(user, is_search_kind(kind), target_id, &index) : NULL;
+
+    if (op != NULL) {
+        atomic_fetch_add(&coalesced, 1);
+        atomic_fetch_add(&mutations, 1);
+        if (kind == OP_DELETE_SEARCH && op->kind == OP_CREATE_SEARCH && !op->flushing) {
+            // The search never reached the database
+            remove_op_locked(user, index);
+        } else {
+            free_op(op);
+            op->kind = kind;
+            op->name = name;
+            op->params = params;
+            op->created_at = created_at;
+            op->version = next_version++;
+        }
+        pthread_mutex_unlock(&lock);
+        return USER_WRITES_OK;
+    }
+
+    if (pending_count >= USER_WRITES_MAX_PENDING) {
+        pthread_mutex_unlock(&lock);
+        atomic_fetch_add(&rejected_busy, 1);
+        free(name);
+        free(params);
+        return USER_WRITES_ERR_BUSY;
+    }
+    if (user == NULL) {
+        user = calloc(1, sizeof(user_ops_t));
+        if (user == NULL) {
+            pthread_mutex_unlock(&lock);
+            free(name);
+            free(params);
+            return USER_WRITES_ERR_INTERNAL;
+        }
+        user->user_id = user_id;
+        user_ops_t** bucket = bucket_of(user_id);
+        user->next = *bucket;
+        *bucket = user;
+    }
+    if (user->count == user->capacity) {
+        size_t capacity = user->capacity ? user->capacity * 2 : 4;
+        pending_op_t* grown = realloc(user->ops, sizeof(pending_op_t) * capacity);
+        if (grown == NULL) {
+            if (user->count == 0) {
+                drop_user_locked(user);
+            }
+            pthread_mutex_unlock(&lock);
+            free(name);
+            free(params);
+            return USER_WRITES_ERR_INTERNAL;
+        }
+        user->ops = grown;
+        user->capacity = capacity;
+    }
+    user->ops[user->count++] = (pending_op_t) {
+        .kind = kind, .target_id = target_id, .version = next_version++,
+        .name = name, .params = params, .created_at = created_at
+    };
+    pending_count++;
+    atomic_fetch_add(&mutations, 1);
+    if (pending_count >= USER_WRITES_FLUSH_BATCH) {
+        pthread_cond_signal(&flush_wanted);
+    }
+    pthread_mutex_unlock(&lock);
+    return USER_WRITES_OK;
+}
+
+int user_writes_save_property(int user_id, int property_id) {
+    return queue_op(user_id, OP_SAVE_PROPERTY, property_id, NULL, NULL, 0);
+}
+
+int user_writes_unsave_property(int user_id, int property_id) {
+    return queue_op(user_id, OP_UNSAVE_PROPERTY, property_id, NULL, NULL, 0);
+}
+
+int user_writes_delete_search(int user_id, int search_id) {
+    return queue_op(user_id, OP_DELETE_SEARCH, search_id, NULL, NULL, 0);
+}
+
+int user_writes_create_search(int user_id, const char* name, const char* params, user_search_row_t* out) {
+    char* name_copy = name ? strdup(name) : NULL;
+    char* params_copy = strdup(params);
+    if ((name != NULL && name_copy == NULL) || params_copy == NULL) {
+        free(name_copy);
+        free(params_copy);
+        return USER_WRITES_ERR_INTERNAL;
+    }
+
+    pthread_mutex_lock(&lock);
+    int id = id_count > 0 ? id_pool[id_head] : 0;
+    if (id_count > 0) {
+        id_head++;
+        id_count--;
+    }
+    pthread_mutex_unlock(&lock);
+    if (id == 0) {
+        free(name_copy);
+        free(params_copy);
+        return USER_WRITES_ERR_NO_IDS;
+    }
+
+    time_t now = time(NULL);
+    if (out != NULL) {
+        out->id = id;
+        out->user_id = user_id;
+        out->name = name ? strdup(name) : NULL;
+        out->params = strdup(params);
+        out->created_at = now;
+    }
+    int rc = queue_op(user_id, OP_CREATE_SEARCH, id, name_copy, params_copy, now);
+    if (rc != USER_WRITES_OK && out != NULL) {
+        user_writes_free_search_row(out);
+    }
+    return rc;
+}
+
+// ----- Saved-search ids -----
+
+size_t user_writes_add_ids(const int* ids, size_t count) {
+    pthread_mutex_lock(&lock);
+    if (id_head > 0) {
+        memmove(id_pool, id_pool + id_head, sizeof(int) * id_count);
+        id_head = 0;
+    }
+    if (id_count + count > id_capacity) {
+        size_t capacity = id_capacity ? id_capacity : USER_WRITES_ID_BLOCK;
+        while (capacity < id_count + count) {
+            capacity *= 2;
+        }
+        int* grown = realloc(id_pool, sizeof(int) * capacity);
+        if (grown != NULL) {
+            id_pool = grown;
+            id_capacity = capacity;
+        } else {
+            count = id_capacity - id_count;
+        }
+    }
+    memcpy(id_pool + id_count, ids, sizeof(int) * count);
+    id_count += count;
+    size_t available = id_count;
+    pthread_mutex_unlock(&lock);
+    return available;
+}
+
+int user_writes_reserve_ids(PGconn* conn) {
+    static const char* sql =
+        "SELECT nextval(pg_get_serial_sequence('user_saved_searches', 'id')) FROM generate_series(1, $1::int)";
+
+    char block[16];
+    snprintf(block, sizeof(block), "%d", USER_WRITES_ID_BLOCK);
+    const char* params[1] = { block };
+    PGresult* res = db_query_params(conn, sql, 1, params);
+    if (res == NULL) {
+        return -1;
+    }
+    int ids[USER_WRITES_ID_BLOCK];
+    int n = PQntuples(res);
+    for (int i = 0; i < n && i < USER_WRITES_ID_BLOCK; i++) {
+        ids[i] = atoi(PQgetvalue(res, i, 0));
+    }
+    PQclear(res);
+    return (int) user_writes_add_ids(ids, (size_t) (n < USER_WRITES_ID_BLOCK ? n : USER_WRITES_ID_BLOCK));
+}
+
+// ----- Flushing -----
+
+typedef struct {
+    int* save_users;
+    int* save_properties;
+    int* unsave_users;
+    int* unsave_properties;
+    user_search_row_t* created;
+    int* delete_users;
+    int* delete_searches;
+    flushed_op_t* flushed;
+    user_writes_batch_t batch;
+    size_t count;
+} flush_batch_t;
+
+static void free_flush_batch(flush_batch_t* b) {
+    for (size_t i = 0; i < b->batch.create_count; i++) {
+        user_writes_free_search_row(&b->created[i]);
+    }
+    free(b->save_users);
+    free(b->save_properties);
+    free(b->unsave_users);
+    free(b->unsave_properties);
+    free(b->created);
+    free(b->delete_users);
+    free(b->delete_searches);
+    free(b->flushed);
+}
+
+// Copy up to USER_WRITES_FLUSH_BATCH pending mutations into a batch and
+// mark them as being written
+static int take_batch(flush_batch_t* b) {
+    memset(b, 0, sizeof(*b));
+    size_t n = USER_WRITES_FLUSH_BATCH;
+    b->save_users = malloc(sizeof(int) * n);
+    b->save_properties = malloc(sizeof(int) * n);
+    b->unsave_users = malloc(sizeof(int) * n);
+    b->unsave_properties = malloc(sizeof(int) * n);
+    b->created = calloc(n, sizeof(user_search_row_t));
+    b->delete_users = malloc(sizeof(int) * n);
+    b->delete_searches = malloc(sizeof(int) * n);
+    b->flushed = malloc(sizeof(flushed_op_t) * n);
+    if (!b->save_users || !b->save_properties || !b->unsave_users || !b->unsave_properties || !b->created ||
+        !b->delete_users || !b->delete_searches || !b->flushed) {
+        free_flush_batch(b);
+        return -1;
+    }
+
+    user_writes_batch_t* batch = &b->batch;
+    pthread_mutex_lock(&lock);
+    for (size_t k = 0; k < USER_BUCKETS && b->count < n; k++) {
+        for (user_ops_t* u = buckets[k]; u != NULL && b->count < n; u = u->next) {
+            for (size_t i = 0; i < u->count && b->count < n; i++) {
+                pending_op_t* op = &u->ops[i];
+                if (op->flushing) {
+                    continue;
+                }
+                switch (op->kind) {
+                    case OP_SAVE_PROPERTY:
+                        b->save_users[batch->save_count] = u->user_id;
+                        b->save_properties[batch->save_count++] = op->target_id;
+                        break;
+                    case OP_UNSAVE_PROPERTY:
+                        b->unsave_users[batch->unsave_count] = u->user_id;
+                        b->unsave_properties[batch->unsave_count++] = op->target_id;
+                        break;
+                    case OP_CREATE_SEARCH: {
+                        user_search_row_t* row = &b->created[batch->create_count++];
+                        row->id = op->target_id;
+                        row->user_id = u->user_id;
+                        row->name = op->name ? strdup(op->name) : NULL;
+                        row->params = strdup(op->params);
+                        row->created_at = op->created_at;
+                        break;
+                    }
+                    case OP_DELETE_SEARCH:
+                        b->delete_users[batch->delete_count] = u->user_id;
+                        b->delete_searches[batch->delete_count++] = op->target_id;
+                        break;
+                }
+                op->flushing = 1;
+                b->flushed[b->count++] = (flushed_op_t) {
+                    u->user_id, is_search_kind(op->kind), op->target_id, op->version
+                };
+            }
+        }
+    }
+    pthread_mutex_unlock(&lock);
+
+    batch->save_users = b->save_users;
+    batch->save_properties = b->save_properties;
+    batch->unsave_users = b->unsave_users;
+    batch->unsave_properties = b->unsave_properties;
+    batch->created_searches = b->created;
+    batch->delete_users = b->delete_users;
+    batch->delete_searches = b->delete_searches;
+    return 0;
+}
+
+// Drop the written mutations that were not changed meanwhile; the rest
+// stay pending
+static void finish_batch(const flush_batch_t* b, int committed) {
+    pthread_mutex_lock(&lock);
+    for (size_t f = 0; f < b->count; f++) {
+        const flushed_op_t* written = &b->flushed[f];
+        user_ops_t* user = find_user_locked(written->user_id);
+        size_t index = 0;
+        pending_op_t* op = user ? find_op_locked(user, written->is_search, written->target_id, &index) : NULL;
+        if (op == NULL) {
+            continue;
+        }
+        if (committed && op->version == written->version) {
+            remove_op_locked(user, index);
+        } else {
+            op->flushing = 0;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+long user_writes_flush_with(user_writes_writer writer, void* ctx) {
+    pthread_mutex_lock(&flush_lock);
+    long written = 0;
+    for (;;) {
+        flush_batch_t b;
+        if (take_batch(&b) != 0) {
+            written = -1;
+            break;
+        }
+        if (b.count == 0) {
+            free_flush_batch(&b);
+            break;
+        }
+        int committed = writer(&b.batch, ctx) == 0;
+        finish_batch(&b, committed);
+        size_t count = b.count;
+        free_flush_batch(&b);
+        if (!committed) {
+            atomic_fetch_add(&failed_flushes, 1);
+            written = -1;
+            break;
+        }
+        atomic_fetch_add(&flushes, 1);
+        atomic_fetch_add(&rows_written, count);
+        written += (long) count;
+        if (count < USER_WRITES_FLUSH_BATCH) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&flush_lock);
+    return written;
+}
+
+// "{1,2,3}" array literal of ints
+static int int_array(string_buffer_t* sb, const int* values, size_t count) {
+    string_buffer_init(sb);
+    int failed = string_buffer_append(sb, "{", 1) != 0;
+    for (size_t i = 0; i < count; i++) {
+        failed |= string_buffer_appendf(sb, "%s%d", i > 0 ? "," : "", values[i]) != 0;
+    }
+    failed |= string_buffer_append(sb, "}", 1) != 0;
+    return failed ? -1 : 0;
+}
+
+// Writes a batch as one transaction: the statements go out in a single
+// pipeline, which runs as one implicit transaction up to its sync
+static int write_batch_to_db(const user_writes_batch_t* batch, void* ctx) {
+    static const char* save_sql =
+        "INSERT INTO user_saved_properties (user_id, property_id) "
+        "SELECT u.user_id, u.property_id FROM unnest($1::int[], $2::int[]) AS u(user_id, property_id) "
+        "WHERE EXISTS (SELECT 1 FROM users WHERE id = u.user_id) "
+        "AND EXISTS (SELECT 1 FROM properties WHERE id = u.property_id) "
+        "ON CONFLICT DO NOTHING";
+    static const char* unsave_sql =
+        "DELETE FROM user_saved_properties s "
+        "USING unnest($1::int[], $2::int[]) AS u(user_id, property_id) "
+        "WHERE s.user_id = u.user_id AND s.property_id = u.property_id";
+    static const char* create_sql =
+        "INSERT INTO user_saved_searches (id, user_id, name, search_params, created_at, updated_at) "
+        "SELECT r.id, r.user_id, r.name, r.params, to_timestamp(r.created_at)::timestamp, "
+        "to_timestamp(r.created_at)::timestamp "
+        "FROM json_to_recordset($1::json) AS r(id int, user_id int, name text, params jsonb, created_at bigint) "
+        "WHERE EXISTS (SELECT 1 FROM users WHERE id = r.user_id) "
+        "ON CONFLICT (id) DO NOTHING";
+    static const char* delete_sql =
+        "DELETE FROM user_saved_searches s "
+        "USING unnest($1::int[], $2::int[]) AS u(user_id, id) "
+        "WHERE s.id = u.id AND s.user_id = u.user_id";
+
+    PGconn* conn = ctx;
+    enum { ARRAYS = 6 };
+    string_buffer_t arrays[ARRAYS];
+    int failed = 0;
+    failed |= int_array(&arrays[0], batch->save_users, batch->save_count);
+    failed |= int_array(&arrays[1], batch->save_properties, batch->save_count);
+    failed |= int_array(&arrays[2], batch->unsave_users, batch->unsave_count);
+    failed |= int_array(&arrays[3], batch->unsave_properties, batch->unsave_count);
+    failed |= int_array(&arrays[4], batch->delete_users, batch->delete_count);
+    failed |= int_array(&arrays[5], batch->delete_searches, batch->delete_count);
+
+    json_t* rows = json_array();
+    for (size_t i = 0; i < batch->create_count; i++) {
+        const user_search_row_t* s = &batch->created_searches[i];
+        json_t* params = s->params ? json_loads(s->params, 0, NULL) : NULL;
+        json_t* row = json_object();
+        json_object_set_new(row, "id", json_integer(s->id));
+        json_object_set_new(row, "user_id", json_integer(s->user_id));
+        json_object_set_new(row, "name", s->name ? json_string(s->name) : json_null());
+        json_object_set_new(row, "params", params ? params : json_object());
+        json_object_set_new(row, "created_at", json_integer((json_int_t) s->created_at));
+        json_array_append_new(rows, row);
+    }
+    char* created = json_dumps(rows, JSON_COMPACT);
+    json_decref(rows);
+    failed |= created == NULL;
+
+    const char* save_params[2] = { arrays[0].data, arrays[1].data };
+    const char* unsave_params[2] = { arrays[2].data, arrays[3].data };
+    const char* create_params[1] = { created };
+    const char* delete_params[2] = { arrays[4].data, arrays[5].data };
+    db_statement_t statements[4];
+    int count = 0;
+    if (batch->save_count > 0) {
+        statements[count++] = (db_statement_t) { save_sql, 2, save_params };
+    }
+    if (batch->unsave_count > 0) {
+        statements[count++] = (db_statement_t) { unsave_sql, 2, unsave_params };
+    }
+    if (batch->create_count > 0) {
+        statements[count++] = (db_statement_t) { create_sql, 1, create_params };
+    }
+    if (batch->delete_count > 0) {
+        statements[count++] = (db_statement_t) { delete_sql, 2, delete_params };
+    }
+
+    PGresult* results[4];
+    int rc = failed ? -1 : db_pipeline(conn, statements, count, results);
+    if (rc == 0) {
+        for (int i = 0; i < count; i++) {
+            PQclear(results[i]);
+        }
+    }
+    free(created);
+    for (int a = 0; a < ARRAYS; a++) {
+        string_buffer_free(&arrays[a]);
+    }
+    return rc;
+}
+
+long user_writes_flush(PGconn* conn) {
+    return user_writes_flush_with(write_batch_to_db, conn);
+}
+
+// ----- Flusher thread -----
+
+static void flush_pooled(void) {
+    pthread_mutex_lock(&lock);
+    int need_ids = id_count < USER_WRITES_ID_BLOCK / 2;
+    int need_flush = pending_count > 0;
+    pthread_mutex_unlock(&lock);
+    if (!need_ids && !need_flush) {
+        return;
+    }
+    PGconn* conn = db_pool_acquire();
+    if (conn == NULL) {
+        return;
+    }
+    if (need_ids) {
+        user_writes_reserve_ids(conn);
+    }
+    if (need_flush) {
+        user_writes_flush(conn);
+    }
+    db_pool_release(conn);
+}
+
+static void* flusher(void* arg) {
+    (void) arg;
+    pthread_mutex_lock(&lock);
+    while (!stopping) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_nsec += (long) USER_WRITES_FLUSH_INTERVAL_MS * 1000000L;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+        while (!stopping && pending_count < USER_WRITES_FLUSH_BATCH &&
+               pthread_cond_timedwait(&flush_wanted, &lock, &deadline) != ETIMEDOUT) {
+        }
+        if (stopping) {
+            break;
+        }
+        pthread_mutex_unlock(&lock);
+        flush_pooled();
+        pthread_mutex_lock(&lock);
+    }
+    pthread_mutex_unlock(&lock);
+    return NULL;
+}
+
+int user_writes_start(void) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&flush_wanted, &attr);
+    pthread_condattr_destroy(&attr);
+
+    pthread_mutex_lock(&lock);
+    stopping = 0;
+    pthread_mutex_unlock(&lock);
+    if (pthread_create(&flusher_thread, NULL, flusher, NULL) != 0) {
+        return 1;
+    }
+    flusher_running = 1;
+    return 0;
+}
+
+size_t user_writes_shutdown(void) {
+    if (flusher_running) {
+        pthread_mutex_lock(&lock);
+        stopping = 1;
+        pthread_cond_signal(&flush_wanted);
+        pthread_mutex_unlock(&lock);
+        pthread_join(flusher_thread, NULL);
+        flusher_running = 0;
+    }
+
+    size_t left = 0;
+    for (int attempt = 0; attempt < SHUTDOWN_FLUSH_ATTEMPTS; attempt++) {
+        pthread_mutex_lock(&lock);
+        left = pending_count;
+        pthread_mutex_unlock(&lock);
+        if (left == 0) {
+            break;
+        }
+        PGconn* conn = db_pool_acquire();
+        if (conn == NULL) {
+            break;
+        }
+        user_writes_flush(conn);
+        db_pool_release(conn);
+    }
+    pthread_mutex_lock(&lock);
+    left = pending_count;
+    pthread_mutex_unlock(&lock);
+    if (left > 0) {
+        fprintf(stderr, "Saved property and search changes not written at shutdown: %zu\n", left);
+    }
+    return left;
+}
+
+// ----- Overlay -----
+
+static int compare_search_rows(const void* a, const void* b) {
+    int x = ((const user_search_row_t*) a)->id;
+    int y = ((const user_search_row_t*) b)->id;
+    return (x > y) - (x < y);
+}
+
+int user_writes_overlay(int user_id, user_writes_overlay_t* out) {
+    memset(out, 0, sizeof(*out));
+    pthread_mutex_lock(&lock);
+    user_ops_t* user = find_user_locked(user_id);
+    size_t n = user ? user->count : 0;
+    if (n == 0) {
+        pthread_mutex_unlock(&lock);
+        return 0;
+    }
+    out->saved_properties = malloc(sizeof(int) * n);
+    out->unsaved_properties = malloc(sizeof(int) * n);
+    out->created_searches = calloc(n, sizeof(user_search_row_t));
+    out->deleted_searches = malloc(sizeof(int) * n);
+    if (!out->saved_properties || !out->unsaved_properties || !out->created_searches || !out->deleted_searches) {
+        pthread_mutex_unlock(&lock);
+        user_writes_overlay_free(out);
+        return -1;
+    }
+    for (size_t i = 0; i < n; i++) {
+        const pending_op_t* op = &user->ops[i];
+        switch (op->kind) {
+            case OP_SAVE_PROPERTY:
+                out->saved_properties[out->saved_count++] = op->target_id;
+                break;
+            case OP_UNSAVE_PROPERTY:
+                out->unsaved_properties[out->unsaved_count++] = op->target_id;
+                break;
+            case OP_CREATE_SEARCH: {
+                user_search_row_t* row = &out->created_searches[out->created_count++];
+                row->id = op->target_id;
+                row->user_id = user_id;
+                row->name = op->name ? strdup(op->name) : NULL;
+                row->params = strdup(op->params);
+                row->created_at = op->created_at;
+                break;
+            }
+            case OP_DELETE_SEARCH:
+                out->deleted_searches[out->deleted_count++] = op->target_id;
+                break;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    // Ids are reserved in increasing order, so this is creation order
+    qsort(out->created_searches, out->created_count, sizeof(user_search_row_t), compare_search_rows);
+    return 0;
+}
+
+void user_writes_overlay_free(user_writes_overlay_t* overlay) {
+    for (size_t i = 0; i < overlay->created_count; i++) {
+        user_writes_free_search_row(&overlay->created_searches[i]);
+    }
+    free(overlay->saved_properties);
+    free(overlay->unsaved_properties);
+    free(overlay->created_searches);
+    free(overlay->deleted_searches);
+    memset(overlay, 0, sizeof(*overlay));
+}
+
+void user_writes_free_search_row(user_search_row_t* row) {
+    free(row->name);
+    free(row->params);
+    row->name = NULL;
+    row->params = NULL;
+}
+
+void user_writes_get_stats(user_writes_stats_t* out) {
+    out->mutations = atomic_load(&mutations);
+    out->coalesced = atomic_load(&coalesced);
+    out->rejected_busy = atomic_load(&rejected_busy);
+    out->flushes = atomic_load(&flushes);
+    out->rows_written = atomic_load(&rows_written);
+    out->failed_flushes = atomic_load(&failed_flushes);
+    pthread_mutex_lock(&lock);
+    out->pending = pending_count;
+    out->reserved_ids = id_count;
+    pthread_mutex_unlock(&lock);
+}
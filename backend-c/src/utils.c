@@ -1,5 +1,145 @@
 #include "include/utils.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+
 void print_stub(const char* func) {
     printf("[STUB] %s called.\n", func);
 }
+
+// Convert a YYYY-MM-DD (or YYYY-MM) string into a month index
+int month_index_from_date(const char* date_str) {
+    int year = 0, month = 0;
+    if (date_str == NULL || sscanf(date_str, "%d-%d", &year, &month) != 2) {
+        return -1;
+    }
+    if (month < 1 || month > 12) {
+        return -1;
+    }
+    return month_index_from_ym(year, month);
+}
+
+int month_index_from_ym(int year, int month) {
+    return (year - 1970) * 12 + (month - 1);
+}
+
+// Format a month index as the first day of that month (YYYY-MM-01)
+void month_index_to_date(int month_index, char* out, size_t out_size) {
+    int year = 1970 + month_index / 12;
+    int month = month_index % 12 + 1;
+    snprintf(out, out_size, "%04d-%02d-01", year, month);
+}
+
+int month_index_current(void) {
+    time_t now = time(NULL);
+    struct tm tm_now;
+    gmtime_r(&now, &tm_now);
+    return month_index_from_ym(tm_now.tm_year + 1900, tm_now.tm_mon + 1);
+}
+
+long long monotonic_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+void string_buffer_init(string_buffer_t* sb) {
+    sb->data = NULL;
+    sb->length = 0;
+    sb->capacity = 0;
+}
+
+static int string_buffer_reserve(string_buffer_t* sb, size_t extra) {
+    size_t needed = sb->length + extra + 1;
+    if (needed <= sb->capacity) {
+        return 0;
+    }
+
+    size_t capacity = sb->capacity ? sb->capacity : 256;
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+
+    char* data = realloc(sb->data, capacity);
+    if (data == NULL) {
+        return -1;
+    }
+    sb->data = data;
+    sb->capacity = capacity;
+    return 0;
+}
+
+int string_buffer_append(string_buffer_t* sb, const char* text, size_t length) {
+    if (string_buffer_reserve(sb, length) != 0) {
+        return -1;
+    }
+    memcpy(sb->data + sb->length, text, length);
+    sb->length += length;
+    sb->data[sb->length] = '\0';
+    return 0;
+}
+
+int string_buffer_appendf(string_buffer_t* sb, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int needed = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+
+    if (needed < 0 || string_buffer_reserve(sb, (size_t) needed) != 0) {
+        return -1;
+    }
+
+    va_start(args, format);
+    vsnprintf(sb->data + sb->length, (size_t) needed + 1, format, args);
+    va_end(args);
+    sb->length += (size_t) needed;
+    return 0;
+}
+
+void string_buffer_free(string_buffer_t* sb) {
+    free(sb->data);
+    string_buffer_init(sb);
+}
+
+static int query_string_append_escaped(string_buffer_t* sb, const char* text) {
+    for (const char* p = text; *p; p++) {
+        int rc = *p == '&' ? string_buffer_append(sb, "%26", 3)
+               : *p == '%' ? string_buffer_append(sb, "%25", 3)
+               : string_buffer_append(sb, p, 1);
+        if (rc != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int query_string_append(string_buffer_t* sb, const char* key, const char* value) {
+    if ((sb->length > 0 && string_buffer_append(sb, "&", 1) != 0) ||
+        query_string_append_escaped(sb, key) != 0) {
+        return -1;
+    }
+    if (value == NULL) {
+        return 0;
+    }
+    if (string_buffer_append(sb, "=", 1) != 0) {
+        return -1;
+    }
+    return query_string_append_escaped(sb, value);
+}
+
+double dot_product(const double* a, const double* b, int n) {
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+    for (; i < n; i++) {
+        s0 += a[i] * b[i];
+    }
+    return (s0 + s1) + (s2 + s3);
+}
@@ -0,0 +1,447 @@
+#include "include/valuation.h"
+#include "include/parallel.h"
+#include "include/utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#define DIM VALUATION_DIMENSION
+#define DISTRICT_COLUMN VALUATION_NUMERIC_COLUMNS
+#define TYPE_COLUMN (DISTRICT_COLUMN + VALUATION_MAX_DISTRICTS)
+#define FEATURE_COLUMN (TYPE_COLUMN + VALUATION_MAX_TYPES)
+
+// Listings packed per block when accumulating X'X (DIM columns of
+// TRAIN_BLOCK_ROWS doubles stay in L2)
+#define TRAIN_BLOCK_ROWS 256
+#define CHOLESKY_BLOCK 16
+#define MIN_SAMPLES 20
+#define RIDGE 1.0            // Added to the diagonal, except the intercept
+#define INTERVAL_Z 1.2816    // 80% two-sided interval
+
+// Sufficient statistics of the least-squares problem on log price; only
+// the upper triangle of the Gram matrix is maintained
+typedef struct {
+    double gram[DIM * DIM];
+    double xty[DIM];
+    double yty;
+    double y_sum;
+    long n;
+} normal_equations_t;
+
+static pthread_mutex_t equations_lock = PTHREAD_MUTEX_INITIALIZER;
+static normal_equations_t equations;
+static atomic_int equations_ready;
+static int equations_dirty = 0;
+
+static pthread_rwlock_t model_lock = PTHREAD_RWLOCK_INITIALIZER;
+static double coefficients[DIM];
+static valuation_stats_t model_stats;
+static int model_ready = 0;
+
+typedef struct {
+    const property_t* listings;
+    normal_equations_t* partials;  // One per worker
+    double* blocks;                // Per worker: DIM columns of TRAIN_BLOCK_ROWS, then the targets
+} train_job_t;
+
+static int listing_is_valid(const property_t* p) {
+    return p->price > 0 && p->area_sqm > 0;
+}
+
+void valuation_pack_features(const property_t* p, double* out) {
+    memset(out, 0, sizeof(double) * DIM);
+    out[0] = 1.0;
+    out[1] = log(p->area_sqm > 0 ? (double) p->area_sqm : 1.0);
+    out[2] = p->num_rooms < 0 ? 0.0 : (p->num_rooms > 6 ? 6.0 : (double) p->num_rooms);
+
+    if (p->floor > 0 && p->total_floors > 0) {
+        out[3] = (double) p->floor / p->total_floors;
+        out[4] = p->floor == 1 ? 1.0 : 0.0;
+        out[5] = (p->floor == p->total_floors && p->total_floors > 1) ? 1.0 : 0.0;
+    } else {
+        out[6] = 1.0;
+    }
+
+    if (p->year_built > 0) {
+        double decades = (p->year_built - 1980) / 10.0;
+        out[7] = decades;
+        out[8] = decades * decades;
+    } else {
+        out[9] = 1.0;
+    }
+
+    if (p->district_id >= 1 && p->district_id <= VALUATION_MAX_DISTRICTS) {
+        out[DISTRICT_COLUMN + p->district_id - 1] = 1.0;
+    }
+    if (p->type_id >= 1 && p->type_id <= VALUATION_MAX_TYPES) {
+        out[TYPE_COLUMN + p->type_id - 1] = 1.0;
+    }
+    for (int b = 0; b < VALUATION_MAX_FEATURES; b++) {
+        out[FEATURE_COLUMN + b] = (double) ((p->features >> b) & 1u);
+    }
+}
+
+// Add (sign = 1) or remove (sign = -1) one listing
+static void equations_apply(normal_equations_t* eq, const property_t* p, double sign) {
+    double x[DIM];
+    valuation_pack_features(p, x);
+    double y = log((double) p->price);
+
+    for (int i = 0; i < DIM; i++) {
+        if (x[i] == 0.0) {
+            continue;
+        }
+        double xi = sign * x[i];
+        eq->xty[i] += xi * y;
+        double* row = &eq->gram[i * DIM];
+        for (int j = i; j < DIM; j++) {
+            row[j] += xi * x[j];
+        }
+    }
+    eq->yty += sign * y * y;
+    eq->y_sum += sign * y;
+    eq->n += sign > 0 ? 1 : -1;
+}
+
+static void equations_merge(normal_equations_t* into, const normal_equations_t* from) {
+    for (int i = 0; i < DIM * DIM; i++) {
+        into->gram[i] += from->gram[i];
+    }
+    for (int i = 0; i < DIM; i++) {
+        into->xty[i] += from->xty[i];
+    }
+    into->yty += from->yty;
+    into->y_sum += from->y_sum;
+    into->n += from->n;
+}
+
+// Accumulate one packed block: every Gram entry is a dot product of two
+// contiguous columns
+static void equations_add_block(normal_equations_t* eq, const double* columns, const double* y, int rows) {
+    for (int i = 0; i < DIM; i++) {
+        const double* ci = &columns[(size_t) i * TRAIN_BLOCK_ROWS];
+        eq->xty[i] += dot_product(ci, y, rows);
+        double* row = &eq->gram[i * DIM];
+        for (int j = i; j < DIM; j++) {
+            row[j] += dot_product(ci, &columns[(size_t) j * TRAIN_BLOCK_ROWS], rows);
+        }
+    }
+    for (int r = 0; r < rows; r++) {
+        eq->y_sum += y[r];
+    }
+    eq->yty += dot_product(y, y, rows);
+    eq->n += rows;
+}
+
+static void train_task(size_t begin, size_t end, int worker, void* ctx) {
+    train_job_t* job = ctx;
+    normal_equations_t* eq = &job->partials[worker];
+    double* columns = &job->blocks[(size_t) worker * (DIM + 1) * TRAIN_BLOCK_ROWS];
+    double* y = columns + (size_t) DIM * TRAIN_BLOCK_ROWS;
+    double x[DIM];
+
+    int rows = 0;
+    for (size_t i = begin; i < end; i++) {
+        const property_t* p = &job->listings[i];
+        if (!listing_is_valid(p)) {
+            continue;
+        }
+        valuation_pack_features(p, x);
+        for (int c = 0; c < DIM; c++) {
+            columns[(size_t) c * TRAIN_BLOCK_ROWS + rows] = x[c];
+        }
+        y[rows++] = log((double) p->price);
+        if (rows == TRAIN_BLOCK_ROWS) {
+            equations_add_block(eq, columns, y, rows);
+            rows = 0;
+        }
+    }
+    if (rows > 0) {
+        equations_add_block(eq, columns, y, rows);
+    }
+}
+
+// In-place blocked Cholesky factorization of a row-major symmetric
+// matrix; the lower triangle receives L. Returns non-zero if the matrix
+// is not positive definite.
+static int cholesky_blocked(double* a, int n) {
+    for (int k = 0; k < n; k += CHOLESKY_BLOCK) {
+        int kend = k + CHOLESKY_BLOCK < n ? k + CHOLESKY_BLOCK : n;
+
+        // Diagonal block
+        for (int j = k; j < kend; j++) {
+            double d = a[j * n + j] - dot_product(&a[j * n + k], &a[j * n + k], j - k);
+            if (d <= 0.0) {
+                return 1;
+            }
+            a[j * n + j] = sqrt(d);
+            for (int i = j + 1; i < kend; i++) {
+                a[i * n + j] = (a[i * n + j] - dot_product(&a[i * n + k], &a[j * n + k], j - k)) / a[j * n + j];
+            }
+        }
+
+        // Panel below the diagonal block
+        for (int i = kend; i < n; i++) {
+            for (int j = k; j < kend; j++) {
+                a[i * n + j] = (a[i * n + j] - dot_product(&a[i * n + k], &a[j * n + k], j - k)) / a[j * n + j];
+            }
+        }
+
+        // Trailing update with the panel (lower triangle only)
+        for (int i = kend; i < n; i++) {
+            for (int j = kend; j <= i; j++) {
+                a[i * n + j] -= dot_product(&a[i * n + k], &a[j * n + k], kend - k);
+            }
+        }
+    }
+    return 0;
+}
+
+static int equations_solve(const normal_equations_t* eq, double* beta, valuation_stats_t* stats) {
+    if (eq->n < MIN_SAMPLES) {
+        return 1;
+    }
+
+    double* a = malloc(sizeof(double) * DIM * DIM);
+    if (a == NULL) {
+        return 1;
+    }
+    for (int i = 0; i < DIM; i++) {
+        for (int j = i; j < DIM; j++) {
+            a[i * DIM + j] = a[j * DIM + i] = eq->gram[i * DIM + j];
+        }
+        if (i > 0) {
+            a[i * DIM + i] += RIDGE;
+        }
+    }
+    if (cholesky_blocked(a, DIM) != 0) {
+        free(a);
+        return 1;
+    }
+
+    // L z = X'y, then L' beta = z
+    for (int i = 0; i < DIM; i++) {
+        beta[i] = (eq->xty[i] - dot_product(&a[i * DIM], beta, i)) / a[i * DIM + i];
+    }
+    for (int i = DIM - 1; i >= 0; i--) {
+        double sum = beta[i];
+        for (int k = i + 1; k < DIM; k++) {
+            sum -= a[k * DIM + i] * beta[k];
+        }
+        beta[i] = sum / a[i * DIM + i];
+    }
+    free(a);
+
+    // SSE = y'y - 2 beta'X'y + beta'X'X beta (Gram without the ridge)
+    double quadratic = 0.0;
+    for (int i = 0; i < DIM; i++) {
+        double row = eq->gram[i * DIM + i] * beta[i];
+        for (int j = i + 1; j < DIM; j++) {
+            row += 2.0 * eq->gram[i * DIM + j] * beta[j];
+        }
+        quadratic += beta[i] * row;
+    }
+    double sse = eq->yty - 2.0 * dot_product(beta, eq->xty, DIM) + quadratic;
+    double sst = eq->yty - eq->y_sum * eq->y_sum / eq->n;
+    long dof = eq->n > DIM ? eq->n - DIM : 1;
+
+    stats->samples = eq->n;
+    stats->residual_sd = sqrt(sse > 0.0 ? sse / dof : 0.0);
+    stats->r_squared = sst > 0.0 ? 1.0 - (sse > 0.0 ? sse : 0.0) / sst : 0.0;
+    stats->stale = 0;
+    return 0;
+}
+
+static int model_publish_from(const normal_equations_t* eq) {
+    double beta[DIM];
+    valuation_stats_t stats;
+    if (equations_solve(eq, beta, &stats) != 0) {
+        return 1;
+    }
+    pthread_rwlock_wrlock(&model_lock);
+    memcpy(coefficients, beta, sizeof(beta));
+    model_stats = stats;
+    model_ready = 1;
+    pthread_rwlock_unlock(&model_lock);
+    return 0;
+}
+
+static void valuation_on_ingest(const property_t* previous, const property_t* current, void* ctx) {
+    (void) ctx;
+    // Listings ingested before the first training are picked up by it
+    if (!atomic_load(&equations_ready)) {
+        return;
+    }
+    if (previous != NULL && previous->price == current->price && previous->area_sqm == current->area_sqm &&
+        previous->num_rooms == current->num_rooms && previous->floor == current->floor &&
+        previous->total_floors == current->total_floors && previous->year_built == current->year_built &&
+        previous->district_id == current->district_id && previous->type_id == current->type_id &&
+        previous->features == current->features) {
+        return; // Nothing the model uses has changed
+    }
+
+    pthread_mutex_lock(&equations_lock);
+    if (previous != NULL && listing_is_valid(previous)) {
+        equations_apply(&equations, previous, -1.0);
+    }
+    if (listing_is_valid(current)) {
+        equations_apply(&equations, current, 1.0);
+    }
+    equations_dirty = 1;
+    pthread_mutex_unlock(&equations_lock);
+}
+
+void valuation_init(void) {
+    properties_register_ingest_hook(valuation_on_ingest, NULL);
+}
+
+int valuation_train(int workers) {
+    if (workers <= 0) {
+        workers = parallel_default_workers();
+    }
+
+    train_job_t job;
+    job.partials = calloc((size_t) workers, sizeof(normal_equations_t));
+    job.blocks = malloc(sizeof(double) * (size_t) workers * (DIM + 1) * TRAIN_BLOCK_ROWS);
+    normal_equations_t* total = calloc(1, sizeof(normal_equations_t));
+    if (job.partials == NULL || job.blocks == NULL || total == NULL) {
+        free(job.partials);
+        free(job.blocks);
+        free(total);
+        return 1;
+    }
+
+    size_t count = 0;
+    job.listings = properties_acquire(&count);
+    int rc = parallel_for(count, TRAIN_BLOCK_ROWS, workers, train_task, &job) < 0 ? 1 : 0;
+    properties_release();
+
+    for (int w = 0; w < workers && rc == 0; w++) {
+        equations_merge(total, &job.partials[w]);
+    }
+
+    if (rc == 0) {
+        pthread_mutex_lock(&equations_lock);
+        equations = *total;
+        equations_dirty = 0;
+        atomic_store(&equations_ready, 1);
+        pthread_mutex_unlock(&equations_lock);
+        rc = model_publish_from(total);
+    }
+
+    if (rc == 0) {
+        printf("Valuation model trained on %ld listings (R^2 %.3f)\n", model_stats.samples, model_stats.r_squared);
+    }
+    free(job.partials);
+    free(job.blocks);
+    free(total);
+    return rc;
+}
+
+int valuation_update(void) {
+    normal_equations_t* snapshot = malloc(sizeof(normal_equations_t));
+    if (snapshot == NULL) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&equations_lock);
+    int dirty = equations_dirty;
+    if (dirty) {
+        *snapshot = equations;
+        equations_dirty = 0;
+    }
+    pthread_mutex_unlock(&equations_lock);
+
+    int rc = 0;
+    if (dirty) {
+        if (model_publish_from(snapshot) == 0) {
+            rc = 1;
+        } else {
+            // Keep serving the previous model; retry after the next ingest
+            pthread_mutex_lock(&equations_lock);
+            equations_dirty = 1;
+            pthread_mutex_unlock(&equations_lock);
+            rc = -1;
+        }
+    }
+    free(snapshot);
+    return rc;
+}
+
+int valuation_estimate(const property_t* properties, size_t count, valuation_t* out) {
+    double x[DIM];
+
+    pthread_rwlock_rdlock(&model_lock);
+    if (!model_ready) {
+        pthread_rwlock_unlock(&model_lock);
+        return 1;
+    }
+    double spread = INTERVAL_Z * model_stats.residual_sd;
+
+    for (size_t i = 0; i < count; i++) {
+        const property_t* p = &properties[i];
+        valuation_t* v = &out[i];
+        valuation_pack_features(p, x);
+        double log_price = dot_product(coefficients, x, DIM);
+
+        // Log-normal: exp of the fitted log price is the median price
+        v->property_id = p->id;
+        v->asking_price = p->price;
+        v->estimated_price = exp(log_price);
+        v->low = exp(log_price - spread);
+        v->high = exp(log_price + spread);
+        v->difference_pct = 100.0 * (p->price - v->estimated_price) / v->estimated_price;
+        if (p->price < v->low) {
+            v->verdict = "undervalued";
+        } else if (p->price > v->high) {
+            v->verdict = "overvalued";
+        } else {
+            v->verdict = "fair";
+        }
+    }
+    pthread_rwlock_unlock(&model_lock);
+    return 0;
+}
+
+void valuation_get_stats(valuation_stats_t* out) {
+    pthread_rwlock_rdlock(&model_lock);
+    *out = model_stats;
+    pthread_rwlock_unlock(&model_lock);
+
+    pthread_mutex_lock(&equations_lock);
+    out->stale = equations_dirty;
+    pthread_mutex_unlock(&equations_lock);
+}
+
+json_t* valuation_get_handler(int property_id) {
+    property_t property;
+    valuation_t valuation;
+    if (properties_find(property_id, &property) != 0 || valuation_estimate(&property, 1, &valuation) != 0) {
+        return NULL;
+    }
+    valuation_stats_t stats;
+    valuation_get_stats(&stats);
+
+    json_t* range = json_object();
+    json_object_set_new(range, "low", json_real(valuation.low));
+    json_object_set_new(range, "high", json_real(valuation.high));
+
+    json_t* model = json_object();
+    json_object_set_new(model, "samples", json_integer(stats.samples));
+    json_object_set_new(model, "r_squared", json_real(stats.r_squared));
+
+    json_t* json_obj = json_object();
+    json_object_set_new(json_obj, "property_id", json_integer(valuation.property_id));
+    json_object_set_new(json_obj, "asking_price", json_integer(valuation.asking_price));
+    json_object_set_new(json_obj, "estimated_price", json_real(valuation.estimated_price));
+    json_object_set_new(json_obj, "estimated_price_per_sqm",
+                        json_real(property.area_sqm > 0 ? valuation.estimated_price / property.area_sqm : 0.0));
+    json_object_set_new(json_obj, "range", range);
+    json_object_set_new(json_obj, "difference_pct", json_real(valuation.difference_pct));
+    json_object_set_new(json_obj, "verdict", json_string(valuation.verdict));
+    json_object_set_new(json_obj, "model", model);
+    return json_obj;
+}
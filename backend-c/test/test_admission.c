@@ -0,0 +1,208 @@
+#include "../src/include/admission.h"
+#include "../src/include/db.h"
+#include "../src/include/utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <arpa/inet.h>
+
+#define LOAD_THREADS 8
+#define LOAD_CHECKS 200000    // Per thread
+#define LOAD_BURST 1000
+
+// Test utility functions
+void print_separator() {
+    printf("\n--------------------------------------------------\n");
+}
+
+void print_test_header(const char* test_name) {
+    print_separator();
+    printf("TEST: %s\n", test_name);
+    print_separator();
+}
+
+static double elapsed_us(struct timespec start, struct timespec end) {
+    return (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3;
+}
+
+static struct sockaddr_in ipv4(const char* text) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    assert(inet_pton(AF_INET, text, &addr.sin_addr) == 1);
+    return addr;
+}
+
+static struct sockaddr_in6 ipv6(const char* text) {
+    struct sockaddr_in6 addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin6_family = AF_INET6;
+    assert(inet_pton(AF_INET6, text, &addr.sin6_addr) == 1);
+    return addr;
+}
+
+// Test the per-client token buckets
+void test_rate_limit() {
+    print_test_header("admission (per-client token buckets)");
+
+    admission_configure(20, 10, 0);
+    struct sockaddr_in client = ipv4("192.0.2.10");
+    struct sockaddr_in other = ipv4("192.0.2.11");
+    unsigned int retry_after = 0;
+
+    // A burst, then the client is turned away with a hint
+    for (int i = 0; i < 10; i++) {
+        assert(admission_check_rate((struct sockaddr*) &client, &retry_after) == ADMISSION_OK);
+    }
+    assert(admission_check_rate((struct sockaddr*) &client, &retry_after) == ADMISSION_RATE_LIMITED);
+    assert(retry_after == 1);
+
+    // Other clients keep their own bucket
+    assert(admission_check_rate((struct sockaddr*) &other, &retry_after) == ADMISSION_OK);
+
+    // Tokens come back at the configured rate (20/s: one per 50 ms)
+    long long slept_from = monotonic_ms();
+    usleep(120000);
+    int granted = 0;
+    while (admission_check_rate((struct sockaddr*) &client, &retry_after) == ADMISSION_OK) {
+        granted++;
+    }
+    long long slept = monotonic_ms() - slept_from;
+    printf("Tokens after %lld ms at 20/s: %d\n", slept, granted);
+    assert(granted >= 2 && granted <= slept / 50 + 1);
+
+    // IPv6 clients are limited by their /64
+    struct sockaddr_in6 host_a = ipv6("2001:db8:1:2::a");
+    struct sockaddr_in6 host_b = ipv6("2001:db8:1:2::b");
+    struct sockaddr_in6 elsewhere = ipv6("2001:db8:1:3::a");
+    for (int i = 0; i < 10; i++) {
+        assert(admission_check_rate((struct sockaddr*) (i % 2 ? &host_a : &host_b), &retry_after) == ADMISSION_OK);
+    }
+    assert(admission_check_rate((struct sockaddr*) &host_a, &retry_after) == ADMISSION_RATE_LIMITED);
+    assert(admission_check_rate((struct sockaddr*) &elsewhere, &retry_after) == ADMISSION_OK);
+
+    // Requests without an address and a disabled limit always pass
+    assert(admission_check_rate(NULL, &retry_after) == ADMISSION_OK);
+    admission_configure(0, 10, 0);
+    assert(admission_check_rate((struct sockaddr*) &client, &retry_after) == ADMISSION_OK);
+    printf("Test passed!\n");
+}
+
+static atomic_long granted_total = 0;
+
+static void* hammer_thread(void* arg) {
+    struct sockaddr_in* client = arg;
+    long granted = 0;
+    unsigned int retry_after = 0;
+    for (int i = 0; i < LOAD_CHECKS; i++) {
+        if (admission_check_rate((struct sockaddr*) client, &retry_after) == ADMISSION_OK) {
+            granted++;
+        }
+    }
+    atomic_fetch_add(&granted_total, granted);
+    return NULL;
+}
+
+// Test that concurrent takes from one bucket never overdraw it
+void test_concurrent_bucket() {
+    print_test_header("admission (one bucket, many threads)");
+
+    admission_configure(1, LOAD_BURST, 0);
+    struct sockaddr_in client = ipv4("198.51.100.7");
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pthread_t threads[LOAD_THREADS];
+    for (int t = 0; t < LOAD_THREADS; t++) {
+        pthread_create(&threads[t], NULL, hammer_thread, &client);
+    }
+    for (int t = 0; t < LOAD_THREADS; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double us = elapsed_us(start, end);
+
+    long total = (long) LOAD_THREADS * LOAD_CHECKS;
+    long granted = atomic_load(&granted_total);
+    printf("%ld checks in %.1f ms (%.0f/s), %ld granted\n", total, us / 1000.0, total / (us / 1e6), granted);
+    assert(granted >= LOAD_BURST && granted <= LOAD_BURST + (long) (us / 1e6) + 1);
+    printf("Test passed!\n");
+}
+
+// Test the global in-flight limit
+void test_in_flight() {
+    print_test_header("admission (in-flight limit)");
+
+    admission_configure(0, 1, 4);
+    admission_stats_t before;
+    admission_get_stats(&before);
+    for (int i = 0; i < 4; i++) {
+        assert(admission_enter() == ADMISSION_OK);
+    }
+    assert(admission_enter() == ADMISSION_OVERLOADED);
+    assert(admission_enter() == ADMISSION_OVERLOADED);
+    admission_leave();
+    assert(admission_enter() == ADMISSION_OK);
+
+    admission_record_deadline_exceeded();
+    admission_stats_t after;
+    admission_get_stats(&after);
+    assert(after.in_flight == 4);
+    assert(after.admitted - before.admitted == 5 && after.shed - before.shed == 2);
+    assert(after.deadline_exceeded - before.deadline_exceeded == 1);
+    for (int i = 0; i < 4; i++) {
+        admission_leave();
+    }
+    admission_get_stats(&after);
+    assert(after.in_flight == 0);
+    printf("Test passed!\n");
+}
+
+// Test that database work is not started past the deadline
+void test_db_deadline() {
+    print_test_header("db deadlines");
+
+    PGconn* conn = PQconnectdb("host=/nonexistent connect_timeout=1");
+    db_deadline_stats_t before, after;
+    db_get_deadline_stats(&before);
+
+    db_set_deadline(monotonic_ms() - 1);
+    assert(db_deadline_hit() == 0);
+    assert(db_query_params(conn, "SELECT 1", 0, NULL) == NULL);
+    assert(db_deadline_hit() == 1 && "A passed deadline should stop the query before it is sent");
+    db_statement_t statement = { "SELECT 1", 0, NULL };
+    PGresult* result = NULL;
+    assert(db_pipeline(conn, &statement, 1, &result) != 0 && result == NULL);
+    db_get_deadline_stats(&after);
+    assert(after.skipped - before.skipped == 2);
+
+    // Clearing the deadline clears the flag; failures are then ordinary ones
+    db_set_deadline(0);
+    assert(db_deadline_hit() == 0);
+    assert(db_query_params(conn, "SELECT 1", 0, NULL) == NULL && db_deadline_hit() == 0);
+
+    // A deadline still ahead does not count a connection failure against it
+    db_set_deadline(monotonic_ms() + 1000);
+    assert(db_query_params(conn, "SELECT 1", 0, NULL) == NULL && db_deadline_hit() == 0);
+    db_set_deadline(0);
+    PQfinish(conn);
+    printf("Test passed!\n");
+}
+
+// Main test function
+int main() {
+    printf("Starting admission control tests...\n");
+
+    test_rate_limit();
+    test_concurrent_bucket();
+    test_in_flight();
+    test_db_deadline();
+
+    print_separator();
+    printf("All tests passed!\n");
+    return 0;
+}
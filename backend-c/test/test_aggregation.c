@@ -0,0 +1,161 @@
+#include "../src/include/aggregation.h"
+#include "../src/include/prediction.h"
+#include "../src/include/utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+
+// Test utility functions
+void print_separator() {
+    printf("\n--------------------------------------------------\n");
+}
+
+void print_test_header(const char* test_name) {
+    print_separator();
+    printf("TEST: %s\n", test_name);
+    print_separator();
+}
+
+static property_t make_listing(int id, int district_id, int rooms, int area, int price, int month) {
+    property_t p;
+    memset(&p, 0, sizeof(p));
+    p.id = id;
+    p.district_id = district_id;
+    p.num_rooms = rooms;
+    p.area_sqm = area;
+    p.price = price;
+    p.month_listed = month;
+    p.status = PROPERTY_STATUS_ACTIVE;
+    return p;
+}
+
+// Test month index round trip
+void test_month_index() {
+    print_test_header("month_index helpers");
+
+    int month = month_index_from_date("2024-03-15");
+    assert(month == month_index_from_ym(2024, 3) && "Date should map to its month");
+
+    char date_str[16];
+    month_index_to_date(month, date_str, sizeof(date_str));
+    printf("2024-03-15 -> month %d -> %s\n", month, date_str);
+    assert(strcmp(date_str, "2024-03-01") == 0 && "Month should format as first day");
+    assert(month_index_from_date("not a date") == -1 && "Invalid dates should be rejected");
+
+    printf("Test passed!\n");
+}
+
+// Test the parallel group-by against a sequential reference
+void test_group_by() {
+    print_test_header("aggregation_group_by");
+
+    const int count = 20000;
+    const int base_month = month_index_from_ym(2024, 1);
+    property_t* listings = malloc(sizeof(property_t) * count);
+
+    // Reference sums for district 2, 3 rooms, first month
+    double ref_sum = 0.0;
+    int ref_count = 0;
+    for (int i = 0; i < count; i++) {
+        int district = 1 + i % 5;
+        int rooms = 1 + (i / 5) % 4;
+        int month = base_month + (i / 20) % 12;
+        int area = 40 + i % 60;
+        int price = 30000 + (i * 37) % 70000;
+        listings[i] = make_listing(i + 1, district, rooms, area, price, month);
+        if (district == 2 && rooms == 3 && month == base_month) {
+            ref_sum += (double) price / area;
+            ref_count++;
+        }
+    }
+    // Invalid rows must be skipped
+    listings[0].area_sqm = 0;
+
+    price_history_row_t* rows = NULL;
+    size_t row_count = 0;
+    int rc = aggregation_group_by(listings, count, NULL, 4, &rows, &row_count);
+    assert(rc == 0 && "Group-by should succeed");
+
+    printf("Aggregated %d listings into %zu groups\n", count, row_count);
+    assert(row_count == 5 * 4 * 12 && "Every (district, rooms, month) group should be present");
+
+    int total = 0;
+    const price_history_row_t* match = NULL;
+    for (size_t i = 0; i < row_count; i++) {
+        total += rows[i].sample_size;
+        if (i > 0) {
+            assert((rows[i - 1].district_id < rows[i].district_id ||
+                    (rows[i - 1].district_id == rows[i].district_id && rows[i - 1].room_count < rows[i].room_count) ||
+                    (rows[i - 1].district_id == rows[i].district_id && rows[i - 1].room_count == rows[i].room_count &&
+                     rows[i - 1].month < rows[i].month)) && "Rows should be sorted");
+        }
+        if (rows[i].district_id == 2 && rows[i].room_count == 3 && rows[i].month == base_month) {
+            match = &rows[i];
+        }
+    }
+    assert(total == count - 1 && "All valid listings should be counted once");
+    assert(match != NULL && match->sample_size == ref_count && "Group count should match reference");
+    assert(fabs(match->avg_price_per_sqm - ref_sum / ref_count) < 1e-9 && "Group average should match reference");
+
+    free(rows);
+    free(listings);
+    printf("Test passed!\n");
+}
+
+// Test dirty-month tracking through the ingest hook and the served series
+void test_incremental_run() {
+    print_test_header("aggregation_run (dirty months)");
+
+    aggregation_init();
+
+    const int month = month_index_from_ym(2025, 6);
+    property_t batch[3] = {
+        make_listing(101, 7, 2, 50, 50000, month),
+        make_listing(102, 7, 2, 50, 60000, month),
+        make_listing(103, 7, 2, 50, 55000, month + 1)
+    };
+    assert(properties_ingest(batch, 3) == 0 && "Ingest should succeed");
+
+    int recomputed = aggregation_run(NULL, 2);
+    printf("First run recomputed %d month(s)\n", recomputed);
+    assert(recomputed == 2 && "Both touched months should be dirty");
+    assert(aggregation_run(NULL, 2) == 0 && "Nothing should be dirty after a run");
+
+    // A status-only change does not dirty anything
+    property_t sold = batch[0];
+    sold.status = PROPERTY_STATUS_SOLD;
+    properties_ingest(&sold, 1);
+    assert(aggregation_run(NULL, 2) == 0 && "Status changes should not dirty months");
+
+    // A price change dirties only its own month
+    property_t repriced = batch[2];
+    repriced.price = 65000;
+    properties_ingest(&repriced, 1);
+    assert(aggregation_run(NULL, 2) == 1 && "Only the repriced month should be recomputed");
+
+    int count = 0;
+    price_trend_point_t* trends = get_price_trends(7, 2, 12, &count);
+    printf("Series has %d point(s): %.1f, %.1f\n", count, trends[0].price, trends[count - 1].price);
+    assert(count == 2 && "Trends should be served from the aggregated view");
+    assert(fabs(trends[0].price - 1100.0) < 1e-9 && "First month average should be 1100/sqm");
+    assert(fabs(trends[1].price - 1300.0) < 1e-9 && "Repriced month should reflect the new price");
+    assert(trends[0].sample_size == 2 && "Sample size should count listings");
+
+    free(trends);
+    printf("Test passed!\n");
+}
+
+// Main test function
+int main() {
+    printf("Starting aggregation module tests...\n");
+
+    test_month_index();
+    test_group_by();
+    test_incremental_run();
+
+    print_separator();
+    printf("All tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,148 @@
+#include "../src/include/api_handler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+// Test utility functions
+void print_separator() {
+    printf("\n--------------------------------------------------\n");
+}
+
+void print_test_header(const char* test_name) {
+    print_separator();
+    printf("TEST: %s\n", test_name);
+    print_separator();
+}
+
+static const char* method_name(http_method_t method) {
+    switch (method) {
+    case METHOD_GET:
+        return "GET";
+    case METHOD_POST:
+        return "POST";
+    case METHOD_PUT:
+        return "PUT";
+    case METHOD_DELETE:
+        return "DELETE";
+    }
+    return "";
+}
+
+static void free_params(char** params) {
+    for (int i = 0; i < API_MAX_ROUTE_PARAMS; i++) {
+        free(params[i]);
+        params[i] = NULL;
+    }
+}
+
+// Route path with every ":name" segment replaced by "<n>0<n>" (n from 1)
+static int concrete_url(const char* path, char* out, size_t out_size) {
+    size_t length = 0;
+    int param_count = 0;
+    while (*path != '\0' && length + 8 < out_size) {
+        if (path[0] == ':') {
+            param_count++;
+            length += (size_t) snprintf(out + length, out_size - length, "%d0%d", param_count, param_count);
+            path += strcspn(path, "/");
+        } else {
+            out[length++] = *path++;
+        }
+    }
+    out[length] = '\0';
+    return param_count;
+}
+
+// Test that every entry in the route table resolves to itself
+void test_route_table() {
+    print_test_header("api_handler (every route resolves)");
+
+    size_t count = 0;
+    const api_route_t* routes = api_routes(&count);
+    assert(count > 0);
+    for (size_t i = 0; i < count; i++) {
+        char url[256];
+        char* params[API_MAX_ROUTE_PARAMS] = {NULL};
+        int param_count = concrete_url(routes[i].path, url, sizeof(url));
+        const api_route_t* route = api_find_route(url, method_name(routes[i].method), params);
+        printf("%-6s %-40s -> %s\n", method_name(routes[i].method), url, route ? route->path : "(none)");
+        assert(route == &routes[i]);
+        assert((route->handler != NULL) != (route->user_handler != NULL));
+        for (int p = 0; p < API_MAX_ROUTE_PARAMS; p++) {
+            if (p < param_count) {
+                char expected[16];
+                snprintf(expected, sizeof(expected), "%d0%d", p + 1, p + 1);
+                assert(params[p] != NULL && strcmp(params[p], expected) == 0);
+            } else {
+                assert(params[p] == NULL);
+            }
+        }
+        free_params(params);
+    }
+
+    printf("Test passed!\n");
+}
+
+// Test paths and methods that must not resolve, or resolve elsewhere
+void test_mismatches() {
+    print_test_header("api_handler (mismatches)");
+
+    char* params[API_MAX_ROUTE_PARAMS] = {NULL};
+    const char* misses[][2] = {
+        { "GET", "/api/properties/5/unknown" },
+        { "GET", "/api/properties/5/valuation/extra" },
+        { "GET", "/api/nothing" },
+        { "GET", "/" },
+        { "GET", "" },
+        { "POST", "/api/properties" },
+        { "PATCH", "/api/properties/5" },
+        { "DELETE", "/api/user/saved-properties" },
+        { "GET", "/api/user/saved-properties/5" }
+    };
+    for (size_t i = 0; i < sizeof(misses) / sizeof(misses[0]); i++) {
+        assert(api_find_route(misses[i][1], misses[i][0], params) == NULL);
+        // Partial matches leave no copies behind
+        for (int p = 0; p < API_MAX_ROUTE_PARAMS; p++) {
+            assert(params[p] == NULL);
+        }
+    }
+
+    // The segment after a parameter decides the route
+    const api_route_t* route = api_find_route("/api/properties/5/comparables", "GET", params);
+    assert(route != NULL && strcmp(route->path, "/api/properties/:id/comparables") == 0);
+    assert(strcmp(params[0], "5") == 0);
+    free_params(params);
+    route = api_find_route("/api/properties/5", "GET", params);
+    assert(route != NULL && strcmp(route->path, "/api/properties/:id") == 0);
+    free_params(params);
+
+    // Repeated and trailing slashes are ignored
+    route = api_find_route("//api/districts/7/stats/", "GET", params);
+    assert(route != NULL && strcmp(route->path, "/api/districts/:id/stats") == 0);
+    assert(strcmp(params[0], "7") == 0);
+    free_params(params);
+
+    // URLs longer than any fixed buffer still match in full
+    char long_url[1024];
+    memset(long_url, 0, sizeof(long_url));
+    strcpy(long_url, "/api/properties/");
+    memset(long_url + strlen(long_url), '9', 900);
+    route = api_find_route(long_url, "GET", params);
+    assert(route != NULL && strcmp(route->path, "/api/properties/:id") == 0);
+    assert(strlen(params[0]) == 900);
+    free_params(params);
+
+    printf("Test passed!\n");
+}
+
+// Main test function
+int main() {
+    printf("Starting API routing tests...\n");
+
+    test_route_table();
+    test_mismatches();
+
+    print_separator();
+    printf("All tests passed!\n");
+    return 0;
+}
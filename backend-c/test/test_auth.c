@@ -0,0 +1,193 @@
+#include "../src/include/auth.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <pthread.h>
+#include <crypt.h>
+
+#define TOKEN_ROUNDS 100000
+#define BUSY_THREADS 80
+
+// Test utility functions
+void print_separator() {
+    printf("\n--------------------------------------------------\n");
+}
+
+void print_test_header(const char* test_name) {
+    print_separator();
+    printf("TEST: %s\n", test_name);
+    print_separator();
+}
+
+static double elapsed_us(struct timespec start, struct timespec end) {
+    return (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3;
+}
+
+// Test issuing, verifying, tampering with and revoking tokens
+void test_tokens() {
+    print_test_header("auth (session tokens)");
+
+    char token[AUTH_TOKEN_MAX_LENGTH];
+    time_t expires = 0;
+    assert(auth_issue_token(42, token, sizeof(token), &expires) == AUTH_OK);
+    printf("Token: %s\n", token);
+    assert(expires > time(NULL) + AUTH_TOKEN_TTL_SECONDS - 10);
+
+    int user_id = 0;
+    assert(auth_verify_token(token, &user_id) == AUTH_OK && user_id == 42);
+
+    // Any change to the claims or the MAC is rejected
+    char forged[AUTH_TOKEN_MAX_LENGTH + 1];
+    snprintf(forged, sizeof(forged), "1%s", token);
+    assert(auth_verify_token(forged, &user_id) == AUTH_ERR_INVALID);
+    snprintf(forged, sizeof(forged), "%s", token);
+    forged[strlen(forged) - 1] = forged[strlen(forged) - 1] == 'A' ? 'B' : 'A';
+    assert(auth_verify_token(forged, &user_id) == AUTH_ERR_INVALID);
+    assert(auth_verify_token("", &user_id) == AUTH_ERR_INVALID);
+    assert(auth_verify_token("42.99999999999.0000000000000001.x", &user_id) == AUTH_ERR_INVALID);
+
+    // Verification is a single HMAC, no hashing or database round trip
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < TOKEN_ROUNDS; i++) {
+        assert(auth_verify_token(token, &user_id) == AUTH_OK);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double us = elapsed_us(start, end) / TOKEN_ROUNDS;
+    printf("Token verification: %.2f us\n", us);
+    assert(us < 50.0 && "Token checks should cost microseconds");
+
+    // Revoked tokens stop working; other tokens are unaffected
+    char other[AUTH_TOKEN_MAX_LENGTH];
+    assert(auth_issue_token(42, other, sizeof(other), NULL) == AUTH_OK);
+    assert(auth_revoke_token(token) == AUTH_OK);
+    assert(auth_revoke_token(token) == AUTH_ERR_REVOKED);
+    assert(auth_verify_token(token, &user_id) == AUTH_ERR_REVOKED);
+    assert(auth_verify_token(other, &user_id) == AUTH_OK);
+    assert(auth_revoke_token(forged) == AUTH_ERR_INVALID);
+
+    auth_stats_t stats;
+    auth_get_stats(&stats);
+    assert(stats.revoked == 1);
+    printf("Test passed!\n");
+}
+
+// Test hashing and verifying passwords on the worker pool
+void test_passwords() {
+    print_test_header("auth (password hashing)");
+
+    char hash[128];
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    assert(auth_hash_password("correct horse battery", hash, sizeof(hash)) == AUTH_OK);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("Hash: %s (%.0f ms)\n", hash, elapsed_us(start, end) / 1000.0);
+    assert(strncmp(hash, "$2b$12$", 7) == 0);
+
+    assert(auth_verify_password("correct horse battery", hash) == AUTH_OK);
+    assert(auth_verify_password("correct horse battery!", hash) == AUTH_ERR_INVALID);
+
+    // Without a database pool, users cannot be looked up
+    auth_user_t user;
+    assert(login_user("nobody@example.com", "password", &user) == AUTH_ERR_INTERNAL);
+    printf("Test passed!\n");
+}
+
+typedef struct {
+    const char* hash;
+    int result;
+} verify_arg_t;
+
+static void* verify_thread(void* arg) {
+    verify_arg_t* v = arg;
+    v->result = auth_verify_password("password123", v->hash);
+    return NULL;
+}
+
+// Test that a flood of logins is turned away instead of queueing without bound
+void test_backpressure() {
+    print_test_header("auth (bounded hash queue)");
+
+    // Cheap hash so the test is quick; one worker keeps the queue full
+    auth_shutdown();
+    assert(auth_init(NULL, 1) == 0);
+    char salt[CRYPT_GENSALT_OUTPUT_SIZE];
+    struct crypt_data data;
+    memset(&data, 0, sizeof(data));
+    assert(crypt_gensalt_rn("$2b$", 8, NULL, 0, salt, sizeof(salt)) != NULL);
+    char* hash = strdup(crypt_r("password123", salt, &data));
+
+    auth_stats_t before;
+    auth_get_stats(&before);
+    pthread_t threads[BUSY_THREADS];
+    verify_arg_t args[BUSY_THREADS];
+    for (int i = 0; i < BUSY_THREADS; i++) {
+        args[i].hash = hash;
+        pthread_create(&threads[i], NULL, verify_thread, &args[i]);
+    }
+    int ok = 0, busy = 0;
+    for (int i = 0; i < BUSY_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        if (args[i].result == AUTH_OK) {
+            ok++;
+        } else if (args[i].result == AUTH_ERR_BUSY) {
+            busy++;
+        }
+    }
+    auth_stats_t after;
+    auth_get_stats(&after);
+    printf("%d verified, %d turned away\n", ok, busy);
+    assert(ok + busy == BUSY_THREADS && ok > 0);
+    assert(busy > 0 && "More callers than queue slots should be turned away");
+    assert(after.rejected_busy - before.rejected_busy == (uint64_t) busy && after.queue_length == 0);
+
+    free(hash);
+    printf("Test passed!\n");
+}
+
+// Test generated keys, which every worker process is handed the same of
+void test_generated_secret() {
+    print_test_header("auth (generated signing key)");
+
+    char key[AUTH_SECRET_TEXT_LENGTH + 1];
+    char other[AUTH_SECRET_TEXT_LENGTH + 1];
+    assert(auth_generate_secret(key, AUTH_SECRET_TEXT_LENGTH) != 0 && "Short buffers should be refused");
+    assert(auth_generate_secret(key, sizeof(key)) == 0);
+    assert(auth_generate_secret(other, sizeof(other)) == 0);
+    printf("Key: %s\n", key);
+    assert(strlen(key) == AUTH_SECRET_TEXT_LENGTH && strspn(key, "0123456789abcdef") == AUTH_SECRET_TEXT_LENGTH);
+    assert(strcmp(key, other) != 0);
+
+    // A process started with the same key accepts the token, one with
+    // another key does not
+    char token[AUTH_TOKEN_MAX_LENGTH];
+    int user_id = 0;
+    assert(auth_init(key, 0) == 0);
+    assert(auth_issue_token(7, token, sizeof(token), NULL) == AUTH_OK);
+    assert(auth_init(key, 0) == 0);
+    assert(auth_verify_token(token, &user_id) == AUTH_OK && user_id == 7);
+    assert(auth_init(other, 0) == 0);
+    assert(auth_verify_token(token, &user_id) == AUTH_ERR_INVALID);
+
+    printf("Test passed!\n");
+}
+
+// Main test function
+int main() {
+    printf("Starting auth tests...\n");
+
+    assert(auth_init("too short", 0) != 0 && "Short signing keys should be refused");
+    assert(auth_init("0123456789abcdef0123456789abcdef", 0) == 0);
+
+    test_tokens();
+    test_passwords();
+    test_backpressure();
+    test_generated_secret();
+    auth_shutdown();
+
+    print_separator();
+    printf("All tests passed!\n");
+    return 0;
+}
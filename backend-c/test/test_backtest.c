@@ -0,0 +1,167 @@
+#include "../src/include/backtest.h"
+#include "../src/include/prediction.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <time.h>
+
+// Test utility functions
+void print_separator() {
+    printf("\n--------------------------------------------------\n");
+}
+
+void print_test_header(const char* test_name) {
+    print_separator();
+    printf("TEST: %s\n", test_name);
+    print_separator();
+}
+
+// Test the forecast core against linear_regression_predict
+void test_forecast_core() {
+    print_test_header("linear_regression_forecast");
+
+    double prices[24];
+    for (int i = 0; i < 24; i++) {
+        prices[i] = 900.0 + 5.0 * i;
+    }
+
+    double std_error = -1.0;
+    double forecast = linear_regression_forecast(prices, 24, 2, 6, &std_error);
+    // Target month is (2 + 6) % 12 = September (Q3 factor 1.01)
+    double expected = (900.0 + 5.0 * 29) * 1.01;
+    printf("Forecast: %.2f, expected %.2f, std error %.4f\n", forecast, expected, std_error);
+    assert(fabs(forecast - expected) < 1e-9 && "Forecast should extrapolate the exact trend");
+    assert(std_error >= 0.0 && std_error < 1e-6 && "A perfect fit should have no error");
+
+    printf("Test passed!\n");
+}
+
+// Test walk-forward bookkeeping on a gap-free series
+void test_walk_forward_counts() {
+    print_test_header("backtest_run (walk-forward counts)");
+
+    backtest_series_t* series = backtest_generate_synthetic(1, 60, 7);
+    backtest_config_t config = backtest_default_config(6);
+    backtest_result_t result;
+    backtest_summary_t summary;
+
+    assert(backtest_run(series, 1, &config, 1, &result, &summary) == 0 && "Backtest should succeed");
+    printf("Forecasts: %d, MAE %.2f, MAPE %.2f%%, coverage %.2f\n",
+           result.forecasts, result.mae, result.mape, result.coverage);
+    // Origins t = 12..54 have their target (index t - 1 + 6) inside the series
+    assert(result.forecasts == 60 - 6 - 12 + 1 && "Every origin with a target should be scored");
+    assert(summary.forecasts == result.forecasts && summary.series == 1 && "Summary should aggregate the series");
+    assert(result.coverage >= 0.0 && result.coverage <= 1.0 && "Coverage should be a share");
+
+    // Removing the target months of some origins skips them
+    series[0].months[30] += 100;
+    for (int i = 31; i < 60; i++) {
+        series[0].months[i] += 100;
+    }
+    assert(backtest_run(series, 1, &config, 1, &result, &summary) == 0 && "Backtest should succeed");
+    printf("Forecasts with a gap: %d\n", result.forecasts);
+    assert(result.forecasts < 60 - 6 - 12 + 1 && "Origins without a target should be skipped");
+
+    backtest_free_series(series, 1);
+    printf("Test passed!\n");
+}
+
+// Test that missing months are filled before fitting, so a gappy series
+// is backtested on calendar months rather than array positions
+void test_gappy_series() {
+    print_test_header("backtest_evaluate (series with missing months)");
+
+    // A straight line with every third month missing
+    int months[60];
+    double prices[60];
+    int count = 0;
+    for (int m = 0; m < 90; m++) {
+        if (m % 3 != 1) {
+            months[count] = 24000 + m;
+            prices[count] = 900.0 + 5.0 * m;
+            count++;
+        }
+    }
+    double filled[90];
+    assert(forecast_fill_gaps(months, prices, count, NULL) == 90 && "Every month should be covered");
+    assert(forecast_fill_gaps(months, prices, count, filled) == 90);
+    for (int m = 0; m < 90; m++) {
+        assert(fabs(filled[m] - (900.0 + 5.0 * m)) < 1e-9 && "Missing months should be interpolated");
+    }
+
+    backtest_series_t series = { 0, 0, count, months, prices };
+    backtest_config_t config = backtest_default_config(6);
+    backtest_result_t result;
+    backtest_evaluate(&series, &config, &result);
+
+    // The same forecasts made on the full line: the training history is
+    // the months up to each observed origin
+    double abs_sum = 0.0;
+    int expected = 0;
+    for (int i = 0; i < count; i++) {
+        int t = months[i] - months[0] + 1;
+        int target = t - 1 + 6;
+        if (t < config.min_train || target >= 90 || target % 3 == 1) {
+            continue;
+        }
+        double forecast = linear_regression_forecast(filled, t, months[i] % 12, 6, NULL);
+        abs_sum += fabs(filled[target] - forecast);
+        expected++;
+    }
+    printf("Forecasts: %d (expected %d), MAE %.4f (expected %.4f)\n",
+           result.forecasts, expected, result.mae, abs_sum / expected);
+    assert(result.forecasts == expected && "Every observed origin with an observed target should be scored");
+    assert(fabs(result.mae - abs_sum / expected) < 1e-9 && "Fits should see the months at their real spacing");
+
+    printf("Test passed!\n");
+}
+
+// Test that the parallel run matches the single-threaded run
+void test_parallel_matches_serial() {
+    print_test_header("backtest_run (parallel determinism)");
+
+    const size_t count = 2000;
+    backtest_series_t* series = backtest_generate_synthetic(count, 120, 11);
+    backtest_result_t* serial = malloc(sizeof(backtest_result_t) * count);
+    backtest_result_t* parallel = malloc(sizeof(backtest_result_t) * count);
+    backtest_summary_t serial_summary, parallel_summary;
+
+    for (int h = 6; h <= 12; h += 6) {
+        backtest_config_t config = backtest_default_config(h);
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        assert(backtest_run(series, count, &config, 1, serial, &serial_summary) == 0);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        assert(backtest_run(series, count, &config, 4, parallel, &parallel_summary) == 0);
+
+        printf("Horizon %2d: %ld forecasts, MAPE %.2f%%, coverage %.1f%% (%.1f ms serial)\n",
+               h, serial_summary.forecasts, serial_summary.mape, serial_summary.coverage * 100.0,
+               (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1e6);
+
+        assert(memcmp(serial, parallel, sizeof(backtest_result_t) * count) == 0 &&
+               "Parallel results should match serial results");
+        assert(serial_summary.mape > 0.0 && serial_summary.mape < 20.0 && "MAPE should be plausible");
+    }
+
+    free(serial);
+    free(parallel);
+    backtest_free_series(series, count);
+    printf("Test passed!\n");
+}
+
+// Main test function
+int main() {
+    printf("Starting backtest module tests...\n");
+
+    test_forecast_core();
+    test_walk_forward_counts();
+    test_gappy_series();
+    test_parallel_matches_serial();
+
+    print_separator();
+    printf("All tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,175 @@
+#include "../src/include/comparables.h"
+#include "../src/include/properties.h"
+#include "../src/include/rng.h"
+#include "../src/include/utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <time.h>
+
+#define LISTINGS 1000000
+
+// Test utility functions
+void print_separator() {
+    printf("\n--------------------------------------------------\n");
+}
+
+void print_test_header(const char* test_name) {
+    print_separator();
+    printf("TEST: %s\n", test_name);
+    print_separator();
+}
+
+static double elapsed_us(struct timespec start, struct timespec end) {
+    return (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3;
+}
+
+static void generate_listings(property_t* listings, int count) {
+    rng_t rng;
+    rng_seed(&rng, 17);
+    for (int i = 0; i < count; i++) {
+        property_t* p = &listings[i];
+        memset(p, 0, sizeof(*p));
+        p->id = i + 1;
+        p->district_id = 1 + (int) rng_below(&rng, 16);
+        p->type_id = 1;
+        p->num_rooms = 1 + (int) rng_below(&rng, 5);
+        p->area_sqm = 20 + 18 * p->num_rooms + (int) rng_below(&rng, 25);
+        p->total_floors = 4 + (int) rng_below(&rng, 12);
+        p->floor = 1 + (int) rng_below(&rng, (uint32_t) p->total_floors);
+        p->year_built = 1950 + (int) rng_below(&rng, 75);
+        p->price = p->area_sqm * (700 + (int) rng_below(&rng, 600));
+        p->latitude = 46.95 + 0.1 * rng_uniform(&rng);
+        p->longitude = 28.75 + 0.15 * rng_uniform(&rng);
+        p->status = PROPERTY_STATUS_ACTIVE;
+    }
+}
+
+// Test index build and the nearest twin of a listing
+void test_build_and_twin() {
+    print_test_header("comparables_rebuild / comparables_find");
+
+    property_t* listings = malloc(sizeof(property_t) * LISTINGS);
+    generate_listings(listings, LISTINGS);
+
+    // Listing 2 becomes a near twin of listing 1
+    listings[1] = listings[0];
+    listings[1].id = 2;
+    listings[1].latitude += 0.0005;
+    assert(properties_ingest(listings, LISTINGS) == 0);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    assert(comparables_rebuild() == LISTINGS && "Every listing should be indexed");
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("Indexed %zu listings in %.1f ms\n", comparables_count(), elapsed_us(start, end) / 1000.0);
+
+    comparables_query_t query = comparables_default_query();
+    comparable_t found[COMPARABLES_MAX_K];
+    int n = comparables_find(&listings[0], &query, found);
+    printf("Nearest to #1: #%d at %.4f\n", found[0].property_id, found[0].distance);
+    assert(n == 5 && "Five comparables should be found");
+    assert(found[0].property_id == 2 && "The twin should be the nearest");
+    for (int i = 0; i < n; i++) {
+        assert(found[i].property_id != 1 && "The subject should not be returned");
+        assert(found[i].district_id == listings[0].district_id && "Same-district filter should apply");
+        assert(abs(found[i].num_rooms - listings[0].num_rooms) <= 1 && "Rooms filter should apply");
+        assert((i == 0 || found[i - 1].distance <= found[i].distance) && "Results should be sorted");
+    }
+
+    free(listings);
+    printf("Test passed!\n");
+}
+
+// Test that pruning never beats the full scan and that latency is low
+void test_pruning_and_latency() {
+    print_test_header("comparables_find (pruning, latency)");
+
+    comparables_query_t pruned = comparables_default_query();
+    pruned.k = 10;
+    comparables_query_t full = pruned;
+    full.same_district = 0;
+    full.rooms_tolerance = -1;
+
+    const int subjects = 200;
+    double pruned_us = 0.0, full_us = 0.0;
+    comparable_t a[COMPARABLES_MAX_K], b[COMPARABLES_MAX_K];
+    for (int s = 0; s < subjects; s++) {
+        property_t subject;
+        assert(properties_find(1 + s * 4999, &subject) == 0);
+
+        struct timespec t0, t1, t2;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        int na = comparables_find(&subject, &pruned, a);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        int nb = (s % 20 == 0) ? comparables_find(&subject, &full, b) : 0;
+        clock_gettime(CLOCK_MONOTONIC, &t2);
+        pruned_us += elapsed_us(t0, t1);
+        full_us += elapsed_us(t1, t2);
+
+        assert(na == 10 && "Pruned query should fill k");
+        for (int i = 0; i < nb; i++) {
+            assert(b[i].distance <= a[i].distance + 1e-6f && "The full scan is a superset of the pruned scan");
+        }
+    }
+    printf("Pruned query: %.1f us average; full scan: %.1f us average (%d listings)\n",
+           pruned_us / subjects, full_us / (subjects / 20), LISTINGS);
+
+    json_t* json = comparables_get_handler(42, &pruned);
+    assert(json != NULL && json_array_size(json_object_get(json, "comparables")) == 10 && "Handler should list comparables");
+    assert(json_object_get(json, "avg_price_per_sqm") != NULL && "Handler should summarize prices");
+    json_decref(json);
+    assert(comparables_get_handler(LISTINGS + 1, &pruned) == NULL && "Unknown listings should not be found");
+
+    printf("Test passed!\n");
+}
+
+// Test query options from arguments as MHD hands them to the server
+void test_query_arguments() {
+    print_test_header("comparables query arguments");
+
+    // ?k=8&scope=all&rooms=-1, decoded into key/value pairs
+    string_buffer_t query;
+    string_buffer_init(&query);
+    assert(query_string_append(&query, "k", "8") == 0);
+    assert(query_string_append(&query, "scope", "all") == 0);
+    assert(query_string_append(&query, "rooms", "-1") == 0);
+    assert(strcmp(query.data, "k=8&scope=all&rooms=-1") == 0 && "Arguments should be rebuilt in order");
+
+    comparables_query_t parsed = comparables_parse_query(query.data);
+    assert(parsed.k == 8 && parsed.same_district == 0 && parsed.rooms_tolerance == -1 &&
+           "Every argument should reach the query");
+    string_buffer_free(&query);
+
+    // A value cannot smuggle in another argument
+    string_buffer_init(&query);
+    assert(query_string_append(&query, "scope", "district&k=40") == 0);
+    assert(query_string_append(&query, "flag", NULL) == 0);
+    assert(strcmp(query.data, "scope=district%26k=40&flag") == 0 && "Separators in values should be escaped");
+    parsed = comparables_parse_query(query.data);
+    comparables_query_t defaults = comparables_default_query();
+    assert(parsed.k == defaults.k && parsed.same_district == defaults.same_district &&
+           "An escaped value should not set k");
+    string_buffer_free(&query);
+
+    parsed = comparables_parse_query(NULL);
+    assert(parsed.k == defaults.k && parsed.rooms_tolerance == defaults.rooms_tolerance &&
+           "No query should give the defaults");
+
+    printf("Test passed!\n");
+}
+
+// Main test function
+int main() {
+    printf("Starting comparables module tests...\n");
+
+    test_build_and_twin();
+    test_pruning_and_latency();
+    test_query_arguments();
+
+    print_separator();
+    printf("All tests passed!\n");
+    return 0;
+}
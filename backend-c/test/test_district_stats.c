@@ -0,0 +1,300 @@
+#include "../src/include/district_stats.h"
+#include "../src/include/quantile_sketch.h"
+#include "../src/include/properties.h"
+#include "../src/include/rng.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define VALUES 1000000
+#define LISTINGS 200000
+#define MAX_RANK_ERROR 0.02
+
+// Test utility functions
+void print_separator() {
+    printf("\n--------------------------------------------------\n");
+}
+
+void print_test_header(const char* test_name) {
+    print_separator();
+    printf("TEST: %s\n", test_name);
+    print_separator();
+}
+
+static double elapsed_us(struct timespec start, struct timespec end) {
+    return (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3;
+}
+
+static int compare_floats(const void* a, const void* b) {
+    float x = *(const float*) a;
+    float y = *(const float*) b;
+    return (x > y) - (x < y);
+}
+
+// Fraction of the sorted values at or below v
+static double rank_of(const float* sorted, size_t n, double v) {
+    size_t lo = 0, hi = n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (sorted[mid] <= v) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return (double) lo / n;
+}
+
+static double max_rank_error(const quantile_sketch_t* sketch, const float* sorted, size_t n) {
+    double fractions[9], values[9];
+    for (int i = 0; i < 9; i++) {
+        fractions[i] = (i + 1) / 10.0;
+    }
+    assert(quantile_sketch_quantiles(sketch, fractions, 9, values) == 0);
+    double worst = 0.0;
+    for (int i = 0; i < 9; i++) {
+        worst = fmax(worst, fabs(rank_of(sorted, n, values[i]) - fractions[i]));
+    }
+    return worst;
+}
+
+// Test sketch accuracy, memory and merging
+void test_sketch() {
+    print_test_header("quantile_sketch (accuracy, merge)");
+
+    float* values = malloc(sizeof(float) * VALUES);
+    rng_t rng;
+    rng_seed(&rng, 21);
+    for (int i = 0; i < VALUES; i++) {
+        values[i] = (float) exp(7.0 + 0.3 * rng_gaussian(&rng));
+    }
+
+    quantile_sketch_t whole, parts[8];
+    quantile_sketch_init(&whole, 0, 1);
+    for (int p = 0; p < 8; p++) {
+        quantile_sketch_init(&parts[p], 0, 100 + p);
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < VALUES; i++) {
+        assert(quantile_sketch_update(&whole, values[i]) == 0);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("%d updates: %.1f ns each, %zu values retained\n", VALUES, elapsed_us(start, end) * 1000.0 / VALUES,
+           quantile_sketch_retained(&whole));
+    assert(whole.count == VALUES && quantile_sketch_retained(&whole) < 4 * QUANTILE_SKETCH_DEFAULT_K);
+
+    for (int i = 0; i < VALUES; i++) {
+        quantile_sketch_update(&parts[i % 8], values[i]);
+    }
+    for (int p = 1; p < 8; p++) {
+        assert(quantile_sketch_merge(&parts[0], &parts[p]) == 0);
+    }
+    assert(parts[0].count == VALUES && "Merged count should add up");
+
+    qsort(values, VALUES, sizeof(float), compare_floats);
+    double err_whole = max_rank_error(&whole, values, VALUES);
+    double err_merged = max_rank_error(&parts[0], values, VALUES);
+    printf("Max rank error: %.4f single, %.4f merged\n", err_whole, err_merged);
+    assert(err_whole < MAX_RANK_ERROR && err_merged < MAX_RANK_ERROR && "Quantiles should be accurate");
+
+    double extremes[2], bounds[2] = { 0.0, 1.0 };
+    quantile_sketch_quantiles(&parts[0], bounds, 2, extremes);
+    assert(extremes[0] == values[0] && extremes[1] == values[VALUES - 1] && "Min and max should be exact");
+
+    quantile_sketch_free(&whole);
+    for (int p = 0; p < 8; p++) {
+        quantile_sketch_free(&parts[p]);
+    }
+    free(values);
+    printf("Test passed!\n");
+}
+
+// Test district statistics and outlier flags
+void test_district_stats() {
+    print_test_header("district_stats (rebuild, get, outliers)");
+
+    district_stats_init();
+    property_t* listings = malloc(sizeof(property_t) * LISTINGS);
+    float* district1 = malloc(sizeof(float) * LISTINGS);
+    size_t district1_count = 0;
+    rng_t rng;
+    rng_seed(&rng, 8);
+    for (int i = 0; i < LISTINGS; i++) {
+        property_t* p = &listings[i];
+        memset(p, 0, sizeof(*p));
+        p->id = i + 1;
+        p->district_id = 1 + (int) rng_below(&rng, 4);
+        p->type_id = 1 + (int) rng_below(&rng, 2);
+        p->num_rooms = 1 + (int) rng_below(&rng, 4);
+        p->area_sqm = 30 + 15 * p->num_rooms + (int) rng_below(&rng, 20);
+        double per_sqm = 800.0 * p->district_id * exp(0.15 * rng_gaussian(&rng));
+        p->price = (int) (per_sqm * p->area_sqm);
+        p->status = PROPERTY_STATUS_ACTIVE;
+        if (p->district_id == 1) {
+            district1[district1_count++] = (float) p->price / (float) p->area_sqm;
+        }
+    }
+    assert(properties_ingest(listings, LISTINGS) == 0);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    assert(district_stats_rebuild(4) == LISTINGS && "Every listing should be sketched");
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("Rebuilt with 4 workers in %.1f ms\n", elapsed_us(start, end) / 1000.0);
+
+    price_distribution_t d;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    assert(district_stats_get(1, 0, 0, &d) == 0);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("District 1: p10 %.0f p50 %.0f p90 %.0f (%lu listings, %.1f us)\n", d.p10, d.p50, d.p90,
+           (unsigned long) d.count, elapsed_us(start, end));
+    assert(d.count == district1_count && "District count should be exact");
+    qsort(district1, district1_count, sizeof(float), compare_floats);
+    assert(fabs(rank_of(district1, district1_count, d.p10) - 0.10) < MAX_RANK_ERROR);
+    assert(fabs(rank_of(district1, district1_count, d.p50) - 0.50) < MAX_RANK_ERROR);
+    assert(fabs(rank_of(district1, district1_count, d.p90) - 0.90) < MAX_RANK_ERROR);
+    assert(d.lower_fence < d.p10 && d.upper_fence > d.p90 && "Fences should lie outside the bulk");
+    assert(district_stats_get(99, 0, 0, &d) != 0 && "Unknown districts should have no stats");
+
+    // New listings: one far too expensive, one far too cheap, one typical
+    property_t fresh[3];
+    for (int i = 0; i < 3; i++) {
+        fresh[i] = listings[0];
+        fresh[i].id = LISTINGS + 1 + i;
+        fresh[i].district_id = 2;
+    }
+    fresh[0].price = 1600 * 4 * fresh[0].area_sqm;
+    fresh[1].price = 1600 / 4 * fresh[1].area_sqm;
+    fresh[2].price = 1600 * fresh[2].area_sqm;
+    assert(district_stats_classify(&fresh[0]) == PRICE_OUTLIER_HIGH && "Overpriced listing should be flagged");
+    assert(district_stats_classify(&fresh[1]) == PRICE_OUTLIER_LOW && "Underpriced listing should be flagged");
+    assert(district_stats_classify(&fresh[2]) == PRICE_OUTLIER_NONE && "Typical listing should pass");
+
+    price_distribution_t before, after;
+    district_stats_get(2, 0, 0, &before);
+    assert(properties_ingest(fresh, 3) == 0);
+    district_stats_get(2, 0, 0, &after);
+    assert(after.count == before.count + 3 && "Ingested listings should be sketched");
+
+    // A status-only change is not a new observation
+    fresh[2].status = PROPERTY_STATUS_SOLD;
+    assert(properties_ingest(&fresh[2], 1) == 0);
+    district_stats_get(2, 0, 0, &after);
+    assert(after.count == before.count + 3 && "Status changes should not be sketched");
+
+    json_t* json = district_stats_handler(2, 0, 0);
+    assert(json != NULL);
+    json_t* recent = json_object_get(json, "recent_outliers");
+    assert(json_array_size(recent) == 2 && "Both outliers should be listed");
+    assert(json_integer_value(json_object_get(json_array_get(recent, 0), "id")) == LISTINGS + 2 &&
+           "Newest outlier should come first");
+    assert(json_array_size(json_object_get(json, "by_rooms")) == 4 && "Every room count should be broken down");
+    json_decref(json);
+    assert(district_stats_handler(99, 0, 0) == NULL);
+
+    free(listings);
+    free(district1);
+    printf("Test passed!\n");
+}
+
+// Listings sketched in districts 1-4, against the listings in the store
+static void assert_counts_match_store(const char* message) {
+    uint64_t expected[5] = { 0 };
+    size_t n = 0;
+    const property_t* rows = properties_acquire(&n);
+    for (size_t i = 0; i < n; i++) {
+        expected[rows[i].district_id]++;
+    }
+    properties_release();
+    for (int district = 1; district <= 4; district++) {
+        price_distribution_t d;
+        assert(district_stats_get(district, 0, 0, &d) == 0);
+        if (d.count != expected[district]) {
+            printf("District %d: %lu sketched, %lu listed\n", district, (unsigned long) d.count,
+                   (unsigned long) expected[district]);
+            assert(0 && message);
+        }
+    }
+}
+
+#define CONCURRENT_LISTINGS 20000
+
+static atomic_int ingest_done = 0;
+
+static void* ingest_thread(void* arg) {
+    const property_t* model = arg;
+    for (int i = 0; i < CONCURRENT_LISTINGS; i += 10) {
+        property_t batch[10];
+        for (int j = 0; j < 10; j++) {
+            batch[j] = *model;
+            batch[j].id = 2 * LISTINGS + i + j;
+            batch[j].district_id = 1 + (i + j) % 4;
+        }
+        assert(properties_ingest(batch, 10) == 0);
+    }
+    atomic_store(&ingest_done, 1);
+    return NULL;
+}
+
+// Test that reprices and moves do not inflate counts, and that listings
+// ingested while a rebuild runs are neither lost nor counted twice
+void test_changes_and_rebuild() {
+    print_test_header("district_stats (reprices, moves, concurrent rebuild)");
+
+    size_t n = 0;
+    property_t listing = properties_acquire(&n)[0];
+    properties_release();
+    price_distribution_t before[2], after[2];
+    int from = listing.district_id, to = from % 4 + 1;
+    district_stats_get(from, 0, 0, &before[0]);
+    district_stats_get(to, 0, 0, &before[1]);
+
+    listing.price *= 2;
+    assert(properties_ingest(&listing, 1) == 0);
+    listing.district_id = to;
+    assert(properties_ingest(&listing, 1) == 0);
+    district_stats_get(from, 0, 0, &after[0]);
+    district_stats_get(to, 0, 0, &after[1]);
+    assert(after[0].count == before[0].count && after[1].count == before[1].count &&
+           "Reprices and moves should wait for the rebuild");
+
+    assert(district_stats_rebuild(4) > 0);
+    district_stats_get(from, 0, 0, &after[0]);
+    district_stats_get(to, 0, 0, &after[1]);
+    assert(after[0].count == before[0].count - 1 && after[1].count == before[1].count + 1 &&
+           "The rebuild should count the moved listing in its new district");
+    assert_counts_match_store("Rebuilt counts should match the store");
+
+    pthread_t tid;
+    pthread_create(&tid, NULL, ingest_thread, &listing);
+    int rebuilds = 0;
+    while (!atomic_load(&ingest_done)) {
+        assert(district_stats_rebuild(4) > 0);
+        rebuilds++;
+    }
+    pthread_join(tid, NULL);
+    printf("%d rebuilds while %d listings were ingested\n", rebuilds, CONCURRENT_LISTINGS);
+    assert_counts_match_store("Listings ingested during rebuilds should be counted once");
+
+    printf("Test passed!\n");
+}
+
+// Main test function
+int main() {
+    printf("Starting district statistics tests...\n");
+
+    test_sketch();
+    test_district_stats();
+    test_changes_and_rebuild();
+
+    print_separator();
+    printf("All tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,216 @@
+#include "../src/include/event_stream.h"
+#include "../src/include/properties.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <pthread.h>
+
+#define FANOUT_EVENTS 100000
+#define FANOUT_SUBSCRIBERS 200
+
+// Test utility functions
+void print_separator() {
+    printf("\n--------------------------------------------------\n");
+}
+
+void print_test_header(const char* test_name) {
+    print_separator();
+    printf("TEST: %s\n", test_name);
+    print_separator();
+}
+
+static double elapsed_us(struct timespec start, struct timespec end) {
+    return (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3;
+}
+
+static property_t make_listing(int id, int price) {
+    property_t p;
+    memset(&p, 0, sizeof(p));
+    p.id = id;
+    p.district_id = 1;
+    p.type_id = 1;
+    p.num_rooms = 2;
+    p.area_sqm = 60;
+    p.price = price;
+    p.status = PROPERTY_STATUS_ACTIVE;
+    return p;
+}
+
+// Read one call's worth of frames (short timeout) into a string
+static ssize_t read_text(event_subscriber_t* s, char* buf, size_t size) {
+    ssize_t n = event_stream_read(s, buf, size - 1, 20);
+    if (n > 0) {
+        buf[n] = '\0';
+    }
+    return n;
+}
+
+// Test listing events, filters, heartbeats and resuming
+void test_feed() {
+    print_test_header("event_stream (events, filters, heartbeat, resume)");
+
+    property_t listing = make_listing(1, 50000);
+    assert(properties_ingest(&listing, 1) == 0);
+    assert(event_stream_publish(STREAM_EVENT_LISTING, "{}") == 0 && "Nothing is published before init");
+
+    event_stream_init();
+    event_subscriber_t* all = event_stream_subscribe(0, STREAM_EVENT_ALL);
+    event_subscriber_t* predictions = event_stream_subscribe(0, event_stream_parse_types("prediction"));
+    assert(all != NULL && predictions != NULL);
+    assert(event_stream_parse_types("listing,status") == ((1u << STREAM_EVENT_LISTING) | (1u << STREAM_EVENT_STATUS)));
+    assert(event_stream_parse_types("listing,bogus") == 0);
+
+    char buf[4096];
+    assert(read_text(all, buf, sizeof(buf)) > 0 && strcmp(buf, ": keep-alive\n\n") == 0 &&
+           "An idle stream should get a heartbeat");
+
+    // Price drop, then a sale
+    listing.price = 45000;
+    assert(properties_ingest(&listing, 1) == 0);
+    listing.status = PROPERTY_STATUS_SOLD;
+    assert(properties_ingest(&listing, 1) == 0);
+    property_t fresh = make_listing(2, 70000);
+    assert(properties_ingest(&fresh, 1) == 0);
+
+    assert(read_text(all, buf, sizeof(buf)) > 0);
+    printf("%s", buf);
+    char* price = strstr(buf, "event: listing\ndata: {\"action\":\"updated\"");
+    char* sold = strstr(buf, "event: status\ndata: {\"id\":1,\"district_id\":1,\"from\":\"active\",\"to\":\"sold\"}");
+    char* created = strstr(buf, "\"action\":\"created\"");
+    assert(price && sold && created && price < sold && sold < created && "Events should arrive in order");
+    assert(strstr(price, "\"previous_price\":50000") != NULL);
+    assert(strstr(sold, "event: listing\ndata: {\"action\":\"updated\"") == NULL &&
+           "Status-only changes should not repeat the listing");
+
+    // The filtered subscriber skips all of it
+    assert(read_text(predictions, buf, sizeof(buf)) > 0 && strcmp(buf, ": keep-alive\n\n") == 0);
+    price_prediction_t prediction = { 0 };
+    prediction.prediction_12m = 1234.0;
+    prediction.algorithm = "damped_trend";
+    uint64_t id = event_stream_publish_prediction(1, 2, &prediction);
+    assert(id != 0 && read_text(predictions, buf, sizeof(buf)) > 0);
+    assert(strstr(buf, "event: prediction\n") && strstr(buf, "\"prediction_12m\":1234"));
+
+    // Resume after the first listing event: the rest is replayed
+    event_subscriber_t* resumed = event_stream_subscribe(id - 3, STREAM_EVENT_ALL);
+    assert(read_text(resumed, buf, sizeof(buf)) > 0);
+    assert(strstr(buf, "event: status") && strstr(buf, "\"created\"") && strstr(buf, "event: prediction") &&
+           strstr(buf, "previous_price") == NULL);
+    event_stream_unsubscribe(resumed);
+
+    // Frames larger than the buffer are split across reads
+    event_subscriber_t* split = event_stream_subscribe(0, STREAM_EVENT_ALL);
+    event_stream_publish(STREAM_EVENT_LISTING, "{\"padding\":\"0123456789012345678901234567890123456789\"}");
+    char small[17], joined[256] = "";
+    do {
+        assert(read_text(split, small, sizeof(small)) > 0);
+        strcat(joined, small);
+    } while (strstr(joined, "\n\n") == NULL);
+    assert(strstr(joined, "0123456789012345678901234567890123456789\"}\n\n") != NULL);
+    event_stream_unsubscribe(split);
+
+    event_stream_unsubscribe(all);
+    event_stream_unsubscribe(predictions);
+    printf("Test passed!\n");
+}
+
+// Test that slow subscribers are skipped ahead and eventually dropped
+void test_slow_consumers() {
+    print_test_header("event_stream (lagging, disconnects, subscriber limit)");
+
+    event_subscriber_t* slow = event_stream_subscribe(0, STREAM_EVENT_ALL);
+    char buf[65536];
+    for (int lag = 1; lag <= EVENT_STREAM_MAX_LAGS + 1; lag++) {
+        for (int i = 0; i < EVENT_STREAM_CAPACITY + 10; i++) {
+            event_stream_publish(STREAM_EVENT_LISTING, "{}");
+        }
+        ssize_t n = read_text(slow, buf, sizeof(buf));
+        if (lag <= EVENT_STREAM_MAX_LAGS) {
+            assert(n > 0 && strncmp(buf, "event: resync\n", 14) == 0 && "Lagging subscribers should resync");
+            while (read_text(slow, buf, sizeof(buf)) > 0 && strcmp(buf, ": keep-alive\n\n") != 0) {
+            }
+        } else {
+            assert(n < 0 && "Repeatedly lagging subscribers should be dropped");
+        }
+    }
+    event_stream_unsubscribe(slow);
+
+    event_stream_stats_t stats;
+    event_stream_get_stats(&stats);
+    assert(stats.lagged == EVENT_STREAM_MAX_LAGS + 1 && stats.disconnected == 1 && stats.subscribers == 0);
+
+    event_subscriber_t* subscribers[EVENT_STREAM_MAX_SUBSCRIBERS];
+    for (int i = 0; i < EVENT_STREAM_MAX_SUBSCRIBERS; i++) {
+        subscribers[i] = event_stream_subscribe(0, STREAM_EVENT_ALL);
+        assert(subscribers[i] != NULL);
+    }
+    assert(event_stream_subscribe(0, STREAM_EVENT_ALL) == NULL && "Subscribers should be capped");
+    for (int i = 0; i < EVENT_STREAM_MAX_SUBSCRIBERS; i++) {
+        event_stream_unsubscribe(subscribers[i]);
+    }
+    printf("Test passed!\n");
+}
+
+static void* wait_for_event(void* arg) {
+    char buf[256];
+    ssize_t n = event_stream_read(arg, buf, sizeof(buf) - 1, 5000);
+    buf[n > 0 ? n : 0] = '\0';
+    return strstr(buf, "\"wake\"") != NULL ? arg : NULL;
+}
+
+// Test wakeups and that publishing cost does not grow with subscribers
+void test_fanout() {
+    print_test_header("event_stream (wakeup, fan-out cost)");
+
+    event_subscriber_t* waiting = event_stream_subscribe(0, STREAM_EVENT_ALL);
+    pthread_t thread;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pthread_create(&thread, NULL, wait_for_event, waiting);
+    struct timespec pause = { 0, 20000000 };
+    nanosleep(&pause, NULL);
+    event_stream_publish(STREAM_EVENT_STATUS, "{\"wake\":1}");
+    void* result;
+    pthread_join(thread, &result);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    assert(result == waiting && "A blocked reader should wake on publish");
+    assert(elapsed_us(start, end) < 1e6 && "Wakeup should not wait for the heartbeat");
+    event_stream_unsubscribe(waiting);
+
+    double us[2];
+    for (int round = 0; round < 2; round++) {
+        event_subscriber_t* subscribers[FANOUT_SUBSCRIBERS];
+        int count = round == 0 ? 0 : FANOUT_SUBSCRIBERS;
+        for (int i = 0; i < count; i++) {
+            subscribers[i] = event_stream_subscribe(0, STREAM_EVENT_ALL);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < FANOUT_EVENTS; i++) {
+            event_stream_publish(STREAM_EVENT_LISTING, "{\"id\":1,\"price\":50000}");
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        us[round] = elapsed_us(start, end);
+        for (int i = 0; i < count; i++) {
+            event_stream_unsubscribe(subscribers[i]);
+        }
+    }
+    printf("Publish: %.0f ns/event with no subscribers, %.0f ns/event with %d\n", us[0] * 1000.0 / FANOUT_EVENTS,
+           us[1] * 1000.0 / FANOUT_EVENTS, FANOUT_SUBSCRIBERS);
+    assert(us[1] < 3.0 * us[0] + 1e5 && "Publishing should not depend on the subscriber count");
+    printf("Test passed!\n");
+}
+
+// Main test function
+int main() {
+    printf("Starting event stream tests...\n");
+
+    test_feed();
+    test_slow_consumers();
+    test_fanout();
+
+    print_separator();
+    printf("All tests passed!\n");
+    return 0;
+}
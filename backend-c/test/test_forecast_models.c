@@ -0,0 +1,206 @@
+#include "../src/include/prediction.h"
+#include "../src/include/series_store.h"
+#include "../src/include/backtest.h"
+#include "../src/include/utils.h"
+#include "../src/include/bootstrap.h"
+#include "../src/include/rng.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <time.h>
+
+#define TEST_STORE_PATH "/tmp/test_forecast_series.bin"
+
+// Test utility functions
+void print_separator() {
+    printf("\n--------------------------------------------------\n");
+}
+
+void print_test_header(const char* test_name) {
+    print_separator();
+    printf("TEST: %s\n", test_name);
+    print_separator();
+}
+
+// Monthly series with a trend and a strong yearly cycle starting in January
+static void seasonal_series(double* prices, int count) {
+    for (int i = 0; i < count; i++) {
+        prices[i] = 900.0 + 2.0 * i + 40.0 * sin(2.0 * M_PI * (i % 12) / 12.0);
+    }
+}
+
+// Test the model registry
+void test_registry() {
+    print_test_header("forecast_models / forecast_model_find");
+
+    int count = 0;
+    const forecast_model_t* models = forecast_models(&count);
+    printf("Registered models: %d\n", count);
+    assert(count >= 3 && "Linear, Holt-Winters and damped trend should be registered");
+    assert(strcmp(models[0].name, "linear_regression") == 0 && "Linear regression should come first");
+    for (int i = 0; i < count; i++) {
+        assert(forecast_model_find(models[i].name) == &models[i] && "Every model should be found by name");
+    }
+    assert(forecast_model_find("arima") == NULL && "Unknown names should not be found");
+
+    printf("Test passed!\n");
+}
+
+// Test that Holt-Winters tracks a seasonal pattern the linear model misses
+void test_holt_winters_seasonal() {
+    print_test_header("holt_winters (seasonal series)");
+
+    double prices[48];
+    seasonal_series(prices, 48);
+    const forecast_model_t* hw = forecast_model_find("holt_winters");
+    const forecast_model_t* linear = forecast_model_find("linear_regression");
+
+    forecast_fit_t fit;
+    assert(hw->fit(prices, 20, 7, &fit) != 0 && "Less than two seasons should be rejected");
+    assert(hw->fit(prices, 42, 5, &fit) == 0 && "Holt-Winters should fit 42 points");
+
+    double hw_error = 0.0, linear_error = 0.0;
+    forecast_fit_t linear_fit;
+    assert(linear->fit(prices, 42, 5, &linear_fit) == 0);
+    for (int h = 1; h <= 6; h++) {
+        double std_error = -1.0;
+        double actual = prices[41 + h];
+        hw_error += fabs(hw->forecast(&fit, h, &std_error) - actual);
+        linear_error += fabs(linear->forecast(&linear_fit, h, NULL) - actual);
+        assert(std_error >= 0.0 && "Standard error should be set");
+    }
+    printf("Mean abs error over 6 months: holt_winters %.2f, linear %.2f\n", hw_error / 6, linear_error / 6);
+    assert(hw_error < linear_error && "Holt-Winters should beat linear regression on seasonal data");
+
+    printf("Test passed!\n");
+}
+
+// Test that the damped trend flattens out
+void test_damped_trend() {
+    print_test_header("damped_trend");
+
+    double prices[36];
+    for (int i = 0; i < 36; i++) {
+        prices[i] = 1000.0 + 10.0 * i;
+    }
+    const forecast_model_t* damped = forecast_model_find("damped_trend");
+    forecast_fit_t fit;
+    assert(damped->fit(prices, 36, 0, &fit) == 0 && "Damped trend should fit");
+
+    double step_6 = damped->forecast(&fit, 6, NULL) - damped->forecast(&fit, 5, NULL);
+    double step_12 = damped->forecast(&fit, 12, NULL) - damped->forecast(&fit, 11, NULL);
+    printf("phi %.2f, monthly step at 6m %.3f, at 12m %.3f\n", fit.damping, step_6, step_12);
+    assert(step_6 > 0.0 && step_12 <= step_6 && "Growth should not accelerate");
+    assert(fit.damping > 0.0 && fit.damping <= 1.0 && "Damping should be a fraction");
+
+    printf("Test passed!\n");
+}
+
+// Test bootstrap bands: ordered, reproducible and calibrated on noisy data
+void test_bootstrap_bands() {
+    print_test_header("forecast_bootstrap");
+
+    const forecast_model_t* linear = forecast_model_find("linear_regression");
+    const forecast_model_t* damped = forecast_model_find("damped_trend");
+    const int horizons[2] = { 6, 12 };
+    const int trials = 200, length = 60;
+    double prices[60 + 12];
+    int covered[2] = { 0, 0 };
+    rng_t noise;
+    rng_seed(&noise, 5);
+
+    clock_t start = clock();
+    for (int t = 0; t < trials; t++) {
+        for (int i = 0; i < length + 12; i++) {
+            prices[i] = 900.0 + 3.0 * i + 15.0 * rng_gaussian(&noise);
+        }
+
+        price_band_t bands[2];
+        rng_t rng;
+        rng_seed(&rng, (uint64_t) t);
+        assert(forecast_bootstrap(damped, prices, length, (length - 1) % 12, horizons, 2,
+                                  BOOTSTRAP_DEFAULT_RESAMPLES, &rng, bands) == 0 && "Bootstrap should succeed");
+        for (int h = 0; h < 2; h++) {
+            assert(bands[h].p10 <= bands[h].p50 && bands[h].p50 <= bands[h].p90 && "Bands should be ordered");
+            double actual = prices[length - 1 + horizons[h]];
+            covered[h] += actual >= bands[h].p10 && actual <= bands[h].p90;
+        }
+    }
+    double ms = (double) (clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+    printf("80%% band coverage: 6m %.1f%%, 12m %.1f%% (%.3f ms per series)\n",
+           100.0 * covered[0] / trials, 100.0 * covered[1] / trials, ms / trials);
+    for (int h = 0; h < 2; h++) {
+        assert(covered[h] > trials * 0.65 && covered[h] < trials * 0.95 && "Bands should be roughly calibrated");
+    }
+
+    // Same seed, same bands
+    price_band_t first[2], second[2];
+    rng_t a, b;
+    rng_seed(&a, 42);
+    rng_seed(&b, 42);
+    forecast_bootstrap(linear, prices, length, 0, horizons, 2, 500, &a, first);
+    forecast_bootstrap(linear, prices, length, 0, horizons, 2, 500, &b, second);
+    assert(memcmp(first, second, sizeof(first)) == 0 && "Bootstrap should be reproducible");
+
+    printf("Test passed!\n");
+}
+
+// Test the prediction job end to end on a series store
+void test_prediction_job() {
+    print_test_header("prediction_job_run / prediction_lookup");
+
+    const int months = 48;
+    price_history_row_t rows[2 * 48];
+    double seasonal[48];
+    seasonal_series(seasonal, months);
+    int base = month_index_from_ym(2021, 1);
+    for (int i = 0; i < months; i++) {
+        rows[i] = (price_history_row_t) { 3, 2, base + i, seasonal[i], 20 };
+        rows[months + i] = (price_history_row_t) { 4, 1, base + i, 800.0 + 3.0 * i, 20 };
+    }
+    assert(series_store_build(TEST_STORE_PATH, rows, 2 * months, 1) == 0 && "Store should build");
+    assert(series_store_open(TEST_STORE_PATH) == 0 && "Store should open");
+
+    int published = prediction_job_run(NULL, 2);
+    printf("Published %d series\n", published);
+    assert(published == 2 && "Both series should be published");
+
+    price_prediction_t prediction;
+    assert(prediction_lookup(3, 2, &prediction) == 0 && "Seasonal series should be found");
+    printf("District 3, 2 rooms: %s, current %.2f, 6m %.2f, 12m %.2f, confidence %.2f\n",
+           prediction.algorithm, prediction.current_avg_price, prediction.prediction_6m,
+           prediction.prediction_12m, prediction.confidence);
+    assert(strcmp(prediction.algorithm, "linear_regression") != 0 && "A seasonal model should win");
+    assert(fabs(prediction.current_avg_price - seasonal[months - 1]) < 0.01 && "Current price is the last point");
+    assert(prediction.confidence >= 0.0 && prediction.confidence <= 1.0 && "Confidence should be a share");
+    assert(prediction.band_6m.p10 < prediction.band_6m.p90 && prediction.band_12m.p10 < prediction.band_12m.p90 &&
+           "Published predictions should carry bootstrap bands");
+
+    assert(prediction_lookup(4, 1, &prediction) == 0 && "Trend series should be found");
+    assert(prediction.prediction_12m > prediction.current_avg_price && "A rising series should keep rising");
+    assert(prediction_lookup(9, 9, &prediction) != 0 && "Unknown series should not be found");
+
+    price_prediction_t served = predict_prices(3, 2);
+    assert(served.algorithm != NULL && strcmp(served.algorithm, "demo") != 0 && "predict_prices should serve the job");
+
+    series_store_close();
+    remove(TEST_STORE_PATH);
+    printf("Test passed!\n");
+}
+
+// Main test function
+int main() {
+    printf("Starting forecast model tests...\n");
+
+    test_registry();
+    test_holt_winters_seasonal();
+    test_damped_trend();
+    test_bootstrap_bands();
+    test_prediction_job();
+
+    print_separator();
+    printf("All tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,309 @@
+#include "../src/include/investment.h"
+#include "../src/include/properties.h"
+#include "../src/include/rng.h"
+#include "../src/include/utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <time.h>
+
+#define LISTINGS 1000000
+#define BATCH 1003
+
+// Test utility functions
+void print_separator() {
+    printf("\n--------------------------------------------------\n");
+}
+
+void print_test_header(const char* test_name) {
+    print_separator();
+    printf("TEST: %s\n", test_name);
+    print_separator();
+}
+
+static double elapsed_us(struct timespec start, struct timespec end) {
+    return (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3;
+}
+
+static int close_to(double a, double b) {
+    return fabs(a - b) <= 1e-9 * fmax(1.0, fabs(b));
+}
+
+// Straight port of the advancedInvestmentCalculator.js formulas for one listing
+typedef struct {
+    double cash_flow_monthly, noi, cap_rate, coc, dscr, break_even, roi, annualized, mirr, cfroi;
+} reference_t;
+
+static reference_t reference(const investment_assumptions_t* a, double price, double rent, double growth) {
+    reference_t r;
+    double loan = price * (1.0 - a->down_payment);
+    double investment = price * a->down_payment;
+    double mortgage = investment_monthly_payment(loan, a->interest_rate, a->loan_term_years);
+    double fixed = price * (a->property_tax_rate + a->insurance_rate + a->maintenance_rate) + a->monthly_hoa * 12.0;
+    r.noi = rent * 12.0 * (1.0 - a->vacancy_rate) * (1.0 - a->management_rate) - fixed;
+    double cash_flow = r.noi - mortgage * 12.0;
+    r.cash_flow_monthly = cash_flow / 12.0;
+    r.cap_rate = r.noi / price;
+    r.coc = cash_flow / investment;
+    r.dscr = r.noi / (mortgage * 12.0);
+    r.break_even = fmin((mortgage * 12.0 + fixed) / (rent * 12.0 * (1.0 - a->management_rate)), 1.0);
+
+    // calculateROI
+    int years = a->holding_years;
+    double future = price * pow(1.0 + growth, years);
+    r.roi = (future - price + cash_flow * years) / price;
+    r.annualized = pow(1.0 + r.roi, 1.0 / years) - 1.0;
+
+    // Remaining balance from the amortization schedule
+    investment_payment_t* schedule = malloc(sizeof(investment_payment_t) * a->loan_term_years * 12);
+    investment_amortization(loan, a->interest_rate, a->loan_term_years, schedule);
+    double balance_hold = years * 12 <= a->loan_term_years * 12 ? schedule[years * 12 - 1].remaining_balance : 0.0;
+    double principal_year1 = loan - schedule[11].remaining_balance;
+    free(schedule);
+
+    // calculateMIRR over the yearly flows, the sale equity in the last
+    double flows[64];
+    for (int i = 0; i < years; i++) {
+        flows[i] = cash_flow;
+    }
+    flows[years - 1] += future - balance_hold;
+    double positive = 0.0, negative = 0.0;
+    for (int i = 0; i < years; i++) {
+        if (flows[i] > 0) {
+            positive += flows[i] * pow(1.0 + a->reinvest_rate, years - i - 1);
+        } else if (flows[i] < 0) {
+            negative += flows[i] / pow(1.0 + a->finance_rate, i + 1);
+        }
+    }
+    r.mirr = pow(positive / (fabs(negative) + investment), 1.0 / years) - 1.0;
+
+    // calculateCFROI with calculateDepreciationTaxBenefits
+    double tax_benefit = price * (1.0 - a->land_share) / a->depreciation_years * a->tax_bracket;
+    r.cfroi = (cash_flow + principal_year1 + price * growth + tax_benefit) / investment;
+    return r;
+}
+
+// Test the vectorized batch against the scalar formulas
+void test_batch_formulas() {
+    print_test_header("investment_evaluate (batch vs. scalar formulas)");
+
+    // calculateMonthlyMortgagePayment: 64000 at 5% over 25 years
+    assert(fabs(investment_monthly_payment(64000, 0.05, 25) - 374.14) < 0.01 && "Payment should match");
+    assert(close_to(investment_monthly_payment(12000, 0.0, 10), 100.0) && "Zero rate should split evenly");
+
+    investment_payment_t schedule[300];
+    assert(investment_amortization(64000, 0.05, 25, schedule) == 300);
+    double principal = 0.0;
+    for (int i = 0; i < 300; i++) {
+        principal += schedule[i].principal;
+    }
+    assert(fabs(principal - 64000) < 1e-6 && schedule[299].remaining_balance < 1e-6 && "Loan should be repaid");
+
+    double prices[BATCH], rents[BATCH], growth[BATCH];
+    double values[11][BATCH];
+    rng_t rng;
+    rng_seed(&rng, 5);
+    for (int i = 0; i < BATCH; i++) {
+        prices[i] = 30000 + rng_uniform(&rng) * 200000;
+        rents[i] = prices[i] * (0.003 + 0.005 * rng_uniform(&rng));
+        growth[i] = -0.05 + 0.12 * rng_uniform(&rng);
+    }
+    investment_inputs_t in = { prices, rents, growth };
+    investment_outputs_t out = {
+        values[0], values[1], values[2], values[3], values[4], values[5],
+        values[6], values[7], values[8], values[9], values[10]
+    };
+
+    investment_assumptions_t a = investment_default_assumptions();
+    for (int scenario = 0; scenario < 2; scenario++) {
+        if (scenario == 1) {
+            a.down_payment = 0.35;
+            a.interest_rate = 0.08;
+            a.holding_years = 7;
+            a.monthly_hoa = 50;
+        }
+        assert(investment_validate_assumptions(&a) == 0 && "Assumptions should be valid");
+        investment_evaluate(&a, &in, BATCH, &out);
+        for (int i = 0; i < BATCH; i++) {
+            reference_t r = reference(&a, prices[i], rents[i], growth[i]);
+            assert(close_to(out.monthly_cash_flow[i], r.cash_flow_monthly) && "Cash flow should match");
+            assert(close_to(out.net_operating_income[i], r.noi) && "NOI should match");
+            assert(close_to(out.cap_rate[i], r.cap_rate) && "Cap rate should match");
+            assert(close_to(out.cash_on_cash[i], r.coc) && "Cash on cash should match");
+            assert(close_to(out.dscr[i], r.dscr) && "DSCR should match");
+            assert(close_to(out.break_even_occupancy[i], r.break_even) && "Break-even should match");
+            assert(close_to(out.roi[i], r.roi) && "ROI should match");
+            assert(close_to(out.annualized_roi[i], r.annualized) && "Annualized ROI should match");
+            assert(fabs(out.mirr[i] - r.mirr) < 1e-9 && "MIRR should match");
+            assert(close_to(out.cfroi[i], r.cfroi) && "CFROI should match");
+        }
+    }
+
+    investment_assumptions_t bad = investment_default_assumptions();
+    bad.down_payment = 0.0;
+    assert(investment_validate_assumptions(&bad) != 0 && "A zero down payment should be rejected");
+
+    printf("Test passed!\n");
+}
+
+// Test the sensitivity grid
+void test_sensitivity() {
+    print_test_header("investment_sensitivity");
+
+    investment_assumptions_t a = investment_default_assumptions();
+    investment_sensitivity_t grid[INVESTMENT_SENSITIVITY_PARAMETERS];
+    investment_sensitivity(&a, 80000, 400, 0.03, grid);
+
+    reference_t base = reference(&a, 80000, 400, 0.03);
+    for (int p = 0; p < INVESTMENT_SENSITIVITY_PARAMETERS; p++) {
+        double middle = grid[p].values[INVESTMENT_SENSITIVITY_STEPS / 2];
+        double expected = strcmp(grid[p].metric, "roi") == 0 ? base.roi : base.cash_flow_monthly;
+        assert(close_to(middle, expected) && "The unchanged scenario should match the base case");
+        printf("%-18s", grid[p].parameter);
+        for (int s = 0; s < INVESTMENT_SENSITIVITY_STEPS; s++) {
+            printf(" %+5.1f:%9.2f", grid[p].variations[s], grid[p].values[s]);
+        }
+        printf("\n");
+    }
+    for (int s = 1; s < INVESTMENT_SENSITIVITY_STEPS; s++) {
+        assert(grid[0].values[s] < grid[0].values[s - 1] && "Higher prices should lower cash flow");
+        assert(grid[1].values[s] < grid[1].values[s - 1] && "Higher rates should lower cash flow");
+        assert(grid[2].values[s] > grid[2].values[s - 1] && "Higher rent should raise cash flow");
+        assert(grid[3].values[s] < grid[3].values[s - 1] && "Higher vacancy should lower cash flow");
+        assert(grid[4].values[s] > grid[4].values[s - 1] && "Higher growth should raise ROI");
+    }
+
+    printf("Test passed!\n");
+}
+
+// Test ranking every listing by ROI
+void test_rankings() {
+    print_test_header("investment_rank (1M listings)");
+
+    property_t* listings = malloc(sizeof(property_t) * LISTINGS);
+    rng_t rng;
+    rng_seed(&rng, 11);
+    for (int i = 0; i < LISTINGS; i++) {
+        property_t* p = &listings[i];
+        memset(p, 0, sizeof(*p));
+        p->id = i + 1;
+        p->district_id = 1 + (int) rng_below(&rng, 16);
+        p->type_id = 1;
+        p->num_rooms = 1 + (int) rng_below(&rng, 5);
+        p->area_sqm = 20 + 18 * p->num_rooms + (int) rng_below(&rng, 25);
+        p->price = p->area_sqm * (700 + (int) rng_below(&rng, 600));
+        p->status = i % 10 == 0 ? PROPERTY_STATUS_SOLD : PROPERTY_STATUS_ACTIVE;
+    }
+    assert(properties_ingest(listings, LISTINGS) == 0);
+    free(listings);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    long n = investment_rebuild();
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("Built the ranking batch of %ld listings in %.1f ms\n", n, elapsed_us(start, end) / 1000.0);
+    assert(n == LISTINGS - LISTINGS / 10 && "Only active listings should be ranked");
+
+    investment_metrics_t top[20], again[20], custom[20];
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    assert(investment_rank(NULL, NULL, 0, 20, top) == 20);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("Default ranking: %.1f us\n", elapsed_us(start, end));
+    for (int i = 1; i < 20; i++) {
+        assert(top[i - 1].roi >= top[i].roi && "Rankings should be sorted by ROI");
+    }
+    assert(top[0].property_id % 10 != 1 && "Sold listings should not be ranked");
+
+    // Explicit default assumptions take the parallel path and must agree
+    investment_assumptions_t a = investment_default_assumptions();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    assert(investment_rank(&a, NULL, 0, 20, again) == 20);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("Re-evaluated ranking: %.1f ms\n", elapsed_us(start, end) / 1000.0);
+    for (int i = 0; i < 20; i++) {
+        assert(again[i].property_id == top[i].property_id && "Both ranking paths should agree");
+    }
+
+    // Paging continues where the first page ended
+    investment_metrics_t page[10];
+    assert(investment_rank(NULL, NULL, 10, 10, page) == 10);
+    assert(page[0].property_id == top[10].property_id && "Offset should skip the first page");
+
+    // A larger down payment changes the ranking and filters apply
+    a.down_payment = 0.5;
+    investment_filter_t filter = { .district_id = 3, .num_rooms = 2, .max_price = 0 };
+    assert(investment_rank(&a, &filter, 0, 20, custom) == 20);
+    for (int i = 0; i < 20; i++) {
+        assert(custom[i].district_id == 3 && custom[i].num_rooms == 2 && "Filter should apply");
+        assert((i == 0 || custom[i - 1].roi >= custom[i].roi) && "Rankings should be sorted");
+    }
+    assert(investment_rank(NULL, NULL, INVESTMENT_MAX_RANKING, 1, page) == -1 && "Deep pages should be rejected");
+
+    json_t* json = investment_rankings_handler(NULL, NULL, 0, 5);
+    assert(json != NULL && json_array_size(json_object_get(json, "listings")) == 5 && "Handler should rank");
+    json_decref(json);
+
+    json = investment_get_handler(top[0].property_id, &a, 0);
+    assert(json != NULL && "Handler should analyze a listing");
+    assert(json_array_size(json_object_get(json, "sensitivity")) == INVESTMENT_SENSITIVITY_PARAMETERS);
+    json_t* payments = json_object_get(json_object_get(json, "amortization"), "payments");
+    assert(json_array_size(payments) == (size_t) a.loan_term_years && "Yearly schedule should cover the term");
+    json_decref(json);
+    assert(investment_get_handler(LISTINGS + 1, &a, 0) == NULL && "Unknown listings should not be analyzed");
+
+    printf("Test passed!\n");
+}
+
+// Test assumptions and ranking filters from a rebuilt query string, the
+// way the rankings handler splits it
+void test_query_arguments() {
+    print_test_header("investment query arguments");
+
+    string_buffer_t query;
+    string_buffer_init(&query);
+    const char* arguments[][2] = {
+        { "limit", "50" }, { "district", "3" }, { "rooms", "2" }, { "max_price", "90000" },
+        { "down_payment", "30" }, { "interest_rate", "4.5" }, { "years", "15" }, { "hoa", "40" }
+    };
+    for (size_t i = 0; i < sizeof(arguments) / sizeof(arguments[0]); i++) {
+        assert(query_string_append(&query, arguments[i][0], arguments[i][1]) == 0);
+    }
+
+    investment_assumptions_t a = investment_default_assumptions();
+    investment_filter_t filter = { 0 };
+    int custom = 0, other = 0;
+    char* saveptr = NULL;
+    for (char* token = strtok_r(query.data, "&", &saveptr); token; token = strtok_r(NULL, "&", &saveptr)) {
+        if (!investment_parse_filter(token, &filter)) {
+            int applied = investment_parse_assumption(token, &a);
+            custom += applied;
+            other += !applied;
+        }
+    }
+    string_buffer_free(&query);
+
+    assert(filter.district_id == 3 && filter.num_rooms == 2 && filter.max_price == 90000 &&
+           "Every filter should be applied");
+    assert(custom == 4 && other == 1 && "Assumptions should be told apart from other arguments");
+    assert(fabs(a.down_payment - 0.30) < 1e-12 && fabs(a.interest_rate - 0.045) < 1e-12 &&
+           a.holding_years == 15 && fabs(a.monthly_hoa - 40.0) < 1e-12 && "Percentages should become fractions");
+    assert(investment_validate_assumptions(&a) == 0);
+
+    printf("Test passed!\n");
+}
+
+// Main test function
+int main() {
+    printf("Starting investment module tests...\n");
+
+    test_batch_formulas();
+    test_sensitivity();
+    test_rankings();
+    test_query_arguments();
+
+    print_separator();
+    printf("All tests passed!\n");
+    return 0;
+}
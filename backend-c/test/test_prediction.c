@@ -1,9 +1,15 @@
 #include "../src/include/prediction.h"
+#include "../src/include/aggregation.h"
+#include "../src/include/series_store.h"
+#include "../src/include/utils.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
 #include <math.h>
 #include <time.h>
+#include <unistd.h>
+
+#define TEST_STORE_PATH "/tmp/test_prediction_series.bin"
 
 // Test utility functions
 void print_separator() {
@@ -156,6 +162,50 @@ void test_predict_prices() {
     printf("Test passed!\n");
 }
 
+// Test that the prediction job fits a series with missing months on
+// calendar months, as its backtest does
+void test_prediction_job_gaps() {
+    print_test_header("prediction_job_run (series with missing months)");
+
+    // Trend and yearly season, two months in five missing
+    price_history_row_t rows[72];
+    int months[72];
+    double prices[72];
+    int count = 0;
+    for (int m = 0; m < 72; m++) {
+        if (m % 5 == 1 || m % 5 == 3) {
+            continue;
+        }
+        months[count] = month_index_from_ym(2018, 1) + m;
+        prices[count] = (double) lround(900.0 + 4.0 * m + 40.0 * sin(2.0 * M_PI * m / 12.0));
+        rows[count] = (price_history_row_t) { 7, 3, months[count], prices[count], 25 };
+        count++;
+    }
+    assert(series_store_build(TEST_STORE_PATH, rows, (size_t) count, 0) == 0);
+    assert(series_store_open(TEST_STORE_PATH) == 0);
+    assert(prediction_job_run(NULL, 1) == 1 && "The series should be predicted");
+
+    price_prediction_t prediction;
+    assert(prediction_lookup(7, 3, &prediction) == 0);
+    printf("Served %s: 6m %.2f, 12m %.2f\n", prediction.algorithm, prediction.prediction_6m,
+           prediction.prediction_12m);
+
+    // The served model refit on the filled months gives the same forecasts
+    double filled[72];
+    int span = forecast_fill_gaps(months, prices, count, filled);
+    const forecast_model_t* model = forecast_model_find(prediction.algorithm);
+    forecast_fit_t fit;
+    assert(model != NULL && model->fit(filled, span, months[count - 1] % FORECAST_SEASON_LENGTH, &fit) == 0);
+    assert(fabs(model->forecast(&fit, 6, NULL) - prediction.prediction_6m) < 1e-6 &&
+           fabs(model->forecast(&fit, 12, NULL) - prediction.prediction_12m) < 1e-6 &&
+           "Forecasts should come from the gap-filled series");
+    assert(prediction.current_avg_price == prices[count - 1]);
+
+    series_store_close();
+    unlink(TEST_STORE_PATH);
+    printf("Test passed!\n");
+}
+
 // Main test function
 int main() {
     printf("Starting prediction module tests...\n");
@@ -165,6 +215,7 @@ int main() {
     test_linear_regression_predict();
     test_calculate_prediction_confidence();
     test_predict_prices();
+    test_prediction_job_gaps();
     
     print_separator();
     printf("All tests passed!\n");
@@ -0,0 +1,542 @@
+#include "../src/include/response_encoding.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include <math.h>
+#include <time.h>
+
+#define BENCH_ITERATIONS 200
+
+// Test utility functions
+void print_separator() {
+    printf("\n--------------------------------------------------\n");
+}
+
+void print_test_header(const char* test_name) {
+    print_separator();
+    printf("TEST: %s\n", test_name);
+    print_separator();
+}
+
+static double elapsed_us(struct timespec start, struct timespec end) {
+    return (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3;
+}
+
+// Minimal decoders, enough to read back what the encoders write
+
+typedef struct {
+    const uint8_t* p;
+    const uint8_t* end;
+} reader_t;
+
+static uint64_t read_be(reader_t* r, int size) {
+    assert(r->p + size <= r->end);
+    uint64_t value = 0;
+    for (int i = 0; i < size; i++) {
+        value = (value << 8) | *r->p++;
+    }
+    return value;
+}
+
+static double float32_from_bits(uint32_t bits) {
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+static double float64_from_bits(uint64_t bits) {
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+// Typed array payload back to a JSON array; width 4 with is_float for float32
+static json_t* typed_to_json(const uint8_t* data, size_t size, int width, int is_float) {
+    json_t* array = json_array();
+    for (size_t offset = 0; offset < size; offset += (size_t) width) {
+        uint32_t bits = 0;
+        for (int b = 0; b < width; b++) {
+            bits |= (uint32_t) data[offset + (size_t) b] << (8 * b);
+        }
+        if (is_float) {
+            json_array_append_new(array, json_real(float32_from_bits(bits)));
+        } else if (width == 1) {
+            json_array_append_new(array, json_integer((int8_t) bits));
+        } else if (width == 2) {
+            json_array_append_new(array, json_integer((int16_t) bits));
+        } else {
+            json_array_append_new(array, json_integer((int32_t) bits));
+        }
+    }
+    return array;
+}
+
+static uint64_t cbor_argument(reader_t* r, uint8_t info) {
+    if (info < 24) {
+        return info;
+    }
+    assert(info <= 27);
+    return read_be(r, 1 << (info - 24));
+}
+
+static json_t* cbor_decode(reader_t* r) {
+    assert(r->p < r->end);
+    uint8_t initial = *r->p++;
+    int major = initial >> 5;
+    uint8_t info = initial & 0x1f;
+    if (major == 7) {
+        switch (info) {
+            case 20: return json_false();
+            case 21: return json_true();
+            case 22: return json_null();
+            case 26: return json_real(float32_from_bits((uint32_t) read_be(r, 4)));
+            case 27: return json_real(float64_from_bits(read_be(r, 8)));
+            default: assert(0 && "Unexpected CBOR simple value");
+        }
+    }
+    uint64_t arg = cbor_argument(r, info);
+    switch (major) {
+        case 0: return json_integer((json_int_t) arg);
+        case 1: return json_integer(-1 - (json_int_t) arg);
+        case 3: {
+            json_t* text = json_stringn((const char*) r->p, arg);
+            r->p += arg;
+            return text;
+        }
+        case 4: {
+            json_t* array = json_array();
+            for (uint64_t i = 0; i < arg; i++) {
+                json_array_append_new(array, cbor_decode(r));
+            }
+            return array;
+        }
+        case 5: {
+            json_t* object = json_object();
+            for (uint64_t i = 0; i < arg; i++) {
+                json_t* key = cbor_decode(r);
+                json_object_set_new(object, json_string_value(key), cbor_decode(r));
+                json_decref(key);
+            }
+            return object;
+        }
+        case 6: {
+            uint8_t bytes = *r->p++;
+            assert(bytes >> 5 == 2 && "Typed arrays wrap a byte string");
+            uint64_t size = cbor_argument(r, bytes & 0x1f);
+            const uint8_t* data = r->p;
+            r->p += size;
+            switch (arg) {
+                case 72: return typed_to_json(data, size, 1, 0);
+                case 77: return typed_to_json(data, size, 2, 0);
+                case 78: return typed_to_json(data, size, 4, 0);
+                case 85: return typed_to_json(data, size, 4, 1);
+                default: assert(0 && "Unexpected CBOR tag");
+            }
+        }
+        default:
+            assert(0 && "Unexpected CBOR major type");
+    }
+    return NULL;
+}
+
+static json_t* msgpack_decode(reader_t* r);
+
+static json_t* msgpack_array(reader_t* r, size_t count) {
+    json_t* array = json_array();
+    for (size_t i = 0; i < count; i++) {
+        json_array_append_new(array, msgpack_decode(r));
+    }
+    return array;
+}
+
+static json_t* msgpack_map(reader_t* r, size_t count) {
+    json_t* object = json_object();
+    for (size_t i = 0; i < count; i++) {
+        json_t* key = msgpack_decode(r);
+        json_object_set_new(object, json_string_value(key), msgpack_decode(r));
+        json_decref(key);
+    }
+    return object;
+}
+
+static json_t* msgpack_text(reader_t* r, size_t length) {
+    json_t* text = json_stringn((const char*) r->p, length);
+    r->p += length;
+    return text;
+}
+
+static json_t* msgpack_ext(reader_t* r, size_t size) {
+    uint8_t type = *r->p++;
+    const uint8_t* data = r->p;
+    r->p += size;
+    switch (type) {
+        case MSGPACK_EXT_INT8_ARRAY: return typed_to_json(data, size, 1, 0);
+        case MSGPACK_EXT_INT16_ARRAY: return typed_to_json(data, size, 2, 0);
+        case MSGPACK_EXT_INT32_ARRAY: return typed_to_json(data, size, 4, 0);
+        case MSGPACK_EXT_FLOAT32_ARRAY: return typed_to_json(data, size, 4, 1);
+        default: assert(0 && "Unexpected ext type");
+    }
+    return NULL;
+}
+
+static json_t* msgpack_decode(reader_t* r) {
+    assert(r->p < r->end);
+    uint8_t code = *r->p++;
+    if (code < 0x80) {
+        return json_integer(code);
+    }
+    if (code >= 0xe0) {
+        return json_integer((int8_t) code);
+    }
+    if ((code & 0xf0) == 0x80) {
+        return msgpack_map(r, code & 0x0f);
+    }
+    if ((code & 0xf0) == 0x90) {
+        return msgpack_array(r, code & 0x0f);
+    }
+    if ((code & 0xe0) == 0xa0) {
+        return msgpack_text(r, code & 0x1f);
+    }
+    switch (code) {
+        case 0xc0: return json_null();
+        case 0xc2: return json_false();
+        case 0xc3: return json_true();
+        case 0xc7: return msgpack_ext(r, read_be(r, 1));
+        case 0xc8: return msgpack_ext(r, read_be(r, 2));
+        case 0xc9: return msgpack_ext(r, read_be(r, 4));
+        case 0xca: return json_real(float32_from_bits((uint32_t) read_be(r, 4)));
+        case 0xcb: return json_real(float64_from_bits(read_be(r, 8)));
+        case 0xcc: return json_integer((json_int_t) read_be(r, 1));
+        case 0xcd: return json_integer((json_int_t) read_be(r, 2));
+        case 0xce: return json_integer((json_int_t) read_be(r, 4));
+        case 0xcf: return json_integer((json_int_t) read_be(r, 8));
+        case 0xd0: return json_integer((int8_t) read_be(r, 1));
+        case 0xd1: return json_integer((int16_t) read_be(r, 2));
+        case 0xd2: return json_integer((int32_t) read_be(r, 4));
+        case 0xd3: return json_integer((int64_t) read_be(r, 8));
+        case 0xd9: return msgpack_text(r, read_be(r, 1));
+        case 0xda: return msgpack_text(r, read_be(r, 2));
+        case 0xdb: return msgpack_text(r, read_be(r, 4));
+        case 0xdc: return msgpack_array(r, read_be(r, 2));
+        case 0xdd: return msgpack_array(r, read_be(r, 4));
+        case 0xde: return msgpack_map(r, read_be(r, 2));
+        case 0xdf: return msgpack_map(r, read_be(r, 4));
+        default: assert(0 && "Unexpected MessagePack code");
+    }
+    return NULL;
+}
+
+static json_t* decode(response_format_t format, const char* body, size_t length) {
+    reader_t r = { (const uint8_t*) body, (const uint8_t*) body + length };
+    json_t* value = format == RESPONSE_FORMAT_CBOR ? cbor_decode(&r) : msgpack_decode(&r);
+    assert(r.p == r.end && "The whole body should be one value");
+    return value;
+}
+
+// Structural equality; numbers must come back exactly (typed arrays
+// may turn integers into float32 reals of the same value)
+static int same_value(json_t* a, json_t* b) {
+    if (json_is_number(a) && json_is_number(b)) {
+        return json_number_value(a) == json_number_value(b);
+    }
+    if (json_typeof(a) != json_typeof(b)) {
+        return 0;
+    }
+    switch (json_typeof(a)) {
+        case JSON_STRING:
+            return strcmp(json_string_value(a), json_string_value(b)) == 0;
+        case JSON_ARRAY:
+            if (json_array_size(a) != json_array_size(b)) {
+                return 0;
+            }
+            for (size_t i = 0; i < json_array_size(a); i++) {
+                if (!same_value(json_array_get(a, i), json_array_get(b, i))) {
+                    return 0;
+                }
+            }
+            return 1;
+        case JSON_OBJECT: {
+            if (json_object_size(a) != json_object_size(b)) {
+                return 0;
+            }
+            for (void* iter = json_object_iter(a); iter != NULL; iter = json_object_iter_next(a, iter)) {
+                json_t* other = json_object_get(b, json_object_iter_key(iter));
+                if (other == NULL || !same_value(json_object_iter_value(iter), other)) {
+                    return 0;
+                }
+            }
+            return 1;
+        }
+        default:
+            return 1;
+    }
+}
+
+// Test picking the format from the Accept header
+void test_negotiation() {
+    print_test_header("response_format_negotiate");
+
+    assert(response_format_negotiate(NULL) == RESPONSE_FORMAT_JSON);
+    assert(response_format_negotiate("") == RESPONSE_FORMAT_JSON);
+    assert(response_format_negotiate("*/*") == RESPONSE_FORMAT_JSON);
+    assert(response_format_negotiate("text/html") == RESPONSE_FORMAT_JSON);
+    assert(response_format_negotiate("application/cbor") == RESPONSE_FORMAT_CBOR);
+    assert(response_format_negotiate("Application/CBOR") == RESPONSE_FORMAT_CBOR);
+    assert(response_format_negotiate("application/msgpack") == RESPONSE_FORMAT_MSGPACK);
+    assert(response_format_negotiate("application/x-msgpack, */*;q=0.1") == RESPONSE_FORMAT_MSGPACK);
+    assert(response_format_negotiate("application/vnd.msgpack") == RESPONSE_FORMAT_MSGPACK);
+    assert(response_format_negotiate("application/json, application/cbor") == RESPONSE_FORMAT_JSON);
+    assert(response_format_negotiate("application/json;q=0.5, application/cbor") == RESPONSE_FORMAT_CBOR);
+    assert(response_format_negotiate("application/cbor; q=0.2 , application/msgpack ;q=0.9") ==
+           RESPONSE_FORMAT_MSGPACK);
+    assert(response_format_negotiate("application/cbor;q=0") == RESPONSE_FORMAT_JSON);
+
+    assert(strcmp(response_format_content_type(RESPONSE_FORMAT_CBOR), "application/cbor") == 0);
+    assert(strcmp(response_format_content_type(RESPONSE_FORMAT_MSGPACK), "application/msgpack") == 0);
+    assert(strcmp(response_format_content_type(RESPONSE_FORMAT_JSON), "application/json") == 0);
+    printf("Test passed!\n");
+}
+
+// Test exact encodings of a small document
+void test_encoding_bytes() {
+    print_test_header("response_encode (bytes)");
+
+    json_t* doc = json_object();
+    json_object_set_new(doc, "a", json_integer(-2));
+    json_t* ids = json_array();
+    for (int i = 1; i <= 4; i++) {
+        json_array_append_new(ids, json_integer(i));
+    }
+    json_object_set_new(doc, "b", ids);
+    json_object_set_new(doc, "c", json_real(1.5));
+    json_object_set_new(doc, "d", json_null());
+
+    char* body = NULL;
+    size_t length = 0;
+    assert(response_encode(doc, RESPONSE_FORMAT_CBOR, &body, &length) == 0);
+    const uint8_t cbor[] = {
+        0xa4,
+        0x61, 'a', 0x21,
+        0x61, 'b', 0xd8, 72, 0x44, 1, 2, 3, 4,          // Tag 72 (sint8 array) around 4 bytes
+        0x61, 'c', 0xfa, 0x3f, 0xc0, 0x00, 0x00,        // 1.5 fits float32
+        0x61, 'd', 0xf6
+    };
+    assert(length == sizeof(cbor) && memcmp(body, cbor, length) == 0);
+    free(body);
+
+    assert(response_encode(doc, RESPONSE_FORMAT_MSGPACK, &body, &length) == 0);
+    const uint8_t msgpack[] = {
+        0x84,
+        0xa1, 'a', 0xfe,
+        0xa1, 'b', 0xc7, 4, MSGPACK_EXT_INT8_ARRAY, 1, 2, 3, 4,
+        0xa1, 'c', 0xca, 0x3f, 0xc0, 0x00, 0x00,
+        0xa1, 'd', 0xc0
+    };
+    assert(length == sizeof(msgpack) && memcmp(body, msgpack, length) == 0);
+    free(body);
+
+    assert(response_encode(doc, RESPONSE_FORMAT_JSON, &body, &length) == 0);
+    assert(strcmp(body, "{\"a\": -2, \"b\": [1, 2, 3, 4], \"c\": 1.5, \"d\": null}") == 0 ||
+           strcmp(body, "{\"a\":-2,\"b\":[1,2,3,4],\"c\":1.5,\"d\":null}") == 0);
+    assert(length == strlen(body));
+    free(body);
+
+    // Short or mixed arrays stay plain arrays; reals that need it keep float64
+    json_t* plain = json_array();
+    json_array_append_new(plain, json_integer(1));
+    json_array_append_new(plain, json_string("x"));
+    json_array_append_new(plain, json_real(0.1));
+    json_array_append_new(plain, json_integer(100000));
+    assert(response_encode(plain, RESPONSE_FORMAT_CBOR, &body, &length) == 0);
+    assert((uint8_t) body[0] == 0x84 && (uint8_t) body[4] == 0xfb && "0.1 is not exact as float32");
+    json_t* back = decode(RESPONSE_FORMAT_CBOR, body, length);
+    assert(json_real_value(json_array_get(back, 2)) == 0.1 && json_integer_value(json_array_get(back, 3)) == 100000);
+    json_decref(back);
+    free(body);
+    json_decref(plain);
+
+    // Numeric arrays are only packed as float32 when that is exact for
+    // every element, integers above 2^24 included
+    const double mixed_values[][4] = {
+        { 1.5, 2.25, 16777217.0, 4.0 },   // 2^24 + 1 as an integer
+        { 1.5, 2.25, 0.1, 4.0 },          // 0.1 as a real
+        { 1.5, 2.25, 16777216.0, 4.0 }    // All exact: float32
+    };
+    for (int m = 0; m < 3; m++) {
+        json_t* mixed = json_array();
+        for (int i = 0; i < 4; i++) {
+            double v = mixed_values[m][i];
+            json_array_append_new(mixed, v == floor(v) ? json_integer((json_int_t) v) : json_real(v));
+        }
+        for (int f = 1; f <= 2; f++) {
+            response_format_t format = f == 1 ? RESPONSE_FORMAT_CBOR : RESPONSE_FORMAT_MSGPACK;
+            assert(response_encode(mixed, format, &body, &length) == 0);
+            int typed = format == RESPONSE_FORMAT_CBOR ? (uint8_t) body[0] == 0xd8 : (uint8_t) body[0] == 0xc7;
+            assert(typed == (m == 2) && "Only exact float32 arrays should be typed");
+            back = decode(format, body, length);
+            for (int i = 0; i < 4; i++) {
+                assert(json_number_value(json_array_get(back, (size_t) i)) == mixed_values[m][i] &&
+                       "Every element should come back exactly");
+            }
+            json_decref(back);
+            free(body);
+        }
+        json_decref(mixed);
+    }
+    json_decref(doc);
+    printf("Test passed!\n");
+}
+
+// Payloads shaped like the API's responses
+
+static json_t* trend_series(int months) {
+    json_t* points = json_array();
+    for (int i = 0; i < months; i++) {
+        char date[16];
+        snprintf(date, sizeof(date), "%04d-%02d-01", 2005 + i / 12, i % 12 + 1);
+        json_t* point = json_object();
+        json_object_set_new(point, "date", json_string(date));
+        // The series store keeps prices as float32
+        json_object_set_new(point, "price", json_real((float) (850.0 + 3.7 * i + 40.0 * sin(i / 6.0))));
+        json_object_set_new(point, "sample_size", json_integer(20 + (i * 37) % 400));
+        json_array_append_new(points, point);
+    }
+    return points;
+}
+
+static json_t* property_list(int count) {
+    json_t* list = json_array();
+    for (int i = 0; i < count; i++) {
+        int area = 35 + (i * 13) % 90;
+        int price = area * (900 + (i * 31) % 700);
+        json_t* obj = json_object();
+        json_object_set_new(obj, "id", json_integer(10000 + i));
+        json_object_set_new(obj, "title", json_string("Apartament cu 2 camere, reparatie euro"));
+        json_object_set_new(obj, "address", json_string("str. Decebal 99"));
+        json_object_set_new(obj, "district_id", json_integer(1 + i % 5));
+        json_object_set_new(obj, "num_rooms", json_integer(1 + i % 4));
+        json_object_set_new(obj, "area_sqm", json_integer(area));
+        json_object_set_new(obj, "price", json_integer(price));
+        json_object_set_new(obj, "price_per_sqm", json_real((double) price / area));
+        json_object_set_new(obj, "latitude", json_real(46.98 + (i % 100) * 0.00071));
+        json_object_set_new(obj, "longitude", json_real(28.85 + (i % 100) * 0.00093));
+        json_object_set_new(obj, "status", json_string("active"));
+        json_object_set_new(obj, "estimated_value_12m", json_real(price * 1.0437));
+        json_array_append_new(list, obj);
+    }
+    return list;
+}
+
+static json_t* prediction_batch(int count) {
+    json_t* list = json_array();
+    for (int i = 0; i < count; i++) {
+        json_t* obj = json_object();
+        json_object_set_new(obj, "district_id", json_integer(1 + i / 6));
+        json_object_set_new(obj, "num_rooms", json_integer(1 + i % 6));
+        json_object_set_new(obj, "current_avg_price", json_real(1100.0 + i * 7.31));
+        json_object_set_new(obj, "prediction_6m", json_real(1120.0 + i * 7.45));
+        json_object_set_new(obj, "prediction_12m", json_real(1141.0 + i * 7.52));
+        json_object_set_new(obj, "confidence", json_real(0.81 - i * 0.0007));
+        json_object_set_new(obj, "algorithm", json_string("holt_winters"));
+        json_array_append_new(list, obj);
+    }
+    return list;
+}
+
+// Encode time (best of a few runs of BENCH_ITERATIONS) and size in one format
+static void bench_format(json_t* payload, response_format_t format, double* out_us, size_t* out_size) {
+    double best = 1e30;
+    for (int run = 0; run < 3; run++) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < BENCH_ITERATIONS; i++) {
+            char* body = NULL;
+            size_t length = 0;
+            assert(response_encode(payload, format, &body, &length) == 0);
+            *out_size = length;
+            free(body);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double us = elapsed_us(start, end) / BENCH_ITERATIONS;
+        best = us < best ? us : best;
+    }
+    *out_us = best;
+}
+
+// Test round trips and compare encode time and size with JSON
+void test_benchmark() {
+    print_test_header("response_encode (round trip, JSON vs CBOR vs MessagePack)");
+
+    json_t* rows = trend_series(240);
+    struct {
+        const char* name;
+        json_t* payload;
+    } payloads[] = {
+        { "trends, 240 months (rows)", rows },
+        { "trends, 240 months (columns)", response_records_to_columns(rows) },
+        { "1000 listings", property_list(1000) },
+        { "300 predictions", prediction_batch(300) }
+    };
+    const response_format_t formats[] = { RESPONSE_FORMAT_JSON, RESPONSE_FORMAT_CBOR, RESPONSE_FORMAT_MSGPACK };
+
+    printf("%-30s %8s %14s %14s\n", "payload", "format", "encode (us)", "size (bytes)");
+    for (size_t p = 0; p < sizeof(payloads) / sizeof(payloads[0]); p++) {
+        json_t* payload = payloads[p].payload;
+        assert(payload != NULL);
+        size_t json_size = 0;
+        for (size_t f = 0; f < 3; f++) {
+            double us = 0.0;
+            size_t size = 0;
+            bench_format(payload, formats[f], &us, &size);
+            printf("%-30s %8s %14.1f %14zu\n", payloads[p].name, response_format_name(formats[f]), us, size);
+            if (f == 0) {
+                json_size = size;
+                continue;
+            }
+            assert(size < json_size && "Binary encodings should be smaller than JSON");
+
+            char* body = NULL;
+            size_t length = 0;
+            assert(response_encode(payload, formats[f], &body, &length) == 0);
+            json_t* back = decode(formats[f], body, length);
+            assert(same_value(payload, back) && "Decoding should give back the document");
+            json_decref(back);
+            free(body);
+        }
+    }
+
+    // In the column layout each numeric column is one typed array
+    json_t* columns = payloads[1].payload;
+    assert(json_array_size(json_object_get(columns, "price")) == 240);
+    char* body = NULL;
+    size_t length = 0;
+    assert(response_encode(json_object_get(columns, "price"), RESPONSE_FORMAT_CBOR, &body, &length) == 0);
+    assert(length == 2 + 3 + 240 * 4 && "Tag, byte string head and 240 float32");
+    free(body);
+
+    for (size_t p = 0; p < sizeof(payloads) / sizeof(payloads[0]); p++) {
+        json_decref(payloads[p].payload);
+    }
+    assert(response_records_to_columns(NULL) == NULL);
+    json_t* empty = json_array();
+    json_t* no_columns = response_records_to_columns(empty);
+    assert(json_object_size(no_columns) == 0);
+    json_decref(no_columns);
+    json_decref(empty);
+    printf("Test passed!\n");
+}
+
+// Main test function
+int main() {
+    printf("Starting response encoding tests...\n");
+
+    test_negotiation();
+    test_encoding_bytes();
+    test_benchmark();
+
+    print_separator();
+    printf("All tests passed!\n");
+    return 0;
+}
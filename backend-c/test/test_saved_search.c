@@ -0,0 +1,247 @@
+#include "../src/include/saved_search.h"
+#include "../src/include/properties.h"
+#include "../src/include/rng.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <assert.h>
+#include <time.h>
+
+#define SEARCHES 1000000
+#define LISTINGS 20000
+#define CHECKED_LISTINGS 100
+#define BATCH 100
+#define DISTRICTS 30
+
+// Test utility functions
+void print_separator() {
+    printf("\n--------------------------------------------------\n");
+}
+
+void print_test_header(const char* test_name) {
+    print_separator();
+    printf("TEST: %s\n", test_name);
+    print_separator();
+}
+
+static double elapsed_us(struct timespec start, struct timespec end) {
+    return (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3;
+}
+
+static property_t make_listing(int id, int district_id, int rooms, int price) {
+    property_t p;
+    memset(&p, 0, sizeof(p));
+    p.id = id;
+    p.district_id = district_id;
+    p.type_id = 1;
+    p.num_rooms = rooms;
+    p.area_sqm = 25 + 20 * rooms;
+    p.price = price;
+    p.status = PROPERTY_STATUS_ACTIVE;
+    return p;
+}
+
+// Test search_params compilation and the ingest hook
+void test_alerts() {
+    print_test_header("saved_search (compile, hook, alerts)");
+
+    saved_search_init();
+    assert(saved_search_add(1, 10, "{\"district_id\": 1, \"num_rooms\": 2, \"max_price\": 60000}") == 0);
+    assert(saved_search_add(2, 11, "{\"district_ids\": [1, 2], \"min_area\": 60, \"features\": [3]}") == 0);
+    assert(saved_search_add(3, 12, "{\"max_price\": \"45000\", \"min_rooms\": 1, \"max_rooms\": 0}") == 0);
+    assert(saved_search_add(4, 12, "not json") != 0 && "Malformed JSON should be rejected");
+    assert(saved_search_add(4, 12, "{\"district_id\": 65}") != 0 && "Districts beyond 64 should be rejected");
+    assert(saved_search_add(4, 12, "{\"min_price\": 9, \"max_price\": 5}") != 0 && "Empty ranges should be rejected");
+    assert(saved_search_remove(4) != 0 && "Rejected searches should not be indexed");
+
+    saved_search_stats_t stats;
+    saved_search_get_stats(&stats);
+    assert(stats.searches == 3);
+
+    // New listing: matches search 1 (and 3 is over budget)
+    property_t listing = make_listing(100, 1, 2, 55000);
+    assert(properties_ingest(&listing, 1) == 0);
+    assert(saved_search_match_pending(1) == 1);
+    search_alert_t alerts[8];
+    assert(saved_search_dequeue(alerts, 8) == 1);
+    assert(alerts[0].search_id == 1 && alerts[0].user_id == 10 && alerts[0].property_id == 100);
+    assert(alerts[0].reason == SEARCH_ALERT_NEW_LISTING);
+
+    // Price drop into search 3's budget: only search 3 is new
+    listing.price = 44000;
+    assert(properties_ingest(&listing, 1) == 0);
+    assert(saved_search_match_pending(1) == 1);
+    assert(saved_search_dequeue(alerts, 8) == 1);
+    assert(alerts[0].search_id == 3 && alerts[0].reason == SEARCH_ALERT_NOW_MATCHING &&
+           "Searches that already matched should not alert again");
+
+    // Unchanged and non-searchable updates are not queued
+    assert(properties_ingest(&listing, 1) == 0);
+    assert(saved_search_match_pending(1) == 0);
+
+    // Features and area
+    property_t large = make_listing(101, 2, 3, 90000);
+    large.features = 1u << 2;
+    assert(properties_ingest(&large, 1) == 0);
+    assert(saved_search_match_pending(1) == 1);
+    assert(saved_search_dequeue(alerts, 8) == 1 && alerts[0].search_id == 2);
+
+    // Replacing a search re-indexes it; removing it stops alerts
+    assert(saved_search_add(1, 10, "{\"district_id\": 3}") == 0);
+    saved_search_get_stats(&stats);
+    assert(stats.searches == 3 && "Replacing should not add a search");
+    property_t moved = make_listing(102, 1, 2, 50000);
+    assert(saved_search_match(&moved, NULL, 1, 1) == 0 && "Replaced filter should apply");
+    assert(saved_search_remove(3) == 0);
+    assert(saved_search_remove(3) != 0);
+    property_t cheap = make_listing(103, 3, 1, 20000);
+    assert(saved_search_match(&cheap, NULL, 1, 1) == 1);
+    assert(saved_search_dequeue(alerts, 8) == 1 && alerts[0].search_id == 1);
+
+    // Sold listings never alert
+    cheap.status = PROPERTY_STATUS_SOLD;
+    assert(saved_search_match(&cheap, NULL, 1, 1) == 0);
+
+    saved_search_remove(1);
+    saved_search_remove(2);
+    saved_search_get_stats(&stats);
+    assert(stats.searches == 0 && stats.queue_length == 0);
+    printf("Test passed!\n");
+}
+
+// Random search, with its filter also kept in plain form for brute force
+typedef struct {
+    int district_id;           // 0 = any
+    int rooms;                 // 0 = any
+    int min_price;
+    int max_price;             // 0 = any
+} test_search_t;
+
+static int brute_matches(const test_search_t* s, const property_t* p) {
+    return (s->district_id == 0 || p->district_id == s->district_id) &&
+           (s->rooms == 0 || p->num_rooms == s->rooms) &&
+           p->price >= s->min_price && (s->max_price == 0 || p->price <= s->max_price);
+}
+
+static int compare_alerts(const void* a, const void* b) {
+    const search_alert_t* x = a;
+    const search_alert_t* y = b;
+    if (x->property_id != y->property_id) {
+        return x->property_id - y->property_id;
+    }
+    return x->search_id - y->search_id;
+}
+
+// Test correctness against brute force and throughput with 1M searches
+void test_scale() {
+    print_test_header("saved_search (1M searches, brute force, throughput)");
+
+    rng_t rng;
+    rng_seed(&rng, 35);
+    property_t* listings = malloc(sizeof(property_t) * LISTINGS);
+    for (int i = 0; i < LISTINGS; i++) {
+        int rooms = 1 + (int) rng_below(&rng, 4);
+        int price = (int) (rooms * (25000 + rng_below(&rng, 40000)));
+        listings[i] = make_listing(1000 + i, 1 + (int) rng_below(&rng, DISTRICTS), rooms, price);
+    }
+    assert(properties_ingest(listings, LISTINGS) == 0);
+
+    test_search_t* searches = malloc(sizeof(test_search_t) * SEARCHES);
+    char params[160];
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < SEARCHES; i++) {
+        test_search_t* s = &searches[i];
+        memset(s, 0, sizeof(*s));
+        // Mostly district + rooms, a few broader filters
+        int shape = (int) rng_below(&rng, 100);
+        if (shape < 96 || shape == 98) {
+            s->district_id = 1 + (int) rng_below(&rng, DISTRICTS);
+        }
+        if (shape < 98) {
+            s->rooms = 1 + (int) rng_below(&rng, 4);
+        }
+        s->max_price = (s->rooms ? s->rooms : 2) * (30000 + (int) rng_below(&rng, 30000));
+        s->min_price = s->max_price / 4 * 3;
+        snprintf(params, sizeof(params), "{\"district_id\": %d, \"num_rooms\": %d, \"min_price\": %d, \"max_price\": %d}",
+                 s->district_id, s->rooms, s->min_price, s->max_price);
+        assert(saved_search_add(i + 1, 1 + i / 5, params) == 0);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("Compiled and indexed %d searches in %.0f ms\n", SEARCHES, elapsed_us(start, end) / 1000.0);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    saved_search_reindex();
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("Reindexed in %.0f ms\n", elapsed_us(start, end) / 1000.0);
+
+    // Correctness: the alerts for the first listings equal brute force
+    long queued = saved_search_match(listings, NULL, CHECKED_LISTINGS, 4);
+    assert(queued > 0);
+    search_alert_t* alerts = malloc(sizeof(search_alert_t) * SAVED_SEARCH_QUEUE_CAPACITY);
+    size_t got = saved_search_dequeue(alerts, SAVED_SEARCH_QUEUE_CAPACITY);
+    assert(got == (size_t) queued);
+    qsort(alerts, got, sizeof(search_alert_t), compare_alerts);
+    size_t expected = 0;
+    for (int i = 0; i < CHECKED_LISTINGS; i++) {
+        for (int s = 0; s < SEARCHES; s++) {
+            if (brute_matches(&searches[s], &listings[i])) {
+                assert(expected < got && alerts[expected].property_id == listings[i].id &&
+                       alerts[expected].search_id == s + 1 && "Alerts should equal brute force");
+                assert(alerts[expected].user_id == 1 + s / 5);
+                expected++;
+            }
+        }
+    }
+    assert(expected == got && "No alert should be raised twice or wrongly");
+    printf("%zu alerts for %d listings match brute force\n", got, CHECKED_LISTINGS);
+
+    // Throughput over all listings, draining the queue between batches
+    saved_search_stats_t before, after;
+    saved_search_get_stats(&before);
+    double match_us = 0.0;
+    long total = 0;
+    for (int b = 0; b < LISTINGS; b += BATCH) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        long n = saved_search_match(&listings[b], NULL, BATCH, 0);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        assert(n >= 0);
+        match_us += elapsed_us(start, end);
+        total += n;
+        while (saved_search_dequeue(alerts, SAVED_SEARCH_QUEUE_CAPACITY) > 0) {
+        }
+    }
+    saved_search_get_stats(&after);
+    double per_listing = (double) (after.candidates_checked - before.candidates_checked) / LISTINGS;
+    printf("%d listings in %.0f ms: %.0f listings/s, %.0f candidates and %.0f alerts per listing\n", LISTINGS,
+           match_us / 1000.0, LISTINGS / (match_us / 1e6), per_listing, (double) total / LISTINGS);
+    assert(per_listing < SEARCHES / 10.0 && "The index should prune most searches");
+    assert(after.alerts_dropped == 0);
+
+    // Queue overflow is counted, not fatal
+    for (int b = 0; after.alerts_dropped == 0; b += BATCH) {
+        assert(saved_search_match(&listings[b % LISTINGS], NULL, BATCH, 0) >= 0);
+        saved_search_get_stats(&after);
+    }
+    assert(after.queue_length == SAVED_SEARCH_QUEUE_CAPACITY && after.alerts_dropped > 0);
+    while (saved_search_dequeue(alerts, SAVED_SEARCH_QUEUE_CAPACITY) > 0) {
+    }
+
+    free(alerts);
+    free(searches);
+    free(listings);
+    printf("Test passed!\n");
+}
+
+// Main test function
+int main() {
+    printf("Starting saved-search matching tests...\n");
+
+    test_alerts();
+    test_scale();
+
+    print_separator();
+    printf("All tests passed!\n");
+    return 0;
+}
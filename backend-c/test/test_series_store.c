@@ -0,0 +1,144 @@
+#include "../src/include/series_store.h"
+#include "../src/include/prediction.h"
+#include "../src/include/utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TEST_STORE_PATH "/tmp/test_price_series.bin"
+
+// Test utility functions
+void print_separator() {
+    printf("\n--------------------------------------------------\n");
+}
+
+void print_test_header(const char* test_name) {
+    print_separator();
+    printf("TEST: %s\n", test_name);
+    print_separator();
+}
+
+static double elapsed_ms(struct timespec start, struct timespec end) {
+    return (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1e6;
+}
+
+// Synthetic history: `districts` x `rooms` series of `months` points, with
+// a gap every 37 months to exercise non-unit deltas
+static price_history_row_t* make_history(int districts, int rooms, int months, size_t* out_count) {
+    price_history_row_t* rows = malloc(sizeof(price_history_row_t) * (size_t) districts * rooms * months);
+    size_t n = 0;
+    int first = month_index_from_ym(1975, 1);
+    for (int d = 1; d <= districts; d++) {
+        for (int r = 1; r <= rooms; r++) {
+            for (int m = 0; m < months; m++) {
+                if (m % 37 == 36) {
+                    continue;
+                }
+                rows[n].district_id = d;
+                rows[n].room_count = r;
+                rows[n].month = first + m;
+                rows[n].avg_price_per_sqm = 500.0 + d * 10.0 + r + m * 0.75;
+                rows[n].sample_size = (m * 7 + d) % 300;
+                n++;
+            }
+        }
+    }
+    *out_count = n;
+    return rows;
+}
+
+// Test build/open round trip on decades of history
+void test_round_trip() {
+    print_test_header("series_store build/open round trip");
+
+    size_t count = 0;
+    price_history_row_t* rows = make_history(40, 5, 600, &count);
+
+    assert(series_store_build(TEST_STORE_PATH, rows, count, 42) == 0 && "Build should succeed");
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int rc = series_store_open(TEST_STORE_PATH);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("Opened %zu series (%zu points) in %.3f ms\n", series_store_count(), count, elapsed_ms(start, end));
+
+    assert(rc == 0 && "Open should succeed");
+    assert(series_store_count() == 200 && "All series should be present");
+    assert(series_store_version() == 42 && "Data version should round trip");
+
+    int district = 0, rooms = 0;
+    assert(series_store_key(7, &district, &rooms) == 0 && district == 2 && rooms == 3 && "Directory should be sorted");
+
+    int n = 0;
+    price_history_row_t* series = series_store_get_series(17, 4, 10000, &n);
+    assert(series != NULL && "Series should be found");
+
+    // Compare against the source rows of that series
+    size_t src = 0;
+    while (!(rows[src].district_id == 17 && rows[src].room_count == 4)) {
+        src++;
+    }
+    for (int i = 0; i < n; i++, src++) {
+        assert(series[i].month == rows[src].month && "Months should decode exactly");
+        assert(series[i].sample_size == rows[src].sample_size && "Sample sizes should decode exactly");
+        assert(fabs(series[i].avg_price_per_sqm - rows[src].avg_price_per_sqm) < 0.01 && "Prices should round trip as float32");
+    }
+    printf("Series (17, 4): %d points\n", n);
+    free(series);
+
+    // Tail selection keeps the most recent months
+    series = series_store_get_series(17, 4, 12, &n);
+    assert(n == 12 && series[11].month == rows[src - 1].month && "Tail should end at the latest month");
+    free(series);
+
+    assert(series_store_get_series(99, 1, 12, &n) == NULL && n == 0 && "Unknown series should not be found");
+
+    // Trends are served from the store
+    price_trend_point_t* trends = get_price_trends(3, 2, 24, &n);
+    assert(n == 24 && fabs(trends[23].price - (500.0 + 30.0 + 2 + 599 * 0.75)) < 0.01 && "Trends should come from the store");
+    free(trends);
+
+    free(rows);
+    printf("Test passed!\n");
+}
+
+// Test that a rebuild atomically replaces the file and bumps the version
+void test_rebuild_and_validation() {
+    print_test_header("series_store rebuild and validation");
+
+    price_history_row_t row = { .district_id = 1, .room_count = 2, .month = month_index_from_ym(2025, 1),
+                                .avg_price_per_sqm = 1000.0, .sample_size = 5 };
+    assert(series_store_build(TEST_STORE_PATH, &row, 1, 43) == 0 && "Rebuild should succeed");
+    assert(series_store_open(TEST_STORE_PATH) == 0 && "Reopen should succeed");
+    assert(series_store_version() == 43 && series_store_count() == 1 && "New file should be served");
+
+    // A truncated file must be rejected and the current store kept
+    FILE* f = fopen(TEST_STORE_PATH ".bad", "wb");
+    fwrite("MIRS", 1, 4, f);
+    fclose(f);
+    assert(series_store_open(TEST_STORE_PATH ".bad") != 0 && "Truncated file should be rejected");
+    assert(series_store_version() == 43 && "Previous store should stay in service");
+
+    series_store_close();
+    assert(series_store_count() == 0 && "Closed store should be empty");
+
+    unlink(TEST_STORE_PATH);
+    unlink(TEST_STORE_PATH ".bad");
+    printf("Test passed!\n");
+}
+
+// Main test function
+int main() {
+    printf("Starting series store tests...\n");
+
+    test_round_trip();
+    test_rebuild_and_validation();
+
+    print_separator();
+    printf("All tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,296 @@
+#include "../src/include/singleflight.h"
+#include "../src/include/utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define CALLERS 32
+#define KEYS 4
+#define OVERHEAD_CALLS 200000
+
+// Test utility functions
+void print_separator() {
+    printf("\n--------------------------------------------------\n");
+}
+
+void print_test_header(const char* test_name) {
+    print_separator();
+    printf("TEST: %s\n", test_name);
+    print_separator();
+}
+
+static double elapsed_us(struct timespec start, struct timespec end) {
+    return (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3;
+}
+
+static atomic_int loads = 0;
+static atomic_int expected_joins = 0;
+
+// Slow loader: holds its run open until the expected number of callers
+// have joined it (or a second has passed)
+static int slow_loader(void* ctx, char** out_body, size_t* out_length) {
+    const char* key = ctx;
+    atomic_fetch_add(&loads, 1);
+    for (int i = 0; i < 1000; i++) {
+        singleflight_stats_t stats;
+        singleflight_get_stats(&stats);
+        if (stats.coalesced >= (uint64_t) atomic_load(&expected_joins)) {
+            break;
+        }
+        usleep(1000);
+    }
+    usleep(10000);
+    char body[64];
+    int length = snprintf(body, sizeof(body), "{\"key\":\"%s\"}", key);
+    *out_body = strdup(body);
+    *out_length = (size_t) length;
+    return 200;
+}
+
+typedef struct {
+    char key[32];
+    int code;
+    int shared;
+    char* body;
+    size_t length;
+} caller_t;
+
+static void* caller_thread(void* arg) {
+    caller_t* caller = arg;
+    caller->code = singleflight_do(caller->key, slow_loader, caller->key, 0,
+                                   &caller->body, &caller->length, &caller->shared);
+    return NULL;
+}
+
+// Test that identical concurrent calls run the loader once
+void test_coalescing() {
+    print_test_header("singleflight (identical concurrent calls)");
+
+    singleflight_stats_t before;
+    singleflight_get_stats(&before);
+    atomic_store(&loads, 0);
+    atomic_store(&expected_joins, (int) before.coalesced + CALLERS - 1);
+
+    caller_t callers[CALLERS];
+    pthread_t threads[CALLERS];
+    for (int i = 0; i < CALLERS; i++) {
+        memset(&callers[i], 0, sizeof(caller_t));
+        snprintf(callers[i].key, sizeof(callers[i].key), "trends:1:2:12");
+        pthread_create(&threads[i], NULL, caller_thread, &callers[i]);
+    }
+    int shared = 0;
+    for (int i = 0; i < CALLERS; i++) {
+        pthread_join(threads[i], NULL);
+        assert(callers[i].code == 200);
+        assert(strcmp(callers[i].body, "{\"key\":\"trends:1:2:12\"}") == 0);
+        assert(callers[i].length == strlen(callers[i].body));
+        for (int j = 0; j < i; j++) {
+            assert(callers[i].body != callers[j].body && "Each caller gets its own copy");
+        }
+        shared += callers[i].shared;
+    }
+    for (int i = 0; i < CALLERS; i++) {
+        free(callers[i].body);
+    }
+
+    singleflight_stats_t after;
+    singleflight_get_stats(&after);
+    printf("%d callers -> %d loader run(s), %d shared results\n", CALLERS, atomic_load(&loads), shared);
+    assert(atomic_load(&loads) == 1 && shared == CALLERS - 1);
+    assert(after.calls - before.calls == CALLERS);
+    assert(after.executions - before.executions == 1);
+    assert(after.coalesced - before.coalesced == CALLERS - 1);
+    assert(after.in_flight == 0);
+    printf("Test passed!\n");
+}
+
+// Test that different keys do not wait for each other
+void test_distinct_keys() {
+    print_test_header("singleflight (distinct keys)");
+
+    singleflight_stats_t before;
+    singleflight_get_stats(&before);
+    atomic_store(&loads, 0);
+    atomic_store(&expected_joins, (int) before.coalesced + CALLERS - KEYS);
+
+    caller_t callers[CALLERS];
+    pthread_t threads[CALLERS];
+    for (int i = 0; i < CALLERS; i++) {
+        memset(&callers[i], 0, sizeof(caller_t));
+        snprintf(callers[i].key, sizeof(callers[i].key), "property:%d", i % KEYS);
+        pthread_create(&threads[i], NULL, caller_thread, &callers[i]);
+    }
+    for (int i = 0; i < CALLERS; i++) {
+        pthread_join(threads[i], NULL);
+        char expected[64];
+        snprintf(expected, sizeof(expected), "{\"key\":\"property:%d\"}", i % KEYS);
+        assert(callers[i].code == 200 && strcmp(callers[i].body, expected) == 0);
+        free(callers[i].body);
+    }
+
+    singleflight_stats_t after;
+    singleflight_get_stats(&after);
+    printf("%d callers over %d keys -> %d loader runs\n", CALLERS, KEYS, atomic_load(&loads));
+    assert(atomic_load(&loads) == KEYS);
+    assert(after.coalesced - before.coalesced == CALLERS - KEYS);
+    printf("Test passed!\n");
+}
+
+static int failing_loader(void* ctx, char** out_body, size_t* out_length) {
+    (void) ctx;
+    (void) out_body;
+    (void) out_length;
+    atomic_fetch_add(&loads, 1);
+    return 503;
+}
+
+static int counting_loader(void* ctx, char** out_body, size_t* out_length) {
+    (void) ctx;
+    atomic_fetch_add(&loads, 1);
+    *out_body = strdup("[]");
+    *out_length = 2;
+    return 200;
+}
+
+// Test sequential calls, result codes without a body and long keys
+void test_sequential() {
+    print_test_header("singleflight (no caching, codes, long keys)");
+
+    char* body = NULL;
+    size_t length = 0;
+    int shared = -1;
+
+    // Finished runs are not reused
+    atomic_store(&loads, 0);
+    for (int i = 0; i < 3; i++) {
+        assert(singleflight_do("district:3", counting_loader, NULL, 0, &body, &length, &shared) == 200);
+        assert(strcmp(body, "[]") == 0 && length == 2 && shared == 0);
+        free(body);
+    }
+    assert(atomic_load(&loads) == 3);
+
+    // The loader's code comes back even without a body
+    assert(singleflight_do("district:4", failing_loader, NULL, 0, &body, &length, NULL) == 503);
+    assert(body == NULL && length == 0);
+
+    // Keys too long to coalesce still run
+    char long_key[SINGLEFLIGHT_MAX_KEY + 16];
+    memset(long_key, 'k', sizeof(long_key) - 1);
+    long_key[sizeof(long_key) - 1] = '\0';
+    atomic_store(&loads, 0);
+    assert(singleflight_do(long_key, counting_loader, NULL, 0, &body, &length, NULL) == 200);
+    assert(atomic_load(&loads) == 1 && strcmp(body, "[]") == 0);
+    free(body);
+
+    // Overhead of an uncontended call
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < OVERHEAD_CALLS; i++) {
+        char key[32];
+        snprintf(key, sizeof(key), "property:%d", i % 1000);
+        singleflight_do(key, counting_loader, NULL, 0, &body, &length, NULL);
+        free(body);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("Uncontended call: %.3f us\n", elapsed_us(start, end) / OVERHEAD_CALLS);
+    printf("Test passed!\n");
+}
+
+static atomic_int gate_open = 0;
+
+// Loader held until the test opens the gate
+static int gated_loader(void* ctx, char** out_body, size_t* out_length) {
+    (void) ctx;
+    while (!atomic_load(&gate_open)) {
+        usleep(1000);
+    }
+    *out_body = strdup("{}");
+    *out_length = 2;
+    return 200;
+}
+
+typedef struct {
+    long long deadline_ms;
+    int code;
+    char* body;
+    size_t length;
+    long long waited_ms;
+} gated_caller_t;
+
+static void* gated_thread(void* arg) {
+    gated_caller_t* caller = arg;
+    long long started = monotonic_ms();
+    caller->code = singleflight_do("trends:9:9:12", gated_loader, NULL, caller->deadline_ms,
+                                   &caller->body, &caller->length, NULL);
+    caller->waited_ms = monotonic_ms() - started;
+    return NULL;
+}
+
+// Test that a waiter stops waiting at its own deadline while the run and
+// the other waiters carry on
+void test_waiter_deadline() {
+    print_test_header("singleflight (waiter deadlines)");
+
+    singleflight_stats_t before;
+    singleflight_get_stats(&before);
+    atomic_store(&gate_open, 0);
+
+    // The leader and a patient waiter, then a waiter with 50 ms left
+    gated_caller_t callers[3] = { { 0 }, { 0 }, { 0 } };
+    pthread_t threads[3];
+    pthread_create(&threads[0], NULL, gated_thread, &callers[0]);
+    for (;;) {
+        singleflight_stats_t stats;
+        singleflight_get_stats(&stats);
+        if (stats.in_flight > before.in_flight) {
+            break;
+        }
+        usleep(1000);
+    }
+    pthread_create(&threads[1], NULL, gated_thread, &callers[1]);
+    callers[2].deadline_ms = monotonic_ms() + 50;
+    pthread_create(&threads[2], NULL, gated_thread, &callers[2]);
+
+    pthread_join(threads[2], NULL);
+    printf("Waiter with a 50 ms deadline gave up after %lld ms\n", callers[2].waited_ms);
+    assert(callers[2].code == SINGLEFLIGHT_TIMEOUT && callers[2].body == NULL && "The waiter should time out");
+    assert(callers[2].waited_ms >= 45 && callers[2].waited_ms < 1000 && "It should wait until its deadline");
+
+    atomic_store(&gate_open, 1);
+    pthread_join(threads[0], NULL);
+    pthread_join(threads[1], NULL);
+    assert(callers[0].code == 200 && callers[1].code == 200 && "The others should get the result");
+    assert(strcmp(callers[0].body, "{}") == 0 && strcmp(callers[1].body, "{}") == 0);
+    free(callers[0].body);
+    free(callers[1].body);
+
+    // A deadline that is not reached changes nothing
+    char* body = NULL;
+    size_t length = 0;
+    assert(singleflight_do("trends:9:9:12", gated_loader, NULL, monotonic_ms() + 1000, &body, &length, NULL) == 200);
+    free(body);
+
+    singleflight_stats_t after;
+    singleflight_get_stats(&after);
+    assert(after.timeouts - before.timeouts == 1 && after.in_flight == 0);
+    printf("Test passed!\n");
+}
+
+// Main test function
+int main() {
+    printf("Starting singleflight tests...\n");
+
+    test_coalescing();
+    test_distinct_keys();
+    test_sequential();
+    test_waiter_deadline();
+
+    print_separator();
+    printf("All tests passed!\n");
+    return 0;
+}
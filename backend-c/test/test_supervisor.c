@@ -0,0 +1,502 @@
+#include "../src/include/supervisor.h"
+#include "../src/include/properties.h"
+#include "../src/include/utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define WORKERS 3
+#define MAX_PIDS 64
+#define SNAPSHOT_LISTINGS 100000
+
+// Test utility functions
+void print_separator() {
+    printf("\n--------------------------------------------------\n");
+}
+
+void print_test_header(const char* test_name) {
+    print_separator();
+    printf("TEST: %s\n", test_name);
+    print_separator();
+}
+
+static double elapsed_us(struct timespec start, struct timespec end) {
+    return (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3;
+}
+
+static char control_dir[64];
+
+static void control_path(char* out, size_t size, const char* name) {
+    snprintf(out, size, "%s/%s", control_dir, name);
+}
+
+static int control_exists(const char* name) {
+    char path[128];
+    control_path(path, sizeof(path), name);
+    return access(path, F_OK) == 0;
+}
+
+static void control_set(const char* name, int on) {
+    char path[128];
+    control_path(path, sizeof(path), name);
+    if (on) {
+        FILE* f = fopen(path, "w");
+        assert(f != NULL);
+        fclose(f);
+    } else {
+        unlink(path);
+    }
+}
+
+// Worker process (this binary run by the supervisor): answers each
+// connection with its pid and drains on SIGTERM
+static int run_worker(void) {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGINT);
+    sigprocmask(SIG_BLOCK, &signals, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    if (control_exists("fail")) {
+        return 3;   // A broken build
+    }
+    usleep(200000);   // Warm-up before it is ready
+    int listen_fd = supervisor_listen_socket();
+    assert(listen_fd >= 0);
+    supervisor_notify_ready();
+
+    for (;;) {
+        struct timespec zero = { 0, 0 };
+        if (sigtimedwait(&signals, NULL, &zero) > 0) {
+            // Stop accepting; queued connections stay with the socket
+            close(listen_fd);
+            return 0;
+        }
+        struct pollfd pfd = { listen_fd, POLLIN, 0 };
+        if (poll(&pfd, 1, 20) <= 0) {
+            continue;
+        }
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) {
+            continue;   // Another process took it
+        }
+        char request[16] = { 0 };
+        ssize_t n = recv(fd, request, sizeof(request) - 1, 0);
+        usleep(2000);   // Some work
+        char reply[32];
+        int length = snprintf(reply, sizeof(reply), "%ld\n", (long) getpid());
+        send(fd, reply, (size_t) length, MSG_NOSIGNAL);
+        close(fd);
+        if (n > 0 && strncmp(request, "crash", 5) == 0) {
+            _exit(9);
+        }
+    }
+}
+
+static unsigned int test_port = 0;
+static pid_t supervisor_pid = 0;
+
+// One request; returns the pid of the worker that answered, or -1
+static long ask(const char* request) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t) test_port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    long pid = -1;
+    if (connect(fd, (struct sockaddr*) &addr, sizeof(addr)) == 0 &&
+        send(fd, request, strlen(request), MSG_NOSIGNAL) > 0) {
+        char reply[32] = { 0 };
+        size_t got = 0;
+        ssize_t n;
+        while (got < sizeof(reply) - 1 && (n = recv(fd, reply + got, sizeof(reply) - 1 - got, 0)) > 0) {
+            got += (size_t) n;
+        }
+        if (got > 0 && reply[got - 1] == '\n') {
+            pid = atol(reply);
+        }
+    }
+    close(fd);
+    return pid;
+}
+
+typedef struct {
+    long pids[MAX_PIDS];
+    int count;
+} pid_set_t;
+
+static void pid_set_add(pid_set_t* set, long pid) {
+    for (int i = 0; i < set->count; i++) {
+        if (set->pids[i] == pid) {
+            return;
+        }
+    }
+    assert(set->count < MAX_PIDS);
+    set->pids[set->count++] = pid;
+}
+
+static int pid_set_has(const pid_set_t* set, long pid) {
+    for (int i = 0; i < set->count; i++) {
+        if (set->pids[i] == pid) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Workers answering a burst of requests
+static pid_set_t sample_workers(int requests) {
+    pid_set_t set = { { 0 }, 0 };
+    for (int i = 0; i < requests; i++) {
+        long pid = ask("ping\n");
+        assert(pid > 0);
+        pid_set_add(&set, pid);
+    }
+    return set;
+}
+
+// Client load running through reloads and crashes; every request must succeed
+static atomic_int load_running = 0;
+static atomic_long load_ok = 0;
+static atomic_long load_failed = 0;
+
+static void* load_thread(void* arg) {
+    (void) arg;
+    while (atomic_load(&load_running)) {
+        if (ask("ping\n") > 0) {
+            atomic_fetch_add(&load_ok, 1);
+        } else {
+            atomic_fetch_add(&load_failed, 1);
+        }
+    }
+    return NULL;
+}
+
+static pthread_t load_threads[4];
+
+static void load_start(void) {
+    atomic_store(&load_running, 1);
+    for (int t = 0; t < 4; t++) {
+        pthread_create(&load_threads[t], NULL, load_thread, NULL);
+    }
+}
+
+static void load_stop(void) {
+    atomic_store(&load_running, 0);
+    for (int t = 0; t < 4; t++) {
+        pthread_join(load_threads[t], NULL);
+    }
+}
+
+// Wait until a sample of answers is only from workers outside `old`
+static pid_set_t wait_for_new_generation(const pid_set_t* old, int timeout_ms) {
+    long long until = monotonic_ms() + timeout_ms;
+    while (monotonic_ms() < until) {
+        pid_set_t now = sample_workers(30);
+        int fresh = 1;
+        for (int i = 0; i < now.count; i++) {
+            fresh &= !pid_set_has(old, now.pids[i]);
+        }
+        if (fresh && now.count == WORKERS) {
+            return now;
+        }
+        usleep(50000);
+    }
+    assert(0 && "New generation did not take over");
+    return *old;
+}
+
+static unsigned int free_port(void) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert(bind(fd, (struct sockaddr*) &addr, sizeof(addr)) == 0);
+    socklen_t length = sizeof(addr);
+    getsockname(fd, (struct sockaddr*) &addr, &length);
+    close(fd);
+    return ntohs(addr.sin_port);
+}
+
+static char* worker_argv[] = { "test_supervisor", NULL };
+
+// Test that workers share the port and each gets connections
+void test_start(void) {
+    print_test_header("supervisor (start, SO_REUSEPORT spread)");
+
+    test_port = free_port();
+    fflush(stdout);
+    supervisor_pid = fork();
+    assert(supervisor_pid >= 0);
+    if (supervisor_pid == 0) {
+        supervisor_config_t config = { test_port, WORKERS, worker_argv, 5, 2 };
+        _exit(supervisor_run(&config));
+    }
+
+    // Once bound, connections queue on the sockets until workers accept
+    long long started = monotonic_ms();
+    while (ask("ping\n") <= 0) {
+        assert(monotonic_ms() - started < 5000);
+        usleep(10000);
+    }
+    printf("First answer after %lld ms\n", monotonic_ms() - started);
+
+    pid_set_t workers = sample_workers(200);
+    printf("200 connections answered by %d workers\n", workers.count);
+    assert(workers.count == WORKERS);
+    printf("Test passed!\n");
+}
+
+// Test SIGHUP: a new generation takes over without failed requests
+void test_reload(void) {
+    print_test_header("supervisor (SIGHUP reload under load)");
+
+    pid_set_t old = sample_workers(100);
+    assert(old.count == WORKERS);
+    atomic_store(&load_ok, 0);
+    atomic_store(&load_failed, 0);
+    load_start();
+    usleep(100000);
+
+    long long reload_at = monotonic_ms();
+    kill(supervisor_pid, SIGHUP);
+    pid_set_t fresh = wait_for_new_generation(&old, 10000);
+    long long took = monotonic_ms() - reload_at;
+    usleep(300000);
+    load_stop();
+
+    printf("Generation replaced in %lld ms; %ld requests served, %ld failed\n", took,
+           atomic_load(&load_ok), atomic_load(&load_failed));
+    assert(atomic_load(&load_failed) == 0);
+    assert(atomic_load(&load_ok) > 100);
+    // The old workers are gone
+    usleep(200000);
+    for (int i = 0; i < old.count; i++) {
+        assert(kill((pid_t) old.pids[i], 0) != 0 && errno == ESRCH);
+    }
+    assert(fresh.count == WORKERS);
+    printf("Test passed!\n");
+}
+
+// Test that a generation that cannot start leaves the current one serving
+void test_failed_reload(void) {
+    print_test_header("supervisor (failed reload keeps serving)");
+
+    pid_set_t before = sample_workers(100);
+    atomic_store(&load_failed, 0);
+    load_start();
+    control_set("fail", 1);
+    kill(supervisor_pid, SIGHUP);
+    usleep(800000);
+    control_set("fail", 0);
+    load_stop();
+
+    pid_set_t after = sample_workers(100);
+    assert(after.count == WORKERS);
+    for (int i = 0; i < after.count; i++) {
+        assert(pid_set_has(&before, after.pids[i]) && "The old generation should still serve");
+    }
+    assert(atomic_load(&load_failed) == 0);
+
+    // A later reload still works
+    kill(supervisor_pid, SIGHUP);
+    wait_for_new_generation(&before, 10000);
+    printf("Test passed!\n");
+}
+
+// Test that a crashed worker is replaced and its queue is kept
+void test_crash(void) {
+    print_test_header("supervisor (worker crash)");
+
+    pid_set_t before = sample_workers(100);
+    atomic_store(&load_failed, 0);
+    load_start();
+    long crashed = ask("crash\n");
+    assert(crashed > 0);
+    usleep(1500000);   // Restarted after the backoff for workers dying young at most
+    load_stop();
+
+    pid_set_t after = sample_workers(200);
+    printf("Worker %ld crashed; %d workers answer, %ld requests failed\n", crashed, after.count,
+           atomic_load(&load_failed));
+    assert(after.count == WORKERS && !pid_set_has(&after, crashed));
+    assert(atomic_load(&load_failed) == 0);
+    (void) before;
+    printf("Test passed!\n");
+}
+
+// Test SIGTERM: workers drain and the supervisor exits cleanly
+void test_shutdown(void) {
+    print_test_header("supervisor (shutdown)");
+
+    kill(supervisor_pid, SIGTERM);
+    int status = 0;
+    assert(waitpid(supervisor_pid, &status, 0) == supervisor_pid);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    assert(ask("ping\n") == -1 && "Nothing listens after shutdown");
+    printf("Test passed!\n");
+}
+
+static int hook_calls = 0;
+static int hook_new = 0;
+
+static void count_hook(const property_t* previous, const property_t* current, void* ctx) {
+    (void) current;
+    (void) ctx;
+    hook_calls++;
+    hook_new += previous == NULL;
+}
+
+static property_t make_listing(int id) {
+    property_t p;
+    memset(&p, 0, sizeof(p));
+    p.id = id;
+    p.district_id = 1 + id % 5;
+    p.num_rooms = 1 + id % 4;
+    p.area_sqm = 40 + id % 60;
+    p.price = 50000 + id;
+    p.status = PROPERTY_STATUS_ACTIVE;
+    p.latitude = 47.0;
+    p.longitude = 28.8;
+    return p;
+}
+
+// Test publishing and mapping the listing snapshot
+void test_listing_snapshot(void) {
+    print_test_header("properties (listing snapshot)");
+
+    char path[128];
+    control_path(path, sizeof(path), "listings.bin");
+    properties_register_ingest_hook(count_hook, NULL);
+
+    // Ids arrive out of order; the snapshot is sorted
+    property_t* rows = malloc(sizeof(property_t) * SNAPSHOT_LISTINGS);
+    for (int i = 0; i < SNAPSHOT_LISTINGS; i++) {
+        rows[i] = make_listing(SNAPSHOT_LISTINGS - i);
+    }
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    assert(properties_ingest(rows, SNAPSHOT_LISTINGS) == 0);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double ingest_ms = elapsed_us(start, end) / 1000.0;
+    assert(properties_publish_snapshot(path) == 0);
+    struct stat st;
+    assert(stat(path, &st) == 0 && (size_t) st.st_size == 32 + sizeof(property_t) * SNAPSHOT_LISTINGS);
+
+    // Mapping the same listings changes nothing
+    hook_calls = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    assert(properties_open_snapshot(path) == 0);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("%d listings: ingest %.1f ms, snapshot open %.1f ms (%zu bytes shared)\n", SNAPSHOT_LISTINGS, ingest_ms,
+           elapsed_us(start, end) / 1000.0, (size_t) st.st_size);
+    assert(hook_calls == 0);
+    property_t found;
+    assert(properties_find(777, &found) == 0 && found.price == 50777);
+    assert(properties_find(SNAPSHOT_LISTINGS + 1, &found) != 0);
+    size_t count = 0;
+    const property_t* mapped = properties_acquire(&count);
+    assert(count == SNAPSHOT_LISTINGS && mapped[0].id == 1 && mapped[count - 1].id == SNAPSHOT_LISTINGS);
+    properties_release();
+
+    // Changes made while mapped copy the listings out first
+    property_t changed = make_listing(10);
+    changed.price = 1;
+    property_t added = make_listing(SNAPSHOT_LISTINGS + 5);
+    property_t batch[] = { changed, added };
+    hook_calls = hook_new = 0;
+    assert(properties_ingest(batch, 2) == 0);
+    assert(hook_calls == 2 && hook_new == 1);
+    assert(properties_find(10, &found) == 0 && found.price == 1);
+    assert(properties_find(SNAPSHOT_LISTINGS + 5, &found) == 0);
+
+    // Going back to the published file reports what differs from memory
+    hook_calls = hook_new = 0;
+    assert(properties_open_snapshot(path) == 0);
+    assert(hook_calls == 1 && hook_new == 0 && "Only the price change differs; extra rows are kept out");
+    assert(properties_find(10, &found) == 0 && found.price == 50010);
+
+    // A newer snapshot reports the new listing
+    assert(properties_ingest(&added, 1) == 0);
+    assert(properties_publish_snapshot(path) == 0);
+    hook_calls = 0;
+    assert(properties_open_snapshot(path) == 0);
+    assert(hook_calls == 0 && properties_find(SNAPSHOT_LISTINGS + 5, &found) == 0);
+
+    // Files from another layout or truncated ones are refused (published
+    // files are never changed in place, they are mapped; use a copy)
+    char bad_path[160];
+    snprintf(bad_path, sizeof(bad_path), "%s.bad", path);
+    FILE* in = fopen(path, "rb");
+    FILE* out = fopen(bad_path, "wb");
+    assert(in != NULL && out != NULL);
+    char block[4096];
+    size_t n;
+    while ((n = fread(block, 1, sizeof(block), in)) > 0) {
+        fwrite(block, 1, n, out);
+    }
+    fclose(in);
+    fclose(out);
+    FILE* f = fopen(bad_path, "r+b");
+    assert(f != NULL);
+    fseek(f, 8, SEEK_SET);
+    uint32_t record_size = sizeof(property_t) + 8;
+    fwrite(&record_size, sizeof(record_size), 1, f);
+    fclose(f);
+    assert(properties_open_snapshot(bad_path) != 0);
+    record_size = sizeof(property_t);
+    f = fopen(bad_path, "r+b");
+    fseek(f, 8, SEEK_SET);
+    fwrite(&record_size, sizeof(record_size), 1, f);
+    fclose(f);
+    assert(truncate(bad_path, 40) == 0);
+    assert(properties_open_snapshot(bad_path) != 0);
+    assert(properties_find(777, &found) == 0 && "A refused file leaves the store as it was");
+    unlink(bad_path);
+    unlink(path);
+    free(rows);
+    printf("Test passed!\n");
+}
+
+// Main test function
+int main() {
+    if (supervisor_worker_slot() >= 0) {
+        const char* dir = getenv("TEST_CONTROL_DIR");
+        snprintf(control_dir, sizeof(control_dir), "%s", dir ? dir : "/tmp");
+        return run_worker();
+    }
+
+    printf("Starting supervisor tests...\n");
+    snprintf(control_dir, sizeof(control_dir), "/tmp/test_supervisor.XXXXXX");
+    assert(mkdtemp(control_dir) != NULL);
+    setenv("TEST_CONTROL_DIR", control_dir, 1);
+    signal(SIGPIPE, SIG_IGN);
+
+    test_listing_snapshot();
+    test_start();
+    test_reload();
+    test_failed_reload();
+    test_crash();
+    test_shutdown();
+
+    rmdir(control_dir);
+    print_separator();
+    printf("All tests passed!\n");
+    return 0;
+}
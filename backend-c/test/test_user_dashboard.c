@@ -0,0 +1,185 @@
+#include "../src/include/user_dashboard.h"
+#include "../src/include/user_writes.h"
+#include "../src/include/prediction.h"
+#include "../src/include/series_store.h"
+#include "../src/include/utils.h"
+#include "../src/include/db.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+
+#define TEST_STORE_PATH "/tmp/test_dashboard_series.bin"
+
+// Test utility functions
+void print_separator() {
+    printf("\n--------------------------------------------------\n");
+}
+
+void print_test_header(const char* test_name) {
+    print_separator();
+    printf("TEST: %s\n", test_name);
+    print_separator();
+}
+
+// Build a query result by hand; NULL cells are SQL NULL
+static PGresult* make_result(int columns, int rows, const char* const* cells) {
+    PGresult* res = PQmakeEmptyPGresult(NULL, PGRES_TUPLES_OK);
+    PGresAttDesc attrs[16];
+    memset(attrs, 0, sizeof(attrs));
+    for (int c = 0; c < columns; c++) {
+        attrs[c].name = "column";
+    }
+    assert(res != NULL && PQsetResultAttrs(res, columns, attrs));
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < columns; c++) {
+            const char* value = cells[r * columns + c];
+            assert(PQsetvalue(res, r, c, (char*) value, value ? (int) strlen(value) : -1));
+        }
+    }
+    return res;
+}
+
+// Publish a prediction for district 3, 2 rooms
+static void publish_prediction() {
+    const int months = 36;
+    price_history_row_t rows[36];
+    int base = month_index_from_ym(2022, 1);
+    for (int i = 0; i < months; i++) {
+        rows[i] = (price_history_row_t) { 3, 2, base + i, 1000.0 + 5.0 * i, 20 };
+    }
+    assert(series_store_build(TEST_STORE_PATH, rows, months, 1) == 0);
+    assert(series_store_open(TEST_STORE_PATH) == 0);
+    assert(prediction_job_run(NULL, 1) == 1);
+}
+
+// Test assembling the dashboard from the pipeline results
+void test_build() {
+    print_test_header("user_dashboard_build");
+
+    publish_prediction();
+
+    const char* user[] = { "7", "ana@example.com", "Ana", NULL, "f" };
+    const char* properties[] = {
+        "11", "Sunny flat", "Str. Dacia 1", "3", "Botanica", "1", "2", "50", "60000", "EUR", "active",
+        "2025-03-01", "2025-04-02T10:00:00", "https://img/11.jpg",
+        "12", "Old house", "Str. Alba 2", "5", NULL, "2", "4", "0", "90000", "EUR", "sold",
+        "2024-11-15", "2025-04-01T09:00:00", NULL
+    };
+    const char* searches[] = {
+        "4", "Botanica 2-Room", "{\"district_id\": 3, \"rooms\": 2}", "2025-04-20",
+        "5", NULL, "not json", "2025-04-21"
+    };
+    const char* notifications[] = {
+        "900", "4", "11", "new_listing", "2025-04-22T08:00:00", "31"
+    };
+    PGresult* results[DASHBOARD_QUERY_COUNT] = {
+        [DASHBOARD_QUERY_USER] = make_result(5, 1, user),
+        [DASHBOARD_QUERY_PROPERTIES] = make_result(14, 2, properties),
+        [DASHBOARD_QUERY_SEARCHES] = make_result(4, 2, searches),
+        [DASHBOARD_QUERY_NOTIFICATIONS] = make_result(6, 1, notifications)
+    };
+
+    user_writes_overlay_t none = { 0 };
+    json_t* dashboard = user_dashboard_build(results, &none);
+    assert(dashboard != NULL);
+    char* text = json_dumps(dashboard, JSON_COMPACT);
+    printf("%s\n", text);
+    free(text);
+
+    json_t* u = json_object_get(dashboard, "user");
+    assert(json_integer_value(json_object_get(u, "id")) == 7);
+    assert(json_is_null(json_object_get(u, "last_name")) && json_is_false(json_object_get(u, "is_admin")));
+
+    json_t* saved = json_object_get(dashboard, "saved_properties");
+    assert(json_array_size(saved) == 2);
+    json_t* flat = json_array_get(saved, 0);
+    assert(json_real_value(json_object_get(flat, "price_per_sqm")) == 1200.0);
+    json_t* prediction = json_object_get(flat, "prediction");
+    price_prediction_t expected;
+    assert(prediction_lookup(3, 2, &expected) == 0);
+    assert(json_is_object(prediction) && "Saved properties should carry their series' prediction");
+    assert(json_real_value(json_object_get(prediction, "prediction_12m")) == expected.prediction_12m);
+    double value = json_real_value(json_object_get(prediction, "estimated_value_12m"));
+    assert(fabs(value - 60000.0 * expected.prediction_12m / expected.current_avg_price) < 1e-6);
+    assert(value > 60000.0 && "A rising series should raise the estimate");
+
+    json_t* house = json_array_get(saved, 1);
+    assert(json_is_null(json_object_get(house, "prediction")) && "Series without a prediction get null");
+    assert(json_is_null(json_object_get(house, "district_name")) && json_is_null(json_object_get(house, "image_url")));
+    assert(json_real_value(json_object_get(house, "price_per_sqm")) == 0.0);
+
+    json_t* search_list = json_object_get(dashboard, "saved_searches");
+    assert(json_array_size(search_list) == 2);
+    json_t* filters = json_object_get(json_array_get(search_list, 0), "filters");
+    assert(json_integer_value(json_object_get(filters, "rooms")) == 2);
+    assert(json_object_size(json_object_get(json_array_get(search_list, 1), "filters")) == 0 &&
+           "Unparseable filters should become an empty object");
+
+    json_t* alerts = json_object_get(dashboard, "notifications");
+    assert(json_integer_value(json_object_get(alerts, "unread")) == 31 &&
+           json_array_size(json_object_get(alerts, "recent")) == 1);
+    json_decref(dashboard);
+
+    // Unknown users have no dashboard; empty lists are fine
+    PQclear(results[DASHBOARD_QUERY_USER]);
+    results[DASHBOARD_QUERY_USER] = make_result(5, 0, user);
+    assert(user_dashboard_build(results, &none) == NULL);
+    PQclear(results[DASHBOARD_QUERY_USER]);
+    PQclear(results[DASHBOARD_QUERY_NOTIFICATIONS]);
+    results[DASHBOARD_QUERY_USER] = make_result(5, 1, user);
+    results[DASHBOARD_QUERY_NOTIFICATIONS] = make_result(6, 0, notifications);
+    dashboard = user_dashboard_build(results, &none);
+    assert(json_integer_value(json_object_get(json_object_get(dashboard, "notifications"), "unread")) == 0);
+    json_decref(dashboard);
+
+    // Pending writes: property 11 removed, search 4 deleted, search 6 created
+    int ids[] = { 6 };
+    assert(user_writes_add_ids(ids, 1) == 1);
+    assert(user_writes_unsave_property(7, 11) == USER_WRITES_OK);
+    assert(user_writes_delete_search(7, 4) == USER_WRITES_OK);
+    assert(user_writes_create_search(7, "Centru", "{\"district_id\": 2}", NULL) == USER_WRITES_OK);
+    user_writes_overlay_t overlay;
+    assert(user_writes_overlay(7, &overlay) == 0);
+    dashboard = user_dashboard_build(results, &overlay);
+    user_writes_overlay_free(&overlay);
+    saved = json_object_get(dashboard, "saved_properties");
+    assert(json_array_size(saved) == 1 && json_integer_value(json_object_get(json_array_get(saved, 0), "id")) == 12 &&
+           "Removed properties should disappear before the removal is written");
+    search_list = json_object_get(dashboard, "saved_searches");
+    assert(json_array_size(search_list) == 2);
+    assert(json_integer_value(json_object_get(json_array_get(search_list, 0), "id")) == 6 &&
+           "New searches should show up before they are written");
+    assert(json_integer_value(json_object_get(json_array_get(search_list, 1), "id")) == 5);
+    json_decref(dashboard);
+
+    for (int i = 0; i < DASHBOARD_QUERY_COUNT; i++) {
+        PQclear(results[i]);
+    }
+    remove(TEST_STORE_PATH);
+    printf("Test passed!\n");
+}
+
+// Test that a pipeline on a dead connection fails cleanly
+void test_pipeline_failure() {
+    print_test_header("db_pipeline (no server)");
+
+    PGconn* conn = PQconnectdb("host=/nonexistent connect_timeout=1");
+    assert(PQstatus(conn) != CONNECTION_OK);
+    assert(user_dashboard_get(conn, 7) == NULL);
+    PQfinish(conn);
+    printf("Test passed!\n");
+}
+
+// Main test function
+int main() {
+    printf("Starting user dashboard tests...\n");
+
+    test_build();
+    test_pipeline_failure();
+
+    print_separator();
+    printf("All tests passed!\n");
+    return 0;
+}
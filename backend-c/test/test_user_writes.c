@@ -0,0 +1,238 @@
+#include "../src/include/user_writes.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <pthread.h>
+
+#define LOAD_THREADS 8
+#define LOAD_MUTATIONS 50000     // Per thread
+#define LOAD_USERS 1000
+#define LOAD_PROPERTIES 20       // Per user
+
+// Test utility functions
+void print_separator() {
+    printf("\n--------------------------------------------------\n");
+}
+
+void print_test_header(const char* test_name) {
+    print_separator();
+    printf("TEST: %s\n", test_name);
+    print_separator();
+}
+
+static double elapsed_us(struct timespec start, struct timespec end) {
+    return (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3;
+}
+
+// Fake database: records what each batch would write
+typedef struct {
+    int fail;
+    int batches;
+    size_t saves, unsaves, creates, deletes;
+    int last_save_user, last_save_property;
+    int last_create_id;
+    char last_create_name[64];
+    void (*during_write)(void);   // Simulates requests arriving while a batch is in flight
+} fake_db_t;
+
+static int fake_writer(const user_writes_batch_t* batch, void* ctx) {
+    fake_db_t* db = ctx;
+    if (db->during_write != NULL) {
+        db->during_write();
+    }
+    if (db->fail) {
+        return 1;
+    }
+    db->batches++;
+    db->saves += batch->save_count;
+    db->unsaves += batch->unsave_count;
+    db->creates += batch->create_count;
+    db->deletes += batch->delete_count;
+    if (batch->save_count > 0) {
+        db->last_save_user = batch->save_users[batch->save_count - 1];
+        db->last_save_property = batch->save_properties[batch->save_count - 1];
+    }
+    if (batch->create_count > 0) {
+        db->last_create_id = batch->created_searches[0].id;
+        snprintf(db->last_create_name, sizeof(db->last_create_name), "%s",
+                 batch->created_searches[0].name ? batch->created_searches[0].name : "");
+    }
+    return 0;
+}
+
+static size_t pending() {
+    user_writes_stats_t stats;
+    user_writes_get_stats(&stats);
+    return stats.pending;
+}
+
+// Test coalescing, cancelling and the read-your-writes overlay
+void test_coalescing() {
+    print_test_header("user_writes (coalescing, overlay)");
+
+    // Rapid toggles of one property leave a single pending mutation
+    assert(user_writes_save_property(1, 10) == USER_WRITES_OK);
+    assert(user_writes_unsave_property(1, 10) == USER_WRITES_OK);
+    assert(user_writes_save_property(1, 10) == USER_WRITES_OK);
+    assert(user_writes_unsave_property(1, 10) == USER_WRITES_OK);
+    assert(user_writes_save_property(1, 10) == USER_WRITES_OK);
+    assert(user_writes_unsave_property(1, 11) == USER_WRITES_OK);
+    assert(pending() == 2);
+
+    // Saved searches need reserved ids
+    user_search_row_t search;
+    assert(user_writes_create_search(1, "Botanica", "{\"district_id\":1}", &search) == USER_WRITES_ERR_NO_IDS);
+    int ids[] = { 100, 101, 102 };
+    assert(user_writes_add_ids(ids, 3) == 3);
+    assert(user_writes_create_search(1, "Botanica", "{\"district_id\":1}", &search) == USER_WRITES_OK);
+    assert(search.id == 100 && strcmp(search.params, "{\"district_id\":1}") == 0);
+    user_writes_free_search_row(&search);
+    assert(user_writes_create_search(1, NULL, "{}", NULL) == USER_WRITES_OK);
+    assert(user_writes_delete_search(1, 7) == USER_WRITES_OK);
+
+    user_writes_overlay_t overlay;
+    assert(user_writes_overlay(1, &overlay) == 0);
+    assert(overlay.saved_count == 1 && overlay.saved_properties[0] == 10);
+    assert(overlay.unsaved_count == 1 && overlay.unsaved_properties[0] == 11);
+    assert(overlay.created_count == 2 && overlay.created_searches[0].id == 100 &&
+           overlay.created_searches[1].id == 101 && overlay.created_searches[1].name == NULL);
+    assert(overlay.deleted_count == 1 && overlay.deleted_searches[0] == 7);
+    user_writes_overlay_free(&overlay);
+    assert(user_writes_overlay(2, &overlay) == 0 && overlay.saved_count == 0 && overlay.created_count == 0);
+    user_writes_overlay_free(&overlay);
+
+    // Deleting a search that was never written cancels it
+    assert(user_writes_delete_search(1, 101) == USER_WRITES_OK);
+    assert(pending() == 4);
+
+    // A failed flush keeps everything pending and visible
+    fake_db_t db = { .fail = 1 };
+    assert(user_writes_flush_with(fake_writer, &db) == -1);
+    assert(pending() == 4);
+
+    db.fail = 0;
+    assert(user_writes_flush_with(fake_writer, &db) == 4);
+    assert(db.batches == 1 && db.saves == 1 && db.unsaves == 1 && db.creates == 1 && db.deletes == 1);
+    assert(db.last_save_user == 1 && db.last_save_property == 10);
+    assert(db.last_create_id == 100 && strcmp(db.last_create_name, "Botanica") == 0);
+    assert(pending() == 0 && user_writes_flush_with(fake_writer, &db) == 0 && db.batches == 1);
+
+    user_writes_stats_t stats;
+    user_writes_get_stats(&stats);
+    printf("mutations %llu, coalesced %llu, flushes %llu, rows %llu, failed %llu\n",
+           (unsigned long long) stats.mutations, (unsigned long long) stats.coalesced,
+           (unsigned long long) stats.flushes, (unsigned long long) stats.rows_written,
+           (unsigned long long) stats.failed_flushes);
+    assert(stats.mutations == 10 && stats.coalesced == 5 && stats.flushes == 1 && stats.rows_written == 4 &&
+           stats.failed_flushes == 1 && stats.reserved_ids == 1);
+    printf("Test passed!\n");
+}
+
+static void toggle_during_write(void) {
+    assert(user_writes_unsave_property(5, 50) == USER_WRITES_OK);
+    assert(user_writes_delete_search(5, 102) == USER_WRITES_OK);
+}
+
+// Test mutations that arrive while their key is being written
+void test_in_flight() {
+    print_test_header("user_writes (mutations during a flush)");
+
+    assert(user_writes_save_property(5, 50) == USER_WRITES_OK);
+    assert(user_writes_create_search(5, "Centru", "{}", NULL) == USER_WRITES_OK);
+
+    // The batch carries the save and the create; the unsave and the delete
+    // arrive while it is written and must survive its commit
+    fake_db_t db = { .during_write = toggle_during_write };
+    assert(user_writes_flush_with(fake_writer, &db) == 2);
+    assert(db.saves == 1 && db.creates == 1);
+
+    user_writes_overlay_t overlay;
+    assert(user_writes_overlay(5, &overlay) == 0);
+    assert(overlay.saved_count == 0 && overlay.unsaved_count == 1 && overlay.unsaved_properties[0] == 50);
+    assert(overlay.created_count == 0 && overlay.deleted_count == 1 && overlay.deleted_searches[0] == 102 &&
+           "A search already sent to the database must be deleted there");
+    user_writes_overlay_free(&overlay);
+
+    fake_db_t next = { 0 };
+    assert(user_writes_flush_with(fake_writer, &next) == 2);
+    assert(next.unsaves == 1 && next.deletes == 1 && pending() == 0);
+    printf("Test passed!\n");
+}
+
+static void* toggle_thread(void* arg) {
+    unsigned int seed = (unsigned int) (size_t) arg;
+    for (int i = 0; i < LOAD_MUTATIONS; i++) {
+        int user = 1 + rand_r(&seed) % LOAD_USERS;
+        int property = 1 + rand_r(&seed) % LOAD_PROPERTIES;
+        int rc = rand_r(&seed) % 2 ? user_writes_save_property(user, property)
+                                   : user_writes_unsave_property(user, property);
+        assert(rc == USER_WRITES_OK);
+    }
+    return NULL;
+}
+
+// Test that concurrent toggling collapses into a few multi-row batches
+void test_load() {
+    print_test_header("user_writes (concurrent toggles, batching)");
+
+    user_writes_stats_t before;
+    user_writes_get_stats(&before);
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pthread_t threads[LOAD_THREADS];
+    for (size_t t = 0; t < LOAD_THREADS; t++) {
+        pthread_create(&threads[t], NULL, toggle_thread, (void*) (t + 1));
+    }
+    for (int t = 0; t < LOAD_THREADS; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double us = elapsed_us(start, end);
+
+    fake_db_t db = { 0 };
+    long written = user_writes_flush_with(fake_writer, &db);
+    user_writes_stats_t after;
+    user_writes_get_stats(&after);
+    long total = (long) LOAD_THREADS * LOAD_MUTATIONS;
+    printf("%ld mutations in %.1f ms (%.0f/s) -> %ld rows in %d transactions\n",
+           total, us / 1000.0, total / (us / 1e6), written, db.batches);
+    assert(written > 0 && written <= LOAD_USERS * LOAD_PROPERTIES && "Each key is written at most once");
+    assert(db.batches <= (LOAD_USERS * LOAD_PROPERTIES) / USER_WRITES_FLUSH_BATCH + 1);
+    assert(after.coalesced - before.coalesced == (uint64_t) (total - written));
+    assert(pending() == 0);
+    printf("Test passed!\n");
+}
+
+// Test that the queue turns callers away when it is full
+void test_backpressure() {
+    print_test_header("user_writes (bounded queue)");
+
+    for (int i = 0; i < USER_WRITES_MAX_PENDING; i++) {
+        assert(user_writes_save_property(1 + i / 64, 1 + i % 64) == USER_WRITES_OK);
+    }
+    assert(user_writes_save_property(999999, 1) == USER_WRITES_ERR_BUSY);
+    assert(user_writes_unsave_property(1, 1) == USER_WRITES_OK && "Coalescing needs no new slot");
+
+    // Shutdown without a database reports what could not be written
+    assert(user_writes_shutdown() == USER_WRITES_MAX_PENDING);
+    fake_db_t db = { 0 };
+    assert(user_writes_flush_with(fake_writer, &db) == USER_WRITES_MAX_PENDING);
+    assert(db.batches == USER_WRITES_MAX_PENDING / USER_WRITES_FLUSH_BATCH && pending() == 0);
+    printf("Test passed!\n");
+}
+
+// Main test function
+int main() {
+    printf("Starting write-behind tests...\n");
+
+    test_coalescing();
+    test_in_flight();
+    test_load();
+    test_backpressure();
+
+    print_separator();
+    printf("All tests passed!\n");
+    return 0;
+}
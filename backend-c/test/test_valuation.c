@@ -0,0 +1,175 @@
+#include "../src/include/valuation.h"
+#include "../src/include/properties.h"
+#include "../src/include/rng.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <time.h>
+
+#define LISTINGS 20000
+
+// Test utility functions
+void print_separator() {
+    printf("\n--------------------------------------------------\n");
+}
+
+void print_test_header(const char* test_name) {
+    print_separator();
+    printf("TEST: %s\n", test_name);
+    print_separator();
+}
+
+static double elapsed_us(struct timespec start, struct timespec end) {
+    return (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3;
+}
+
+// Known hedonic model: log price = 7 + log(area) + 0.25 in district 2
+// - 0.05 on the ground floor + 0.08 with feature 1, plus noise
+static double true_log_price(const property_t* p) {
+    return 7.0 + log((double) p->area_sqm) + (p->district_id == 2 ? 0.25 : 0.0) -
+           (p->floor == 1 ? 0.05 : 0.0) + ((p->features & 1u) ? 0.08 : 0.0);
+}
+
+static void generate_listings(property_t* listings, int count, uint64_t seed) {
+    rng_t rng;
+    rng_seed(&rng, seed);
+    for (int i = 0; i < count; i++) {
+        property_t* p = &listings[i];
+        memset(p, 0, sizeof(*p));
+        p->id = i + 1;
+        p->district_id = 1 + (int) rng_below(&rng, 5);
+        p->type_id = 1;
+        p->num_rooms = 1 + (int) rng_below(&rng, 4);
+        p->area_sqm = 25 + 20 * p->num_rooms + (int) rng_below(&rng, 20);
+        p->total_floors = 5 + (int) rng_below(&rng, 10);
+        p->floor = 1 + (int) rng_below(&rng, (uint32_t) p->total_floors);
+        p->year_built = 1960 + (int) rng_below(&rng, 60);
+        p->features = rng_below(&rng, 2) | ((uint64_t) rng_below(&rng, 2) << 3);
+        p->status = PROPERTY_STATUS_ACTIVE;
+        p->price = (int) exp(true_log_price(p) + 0.05 * rng_gaussian(&rng));
+    }
+}
+
+// Test training recovers the known model
+void test_train() {
+    print_test_header("valuation_train");
+
+    property_t* listings = malloc(sizeof(property_t) * LISTINGS);
+    generate_listings(listings, LISTINGS, 3);
+    assert(properties_ingest(listings, LISTINGS) == 0 && "Ingest should succeed");
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    assert(valuation_train(4) == 0 && "Training should succeed");
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    valuation_stats_t stats;
+    valuation_get_stats(&stats);
+    printf("Trained on %ld listings in %.1f ms: residual sd %.4f, R^2 %.3f\n",
+           stats.samples, elapsed_us(start, end) / 1000.0, stats.residual_sd, stats.r_squared);
+    assert(stats.samples == LISTINGS && "Every listing should be used");
+    assert(fabs(stats.residual_sd - 0.05) < 0.005 && "Residual sd should match the noise");
+
+    // Same listing in district 2 and district 1: ratio should be e^0.25
+    property_t a = listings[0];
+    property_t b = a;
+    a.district_id = 2;
+    b.district_id = 1;
+    valuation_t va, vb;
+    assert(valuation_estimate(&a, 1, &va) == 0 && valuation_estimate(&b, 1, &vb) == 0);
+    double ratio = va.estimated_price / vb.estimated_price;
+    printf("District premium: %.4f (expected %.4f)\n", ratio, exp(0.25));
+    assert(fabs(ratio - exp(0.25)) < 0.01 && "District premium should be recovered");
+
+    free(listings);
+    printf("Test passed!\n");
+}
+
+// Test that ingest-time rank-one updates match a full retrain
+void test_incremental_update() {
+    print_test_header("valuation_update (incremental)");
+
+    property_t changed[100];
+    for (int i = 0; i < 100; i++) {
+        assert(properties_find(i + 1, &changed[i]) == 0);
+        changed[i].price *= 2;   // Doubling moves log price by ln 2
+    }
+    property_t fresh[50];
+    generate_listings(fresh, 50, 99);
+    for (int i = 0; i < 50; i++) {
+        fresh[i].id = LISTINGS + i + 1;
+    }
+    assert(properties_ingest(changed, 100) == 0 && properties_ingest(fresh, 50) == 0);
+
+    valuation_stats_t stats;
+    valuation_get_stats(&stats);
+    assert(stats.stale && "Ingest should mark the model stale");
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    assert(valuation_update() == 1 && "Model should be re-solved");
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    assert(valuation_update() == 0 && "A current model should not be re-solved");
+    valuation_get_stats(&stats);
+    printf("Re-solved in %.1f us on %ld listings\n", elapsed_us(start, end), stats.samples);
+    assert(stats.samples == LISTINGS + 50 && "New listings should be added");
+
+    valuation_t incremental, retrained;
+    assert(valuation_estimate(&fresh[0], 1, &incremental) == 0);
+    assert(valuation_train(1) == 0);
+    assert(valuation_estimate(&fresh[0], 1, &retrained) == 0);
+    printf("Incremental %.4f vs retrained %.4f\n", incremental.estimated_price, retrained.estimated_price);
+    assert(fabs(incremental.estimated_price / retrained.estimated_price - 1.0) < 1e-9 &&
+           "Incremental update should match a full retrain");
+
+    printf("Test passed!\n");
+}
+
+// Test scoring a result page
+void test_estimate_page() {
+    print_test_header("valuation_estimate (result page)");
+
+    property_t page[20];
+    for (int i = 0; i < 20; i++) {
+        assert(properties_find(1000 + i, &page[i]) == 0);
+    }
+    page[0].price = (int) (exp(true_log_price(&page[0])) * 0.7);
+    page[1].price = (int) (exp(true_log_price(&page[1])) * 1.4);
+
+    valuation_t valuations[20];
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    assert(valuation_estimate(page, 20, valuations) == 0);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("Valued 20 listings in %.2f us\n", elapsed_us(start, end));
+
+    for (int i = 0; i < 20; i++) {
+        assert(valuations[i].low < valuations[i].estimated_price &&
+               valuations[i].estimated_price < valuations[i].high && "Range should contain the estimate");
+    }
+    assert(strcmp(valuations[0].verdict, "undervalued") == 0 && "Cheap listing should be undervalued");
+    assert(strcmp(valuations[1].verdict, "overvalued") == 0 && "Expensive listing should be overvalued");
+
+    json_t* json = valuation_get_handler(1005);
+    assert(json != NULL && json_object_get(json, "verdict") != NULL && "Handler should return a valuation");
+    json_decref(json);
+    assert(valuation_get_handler(999999) == NULL && "Unknown listings should not be valued");
+
+    printf("Test passed!\n");
+}
+
+// Main test function
+int main() {
+    printf("Starting valuation module tests...\n");
+
+    valuation_init();
+    test_train();
+    test_incremental_update();
+    test_estimate_page();
+
+    print_separator();
+    printf("All tests passed!\n");
+    return 0;
+}